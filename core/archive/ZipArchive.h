@@ -30,6 +30,7 @@ public:
 
 	ArchiveFile* OpenFile(const char* name) override;
 	ArchiveFile* OpenFileByCrc(u32 crc) override;
+	bool independentFiles() const override { return true; }
 
 	bool Open(const void *data, size_t size);
 	ArchiveFile *OpenFirstFile();
@@ -36,6 +36,8 @@ public:
 	virtual ~Archive() = default;
 	virtual ArchiveFile *OpenFile(const char *name) = 0;
 	virtual ArchiveFile *OpenFileByCrc(u32 crc) = 0;
+	// Files can be extracted concurrently using one Archive instance per thread
+	virtual bool independentFiles() const { return false; }
 
 protected:
 	virtual bool Open(FILE *file) = 0;
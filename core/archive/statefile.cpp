@@ -0,0 +1,253 @@
+/*
+	Copyright 2024 flyinghead
+
+	This file is part of Flycast.
+
+    Flycast is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    Flycast is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Flycast.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include "statefile.h"
+#include <zlib.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <future>
+#include <thread>
+
+namespace statefile
+{
+
+const u8 Magic[8] = { 'F', 'C', 'S', 'T', 'A', 'T', 'E', '#' };
+constexpr u32 FormatVersion = 1;
+constexpr u32 BlockSize = 1_MB;
+
+enum Compression : u32 {
+	Stored,
+	Zlib
+};
+
+struct Header
+{
+	u8 magic[8];
+	u32 version;
+	u32 blockCount;
+	u64 size;		// uncompressed stream size
+};
+
+struct Block
+{
+	u32 section;
+	u32 compression;
+	u64 offset;		// in the uncompressed stream
+	u32 size;
+	u32 compressedSize;
+	u64 fileOffset;
+};
+
+// Runs task(i) for i in [0, count) on all available cores. Returns false if any task failed.
+template<typename F>
+static bool parallelFor(size_t count, F task)
+{
+	std::atomic<size_t> next { 0 };
+	std::atomic<bool> failed { false };
+	auto worker = [&]() {
+		for (size_t i = next++; i < count && !failed; i = next++)
+			if (!task(i))
+				failed = true;
+	};
+	size_t threadCount = std::min<size_t>(std::max(std::thread::hardware_concurrency(), 1u), count);
+	std::vector<std::future<void>> workers;
+	for (size_t i = 1; i < threadCount; i++)
+		workers.push_back(std::async(std::launch::async, worker));
+	worker();
+	for (auto& w : workers)
+		w.get();
+
+	return !failed;
+}
+
+static bool readHeader(FILE *file, Header& header, std::vector<Block>& blocks)
+{
+	std::fseek(file, 0, SEEK_SET);
+	if (std::fread(&header, sizeof(header), 1, file) != 1
+			|| memcmp(header.magic, Magic, sizeof(Magic))
+			|| header.version != FormatVersion
+			|| header.blockCount > header.size / 1024 + 64)
+		return false;
+	blocks.resize(header.blockCount);
+	if (header.blockCount != 0
+			&& std::fread(blocks.data(), sizeof(Block), blocks.size(), file) != blocks.size())
+		return false;
+	// blocks must cover the whole stream in order
+	u64 offset = 0;
+	for (const Block& block : blocks)
+	{
+		if (block.offset != offset || block.size > BlockSize
+				|| (block.compression == Stored && block.compressedSize != block.size)
+				|| block.compression > Zlib)
+			return false;
+		offset += block.size;
+	}
+	return offset == header.size;
+}
+
+bool isStateFile(FILE *file)
+{
+	u8 magic[sizeof(Magic)];
+	std::fseek(file, 0, SEEK_SET);
+	bool rc = std::fread(magic, sizeof(magic), 1, file) == 1 && !memcmp(magic, Magic, sizeof(magic));
+	std::fseek(file, 0, SEEK_SET);
+	return rc;
+}
+
+bool save(const std::string& path, const u8 *data, size_t size, const std::vector<Serializer::SectionMark>& sections)
+{
+	// Cut the stream into sections and blocks
+	std::vector<Block> blocks;
+	auto addBlocks = [&blocks](Serializer::Section section, u64 offset, u64 size) {
+		for (u64 end = offset + size; offset < end; offset += BlockSize)
+		{
+			Block block{};
+			block.section = (u32)section;
+			block.offset = offset;
+			block.size = (u32)std::min<u64>(BlockSize, end - offset);
+			blocks.push_back(block);
+		}
+	};
+	std::vector<Serializer::SectionMark> marks = sections;
+	std::sort(marks.begin(), marks.end(), [](const Serializer::SectionMark& a, const Serializer::SectionMark& b) {
+		return a.offset < b.offset;
+	});
+	size_t offset = 0;
+	for (const Serializer::SectionMark& mark : marks)
+	{
+		verify(mark.offset >= offset && mark.offset + mark.size <= size);
+		addBlocks(Serializer::Section::Devices, offset, mark.offset - offset);
+		addBlocks(mark.section, mark.offset, mark.size);
+		offset = mark.offset + mark.size;
+	}
+	addBlocks(Serializer::Section::Devices, offset, size - offset);
+
+	std::vector<std::vector<u8>> compressed(blocks.size());
+	parallelFor(blocks.size(), [&](size_t i) {
+		Block& block = blocks[i];
+		uLongf zippedSize = compressBound(block.size);
+		compressed[i].resize(zippedSize);
+		if (compress(compressed[i].data(), &zippedSize, data + block.offset, block.size) == Z_OK
+				&& zippedSize < block.size)
+		{
+			block.compression = Zlib;
+			block.compressedSize = (u32)zippedSize;
+			compressed[i].resize(zippedSize);
+		}
+		else
+		{
+			// incompressible
+			block.compression = Stored;
+			block.compressedSize = block.size;
+			compressed[i].clear();
+		}
+		return true;
+	});
+
+	Header header{};
+	memcpy(header.magic, Magic, sizeof(Magic));
+	header.version = FormatVersion;
+	header.blockCount = (u32)blocks.size();
+	header.size = size;
+	u64 fileOffset = sizeof(Header) + blocks.size() * sizeof(Block);
+	for (Block& block : blocks)
+	{
+		block.fileOffset = fileOffset;
+		fileOffset += block.compressedSize;
+	}
+
+	FILE *file = nowide::fopen(path.c_str(), "wb");
+	if (file == nullptr)
+		return false;
+	bool rc = std::fwrite(&header, sizeof(header), 1, file) == 1
+			&& (blocks.empty() || std::fwrite(blocks.data(), sizeof(Block), blocks.size(), file) == blocks.size());
+	for (size_t i = 0; i < blocks.size() && rc; i++)
+	{
+		if (blocks[i].compression == Stored)
+			rc = std::fwrite(data + blocks[i].offset, blocks[i].size, 1, file) == 1;
+		else
+			rc = std::fwrite(compressed[i].data(), compressed[i].size(), 1, file) == 1;
+	}
+	rc = std::fclose(file) == 0 && rc;
+
+	return rc;
+}
+
+// Reads the given blocks and decompresses them to dest, one after the other
+static bool loadBlocks(FILE *file, const std::vector<Block>& blocks, u8 *dest)
+{
+	std::vector<std::vector<u8>> compressed(blocks.size());
+	std::vector<u8 *> outputs(blocks.size());
+	for (size_t i = 0; i < blocks.size(); i++)
+	{
+		const Block& block = blocks[i];
+		outputs[i] = dest;
+		dest += block.size;
+		if (block.compressedSize == 0)
+			continue;
+		compressed[i].resize(block.compressedSize);
+		if (std::fseek(file, (long)block.fileOffset, SEEK_SET) != 0
+				|| std::fread(compressed[i].data(), block.compressedSize, 1, file) != 1)
+			return false;
+	}
+	return parallelFor(blocks.size(), [&](size_t i) {
+		const Block& block = blocks[i];
+		if (block.compression == Stored)
+		{
+			memcpy(outputs[i], compressed[i].data(), block.size);
+			return true;
+		}
+		uLongf size = block.size;
+		return uncompress(outputs[i], &size, compressed[i].data(), block.compressedSize) == Z_OK
+				&& size == block.size;
+	});
+}
+
+bool load(FILE *file, std::vector<u8>& data)
+{
+	Header header;
+	std::vector<Block> blocks;
+	if (!readHeader(file, header, blocks))
+		return false;
+	data.resize(header.size);
+
+	return loadBlocks(file, blocks, data.data());
+}
+
+bool loadSection(FILE *file, Serializer::Section section, std::vector<u8>& data)
+{
+	Header header;
+	std::vector<Block> blocks;
+	if (!readHeader(file, header, blocks))
+		return false;
+	blocks.erase(std::remove_if(blocks.begin(), blocks.end(), [section](const Block& block) {
+		return block.section != (u32)section;
+	}), blocks.end());
+	if (blocks.empty())
+		return false;
+	size_t size = 0;
+	for (const Block& block : blocks)
+		size += block.size;
+	data.resize(size);
+
+	return loadBlocks(file, blocks, data.data());
+}
+
+}
@@ -0,0 +1,45 @@
+/*
+	Copyright 2024 flyinghead
+
+	This file is part of Flycast.
+
+    Flycast is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    Flycast is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Flycast.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#pragma once
+#include "types.h"
+#include "serialize.h"
+
+#include <cstdio>
+#include <vector>
+
+//
+// Sectioned savestate file.
+// The savestate stream is cut into the sections marked by the serializer
+// (RAM, VRAM, ARAM, TA context) and the device state in between.
+// Each piece is split into blocks of at most 1 MB that are compressed independently and in parallel.
+// The table of contents following the header gives the type and position of each block
+// so that a section can be read without decompressing the rest of the file.
+//
+namespace statefile
+{
+
+// Returns true if the file is a sectioned savestate
+bool isStateFile(FILE *file);
+bool save(const std::string& path, const u8 *data, size_t size, const std::vector<Serializer::SectionMark>& sections);
+// Decompresses the whole savestate stream
+bool load(FILE *file, std::vector<u8>& data);
+// Decompresses the content of one section. Returns false if the section isn't present.
+bool loadSection(FILE *file, Serializer::Section section, std::vector<u8>& data);
+
+}
@@ -7,6 +7,8 @@
 
 #include "cfg/cfg.h"
 #include "stdclass.h"
+#include "log/LogTrace.h"
+#include "replay.h"
 
 static int setconfig(char *arg[], int cl)
 {
@@ -80,12 +82,60 @@ static int showhelp()
 	printf("-config	section:key=value     add a virtual config value;\n");
 	printf("                              virtual config values won't be saved to the .cfg file\n");
 	printf("                              unless a different value is written to them\n");
+	printf("-decodetrace file             convert a binary log trace to text and exit\n");
+	printf("-record file                  record the inputs of the session to a replay file\n");
+	printf("-replay file                  play back a replay file at full speed and exit\n");
 	printf("-help                         display this help\n");
 
 	exit(0);
 	return 0;
 }
 
+static int decodetrace(char *arg[], int cl)
+{
+	if (cl < 1)
+	{
+		WARN_LOG(COMMON, "-decodetrace : missing trace file name");
+		return 0;
+	}
+	if (!logtrace::decodeLogTrace(arg[1], stdout))
+	{
+		fprintf(stderr, "Can't read log trace file %s\n", arg[1]);
+		exit(1);
+	}
+	exit(0);
+	return 1;
+}
+
+static std::string replayPath;
+
+static int record(char *arg[], int cl)
+{
+	if (cl < 1)
+	{
+		WARN_LOG(COMMON, "-record : missing replay file name");
+		return 0;
+	}
+	replay::requestRecording(arg[1]);
+	return 1;
+}
+
+static int playReplay(char *arg[], int cl)
+{
+	if (cl < 1)
+	{
+		WARN_LOG(COMMON, "-replay : missing replay file name");
+		return 0;
+	}
+	replayPath = replay::requestPlayback(arg[1]);
+	if (replayPath.empty())
+	{
+		fprintf(stderr, "Can't read replay file %s\n", arg[1]);
+		exit(1);
+	}
+	return 1;
+}
+
 void ParseCommandLine(int argc,char* argv[])
 {
 	settings.content.path.clear();
@@ -103,6 +153,24 @@ void ParseCommandLine(int argc,char* argv[])
 			cl-=as;
 			arg+=as;
 		}
+		else if (stricmp(*arg,"-decodetrace")==0 || stricmp(*arg,"--decodetrace")==0)
+		{
+			int as=decodetrace(arg,cl);
+			cl-=as;
+			arg+=as;
+		}
+		else if (stricmp(*arg,"-record")==0 || stricmp(*arg,"--record")==0)
+		{
+			int as=record(arg,cl);
+			cl-=as;
+			arg+=as;
+		}
+		else if (stricmp(*arg,"-replay")==0 || stricmp(*arg,"--replay")==0)
+		{
+			int as=playReplay(arg,cl);
+			cl-=as;
+			arg+=as;
+		}
 #if defined(__APPLE__)
 		else if (!strncmp(*arg, "-NSDocumentRevisions", 20))
 		{
@@ -140,4 +208,7 @@ void ParseCommandLine(int argc,char* argv[])
 		arg++;
 		cl--;
 	}
+	// Play back the recorded game unless another one is given
+	if (!replayPath.empty() && settings.content.path.empty())
+		settings.content.path = replayPath;
 }
@@ -26,6 +26,10 @@ namespace config {
 
 Option<bool> DynarecEnabled("Dynarec.Enabled", true);
 Option<int> Sh4Clock("Sh4Clock", 200);
+Option<bool> IdleLoopSkip("Dynarec.IdleSkip", false);
+Option<bool> MmuShadowPages("Dynarec.MmuShadowPages", false);
+Option<bool> DynarecBlockCounters("Dynarec.BlockCounters", false);
+Option<bool> DynarecPerfMap("Dynarec.PerfMap", false);
 
 // General
 
@@ -75,6 +79,7 @@ Option<int> TextureUpscale("rend.TextureUpscale", 1);
 Option<int> MaxFilteredTextureSize("rend.MaxFilteredTextureSize", 256);
 Option<float> ExtraDepthScale("rend.ExtraDepthScale", 1.f);
 Option<bool> CustomTextures("rend.CustomTextures");
+Option<bool> PackCustomTextures("rend.PackCustomTextures");
 Option<bool> DumpTextures("rend.DumpTextures");
 Option<int> ScreenStretching("rend.ScreenStretching", 100);
 Option<bool> Fog("rend.Fog", true);
@@ -123,6 +128,10 @@ Option<int> GDBPort("Debug.GDBPort", debugger::DEFAULT_PORT);
 Option<bool> GDBWaitForConnection("Debug.GDBWaitForConnection");
 Option<bool> UseReios("UseReios");
 Option<bool> FastGDRomLoad("FastGDRomLoad", false);
+Option<bool> NaomiRomCache("NaomiRomCache", false);
+Option<bool> NaomiDecryptCache("NaomiDecryptCache", true);
+Option<bool> NaomiPredecrypt("NaomiPredecrypt", false);
+Option<bool> SectionedSavestates("SectionedSavestates", true);
 Option<bool> RamMod32MB("Dreamcast.RamMod32MB", false);
 
 Option<bool> OpenGlChecks("OpenGlChecks", false, "validate");
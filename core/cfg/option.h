@@ -356,6 +356,12 @@ using OptionString = Option<std::string>;
 // Dynarec
 
 extern Option<bool> DynarecEnabled;
+extern Option<bool> IdleLoopSkip;
+extern Option<bool> MmuShadowPages;
+// Per-block execution counters and hot block report
+extern Option<bool> DynarecBlockCounters;
+// Symbol export for Linux perf
+extern Option<bool> DynarecPerfMap;
 #ifndef LIBRETRO
 extern Option<int> Sh4Clock;
 #endif
@@ -451,6 +457,7 @@ extern Option<int> PerPixelLayers;
 #endif
 extern Option<float> ExtraDepthScale;
 extern Option<bool> CustomTextures;
+extern Option<bool> PackCustomTextures;
 extern Option<bool> DumpTextures;
 extern Option<int> ScreenStretching;	// in percent. 150 means stretch from 4/3 to 6/3
 extern Option<bool> Fog;
@@ -489,6 +496,10 @@ extern Option<int> GDBPort;
 extern Option<bool> GDBWaitForConnection;
 extern Option<bool> UseReios;
 extern Option<bool> FastGDRomLoad;
+extern Option<bool> NaomiRomCache;
+extern Option<bool> NaomiDecryptCache;
+extern Option<bool> NaomiPredecrypt;
+extern Option<bool> SectionedSavestates;
 extern Option<bool> RamMod32MB;
 
 extern Option<bool> OpenGlChecks;
@@ -0,0 +1,437 @@
+/*
+	Copyright 2024 flyinghead
+
+	This file is part of Flycast.
+
+    Flycast is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    Flycast is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Flycast.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "cheat_search.h"
+#include "hw/sh4/sh4_mem.h"
+#include "hw/aica/aica_if.h"
+#include "log/BitSet.h"
+#include "oslib/oslib.h"
+
+#include <cstring>
+
+#if HOST_CPU == CPU_X64 || (HOST_CPU == CPU_X86 && (defined(__SSE2__) || _M_IX86_FP >= 2))
+#include <emmintrin.h>
+#define SEARCH_SSE2
+#elif HOST_CPU == CPU_ARM64
+#include <arm_neon.h>
+#define SEARCH_NEON
+#endif
+
+CheatSearch cheatSearch;
+
+namespace
+{
+
+// Vector operations on the values of a memory word.
+// eq() and gt() return a bitmask with one bit per lane. gt() is unsigned for integers.
+template<typename T>
+struct Vec
+{
+	using V = T;
+	static constexpr unsigned Count = 1;
+
+	static V load(const T *p) { return *p; }
+	static V splat(T v) { return v; }
+	static V sub(V a, V b) { return (T)(a - b); }
+	static u32 eq(V a, V b) { return a == b; }
+	static u32 gt(V a, V b) { return a > b; }
+};
+
+#if defined(SEARCH_SSE2)
+template<>
+struct Vec<u8>
+{
+	using V = __m128i;
+	static constexpr unsigned Count = 16;
+
+	static V load(const u8 *p) { return _mm_loadu_si128((const __m128i *)p); }
+	static V splat(u8 v) { return _mm_set1_epi8((char)v); }
+	static V sub(V a, V b) { return _mm_sub_epi8(a, b); }
+	static u32 eq(V a, V b) { return _mm_movemask_epi8(_mm_cmpeq_epi8(a, b)); }
+	static u32 gt(V a, V b) {
+		const V sign = _mm_set1_epi8((char)0x80);
+		return _mm_movemask_epi8(_mm_cmpgt_epi8(_mm_xor_si128(a, sign), _mm_xor_si128(b, sign)));
+	}
+};
+
+template<>
+struct Vec<u16>
+{
+	using V = __m128i;
+	static constexpr unsigned Count = 8;
+
+	static V load(const u16 *p) { return _mm_loadu_si128((const __m128i *)p); }
+	static V splat(u16 v) { return _mm_set1_epi16((short)v); }
+	static V sub(V a, V b) { return _mm_sub_epi16(a, b); }
+	static u32 mask(V m) { return _mm_movemask_epi8(_mm_packs_epi16(m, _mm_setzero_si128())); }
+	static u32 eq(V a, V b) { return mask(_mm_cmpeq_epi16(a, b)); }
+	static u32 gt(V a, V b) {
+		const V sign = _mm_set1_epi16((short)0x8000);
+		return mask(_mm_cmpgt_epi16(_mm_xor_si128(a, sign), _mm_xor_si128(b, sign)));
+	}
+};
+
+template<>
+struct Vec<u32>
+{
+	using V = __m128i;
+	static constexpr unsigned Count = 4;
+
+	static V load(const u32 *p) { return _mm_loadu_si128((const __m128i *)p); }
+	static V splat(u32 v) { return _mm_set1_epi32((int)v); }
+	static V sub(V a, V b) { return _mm_sub_epi32(a, b); }
+	static u32 mask(V m) { return _mm_movemask_ps(_mm_castsi128_ps(m)); }
+	static u32 eq(V a, V b) { return mask(_mm_cmpeq_epi32(a, b)); }
+	static u32 gt(V a, V b) {
+		const V sign = _mm_set1_epi32((int)0x80000000);
+		return mask(_mm_cmpgt_epi32(_mm_xor_si128(a, sign), _mm_xor_si128(b, sign)));
+	}
+};
+
+template<>
+struct Vec<float>
+{
+	using V = __m128;
+	static constexpr unsigned Count = 4;
+
+	static V load(const float *p) { return _mm_loadu_ps(p); }
+	static V splat(float v) { return _mm_set1_ps(v); }
+	static V sub(V a, V b) { return _mm_sub_ps(a, b); }
+	static u32 eq(V a, V b) { return _mm_movemask_ps(_mm_cmpeq_ps(a, b)); }
+	static u32 gt(V a, V b) { return _mm_movemask_ps(_mm_cmpgt_ps(a, b)); }
+};
+
+#elif defined(SEARCH_NEON)
+template<>
+struct Vec<u8>
+{
+	using V = uint8x16_t;
+	static constexpr unsigned Count = 16;
+
+	static V load(const u8 *p) { return vld1q_u8(p); }
+	static V splat(u8 v) { return vdupq_n_u8(v); }
+	static V sub(V a, V b) { return vsubq_u8(a, b); }
+	static u32 mask(V m) {
+		static const u8 bits[16] = { 1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128 };
+		V v = vandq_u8(m, vld1q_u8(bits));
+		return vaddv_u8(vget_low_u8(v)) | (vaddv_u8(vget_high_u8(v)) << 8);
+	}
+	static u32 eq(V a, V b) { return mask(vceqq_u8(a, b)); }
+	static u32 gt(V a, V b) { return mask(vcgtq_u8(a, b)); }
+};
+
+template<>
+struct Vec<u16>
+{
+	using V = uint16x8_t;
+	static constexpr unsigned Count = 8;
+
+	static V load(const u16 *p) { return vld1q_u16(p); }
+	static V splat(u16 v) { return vdupq_n_u16(v); }
+	static V sub(V a, V b) { return vsubq_u16(a, b); }
+	static u32 mask(V m) {
+		static const u16 bits[8] = { 1, 2, 4, 8, 16, 32, 64, 128 };
+		return vaddvq_u16(vandq_u16(m, vld1q_u16(bits)));
+	}
+	static u32 eq(V a, V b) { return mask(vceqq_u16(a, b)); }
+	static u32 gt(V a, V b) { return mask(vcgtq_u16(a, b)); }
+};
+
+static inline u32 mask32(uint32x4_t m)
+{
+	static const u32 bits[4] = { 1, 2, 4, 8 };
+	return vaddvq_u32(vandq_u32(m, vld1q_u32(bits)));
+}
+
+template<>
+struct Vec<u32>
+{
+	using V = uint32x4_t;
+	static constexpr unsigned Count = 4;
+
+	static V load(const u32 *p) { return vld1q_u32(p); }
+	static V splat(u32 v) { return vdupq_n_u32(v); }
+	static V sub(V a, V b) { return vsubq_u32(a, b); }
+	static u32 eq(V a, V b) { return mask32(vceqq_u32(a, b)); }
+	static u32 gt(V a, V b) { return mask32(vcgtq_u32(a, b)); }
+};
+
+template<>
+struct Vec<float>
+{
+	using V = float32x4_t;
+	static constexpr unsigned Count = 4;
+
+	static V load(const float *p) { return vld1q_f32(p); }
+	static V splat(float v) { return vdupq_n_f32(v); }
+	static V sub(V a, V b) { return vsubq_f32(a, b); }
+	static u32 eq(V a, V b) { return mask32(vceqq_f32(a, b)); }
+	static u32 gt(V a, V b) { return mask32(vcgtq_f32(a, b)); }
+};
+#endif
+
+// Number of values per candidate bitmap word
+constexpr u32 WordValues = 64;
+
+template<typename T, typename F>
+static inline u64 matchWord(const T *cur, const T *prev, F match)
+{
+	using VT = Vec<T>;
+	u64 mask = 0;
+	for (unsigned i = 0; i < WordValues; i += VT::Count)
+		mask |= (u64)match(VT::load(cur + i), VT::load(prev + i)) << i;
+	return mask;
+}
+
+}
+
+template<typename T, bool Invert, typename F>
+void CheatSearch::filterWords(F match)
+{
+	constexpr u32 WordBytes = WordValues * sizeof(T);
+	alignas(16) T cur[WordValues];
+	u64 newCount = 0;
+	for (size_t w = 0; w < candidates.size(); w++)
+	{
+		u64 bits = candidates[w];
+		// most words have no candidate left after a few passes
+		if (bits == 0)
+			continue;
+		// the emulation keeps running so work on a copy
+		memcpy(cur, source + w * WordBytes, WordBytes);
+		T *prev = (T *)&data[w * WordBytes];
+		u64 mask = matchWord(cur, prev, match);
+		if (Invert)
+			mask = ~mask;
+		bits &= mask;
+		candidates[w] = bits;
+		if (bits != 0)
+		{
+			memcpy(prev, cur, WordBytes);
+			newCount += Common::CountSetBits(bits);
+		}
+	}
+	count = newCount;
+}
+
+template<typename T>
+void CheatSearch::filterPass(Compare compare, T value)
+{
+	using VT = Vec<T>;
+	using V = typename VT::V;
+	const V v = VT::splat(value);
+	switch (compare)
+	{
+	case Compare::Equal:
+		filterWords<T, false>([v](V cur, V) { return VT::eq(cur, v); });
+		break;
+	case Compare::NotEqual:
+		filterWords<T, true>([v](V cur, V) { return VT::eq(cur, v); });
+		break;
+	case Compare::Greater:
+		filterWords<T, false>([v](V cur, V) { return VT::gt(cur, v); });
+		break;
+	case Compare::Less:
+		filterWords<T, false>([v](V cur, V) { return VT::gt(v, cur); });
+		break;
+	case Compare::Changed:
+		filterWords<T, true>([](V cur, V prev) { return VT::eq(cur, prev); });
+		break;
+	case Compare::Unchanged:
+		filterWords<T, false>([](V cur, V prev) { return VT::eq(cur, prev); });
+		break;
+	case Compare::Increased:
+		filterWords<T, false>([](V cur, V prev) { return VT::gt(cur, prev); });
+		break;
+	case Compare::Decreased:
+		filterWords<T, false>([](V cur, V prev) { return VT::gt(prev, cur); });
+		break;
+	case Compare::IncreasedBy:
+		filterWords<T, false>([v](V cur, V prev) { return VT::eq(VT::sub(cur, prev), v); });
+		break;
+	case Compare::DecreasedBy:
+		filterWords<T, false>([v](V cur, V prev) { return VT::eq(VT::sub(prev, cur), v); });
+		break;
+	}
+}
+
+void CheatSearch::snapshot()
+{
+	data.assign(source, source + size);
+	candidates.assign(size / valueSize(type) / WordValues, ~0ull);
+	count = size / valueSize(type);
+}
+
+void CheatSearch::runFilter(Compare compare, u32 value)
+{
+	switch (type)
+	{
+	case ValueType::U8:
+		filterPass<u8>(compare, (u8)value);
+		break;
+	case ValueType::U16:
+		filterPass<u16>(compare, (u16)value);
+		break;
+	case ValueType::U32:
+		filterPass<u32>(compare, value);
+		break;
+	case ValueType::Float:
+		{
+			float f;
+			memcpy(&f, &value, sizeof(f));
+			filterPass<float>(compare, f);
+		}
+		break;
+	}
+}
+
+void CheatSearch::run()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	for (;;)
+	{
+		if (jobs.empty())
+		{
+			doneCond.notify_all();
+			if (stopping)
+				break;
+			cond.wait(lock);
+			continue;
+		}
+		Job job = jobs.front();
+		jobs.pop_front();
+		running = true;
+		lock.unlock();
+
+		double startTime = os_GetSeconds();
+		if (job.start)
+			snapshot();
+		else
+			runFilter(job.compare, job.value);
+		double time = (os_GetSeconds() - startTime) * 1000.0;
+		if (!job.start)
+			DEBUG_LOG(COMMON, "Cheat search: %.2f ms, %llu candidates left", time, (unsigned long long)count);
+
+		lock.lock();
+		passTime = time;
+		running = false;
+	}
+}
+
+void CheatSearch::start(Region region, ValueType type)
+{
+	if (region == Region::Ram)
+		start(&mem_b[0], RAM_SIZE, 0x8C000000, type);
+	else
+		start(&aica::aica_ram[0], ARAM_SIZE, 0x00800000, type);
+}
+
+void CheatSearch::start(const u8 *data, u32 size, u32 baseAddress, ValueType type)
+{
+	verify(size % (WordValues * 4) == 0);
+	wait();
+	std::lock_guard<std::mutex> _(mutex);
+	source = data;
+	this->size = size;
+	this->baseAddress = baseAddress;
+	this->type = type;
+	jobs.push_back({ true, Compare::Equal, 0 });
+	if (!thread.joinable())
+	{
+		stopping = false;
+		thread = std::thread(&CheatSearch::run, this);
+	}
+	cond.notify_one();
+}
+
+void CheatSearch::filter(Compare compare, u32 value)
+{
+	std::lock_guard<std::mutex> _(mutex);
+	if (source == nullptr)
+		return;
+	jobs.push_back({ false, compare, value });
+	cond.notify_one();
+}
+
+void CheatSearch::wait()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	doneCond.wait(lock, [this]() { return jobs.empty() && !running; });
+}
+
+bool CheatSearch::busy()
+{
+	std::lock_guard<std::mutex> _(mutex);
+	return !jobs.empty() || running;
+}
+
+u64 CheatSearch::candidateCount()
+{
+	wait();
+	return count;
+}
+
+double CheatSearch::lastPassTime()
+{
+	std::lock_guard<std::mutex> _(mutex);
+	return passTime;
+}
+
+std::vector<CheatSearch::Result> CheatSearch::results(size_t maxCount)
+{
+	wait();
+	std::vector<Result> results;
+	const u32 valSize = valueSize(type);
+	for (size_t w = 0; w < candidates.size() && results.size() < maxCount; w++)
+	{
+		u64 bits = candidates[w];
+		while (bits != 0 && results.size() < maxCount)
+		{
+			u32 bit = Common::LeastSignificantSetBit(bits);
+			bits &= bits - 1;
+			u32 offset = (u32)(w * WordValues + bit) * valSize;
+			Result result{ baseAddress + offset, 0 };
+			memcpy(&result.value, &data[offset], valSize);
+			results.push_back(result);
+		}
+	}
+	return results;
+}
+
+void CheatSearch::reset()
+{
+	wait();
+	std::lock_guard<std::mutex> _(mutex);
+	source = nullptr;
+	data = std::vector<u8>();
+	candidates = std::vector<u64>();
+	count = 0;
+	passTime = 0;
+}
+
+void CheatSearch::term()
+{
+	{
+		std::lock_guard<std::mutex> _(mutex);
+		stopping = true;
+		cond.notify_one();
+	}
+	if (thread.joinable())
+		thread.join();
+	reset();
+}
@@ -0,0 +1,129 @@
+/*
+	Copyright 2024 flyinghead
+
+	This file is part of Flycast.
+
+    Flycast is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    Flycast is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Flycast.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+#include "types.h"
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//
+// Memory search used to find new cheat codes.
+// A search keeps a snapshot of the memory region and a bitmap of the candidate addresses,
+// one bit per aligned value. Each filter pass compares the current memory content
+// with the snapshot or with a given value, and clears the candidates that don't match.
+// Passes run on a worker thread while the emulation keeps running.
+//
+class CheatSearch
+{
+public:
+	enum class Region {
+		Ram,
+		Aram
+	};
+	enum class ValueType {
+		U8,
+		U16,
+		U32,
+		Float
+	};
+	enum class Compare {
+		// compared with the given value
+		Equal,
+		NotEqual,
+		Greater,
+		Less,
+		// compared with the previous snapshot
+		Changed,
+		Unchanged,
+		Increased,
+		Decreased,
+		// difference with the previous snapshot equal to the given value
+		IncreasedBy,
+		DecreasedBy
+	};
+	struct Result
+	{
+		u32 address;
+		u32 value;	// raw bits for floats
+	};
+
+	~CheatSearch() { term(); }
+
+	// Starts a new search on a memory region. All aligned addresses are candidates.
+	// The initial snapshot is taken by the worker thread.
+	void start(Region region, ValueType type);
+	// Starts a new search on the given memory. size must be a multiple of 256.
+	void start(const u8 *data, u32 size, u32 baseAddress, ValueType type);
+	// Queues a filter pass. value holds the raw bits of floats.
+	void filter(Compare compare, u32 value = 0);
+	// Waits until all queued passes are done
+	void wait();
+	bool busy();
+	bool isActive() const { return source != nullptr; }
+	ValueType valueType() const { return type; }
+	u64 candidateCount();
+	// Returns at most maxCount candidates with their value in the last snapshot
+	std::vector<Result> results(size_t maxCount);
+	// Duration of the last pass in milliseconds
+	double lastPassTime();
+	void reset();
+	void term();
+
+	static u32 valueSize(ValueType type) {
+		return type == ValueType::U8 ? 1 : type == ValueType::U16 ? 2 : 4;
+	}
+
+private:
+	struct Job
+	{
+		bool start;
+		Compare compare;
+		u32 value;
+	};
+
+	void run();
+	void snapshot();
+	void runFilter(Compare compare, u32 value);
+	template<typename T>
+	void filterPass(Compare compare, T value);
+	template<typename T, bool Invert, typename F>
+	void filterWords(F match);
+
+	const u8 *source = nullptr;
+	u32 size = 0;
+	u32 baseAddress = 0;
+	ValueType type = ValueType::U32;
+	std::vector<u8> data;			// last snapshot
+	std::vector<u64> candidates;	// one bit per value
+	u64 count = 0;
+	double passTime = 0;
+
+	std::mutex mutex;
+	std::condition_variable cond;
+	std::condition_variable doneCond;
+	std::deque<Job> jobs;
+	bool running = false;
+	bool stopping = false;
+	std::thread thread;
+};
+
+extern CheatSearch cheatSearch;
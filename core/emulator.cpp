@@ -30,6 +30,7 @@
 #include "hw/sh4/sh4_sched.h"
 #include "hw/flashrom/nvmem.h"
 #include "cheats.h"
+#include "cheat_search.h"
 #include "audio/audiostream.h"
 #include "debug/gdb_server.h"
 #include "hw/pvr/Renderer_if.h"
@@ -43,6 +44,7 @@
 #include "hw/pvr/pvr.h"
 #include "profiler/fc_profiler.h"
 #include "oslib/storage.h"
+#include "oslib/savefile.h"
 #include "wsi/context.h"
 #include <chrono>
 
@@ -527,6 +529,7 @@ void Emulator::loadGame(const char *path, LoadProgress *progress)
 				naomi_cart_ConfigureEEPROM();
 		}
 		cheatManager.reset(settings.content.gameId);
+		cheatSearch.reset();
 		if (cheatManager.isWidescreen())
 		{
 			gui_display_notification("Widescreen cheat activated", 1000);
@@ -629,10 +632,12 @@ void Emulator::term()
 		sh4_cpu.Term();
 		custom_texture.Terminate();	// lr: avoid deadlock on exit (win32)
 		reios_term();
+		cheatSearch.term();
 		aica::term();
 		pvr::term();
 		mem_Term();
 		libGDR_term();
+		savefile::term();
 
 		state = Terminated;
 	}
@@ -659,6 +664,7 @@ void Emulator::stop()
 			throw e;
 		}
 		nvmem::saveFiles();
+		savefile::flush();
 		EventManager::event(Event::Pause);
 	}
 	else
@@ -670,6 +676,7 @@ void Emulator::stop()
 #else
 		TermAudio();
 		nvmem::saveFiles();
+		savefile::flush();
 		EventManager::event(Event::Pause);
 #endif
 	}
@@ -726,21 +733,24 @@ void Emulator::stepRange(u32 from, u32 to)
 void dc_loadstate(Deserializer& deser)
 {
 	custom_texture.Terminate();
-#if FEAT_AREC == DYNAREC_JIT
-	aica::arm::recompiler::flush();
-#endif
+	// Memory regions are restored page by page and only the compiled blocks, arm7 code and
+	// textures coming from the pages that changed are discarded.
+	// Blocks are compiled from virtual addresses when the MMU is on so they must all go.
+	const bool mmuWasOn = mmu_enabled();
 	mmu_flush_table();
-#if FEAT_SHREC != DYNAREC_NONE
-	bm_Reset();
-#endif
 	memwatch::unprotect();
 	memwatch::reset();
 
 	dc_deserialize(deser);
 
 	mmu_set_state();
-	sh4_cpu.ResetCache();
-	KillTex = true;
+	if (mmuWasOn || mmu_enabled())
+	{
+#if FEAT_SHREC != DYNAREC_NONE
+		bm_Reset();
+#endif
+		sh4_cpu.ResetCache();
+	}
 }
 
 void Emulator::setNetworkState(bool online)
@@ -907,6 +917,7 @@ bool Emulator::render()
 			stopRequested = false;
 			TermAudio();
 			nvmem::saveFiles();
+			savefile::flush();
 			EventManager::event(Event::Pause);
 		}
 		// TODO if stopping due to a user request, no frame has been rendered
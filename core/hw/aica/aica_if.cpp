@@ -13,6 +13,7 @@
 #include "profiler/dc_profiler.h"
 #include "hw/sh4/dyna/blockmanager.h"
 #include "hw/arm7/arm7.h"
+#include "hw/arm7/arm7_rec.h"
 #include "cfg/option.h"
 
 #include "serialize.h"
@@ -20,6 +21,7 @@
 #include "dsp.h"
 #include "sgc_if.h"
 #include "aica.h"
+#include "replay.h"
 
 #include <ctime>
 
@@ -40,6 +42,8 @@ u32 GetRTC_now()
 	if (config::GGPOEnable)
 		// 1/1/70 00:00:00
 		return (20 * 365 + 5) * 24 * 60 * 60;
+	if (replay::playing())
+		return replay::playRtc();
 
 	// The Dreamcast Epoch time is 1/1/50 00:00 but without support for time zone or DST.
 	// We compute the TZ/DST current time offset and add it to the result
@@ -51,7 +55,10 @@ u32 GetRTC_now()
 	gmtm.tm_isdst = -1;
 	time_t time_offset = mktime(&localtm) - mktime(&gmtm);
 	// 1/1/50 to 1/1/70 is 20 years and 5 leap days
-	return (20 * 365 + 5) * 24 * 60 * 60 + rawtime + time_offset;
+	u32 now = (20 * 365 + 5) * 24 * 60 * 60 + rawtime + time_offset;
+	if (replay::recording())
+		replay::recordRtc(now);
+	return now;
 }
 
 template<typename T>
@@ -535,7 +542,11 @@ void serialize(Serializer& ser)
 	}
 
 	if (!ser.rollback())
+	{
+		ser.beginSection(Serializer::Section::Aram);
 		aica_ram.serialize(ser);
+		ser.endSection();
+	}
 	ser << VREG;
 	ser << ARMRST;
 	ser << rtc_EN;
@@ -574,7 +585,15 @@ void deserialize(Deserializer& deser)
 
 	if (!deser.rollback())
 	{
-		aica_ram.deserialize(deser);
+		bool changed = false;
+		aica_ram.deserialize(deser, [&changed](u32) {
+			changed = true;
+		});
+#if FEAT_AREC == DYNAREC_JIT
+		// The arm7 code may have changed
+		if (changed)
+			arm::recompiler::flush();
+#endif
 		if (settings.platform.isAtomiswave())
 			deser.skip(6_MB, Deserializer::V30);
 	}
@@ -111,4 +111,29 @@ extern bool Arm7Enabled;
 void CPUFiq();
 void CPUUpdateCPSR();
 
+#if FEAT_AREC != DYNAREC_NONE
+namespace recompiler
+{
+// One bit per ARAM word used by a compiled block
+extern u32 codeWords[ARAM_SIZE_MAX / 4 / 32];
+// Records that compiled code at this address was overwritten
+void codeWritten(u32 addr);
+}
+#endif
+
+// Must be called when ARAM is written. If code was compiled from this address,
+// the blocks using it are discarded before the next timeslice.
+static inline void invalidateCode(u32 addr)
+{
+#if FEAT_AREC != DYNAREC_NONE
+	const u32 word = (addr & (ARAM_SIZE_MAX - 1)) / 4;
+	u32& bits = recompiler::codeWords[word / 32];
+	if (bits & (1u << (word % 32)))
+	{
+		bits &= ~(1u << (word % 32));
+		recompiler::codeWritten(word * 4);
+	}
+#endif
+}
+
 } // namespace aica::arm
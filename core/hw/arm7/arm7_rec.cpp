@@ -26,6 +26,10 @@
 #include "hw/aica/aica_if.h"
 #include "oslib/virtmem.h"
 #include "arm_mem.h"
+#include "cfg/option.h"
+
+#include <map>
+#include <vector>
 
 #if 0
 // for debug
@@ -48,6 +52,14 @@ namespace recompiler {
 u8* icPtr;
 u8* ICache;
 void (*EntryPoints[ARAM_SIZE_MAX / 4])();
+u32 codeWords[ARAM_SIZE_MAX / 4 / 32];
+// Start and end address of each compiled block
+static std::map<u32, u32> blocks;
+// Overwritten code addresses, whose blocks are discarded before the next timeslice
+static std::vector<u32> writtenCode;
+// Too much code was overwritten: the whole cache is flushed
+static bool flushPending;
+constexpr size_t MaxWrittenCode = 1024;
 
 #if defined(_WIN32) || defined(TARGET_IPHONE) || defined(TARGET_ARM_MAC)
 static u8 *ARM7_TCB;
@@ -566,6 +578,45 @@ static void block_ssa_pass()
 	}
 }
 
+// A block is an idle loop if it branches back to itself, has no side effect and only
+// recomputes its state from memory reads and registers it doesn't modify.
+// Nothing changes until an AICA event occurs so the rest of the timeslice can be skipped.
+static bool isIdleLoop(const BlockLinks& links)
+{
+	if (links.exitCount == 0 || links.exits[0] != links.pc)
+		return false;
+
+	std::array<bool, RN_ARM_REG_COUNT> written{};
+	std::array<bool, RN_ARM_REG_COUNT> readOnEntry{};
+	bool setsFlags = false;
+	bool readsEntryFlags = false;
+	for (const ArmOp& op : block_ops)
+	{
+		if (op.op_type > ArmOp::MVN && op.op_type != ArmOp::LDR && op.op_type != ArmOp::B)
+			return false;
+		for (const auto& arg : op.arg)
+		{
+			if (arg.isReg() && arg.getReg().version == 0)
+				readOnEntry[(size_t)arg.getReg().armreg] = true;
+			if (!arg.shift_imm && arg.shift_reg.version == 0)
+				readOnEntry[(size_t)arg.shift_reg.armreg] = true;
+		}
+		if (op.rd.isReg())
+			written[(size_t)op.rd.getReg().armreg] = true;
+		if ((op.flags & ArmOp::OP_READS_FLAGS) && !setsFlags)
+			readsEntryFlags = true;
+		if (op.flags & ArmOp::OP_SETS_FLAGS)
+			setsFlags = true;
+	}
+	if (readsEntryFlags && setsFlags)
+		return false;
+	for (u32 i = 0; i < written.size(); i++)
+		if (written[i] && readOnEntry[i])
+			return false;
+
+	return true;
+}
+
 void compile()
 {
 	//Get the code ptr
@@ -582,16 +633,20 @@ void compile()
 	EntryPoints[(pc & (ARAM_SIZE_MAX - 1)) / 4] = (void (*)())writeToExec(rv);
 
 	block_ops.clear();
+	BlockLinks links;
+	links.pc = pc;
 
 	u32 cycles = 0;
 
 	arm_printf("ARM7 Block %x", pc);
-	//the ops counter is used to terminate the block (max op count for a single block is 32 currently)
-	//We don't want too long blocks for timing accuracy
-	for (u32 ops = 0; ops < 32; ops++)
+	// Blocks end on branches, or when they reach the cycle budget (or max op count).
+	// The cycles of a block are deducted at its start so we don't want too long blocks for timing accuracy.
+	for (u32 ops = 0; ops < MaxBlockOps; ops++)
 	{
 		//Read opcode ...
 		u32 opcd = *(u32*)&aica_ram[pc & ARAM_MASK];
+		const u32 word = (pc & ARAM_MASK) / 4;
+		codeWords[word / 32] |= 1u << (word % 32);
 
 #if 0
 		std::ostringstream ostr;
@@ -620,6 +675,8 @@ void compile()
 			//Branch ?
 			if (last_op.flags & ArmOp::OP_SETS_PC)
 			{
+				const bool staticBranch = (last_op.op_type == ArmOp::B || last_op.op_type == ArmOp::BL)
+						&& last_op.arg[0].isImmediate();
 				if (last_op.condition != ArmOp::AL)
 				{
 					// insert a "mov armNextPC, pc + 4" before the jump if not taken
@@ -637,6 +694,12 @@ void compile()
 					block_ops.push_back(armop);
 				}
 				block_ops.push_back(last_op);
+				if (staticBranch)
+				{
+					links.exits[links.exitCount++] = last_op.arg[0].getImmediate();
+					if (last_op.condition != ArmOp::AL)
+						links.exits[links.exitCount++] = pc;
+				}
 				arm_printf("ARM: %06X: Block End %d", pc, ops);
 				break;
 			}
@@ -644,20 +707,40 @@ void compile()
 		}
 
 		//block size limit ?
-		if (ops == 31)
+		if (ops == MaxBlockOps - 1 || cycles >= MaxBlockCycles)
 		{
 			// Update armNextPC
 			ArmOp armop(ArmOp::MOV, ArmOp::AL);
 			armop.rd = ArmOp::Operand(R15_ARM_NEXT);
 			armop.arg[0] = ArmOp::Operand(pc);
 			block_ops.push_back(armop);
+			links.exits[links.exitCount++] = pc;
 			arm_printf("ARM: %06X: Block split", pc);
+			break;
 		}
 	}
 
 	block_ssa_pass();
 
+	if (config::IdleLoopSkip && isIdleLoop(links))
+	{
+		// End the timeslice when looping
+		ArmOp armop(ArmOp::MOV, block_ops.back().condition);
+		armop.rd = ArmOp::Operand(CYCL_CNT);
+		armop.rd.getReg().version = 1;
+		armop.arg[0] = ArmOp::Operand(0u);
+		block_ops.insert(block_ops.end() - 1, armop);
+		INFO_LOG(AICA_ARM, "ARM7 idle loop detected at %06x", links.pc);
+	}
+
+	const u32 start = links.pc & (ARAM_SIZE_MAX - 1);
+	blocks[start] = start + (pc - links.pc);
+
+#if HOST_CPU == CPU_X64
+	arm7backend_compile(block_ops, cycles, links);
+#else
 	arm7backend_compile(block_ops, cycles);
+#endif
 
 	arm_printf("arm7rec_compile done: %p,%p", rv, icPtr);
 }
@@ -669,6 +752,52 @@ void flush()
 	verify(arm_compilecode != nullptr);
 	for (u32 i = 0; i < std::size(EntryPoints); i++)
 		EntryPoints[i] = arm_compilecode;
+	memset(codeWords, 0, sizeof(codeWords));
+	blocks.clear();
+	writtenCode.clear();
+	flushPending = false;
+}
+
+void codeWritten(u32 addr)
+{
+	if (writtenCode.size() >= MaxWrittenCode)
+		flushPending = true;
+	else
+		writtenCode.push_back(addr);
+}
+
+// Discards the blocks compiled from overwritten code. Must be called between timeslices.
+// The code of discarded blocks isn't reclaimed, so the cache is flushed when it's getting full.
+static void discardWrittenCode()
+{
+	if (flushPending || (!writtenCode.empty() && spaceLeft() < ICacheSize / 4))
+	{
+		flush();
+		return;
+	}
+	for (u32 addr : writtenCode)
+	{
+		// ARAM is mirrored up to 8 MB
+		for (u32 mirror = addr; mirror < ARAM_SIZE_MAX; mirror += ARAM_SIZE)
+		{
+			const u32 first = mirror >= MaxBlockOps * 4 ? mirror - (MaxBlockOps - 1) * 4 : 0;
+			for (auto it = blocks.lower_bound(first); it != blocks.end() && it->first <= mirror; )
+			{
+				if (it->second <= mirror)
+				{
+					++it;
+					continue;
+				}
+				EntryPoints[it->first / 4] = arm_compilecode;
+#if HOST_CPU == CPU_X64
+				arm7backend_discard(it->first);
+#endif
+				// Bits of the other words of this block are left set. They only cause a useless lookup.
+				it = blocks.erase(it);
+			}
+		}
+	}
+	writtenCode.clear();
 }
 
 void init()
@@ -746,6 +875,8 @@ void run(u32 samples)
 	{
 		if (Arm7Enabled)
 		{
+			if (!recompiler::writtenCode.empty() || recompiler::flushPending)
+				recompiler::discardWrittenCode();
 			arm_Reg[CYCL_CNT].I += ARM_CYCLES_PER_SAMPLE;
 			arm_mainloop(arm_Reg, recompiler::EntryPoints);
 		}
@@ -434,6 +434,22 @@ void DYNACALL interpret(u32 opcode);
 extern u8* icPtr;
 extern u8* ICache;
 const u32 ICacheSize = 4_MB;
+extern void (*EntryPoints[ARAM_SIZE_MAX / 4])();
+
+// Max number of ARM ops in a block
+constexpr u32 MaxBlockOps = 128;
+// A block is split when it reaches this number of cycles
+constexpr u32 MaxBlockCycles = ARM_CYCLES_PER_SAMPLE / 2;
+
+// Static successors of a block, which the backend can link directly.
+// Only the x64 backend links blocks. Blocks compiled by the ARM32 and ARM64 backends always
+// return to the dispatcher.
+struct BlockLinks
+{
+	u32 pc = 0;				// block start address
+	u32 exitCount = 0;
+	u32 exits[2] {};		// branch target (taken) first, then fall through
+};
 
 static inline void *currentCode() {
 	return icPtr;
@@ -458,7 +474,13 @@ static inline void *execToWrite(void * addr) {
 
 } // namespace recompiler
 
+#if HOST_CPU == CPU_X64
+void arm7backend_compile(const std::vector<ArmOp>& block_ops, u32 cycles, const recompiler::BlockLinks& links);
+// The block at pc is discarded: exits of other blocks jumping to it must go through the dispatcher
+void arm7backend_discard(u32 pc);
+#else
 void arm7backend_compile(const std::vector<ArmOp>& block_ops, u32 cycles);
+#endif
 void arm7backend_flush();
 
 extern void (*arm_compilecode)();
@@ -29,6 +29,10 @@ using namespace Xbyak::util;
 #include "oslib/unwind_info.h"
 #include "oslib/virtmem.h"
 
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
 namespace aica::arm
 {
 
@@ -41,6 +45,16 @@ static const Xbyak::Reg32 call_regs[] = { edi, esi, edx, ecx  };
 #endif
 static void (**entry_points)();
 static UnwindInfo unwinder;
+// Block exits jumping to the dispatcher until their target is compiled, indexed by target
+static std::unordered_multimap<u32, u8 *> pendingLinks;
+// Block exits jumping directly to their target, indexed by target
+static std::unordered_multimap<u32, u8 *> linkedExits;
+// Target and jump address of the exits of each block
+static std::unordered_map<u32, std::vector<std::pair<u32, u8 *>>> blockExits;
+
+static u32 entryPointIndex(u32 pc) {
+	return (pc & (ARAM_SIZE_MAX - 1)) / 4;
+}
 
 class Arm7Compiler;
 
@@ -803,10 +817,36 @@ class Arm7Compiler : public Xbyak::CodeGenerator
 		call(recompiler::interpret);
 	}
 
+	// Jump directly to the target block if the timeslice isn't over and no interrupt is pending
+	void emitLinkedExit(u32 pc, u32 target)
+	{
+		mov(dword[rip + &arm_Reg[R15_ARM_NEXT].I], target);
+		cmp(dword[rip + &arm_Reg[CYCL_CNT].I], 0);
+		jle((const void *)arm_dispatch);
+		cmp(dword[rip + &arm_Reg[INTR_PEND].I], 0);
+		jne((const void *)arm_dispatch);
+
+		const u32 index = entryPointIndex(target);
+		u8 *jmpAddr = (u8 *)getCurr();
+		blockExits[entryPointIndex(pc)].emplace_back(index, jmpAddr);
+		void (*code)() = recompiler::EntryPoints[index];
+		if (code != arm_compilecode)
+		{
+			linkedExits.emplace(index, jmpAddr);
+			jmp((const void *)code, T_NEAR);
+		}
+		else
+		{
+			// patched when the target block is compiled
+			pendingLinks.emplace(index, jmpAddr);
+			jmp((const void *)arm_dispatch, T_NEAR);
+		}
+	}
+
 public:
 	Arm7Compiler() : Xbyak::CodeGenerator(recompiler::spaceLeft(), recompiler::currentCode()) { }
 
-	void compile(const std::vector<ArmOp>& block_ops, u32 cycles)
+	void compile(const std::vector<ArmOp>& block_ops, u32 cycles, const recompiler::BlockLinks& links)
 	{
 		regalloc = new X64ArmRegAlloc(*this, block_ops);
 
@@ -871,7 +911,23 @@ public:
 		}
 		endConditional(condLabel);
 
-		jmp((void*)arm_dispatch);
+		if (links.exitCount == 0)
+		{
+			jmp((void*)arm_dispatch);
+		}
+		else if (links.exitCount == 1 || links.exits[0] == links.exits[1])
+		{
+			emitLinkedExit(links.pc, links.exits[0]);
+		}
+		else
+		{
+			Xbyak::Label notTaken;
+			cmp(dword[rip + &arm_Reg[R15_ARM_NEXT].I], links.exits[0]);
+			jne(notTaken, T_NEAR);
+			emitLinkedExit(links.pc, links.exits[0]);
+			L(notTaken);
+			emitLinkedExit(links.pc, links.exits[1]);
+		}
 
 		ready();
 		recompiler::advance(getSize());
@@ -995,16 +1051,76 @@ void X64ArmRegAlloc::StoreReg(int host_reg, Arm7Reg armreg)
 	assembler.mov(dword[rip + &arm_Reg[(u32)armreg].I], getReg32(host_reg));
 }
 
-void arm7backend_compile(const std::vector<ArmOp>& block_ops, u32 cycles)
+// Patches a jmp rel32
+static void patchJump(u8 *jmpAddr, const void *target)
+{
+	virtmem::jit_set_exec(jmpAddr, 5, false);
+	const s32 rel = (s32)((const u8 *)target - ((u8 *)recompiler::writeToExec(jmpAddr) + 5));
+	memcpy(jmpAddr + 1, &rel, sizeof(rel));
+	virtmem::jit_set_exec(jmpAddr, 5, true);
+}
+
+static void linkPendingExits(u32 pc)
+{
+	const u32 index = entryPointIndex(pc);
+	const auto range = pendingLinks.equal_range(index);
+	if (range.first == range.second)
+		return;
+	for (auto it = range.first; it != range.second; ++it)
+	{
+		patchJump(it->second, (const void *)recompiler::EntryPoints[index]);
+		linkedExits.emplace(index, it->second);
+	}
+	pendingLinks.erase(range.first, range.second);
+}
+
+static void eraseExit(std::unordered_multimap<u32, u8 *>& exits, u32 index, u8 *jmpAddr)
+{
+	const auto range = exits.equal_range(index);
+	for (auto it = range.first; it != range.second; ++it)
+		if (it->second == jmpAddr)
+		{
+			exits.erase(it);
+			return;
+		}
+}
+
+void arm7backend_discard(u32 pc)
+{
+	const u32 index = entryPointIndex(pc);
+	// The exits of the discarded block are dead code
+	auto it = blockExits.find(index);
+	if (it != blockExits.end())
+	{
+		for (const auto& exit : it->second)
+		{
+			eraseExit(linkedExits, exit.first, exit.second);
+			eraseExit(pendingLinks, exit.first, exit.second);
+		}
+		blockExits.erase(it);
+	}
+	// Other blocks go through the dispatcher until this one is compiled again
+	const auto range = linkedExits.equal_range(index);
+	for (auto link = range.first; link != range.second; ++link)
+	{
+		patchJump(link->second, (const void *)arm_dispatch);
+		pendingLinks.emplace(index, link->second);
+	}
+	linkedExits.erase(range.first, range.second);
+}
+
+void arm7backend_compile(const std::vector<ArmOp>& block_ops, u32 cycles, const recompiler::BlockLinks& links)
 {
 	void* protStart = recompiler::currentCode();
 	size_t protSize = recompiler::spaceLeft();
 	virtmem::jit_set_exec(protStart, protSize, false);
 
 	Arm7Compiler assembler;
-	assembler.compile(block_ops, cycles);
+	assembler.compile(block_ops, cycles, links);
 
 	virtmem::jit_set_exec(protStart, protSize, true);
+
+	linkPendingExits(links.pc);
 }
 
 void arm7backend_flush()
@@ -1013,6 +1129,9 @@ void arm7backend_flush()
 	size_t protSize = recompiler::spaceLeft();
 	virtmem::jit_set_exec(protStart, protSize, false);
 	unwinder.clear();
+	pendingLinks.clear();
+	linkedExits.clear();
+	blockExits.clear();
 
 	Arm7Compiler assembler;
 	assembler.generateMainLoop();
@@ -16,10 +16,13 @@
  */
 #include "flashrom.h"
 #include "oslib/oslib.h"
+#include "oslib/savefile.h"
 #include "stdclass.h"
 
 bool MemChip::Load(const std::string& file)
 {
+	// make sure pending writes are on disk
+	savefile::flush();
 	FILE *f = nowide::fopen(file.c_str(), "rb");
 	if (f)
 	{
@@ -41,15 +44,9 @@ void MemChip::Load(const u8 *data, size_t size)
 
 void WritableChip::Save(const std::string& file)
 {
-	FILE *f = nowide::fopen(file.c_str(), "wb");
-	if (f == nullptr)
-	{
-		ERROR_LOG(FLASHROM, "Cannot save flash/nvmem to file '%s'", file.c_str());
-		return;
-	}
-	if (std::fwrite(data + write_protect_size, 1, size - write_protect_size, f) != size - write_protect_size)
+	// written to disk in the background
+	if (!savefile::write(file, data + write_protect_size, size - write_protect_size))
 		ERROR_LOG(FLASHROM, "Failed or truncated write to flash file '%s'", file.c_str());
-	std::fclose(f);
 }
 
 bool MemChip::Load(const std::string &prefix, const std::string &names_ro, const std::string &title)
@@ -14,8 +14,17 @@
 #include "hw/sh4/sh4_mmr.h"
 #include "hw/sh4/sh4_sched.h"
 #include "imgread/common.h"
+#include "oslib/oslib.h"
 #include "serialize.h"
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
 int gdrom_schid;
 
 //Sense: ASC - ASCQ - Key
@@ -64,12 +73,157 @@ GD_HardwareInfo_t GD_HardwareInfo;
 #define printf_spicmd(...) DEBUG_LOG(GDROM, __VA_ARGS__)
 #define printf_subcode(...) DEBUG_LOG(GDROM, __VA_ARGS__)
 
+//
+// Reads the upcoming CDDA sectors on a background thread into a ring buffer.
+// The AICA side only copies sectors from memory, and falls back to a synchronous read
+// if the ring is empty (underrun) or doesn't follow the current play position.
+//
+class CddaStreamer
+{
+public:
+	// Start streaming from the current play position
+	void start(const cdda_t& cdda)
+	{
+		std::lock_guard<std::mutex> _(mutex);
+		if (!thread.joinable())
+		{
+			stopping = false;
+			thread = std::thread([this]() { run(); });
+		}
+		generation++;
+		tail.store(head.load(std::memory_order_relaxed), std::memory_order_release);
+		nextFad = cdda.CurrAddr.FAD;
+		startFad = cdda.StartAddr.FAD;
+		endFad = cdda.EndAddr.FAD;
+		repeats = cdda.repeats;
+		streaming = nextFad < endFad;
+		cond.notify_one();
+	}
+
+	// Discard the buffered sectors and stop reading
+	void flush()
+	{
+		std::lock_guard<std::mutex> _(mutex);
+		generation++;
+		streaming = false;
+		tail.store(head.load(std::memory_order_relaxed), std::memory_order_release);
+	}
+
+	// Copy the sector at the given position if it has been read already
+	bool read(u8 *dest, u32 fad)
+	{
+		const u32 t = tail.load(std::memory_order_relaxed);
+		if (t == head.load(std::memory_order_acquire))
+		{
+			if (streaming)
+				underruns++;
+			return false;
+		}
+		const Slot& slot = ring[t % RingSize];
+		if (slot.fad != fad)
+			return false;
+		memcpy(dest, slot.data, sizeof(slot.data));
+		tail.store(t + 1, std::memory_order_release);
+		cond.notify_one();
+		return true;
+	}
+
+	void term()
+	{
+		{
+			std::lock_guard<std::mutex> _(mutex);
+			stopping = true;
+			streaming = false;
+			cond.notify_one();
+		}
+		if (thread.joinable())
+			thread.join();
+		if (underruns != 0)
+			INFO_LOG(GDROM, "CDDA streamer: %u underruns", underruns);
+		underruns = 0;
+	}
+
+private:
+	void run()
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		while (true)
+		{
+			cond.wait_for(lock, std::chrono::milliseconds(10), [this]() {
+				return stopping || (streaming && head.load(std::memory_order_relaxed) - tail.load(std::memory_order_acquire) < RingSize);
+			});
+			if (stopping)
+				break;
+			if (!streaming || head.load(std::memory_order_relaxed) - tail.load(std::memory_order_acquire) >= RingSize)
+				continue;
+			// same sequencing as libCore_CDDA_Sector
+			const u32 fad = nextFad++;
+			if (nextFad >= endFad)
+			{
+				if (repeats == 0)
+					streaming = false;
+				else
+				{
+					if (repeats != 0xf)
+						repeats--;
+					nextFad = startFad;
+				}
+			}
+			const u32 gen = generation;
+			lock.unlock();
+
+			libGDR_ReadSector(buffer, fad, 1, sizeof(buffer));
+
+			lock.lock();
+			if (gen != generation)
+				continue;
+			const u32 h = head.load(std::memory_order_relaxed);
+			Slot& slot = ring[h % RingSize];
+			slot.fad = fad;
+			memcpy(slot.data, buffer, sizeof(slot.data));
+			head.store(h + 1, std::memory_order_release);
+		}
+	}
+
+	struct Slot
+	{
+		u32 fad;
+		u8 data[2352];
+	};
+	static constexpr u32 RingSize = 32;	// ~430 ms
+
+	Slot ring[RingSize];
+	std::atomic<u32> head{};	// written by the streaming thread
+	std::atomic<u32> tail{};	// written by the AICA thread
+	u8 buffer[2352];
+
+	std::thread thread;
+	std::mutex mutex;
+	std::condition_variable cond;
+	bool stopping = false;
+	std::atomic<bool> streaming{};
+	u32 generation = 0;
+	u32 nextFad = 0;
+	u32 startFad = 0;
+	u32 endFad = 0;
+	u32 repeats = 0;
+	u32 underruns = 0;
+};
+static CddaStreamer cddaStreamer;
+
 void libCore_CDDA_Sector(s16* sector)
 {
 	//silence ! :p
 	if (cdda.status == cdda_t::Playing)
 	{
-		libGDR_ReadSector((u8*)sector,cdda.CurrAddr.FAD,1,2352);
+		if (!cddaStreamer.read((u8 *)sector, cdda.CurrAddr.FAD))
+		{
+			libGDR_ReadSector((u8*)sector,cdda.CurrAddr.FAD,1,2352);
+			// resync the streamer with the next position
+			cdda_t next = cdda;
+			next.CurrAddr.FAD++;
+			cddaStreamer.start(next);
+		}
 		cdda.CurrAddr.FAD++;
 		if (cdda.CurrAddr.FAD >= cdda.EndAddr.FAD)
 		{
@@ -78,6 +232,7 @@ void libCore_CDDA_Sector(s16* sector)
 				//stop
 				cdda.status = cdda_t::Terminated;
 				SecNumber.Status = GD_PAUSE;
+				cddaStreamer.flush();
 			}
 			else
 			{
@@ -99,6 +254,170 @@ static void gd_spi_pio_end(const u8* buffer, u32 len, gd_states next_state = gds
 static void gd_process_spi_cmd();
 static void gd_process_ata_cmd();
 
+//
+// Reads the sectors of DMA read commands on a background thread as soon as the command is received,
+// so that host I/O overlaps with the emulated transfer time.
+// The emulation thread only waits if a chunk hasn't been read yet when the DMA needs it.
+//
+class ReadAhead
+{
+public:
+	// Start reading the sectors of a new command
+	void start(u32 fad, u32 count, u32 sectorSize)
+	{
+		std::lock_guard<std::mutex> _(mutex);
+		resetLocked();
+		if (count == 0)
+			return;
+		if (!thread.joinable())
+		{
+			stopping = false;
+			thread = std::thread([this]() { run(); });
+		}
+		active = true;
+		nextFad = fad;
+		remaining = count;
+		this->sectorSize = sectorSize;
+		deliverFad = fad;
+		cond.notify_one();
+	}
+
+	// Copy the next chunk of sectors. Reads them synchronously if they don't belong to the current command.
+	void read(u8 *dest, u32 fad, u32 count, u32 sectorSize)
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		if (active && fad == deliverFad && sectorSize == this->sectorSize)
+		{
+			if (chunks.empty())
+			{
+				double start = os_GetSeconds();
+				readyCond.wait(lock, [this]() { return !chunks.empty() || (!reading && remaining == 0); });
+				stalls++;
+				stallTime += os_GetSeconds() - start;
+			}
+			if (!chunks.empty() && chunks.front().fad == fad && chunks.front().count == count)
+			{
+				Chunk& chunk = chunks.front();
+				memcpy(dest, chunk.data.data(), count * sectorSize);
+				freeBuffers.push_back(std::move(chunk.data));
+				chunks.pop_front();
+				deliverFad += count;
+				readSectors += count;
+				cond.notify_one();
+				return;
+			}
+		}
+		resetLocked();
+		lock.unlock();
+		libGDR_ReadSector(dest, fad, count, sectorSize);
+	}
+
+	// Discard pending reads
+	void cancel()
+	{
+		std::lock_guard<std::mutex> _(mutex);
+		resetLocked();
+	}
+
+	void term()
+	{
+		{
+			std::lock_guard<std::mutex> _(mutex);
+			resetLocked();
+			stopping = true;
+			cond.notify_one();
+		}
+		if (thread.joinable())
+			thread.join();
+		freeBuffers.clear();
+		if (readSectors != 0)
+			INFO_LOG(GDROM, "GD-ROM read ahead: %u sectors, %u stalls, %.1f ms stalled", readSectors, stalls, stallTime * 1000.0);
+		readSectors = 0;
+		stalls = 0;
+		stallTime = 0;
+	}
+
+private:
+	struct Chunk
+	{
+		u32 fad;
+		u32 count;
+		std::vector<u8> data;
+	};
+
+	void resetLocked()
+	{
+		generation++;
+		active = false;
+		remaining = 0;
+		while (!chunks.empty())
+		{
+			freeBuffers.push_back(std::move(chunks.front().data));
+			chunks.pop_front();
+		}
+	}
+
+	void run()
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		while (true)
+		{
+			cond.wait(lock, [this]() { return stopping || (remaining != 0 && chunks.size() < MaxChunks); });
+			if (stopping)
+				break;
+			Chunk chunk;
+			chunk.fad = nextFad;
+			chunk.count = std::min(remaining, ChunkSectors);
+			if (!freeBuffers.empty())
+			{
+				chunk.data = std::move(freeBuffers.back());
+				freeBuffers.pop_back();
+			}
+			chunk.data.resize(chunk.count * sectorSize);
+			const u32 size = sectorSize;
+			const u32 gen = generation;
+			nextFad += chunk.count;
+			remaining -= chunk.count;
+			reading = true;
+			lock.unlock();
+
+			libGDR_ReadSector(chunk.data.data(), chunk.fad, chunk.count, size);
+
+			lock.lock();
+			reading = false;
+			if (gen == generation)
+				chunks.push_back(std::move(chunk));
+			else
+				freeBuffers.push_back(std::move(chunk.data));
+			readyCond.notify_one();
+		}
+	}
+
+	// Same chunk size as the read buffer
+	static constexpr u32 ChunkSectors = 32;
+	static constexpr size_t MaxChunks = 4;
+
+	std::thread thread;
+	std::mutex mutex;
+	std::condition_variable cond;		// wakes up the I/O thread
+	std::condition_variable readyCond;	// wakes up the emulation thread
+	std::deque<Chunk> chunks;
+	std::vector<std::vector<u8>> freeBuffers;
+	bool active = false;
+	bool reading = false;
+	bool stopping = false;
+	u32 generation = 0;
+	u32 nextFad = 0;			// next sector to read
+	u32 remaining = 0;			// sectors left to read
+	u32 sectorSize = 0;
+	u32 deliverFad = 0;			// next sector expected by the emulation thread
+	// stats
+	u32 readSectors = 0;
+	u32 stalls = 0;
+	double stallTime = 0;
+};
+static ReadAhead readAhead;
+
 static void FillReadBuffer()
 {
 	read_buff.cache_index=0;
@@ -109,7 +428,7 @@ static void FillReadBuffer()
 
 	read_buff.cache_size=count*read_params.sector_type;
 
-	libGDR_ReadSector(read_buff.cache,read_params.start_sector,count,read_params.sector_type);
+	readAhead.read(read_buff.cache,read_params.start_sector,count,read_params.sector_type);
 	read_params.start_sector+=count;
 	read_params.remaining_sectors-=count;
 }
@@ -205,7 +524,10 @@ static void gd_set_state(gd_states state)
 			break;
 			
 		case gds_readsector_dma:
- 			FillReadBuffer();
+			// The read buffer is filled when the DMA transfer needs it
+			read_buff.cache_index = 0;
+			read_buff.cache_size = 0;
+			readAhead.start(read_params.start_sector, read_params.remaining_sectors, read_params.sector_type);
 			break;
 
 		case gds_pio_end:
@@ -301,6 +623,8 @@ static u32 GetFAD(u8* data, bool msf)
 //disk changes etc
 static void gd_disc_change()
 {
+	readAhead.cancel();
+	cddaStreamer.flush();
 	gd_setdisc();
 	read_params = { 0 };
 	set_mode_offset = 0;
@@ -869,6 +1193,7 @@ static void gd_process_spi_cmd()
 				cdda.repeats = packet_cmd.data_8[6] & 0xF;
 				cdda.status = cdda_t::Playing;
 				SecNumber.Status = GD_PLAY;
+				cddaStreamer.start(cdda);
 
 				GDStatus.DSC = 1;
 			}
@@ -912,6 +1237,7 @@ static void gd_process_spi_cmd()
 			{
 				bool min_sec_frame = param_type == 2;
 				cdda.StartAddr.FAD = cdda.CurrAddr.FAD = GetFAD(&packet_cmd.data_8[2], min_sec_frame);
+				cddaStreamer.start(cdda);
 #ifdef STRICT_MODE
 				SecNumber.Status = GD_SEEK;
 				GDStatus.DSC = 0;
@@ -925,6 +1251,7 @@ static void gd_process_spi_cmd()
 				//stop audio , goto home
 				cdda.StartAddr.FAD = cdda.CurrAddr.FAD = 150;
 				cdda.status = cdda_t::NoInfo;
+				cddaStreamer.flush();
 #ifdef STRICT_MODE
 				SecNumber.Status = GD_BUSY;
 				GDStatus.DSC = 0;
@@ -1306,6 +1633,8 @@ void gdrom_reg_Init()
 
 void gdrom_reg_Term()
 {
+	readAhead.term();
+	cddaStreamer.term();
 	sh4_sched_unregister(gdrom_schid);
 	gdrom_schid = -1;
 }
@@ -1400,6 +1729,8 @@ void deserialize(Deserializer& deser)
 
 	deser >> packet_cmd;
 	deser >> set_mode_offset;
+	readAhead.cancel();
+	cddaStreamer.flush();
 	deser >> read_params;
 	if (deser.version() >= Deserializer::V17)
 		deser >> read_buff;
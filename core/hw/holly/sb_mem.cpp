@@ -7,6 +7,7 @@
 #include "sb_mem.h"
 #include "sb.h"
 #include "hw/aica/aica_if.h"
+#include "hw/arm7/arm7.h"
 #include "hw/flashrom/nvmem.h"
 #include "hw/gdrom/gdrom_if.h"
 #include "hw/modem/modem.h"
@@ -242,6 +243,7 @@ void DYNACALL WriteMem_area0(u32 paddr, T data)
 	case 7:
 		// AICA ram
 		WriteMemArr(&aica::aica_ram[0], addr & ARAM_MASK, data);
+		aica::arm::invalidateCode(addr & ARAM_MASK);
 		return;
 
 	default:
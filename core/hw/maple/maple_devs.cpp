@@ -5,6 +5,7 @@
 #include "hw/pvr/spg.h"
 #include "audio/audiostream.h"
 #include "oslib/oslib.h"
+#include "oslib/savefile.h"
 #include "hw/aica/sgc_if.h"
 #include "cfg/option.h"
 #include "rend/gui.h"
@@ -324,7 +325,7 @@ u8 vmu_default[] = {
 
 struct maple_sega_vmu: maple_base
 {
-	FILE* file;
+	std::string savePath;
 	u8 flash_data[128_KB];
 	u8 lcd_data[192];
 	u8 lcd_data_decoded[48*32];
@@ -365,34 +366,29 @@ struct maple_sega_vmu: maple_base
 		verify(rv == Z_OK);
 		verify(dec_sz == sizeof(flash_data));
 
-		if (file != nullptr)
-		{
-			if (std::fwrite(flash_data, sizeof(flash_data), 1, file) != 1)
-				WARN_LOG(MAPLE, "Failed to write the VMU to disk");
-			if (std::fseek(file, 0, SEEK_SET) != 0)
-				WARN_LOG(MAPLE, "VMU: I/O error");
-		}
+		savefile::write(savePath, flash_data, sizeof(flash_data));
 	}
 
 	void OnSetup() override
 	{
 		memset(flash_data, 0, sizeof(flash_data));
 		memset(lcd_data, 0, sizeof(lcd_data));
-		std::string apath = hostfs::getVmuPath(logical_port);
+		savePath = hostfs::getVmuPath(logical_port);
 
-		file = nowide::fopen(apath.c_str(), "rb+");
+		// make sure pending writes to this VMU are on disk
+		savefile::flush();
+		FILE *file = nowide::fopen(savePath.c_str(), "rb");
 		if (file == nullptr)
 		{
-			INFO_LOG(MAPLE, "Unable to open VMU save file \"%s\", creating new file", apath.c_str());
-			file = nowide::fopen(apath.c_str(), "wb+");
-			if (file == nullptr)
-				ERROR_LOG(MAPLE, "Failed to create VMU save file \"%s\"", apath.c_str());
+			INFO_LOG(MAPLE, "Unable to open VMU save file \"%s\", creating new file", savePath.c_str());
 			initializeVmu();
 		}
-
-		if (file != nullptr)
+		else
+		{
 			if (std::fread(flash_data, sizeof(flash_data), 1, file) != 1)
 				WARN_LOG(MAPLE, "Failed to read the VMU from disk");
+			std::fclose(file);
+		}
 
 		u8 sum = 0;
 		for (u32 i = 0; i < sizeof(flash_data); i++)
@@ -403,12 +399,6 @@ struct maple_sega_vmu: maple_base
 			initializeVmu();
 	}
 
-	~maple_sega_vmu() override
-	{
-		if (file != nullptr)
-			std::fclose(file);
-	}
-
 	u32 dma(u32 cmd) override
 	{
 		//printf("maple_sega_vmu::dma Called for port %d:%d, Command %d\n", bus_id, bus_port, cmd);
@@ -615,21 +605,13 @@ struct maple_sega_vmu: maple_base
 							return MDRE_FileError; //invalid params
 						}
 						rptr(&flash_data[write_adr],write_len);
-
-						if (file != nullptr)
+						// written to disk in the background. An error is reported by the next write.
+						if (!savefile::write(savePath, flash_data, sizeof(flash_data)))
 						{
-							if (std::fseek(file, write_adr, SEEK_SET) != 0
-									|| std::fwrite(&flash_data[write_adr], write_len, 1, file) != 1)
-							{
-								WARN_LOG(MAPLE, "Failed to save VMU %s: I/O error", logical_port);
-								return MDRE_FileError; // I/O error
-							}
-							std::fflush(file);
-						}
-						else
-						{
-							INFO_LOG(MAPLE, "Failed to save VMU %s data", logical_port);
+							WARN_LOG(MAPLE, "Failed to save VMU %s: I/O error", logical_port);
+							return MDRE_FileError; // I/O error
 						}
+
 						return MDRS_DeviceReply;
 					}
 
@@ -20,6 +20,7 @@
 #include "hw/naomi/naomi_cart.h"
 #include <xxhash.h>
 #include "oslib/oslib.h"
+#include "oslib/savefile.h"
 #include "stdclass.h"
 #include "cfg/option.h"
 #include "network/output.h"
@@ -1199,6 +1200,8 @@ maple_naomi_jamma::maple_naomi_jamma()
 	}
 
 	std::string eeprom_file = hostfs::getArcadeFlashPath() + ".eeprom";
+	// make sure pending writes to the EEPROM are on disk
+	savefile::flush();
 	FILE* f = nowide::fopen(eeprom_file.c_str(), "rb");
 	if (f)
 	{
@@ -1510,15 +1513,9 @@ void maple_naomi_jamma::handle_86_subcommand()
 			size = std::min((int)sizeof(eeprom) - address, size);
 			memcpy(eeprom + address, dma_buffer_in + 4, size);
 
+			// written to disk in the background
 			std::string eeprom_file = hostfs::getArcadeFlashPath() + ".eeprom";
-			FILE* f = nowide::fopen(eeprom_file.c_str(), "wb");
-			if (f)
-			{
-				std::fwrite(eeprom, 1, sizeof(eeprom), f);
-				std::fclose(f);
-				INFO_LOG(MAPLE, "Saved EEPROM to %s", eeprom_file.c_str());
-			}
-			else
+			if (!savefile::write(eeprom_file, eeprom, sizeof(eeprom)))
 				WARN_LOG(MAPLE, "EEPROM SAVE FAILED to %s", eeprom_file.c_str());
 
 			w8(MDRS_JVSReply);
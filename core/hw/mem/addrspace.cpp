@@ -549,4 +549,10 @@ u32 getVramOffset(void *addr)
 	}
 }
 
+bool mapRamPage(void *dest, u32 offset, bool writable)
+{
+	offset &= RAM_MASK & ~PAGE_MASK;
+	return virtmem::map_view(dest, PAGE_SIZE, MAP_RAM_START_OFFSET + offset, writable);
+}
+
 } // namespace addrspace
@@ -80,5 +80,7 @@ bool bm_lockedWrite(u8* address); // FIXME rename?
 void protectVram(u32 addr, u32 size);
 void unprotectVram(u32 addr, u32 size);
 u32 getVramOffset(void *addr);
+// Maps a page of system RAM at dest, in an area reserved with virtmem::reserve_view_area()
+bool mapRamPage(void *dest, u32 offset, bool writable);
 
 } // namespace addrspace
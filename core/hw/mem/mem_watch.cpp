@@ -26,6 +26,7 @@ VramWatcher vramWatcher;
 RamWatcher ramWatcher;
 AicaRamWatcher aramWatcher;
 ElanRamWatcher elanWatcher;
+ScriptRamWatcher scriptWatcher;
 
 void AicaRamWatcher::protectMem(u32 addr, u32 size)
 {
@@ -74,5 +75,98 @@ u32 ElanRamWatcher::getMemOffset(void *p)
 	return (u32)((u8 *)p - RAM);
 }
 
+void ScriptRamWatcher::lockPage(u32 page)
+{
+	if (lockedPages[page] != 0)
+		return;
+	bm_LockPage(page * PAGE_SIZE);
+	lockedPages[page] = 1;
+}
+
+void ScriptRamWatcher::unlockPage(u32 page)
+{
+	if (lockedPages[page] == 0)
+		return;
+	lockedPages[page] = 0;
+	// Keep the protection of pages holding compiled code
+	if (!bm_RamPageHasBlocks(page * PAGE_SIZE))
+		bm_UnlockPage(page * PAGE_SIZE);
+}
+
+void ScriptRamWatcher::watch(u32 addr, u32 size)
+{
+	if (!enabled() || size == 0)
+		return;
+	if (watchCount.size() != RAM_SIZE / PAGE_SIZE)
+	{
+		watchCount.assign(RAM_SIZE / PAGE_SIZE, 0);
+		dirtyPages.assign(RAM_SIZE / PAGE_SIZE, 0);
+		lockedPages.assign(RAM_SIZE / PAGE_SIZE, 0);
+	}
+	for (u32 page = addr / PAGE_SIZE; page <= (addr + size - 1) / PAGE_SIZE; page++)
+		if (watchCount[page]++ == 0)
+			lockPage(page);
+	active = true;
+}
+
+void ScriptRamWatcher::unwatch(u32 addr, u32 size)
+{
+	if (!active || size == 0)
+		return;
+	for (u32 page = addr / PAGE_SIZE; page <= (addr + size - 1) / PAGE_SIZE; page++)
+	{
+		if (--watchCount[page] != 0)
+			continue;
+		dirtyPages[page] = 0;
+		unlockPage(page);
+	}
 }
 
+bool ScriptRamWatcher::isDirty(u32 addr, u32 size) const
+{
+	if (!active)
+		return true;
+	for (u32 page = addr / PAGE_SIZE; page <= (addr + size - 1) / PAGE_SIZE; page++)
+		if (dirtyPages[page] != 0)
+			return true;
+	return false;
+}
+
+void ScriptRamWatcher::protect()
+{
+	if (!active)
+		return;
+	for (u32 page = 0; page < dirtyPages.size(); page++)
+		if (dirtyPages[page] != 0)
+		{
+			dirtyPages[page] = 0;
+			if (watchCount[page] != 0)
+				lockPage(page);
+		}
+}
+
+void ScriptRamWatcher::invalidate()
+{
+	if (!active)
+		return;
+	for (u32 page = 0; page < watchCount.size(); page++)
+		if (watchCount[page] != 0)
+		{
+			dirtyPages[page] = 1;
+			// the protection is lost. It's restored by protect().
+			lockedPages[page] = 0;
+		}
+}
+
+void ScriptRamWatcher::reset()
+{
+	if (active)
+		for (u32 page = 0; page < lockedPages.size(); page++)
+			unlockPage(page);
+	active = false;
+	watchCount.clear();
+	dirtyPages.clear();
+	lockedPages.clear();
+}
+
+}
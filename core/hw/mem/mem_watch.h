@@ -26,6 +26,7 @@
 #include "hw/pvr/elan.h"
 #include "rend/TexCache.h"
 #include <unordered_map>
+#include <vector>
 
 namespace memwatch
 {
@@ -180,13 +181,67 @@ public:
 	}
 };
 
+// Write-protects the system RAM pages watched by scripts and records which ones have been written to
+class ScriptRamWatcher
+{
+	std::vector<u16> watchCount;
+	std::vector<u8> dirtyPages;
+	// Pages write-protected by this watcher
+	std::vector<u8> lockedPages;
+	bool active = false;
+
+	void lockPage(u32 page);
+	void unlockPage(u32 page);
+
+public:
+	void watch(u32 addr, u32 size);
+	void unwatch(u32 addr, u32 size);
+	bool isDirty(u32 addr, u32 size) const;
+	// Protects again the pages written since the last call
+	void protect();
+	// Flags all watched pages as written and unprotected, after a state load or a reset
+	void invalidate();
+	void reset();
+
+	bool hit(void *p)
+	{
+		if (!active)
+			return false;
+		u32 offset = bm_getRamOffset(p);
+		if (offset == (u32)-1 || watchCount[offset / PAGE_SIZE] == 0)
+			return false;
+		dirtyPages[offset / PAGE_SIZE] = 1;
+		// unlocked by the caller
+		lockedPages[offset / PAGE_SIZE] = 0;
+		return true;
+	}
+
+	static bool enabled() {
+#ifdef TARGET_NO_EXCEPTIONS
+		return false;
+#else
+		return true;
+#endif
+	}
+};
+
 extern VramWatcher vramWatcher;
 extern RamWatcher ramWatcher;
 extern AicaRamWatcher aramWatcher;
 extern ElanRamWatcher elanWatcher;
+extern ScriptRamWatcher scriptWatcher;
 
 inline static bool writeAccess(void *p)
 {
+	if (scriptWatcher.hit(p))
+	{
+		// Let the rollback watcher save the page first
+		if (config::GGPOEnable)
+			ramWatcher.hit(p);
+		// Discard the blocks compiled from this page. Blocks compiled later will lock it again.
+		bm_DiscardPage(bm_getRamOffset(p));
+		return true;
+	}
 	if (!config::GGPOEnable)
 		return false;
 	if (ramWatcher.hit(p))
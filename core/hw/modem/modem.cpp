@@ -28,6 +28,7 @@
 #include "network/picoppp.h"
 #include "serialize.h"
 #include "cfg/option.h"
+#include "replay.h"
 
 #ifndef NDEBUG
 #include "oslib/oslib.h"
@@ -266,7 +267,8 @@ static int modem_sched_func(int tag, int cycles, int jitter, void *arg)
 			dspram[0x208] = 0xff;	// 2.4 - 19.2 kpbs supported
 			dspram[0x209] = 0xbf;	// 21.6 - 33.6 kpbs supported, asymmetric supported
 
-			start_pico();
+			if (!replay::playing())
+				start_pico();
 			connect_state = CONNECTED;
 			callback_cycles = SH4_MAIN_CLOCK / 1000000 * 238;	// 238 us
 			data_sent = false;
@@ -294,7 +296,9 @@ static int modem_sched_func(int tag, int cycles, int jitter, void *arg)
 			// Let WinCE send data first to avoid choking it
 			if (!modem_regs.reg1e.RDBF && data_sent)
 			{
-				int c = read_pico();
+				int c = replay::playing() ? replay::playModemRead() : read_pico();
+				if (replay::recording())
+					replay::recordModemRead(c);
 				if (c >= 0)
 				{
 					//LOG("pppd received %02x", c);
@@ -531,7 +535,8 @@ static void ModemNormalWrite(u32 reg, u32 data)
 			if (sent_fp)
 				fputc(data, sent_fp);
 #endif
-			write_pico(data);
+			if (!replay::playing())
+				write_pico(data);
 			modem_regs.reg1e.TDBE = 0;
 		}
 		break;
@@ -163,6 +163,7 @@ ROM board internal layouts:
 #include "awcartridge.h"
 #include "awave_regs.h"
 #include "serialize.h"
+#include "cfg/option.h"
 
 u32 AWCartridge::ReadMem(u32 address, u32 size) {
 	verify(size != 1);
@@ -327,6 +328,16 @@ void AWCartridge::Init(LoadProgress *progress, std::vector<u8> *digest)
 	mpr_offset = decrypt16(0x58/2) | (decrypt16(0x5a/2) << 16);
 	INFO_LOG(NAOMI, "AWCartridge::SetKey rombd_key %02x mpr_offset %08x", rombd_key, mpr_offset);
 	device_reset();
+	if (config::NaomiDecryptCache)
+	{
+		decryptedRom.init(RomSize, [this](u32 offset, u8 *dest, u32 size) {
+			u16 *words = (u16 *)dest;
+			for (u32 i = 0; i < size / 2; i++)
+				words[i] = decrypt16(offset / 2 + i);
+		});
+		if (config::NaomiPredecrypt)
+			decryptedRom.prefetch();
+	}
 }
 
 void AWCartridge::SetKey(u32 key)
@@ -377,7 +388,18 @@ void AWCartridge::recalc_dma_offset(int mode)
 
 void *AWCartridge::GetDmaPtr(u32 &size)
 {
-	size = std::min(std::min(size, 32u), dma_limit - dma_offset);
+	size = std::min(size, dma_limit - dma_offset);
+	if ((dma_offset & 1) == 0)
+	{
+		u32 cachedSize = size;
+		u8 *p = decryptedRom.get(dma_offset, cachedSize);
+		if (p != nullptr)
+		{
+			size = cachedSize;
+			return p;
+		}
+	}
+	size = std::min(size, 32u);
 	u32 offset = dma_offset / 2;
 	for (u32 i = 0; i < size / 2; i++)
 		decrypted_buf[i] = decrypt16(offset + i);
@@ -13,6 +13,7 @@
 #define CORE_HW_NAOMI_AWCARTRIDGE_H_
 
 #include "naomi_cart.h"
+#include "decrypted_cache.h"
 
 class AWCartridge: public Cartridge
 {
@@ -41,6 +42,7 @@ private:
 	u32 epr_offset, mpr_file_offset;
 	u16 mpr_record_index, mpr_first_file_index;
 	u16 decrypted_buf[16];
+	DecryptedRomCache decryptedRom;
 
 	u32 dma_offset, dma_limit;
 
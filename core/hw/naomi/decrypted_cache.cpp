@@ -0,0 +1,89 @@
+/*
+	Copyright 2024 flyinghead
+
+	This file is part of Flycast.
+
+    Flycast is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    Flycast is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Flycast.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "decrypted_cache.h"
+#include "oslib/oslib.h"
+
+#include <algorithm>
+
+void DecryptedRomCache::init(u32 romSize, Decryptor decryptor)
+{
+	term();
+	// whole words only
+	this->romSize = romSize & ~1;
+	this->decryptor = decryptor;
+	pageCount = (this->romSize + PageSize - 1) / PageSize;
+	states.reset(new std::atomic<u8>[pageCount]());
+	pages.reset(new std::unique_ptr<u8[]>[pageCount]);
+}
+
+void DecryptedRomCache::prefetch()
+{
+	if (pageCount == 0)
+		return;
+	prefetchTask = std::async(std::launch::async, [this]() {
+		double start = os_GetSeconds();
+		u32 page = 0;
+		for (; page < pageCount && !stopping; page++)
+			fill(page);
+		if (page == pageCount)
+			INFO_LOG(NAOMI, "Cartridge ROM decrypted in %.0f ms", (os_GetSeconds() - start) * 1000.0);
+	});
+}
+
+void DecryptedRomCache::term()
+{
+	if (prefetchTask.valid())
+	{
+		stopping = true;
+		prefetchTask.get();
+		stopping = false;
+	}
+	pages.reset();
+	states.reset();
+	pageCount = 0;
+	romSize = 0;
+	decryptor = nullptr;
+}
+
+bool DecryptedRomCache::fill(u32 page)
+{
+	u8 state = Empty;
+	if (!states[page].compare_exchange_strong(state, Busy, std::memory_order_acquire))
+		return state == Ready;
+	const u32 offset = page * PageSize;
+	const u32 size = std::min(PageSize, romSize - offset);
+	pages[page].reset(new u8[size]);
+	decryptor(offset, pages[page].get(), size);
+	states[page].store(Ready, std::memory_order_release);
+
+	return true;
+}
+
+u8 *DecryptedRomCache::get(u32 offset, u32& size)
+{
+	if (offset >= romSize)
+		return nullptr;
+	const u32 page = offset / PageSize;
+	if (states[page].load(std::memory_order_acquire) != Ready && !fill(page))
+		return nullptr;
+	const u32 pageOffset = offset % PageSize;
+	size = std::min(size, std::min(PageSize - pageOffset, romSize - offset));
+
+	return &pages[page][pageOffset];
+}
@@ -0,0 +1,68 @@
+/*
+	Copyright 2024 flyinghead
+
+	This file is part of Flycast.
+
+    Flycast is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    Flycast is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Flycast.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+#include "types.h"
+
+#include <atomic>
+#include <functional>
+#include <future>
+#include <memory>
+
+//
+// Decrypted content of a cartridge ROM, for the encryption schemes where
+// the plain text only depends on the position in the ROM (M4 and Atomiswave).
+// Pages are decrypted on first access and then served as is.
+// They can also be decrypted in advance by a background thread.
+//
+class DecryptedRomCache
+{
+public:
+	// Must be a multiple of the M4 block size (32 bytes)
+	static constexpr u32 PageSize = 16_KB;
+	// Decrypts size bytes of the ROM at offset into dest. Called from the background thread too.
+	using Decryptor = std::function<void(u32 offset, u8 *dest, u32 size)>;
+
+	~DecryptedRomCache() { term(); }
+
+	void init(u32 romSize, Decryptor decryptor);
+	// Decrypts all the pages on a background thread
+	void prefetch();
+	void term();
+
+	// Returns the decrypted data at offset and clamps size to the end of the page.
+	// Returns nullptr if the cache is disabled, if offset is out of the ROM
+	// or if the page is being decrypted by the background thread.
+	u8 *get(u32 offset, u32& size);
+
+private:
+	enum PageState : u8 {
+		Empty,
+		Busy,
+		Ready
+	};
+	bool fill(u32 page);
+
+	u32 romSize = 0;
+	u32 pageCount = 0;
+	Decryptor decryptor;
+	std::unique_ptr<std::atomic<u8>[]> states;
+	std::unique_ptr<std::unique_ptr<u8[]>[]> pages;
+	std::atomic<bool> stopping { false };
+	std::future<void> prefetchTask;
+};
@@ -9,6 +9,11 @@
  */
 #include "m1cartridge.h"
 #include "serialize.h"
+#include "cfg/option.h"
+
+#include <algorithm>
+
+constexpr size_t MaxStreamsSize = 32_MB;
 
 M1Cartridge::M1Cartridge(u32 size) : NaomiCartridge(size)
 {
@@ -61,8 +66,43 @@ void M1Cartridge::wb(u8 byte)
 	buffer_actual_size++;
 }
 
+void M1Cartridge::startStream()
+{
+	streamPos = 0;
+	if (!config::NaomiDecryptCache)
+	{
+		stream = nullptr;
+		return;
+	}
+	if (streamsSize >= MaxStreamsSize)
+	{
+		streams.clear();
+		streamsSize = 0;
+	}
+	stream = &streams[rom_cur_address];
+}
+
 void M1Cartridge::enc_fill()
 {
+	if (stream != nullptr)
+	{
+		// Replay the output of a previous transfer up to the last checkpoint that fits
+		const u32 end = streamPos + sizeof(buffer) - buffer_actual_size;
+		auto it = std::upper_bound(stream->checkpoints.begin(), stream->checkpoints.end(), end,
+				[](u32 pos, const Checkpoint& cp) { return pos < cp.pos; });
+		if (it != stream->checkpoints.begin() && (--it)->pos > streamPos)
+		{
+			const u32 size = it->pos - streamPos;
+			memcpy(buffer + buffer_actual_size, &stream->data[streamPos], size);
+			buffer_actual_size += size;
+			streamPos = it->pos;
+			rom_cur_address = it->rom_cur_address;
+			avail_val = it->avail_val;
+			avail_bits = it->avail_bits;
+			stream_ended = it->stream_ended;
+		}
+	}
+	const u32 start = buffer_actual_size;
 	while (buffer_actual_size < sizeof(buffer) && !stream_ended)
 	{
 		switch (lookb(3)) {
@@ -109,6 +149,17 @@ void M1Cartridge::enc_fill()
 			}
 		}
 	}
+	if (stream != nullptr && buffer_actual_size != start)
+	{
+		const u32 size = buffer_actual_size - start;
+		if (streamPos == stream->data.size() && streamsSize < MaxStreamsSize)
+		{
+			stream->data.insert(stream->data.end(), buffer + start, buffer + buffer_actual_size);
+			stream->checkpoints.push_back({ streamPos + size, rom_cur_address, avail_val, avail_bits, stream_ended });
+			streamsSize += size;
+		}
+		streamPos += size;
+	}
 	while (buffer_actual_size < sizeof(buffer))
 		buffer[buffer_actual_size++] = 0;
 }
@@ -156,6 +207,8 @@ void M1Cartridge::Deserialize(Deserializer& deser)
 	deser >> stream_ended;
 	deser >> has_history;
 	deser >> encryption;
+	// The transfer in progress won't be cached
+	stream = nullptr;
 
 	NaomiCartridge::Deserialize(deser);
 }
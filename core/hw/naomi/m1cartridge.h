@@ -10,6 +10,9 @@
 #pragma once
 #include "naomi_cart.h"
 
+#include <unordered_map>
+#include <vector>
+
 class M1Cartridge : public NaomiCartridge
 {
 public:
@@ -47,6 +50,7 @@ protected:
 		{
 			//printf("M1 ENCRYPTION ON @ %08x\n", dma_offset);
 			encryption = true;
+			startStream();
 			enc_reset();
 			enc_fill();
 		}
@@ -97,6 +101,7 @@ private:
 
 	void wb(u8 byte);
 	void enc_fill();
+	void startStream();
 
 	u16 actel_id;
 
@@ -106,4 +111,25 @@ private:
 	u32 rom_cur_address, buffer_actual_size, avail_bits;
 	bool stream_ended, has_history;
 	bool encryption;
+
+	// Decompressed output of the previous transfers, by start offset.
+	// The decoder state is saved at the end of each buffer fill so that
+	// the output can be replayed up to a checkpoint and decoding resumed from there.
+	struct Checkpoint
+	{
+		u32 pos;	// offset in the decompressed data
+		u32 rom_cur_address;
+		u64 avail_val;
+		u32 avail_bits;
+		bool stream_ended;
+	};
+	struct Stream
+	{
+		std::vector<u8> data;
+		std::vector<Checkpoint> checkpoints;
+	};
+	std::unordered_map<u32, Stream> streams;
+	size_t streamsSize = 0;
+	Stream *stream = nullptr;	// current transfer
+	u32 streamPos = 0;			// decompressed size of the current transfer
 };
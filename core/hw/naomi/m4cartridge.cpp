@@ -10,6 +10,7 @@
 
 #include "m4cartridge.h"
 #include "serialize.h"
+#include "cfg/option.h"
 
 
 // Decoder for M4-type NAOMI cart encryption
@@ -227,7 +228,7 @@ void M4Cartridge::enc_reset()
 	counter = 0;
 }
 
-u16 M4Cartridge::decrypt_one_round(u16 word, u16 subkey)
+u16 M4Cartridge::decrypt_one_round(u16 word, u16 subkey) const
 {
 	return one_round[word ^ subkey] ^ subkey ;
 }
@@ -248,15 +249,28 @@ u16 M4Cartridge::decrypt(u16 enc)
 
 void M4Cartridge::enc_fill()
 {
-	const u8 *base = RomPtr + rom_cur_address;
 	while (buffer_actual_size < sizeof(buffer))
 	{
+		if (counter == 0 && (rom_cur_address & 31) == 0)
+		{
+			// Whole blocks starting on a 32-byte boundary decrypt the same as in the cache
+			u32 size = (sizeof(buffer) - buffer_actual_size) & ~31;
+			const u8 *p = size != 0 ? decryptedRom.get(rom_cur_address, size) : nullptr;
+			size &= ~31;
+			if (p != nullptr && size != 0)
+			{
+				memcpy(buffer + buffer_actual_size, p, size);
+				buffer_actual_size += size;
+				rom_cur_address += size;
+				continue;
+			}
+		}
+		const u8 *base = RomPtr + rom_cur_address;
 		u16 dec = decrypt(base[0] | (base[1] << 8));
 
 		buffer[buffer_actual_size++] = dec;
 		buffer[buffer_actual_size++] = dec >> 8;
 
-		base += 2;
 		rom_cur_address += 2;
 	}
 //	printf("Decrypted M4 data:\n");
@@ -271,6 +285,29 @@ void M4Cartridge::enc_fill()
 
 }
 
+// The decrypted ROM is the output of transfers starting on a 32-byte boundary
+void M4Cartridge::initDecryptedRom()
+{
+	if (!config::NaomiDecryptCache)
+		return;
+	decryptedRom.init(RomSize, [this](u32 offset, u8 *dest, u32 size) {
+		const u8 *src = RomPtr + offset;
+		u16 iv = 0;
+		for (u32 i = 0; i < size / 2; i++, src += 2)
+		{
+			if (i % 16 == 0)
+				iv = 0;
+			u16 dec = iv;
+			iv = decrypt_one_round((src[0] | (src[1] << 8)) ^ iv, subkey1);
+			dec ^= decrypt_one_round(iv, subkey2);
+			*dest++ = dec;
+			*dest++ = dec >> 8;
+		}
+	});
+	if (config::NaomiPredecrypt)
+		decryptedRom.prefetch();
+}
+
 bool M4Cartridge::Write(u32 offset, u32 size, u32 data)
 {
 	if (((offset&0xffff) == 0x00aa) && (data == 0x0098))
@@ -282,6 +319,7 @@ bool M4Cartridge::Write(u32 offset, u32 size, u32 data)
 
 M4Cartridge::~M4Cartridge()
 {
+	decryptedRom.term();
 	free(m_key_data);
 }
 
@@ -14,6 +14,7 @@
 
 #include "naomi_cart.h"
 #include "naomi_regs.h"
+#include "decrypted_cache.h"
 
 class M4Cartridge: public NaomiCartridge {
 public:
@@ -24,6 +25,7 @@ public:
 	{
 		device_start();
 		device_reset();
+		initDecryptedRom();
 	}
 
 	u32 ReadMem(u32 address, u32 size) override
@@ -76,10 +78,12 @@ private:
 	bool encryption;
 	bool cfi_mode;
 	bool xfer_ready;
+	DecryptedRomCache decryptedRom;
 
 	void enc_init();
 	void enc_fill();
-	u16 decrypt_one_round(u16 word, u16 subkey);
+	u16 decrypt_one_round(u16 word, u16 subkey) const;
+	void initDecryptedRom();
 };
 
 #endif /* CORE_HW_NAOMI_M4CARTRIDGE_H_ */
@@ -19,6 +19,8 @@
 // license:BSD-3-Clause
 // copyright-holders:MetalliC
 
+#include <atomic>
+#include <future>
 #include <memory>
 #include "naomi_cart.h"
 #include "naomi_regs.h"
@@ -45,6 +47,14 @@
 #include "netdimm.h"
 #include "systemsp.h"
 #include "hopper.h"
+#include <xxhash.h>
+#include <nowide/cstdio.hpp>
+#ifdef _WIN32
+#include <windows.h>
+#include <io.h>
+#elif !defined(__SWITCH__)
+#include <sys/mman.h>
+#endif
 
 Cartridge *CurrentCartridge;
 bool bios_loaded = false;
@@ -206,6 +216,270 @@ void naomi_cart_LoadBios(const char *filename)
 	bios_loaded = true;
 }
 
+// Opens a ROM file by CRC, or by name if not found
+static ArchiveFile *openRomFile(Archive *archive, Archive *parentArchive, int romid, const Game *game, bool *foundByCrc = nullptr)
+{
+	const auto& blob = game->blobs[romid];
+	ArchiveFile *file = nullptr;
+	// Find by CRC
+	if (archive != nullptr)
+		file = archive->OpenFileByCrc(blob.crc);
+	if (file == nullptr && parentArchive != nullptr)
+		file = parentArchive->OpenFileByCrc(blob.crc);
+	if (file != nullptr)
+		return file;
+	if (foundByCrc != nullptr)
+		*foundByCrc = false;
+	// Fallback to find by filename
+	if (archive != nullptr)
+		file = archive->OpenFile(blob.filename);
+	if (file == nullptr && parentArchive != nullptr)
+		file = parentArchive->OpenFile(blob.filename);
+	if (file == nullptr)
+		WARN_LOG(NAOMI, "%s: Cannot open %s", game->name, blob.filename);
+
+	return file;
+}
+
+//
+// Concurrent loading of the cartridge ROM files.
+// Each worker thread takes the next file to load and decompresses it straight into the cartridge ROM.
+//
+struct RomLoader
+{
+	RomLoader(const Game *game, int romCount) : game(game), romCount(romCount) {}
+
+	void run(Archive *archive, Archive *parentArchive)
+	{
+		try {
+			for (int romid = nextRom++; romid < romCount && !cancelled; romid = nextRom++)
+			{
+				const BlobType type = game->blobs[romid].blob_type;
+				if (type == Normal || type == InterleavedWord)
+					load(archive, parentArchive, romid);
+				loadedRoms++;
+			}
+		} catch (...) {
+			cancelled = true;
+			throw;
+		}
+	}
+
+	const Game * const game;
+	const int romCount;
+	std::atomic<int> nextRom { 0 };
+	std::atomic<int> loadedRoms { 0 };
+	std::atomic<bool> cancelled { false };
+	std::atomic<bool> foundByCrc { true };
+
+private:
+	void load(Archive *archive, Archive *parentArchive, int romid)
+	{
+		const auto& blob = game->blobs[romid];
+		bool byCrc = true;
+		std::unique_ptr<ArchiveFile> file(openRomFile(archive, parentArchive, romid, game, &byCrc));
+		if (!file)
+			throw NaomiCartException(std::string("Cannot find ") + blob.filename);
+		if (!byCrc)
+			foundByCrc = false;
+		u32 len = blob.length;
+		if (blob.blob_type == Normal)
+		{
+			u8 *dst = (u8 *)CurrentCartridge->GetPtr(blob.offset, len);
+			if (dst == nullptr)
+				throw NaomiCartException(std::string("Invalid ROM: truncated ") + blob.filename);
+			u32 read = file->Read(dst, blob.length);
+			DEBUG_LOG(NAOMI, "Mapped %s: %x bytes at %07x", blob.filename, read, blob.offset);
+		}
+		else
+		{
+			u16 *to = (u16 *)CurrentCartridge->GetPtr(blob.offset, len);
+			if (to == nullptr)
+				throw NaomiCartException(std::string("Invalid ROM: truncated ") + blob.filename);
+			u16 buf[8192];
+			u32 read = 0;
+			while (read < blob.length)
+			{
+				u32 chunk = file->Read(buf, std::min<u32>(sizeof(buf), blob.length - read));
+				if (chunk == 0)
+					break;
+				for (u32 i = 0; i < chunk / 2; i++, to += 2)
+					*to = buf[i];
+				read += chunk;
+			}
+			DEBUG_LOG(NAOMI, "Mapped %s: %x bytes (interleaved word) at %07x", blob.filename, read, blob.offset);
+		}
+	}
+};
+
+static void loadRomBlobs(const Game *game, int romCount, const std::string& path, const std::string& parentPath,
+		Archive *archive, Archive *parentArchive, LoadProgress *progress, bool& foundByCrc)
+{
+	RomLoader loader(game, romCount);
+	// Solid archives (7z) must be extracted sequentially
+	int threadCount = 1;
+	if ((archive == nullptr || archive->independentFiles())
+			&& (parentArchive == nullptr || parentArchive->independentFiles()))
+		threadCount = std::min<int>({ romCount, (int)std::thread::hardware_concurrency(), 8 });
+
+	std::vector<std::future<void>> workers;
+	// The first worker uses the archives already opened
+	workers.push_back(std::async(std::launch::async, [&]() {
+		loader.run(archive, parentArchive);
+	}));
+	for (int i = 1; i < threadCount; i++)
+		workers.push_back(std::async(std::launch::async, [&]() {
+			std::unique_ptr<Archive> threadArchive(archive != nullptr ? OpenArchive(path) : nullptr);
+			std::unique_ptr<Archive> threadParent(parentArchive != nullptr ? OpenArchive(parentPath) : nullptr);
+			loader.run(threadArchive.get(), threadParent.get());
+		}));
+
+	for (auto& worker : workers)
+	{
+		while (worker.wait_for(std::chrono::milliseconds(20)) == std::future_status::timeout)
+		{
+			if (progress == nullptr)
+				continue;
+			if (progress->cancelled)
+				loader.cancelled = true;
+			else if (game->cart_type != GD)
+			{
+				static std::string label;
+				label = "ROM " + std::to_string(loader.loadedRoms + 1);
+				progress->label = label.c_str();
+				progress->progress = (float)loader.loadedRoms / romCount;
+			}
+		}
+	}
+	std::exception_ptr error;
+	for (auto& worker : workers)
+		try {
+			worker.get();
+		} catch (...) {
+			if (!error)
+				error = std::current_exception();
+		}
+	if (error)
+		std::rethrow_exception(error);
+	if (loader.cancelled)
+		throw LoadCancelledException();
+	foundByCrc = loader.foundByCrc;
+}
+
+//
+// Flat ROM image cache.
+// The cartridge ROM is saved once loaded and mapped in memory on the next launches.
+// Only used when all files are found by CRC so the image only depends on the ROM set definition.
+//
+constexpr u32 RomCacheVersion = 1;
+// Must be a multiple of the mapping granularity (64 KB on Windows)
+constexpr size_t RomCacheDataOffset = 64_KB;
+
+struct RomCacheHeader
+{
+	char magic[8];
+	u32 version;
+	u32 romSize;
+	u64 key;
+};
+
+static u64 romCacheKey(const Game *game)
+{
+	std::vector<u32> data;
+	data.push_back(game->size);
+	for (int romid = 0; game->blobs[romid].filename != nullptr; romid++)
+	{
+		const auto& blob = game->blobs[romid];
+		data.push_back(blob.offset);
+		data.push_back(blob.length);
+		data.push_back(blob.crc);
+		data.push_back(blob.blob_type);
+		data.push_back(blob.src_offset);
+	}
+	return XXH64(data.data(), data.size() * sizeof(u32), XXH64(game->name, strlen(game->name), 0));
+}
+
+static std::string romCachePath(const Game *game)
+{
+	return get_writable_data_path("romcache/") + game->name + ".rom";
+}
+
+// Only plain ROM boards are cached. GD-ROM cartridges load their content from the GD-ROM image
+// and System SP carts write their flash to the ROM area.
+static bool isRomCacheable(const Game *game)
+{
+	switch (game->cart_type)
+	{
+	case M1:
+	case M2:
+	case AW:
+		return true;
+	case M4:
+		return game->bios == nullptr || strcmp(game->bios, "segasp") != 0;
+	default:
+		return false;
+	}
+}
+
+static bool loadRomCache(const Game *game)
+{
+	FILE *f = nowide::fopen(romCachePath(game).c_str(), "rb");
+	if (f == nullptr)
+		return false;
+	RomCacheHeader header;
+	bool rc = fread(&header, sizeof(header), 1, f) == 1
+			&& !memcmp(header.magic, "FCROMIMG", sizeof(header.magic))
+			&& header.version == RomCacheVersion
+			&& header.romSize == CurrentCartridge->GetRomSize()
+			&& header.key == romCacheKey(game)
+			&& CurrentCartridge->MapRomImage(f, RomCacheDataOffset);
+	fclose(f);
+	if (rc)
+		INFO_LOG(NAOMI, "Loaded ROM image from cache");
+	else
+		WARN_LOG(NAOMI, "Invalid ROM cache for %s", game->name);
+
+	return rc;
+}
+
+static void saveRomCache(const Game *game)
+{
+	std::string dir = get_writable_data_path("romcache");
+	if (!file_exists(dir))
+		make_directory(dir);
+	const std::string path = romCachePath(game);
+	const std::string tmpPath = path + ".tmp";
+	FILE *f = nowide::fopen(tmpPath.c_str(), "wb");
+	if (f == nullptr)
+	{
+		WARN_LOG(NAOMI, "Can't create ROM cache %s", tmpPath.c_str());
+		return;
+	}
+	RomCacheHeader header{};
+	memcpy(header.magic, "FCROMIMG", sizeof(header.magic));
+	header.version = RomCacheVersion;
+	header.romSize = CurrentCartridge->GetRomSize();
+	header.key = romCacheKey(game);
+	std::vector<u8> padding(RomCacheDataOffset - sizeof(header));
+	bool rc = fwrite(&header, sizeof(header), 1, f) == 1
+			&& fwrite(padding.data(), padding.size(), 1, f) == 1
+			&& fwrite(CurrentCartridge->GetRomPtr(), header.romSize, 1, f) == 1;
+	rc = fclose(f) == 0 && rc;
+	// Only replace the previous image when complete
+	if (rc)
+	{
+		nowide::remove(path.c_str());
+		rc = nowide::rename(tmpPath.c_str(), path.c_str()) == 0;
+	}
+	if (rc)
+		INFO_LOG(NAOMI, "Saved ROM image to %s", path.c_str());
+	else
+	{
+		WARN_LOG(NAOMI, "Can't write ROM cache %s", path.c_str());
+		nowide::remove(tmpPath.c_str());
+	}
+}
+
 static void loadMameRom(const std::string& path, const std::string& fileName, LoadProgress *progress)
 {
 	const Game *game = FindGame(fileName.c_str());
@@ -218,9 +492,10 @@ static void loadMameRom(const std::string& path, const std::string& fileName, Lo
 		INFO_LOG(NAOMI, "Opened %s", path.c_str());
 
 	std::unique_ptr<Archive> parent_archive;
+	std::string parentPath;
 	if (game->parent_name != nullptr)
 	{
-		std::string parentPath = hostfs::storage().getParentPath(path);
+		parentPath = hostfs::storage().getParentPath(path);
 		parentPath = hostfs::storage().getSubPath(parentPath, game->parent_name);
 		parent_archive.reset(OpenArchive(parentPath));
 		if (parent_archive != nullptr)
@@ -290,133 +565,93 @@ static void loadMameRom(const std::string& path, const std::string& fileName, Lo
 		int romCount = 0;
 		while (game->blobs[romCount].filename != nullptr)
 			romCount++;
+		const double startTime = os_GetSeconds();
+		const bool cacheable = config::NaomiRomCache && isRomCacheable(game);
+		const bool cached = cacheable && loadRomCache(game);
+		bool foundByCrc = true;
+		if (!cached)
+			loadRomBlobs(game, romCount, path, parentPath, archive.get(), parent_archive.get(), progress, foundByCrc);
+
 		for (int romid = 0; romid < romCount; romid++)
 		{
-			if (progress != nullptr)
-			{
-				if (progress->cancelled)
-					throw LoadCancelledException();
-				if (game->cart_type != GD)
-				{
-					static std::string label;
-					label = "ROM " + std::to_string(romid + 1);
-					progress->label = label.c_str();
-					progress->progress = (float)(romid + 1) / romCount;
-				}
-			}
-
 			u32 len = game->blobs[romid].length;
 
-			if (game->blobs[romid].blob_type == Copy)
-			{
-				u8 *dst = (u8 *)CurrentCartridge->GetPtr(game->blobs[romid].offset, len);
-				u8 *src = (u8 *)CurrentCartridge->GetPtr(game->blobs[romid].src_offset, len);
-				if (dst == nullptr || src == nullptr)
-					throw NaomiCartException("Invalid ROM");
-				memcpy(dst, src, game->blobs[romid].length);
-				DEBUG_LOG(NAOMI, "Copied: %x bytes from %07x to %07x", game->blobs[romid].length, game->blobs[romid].src_offset, game->blobs[romid].offset);
-			}
-			else
+			switch (game->blobs[romid].blob_type)
 			{
-				std::unique_ptr<ArchiveFile> file;
-				// Find by CRC
-				if (archive != NULL)
-					file.reset(archive->OpenFileByCrc(game->blobs[romid].crc));
-				if (!file && parent_archive != NULL)
-					file.reset(parent_archive->OpenFileByCrc(game->blobs[romid].crc));
-				// Fallback to find by filename
-				if (!file && archive != NULL)
-					file.reset(archive->OpenFile(game->blobs[romid].filename));
-				if (!file && parent_archive != NULL)
-					file.reset(parent_archive->OpenFile(game->blobs[romid].filename));
-				if (!file) {
-					WARN_LOG(NAOMI, "%s: Cannot open %s", fileName.c_str(), game->blobs[romid].filename);
-					if (game->blobs[romid].blob_type != Eeprom)
-						// Default eeprom file is optional
-						throw NaomiCartException(std::string("Cannot find ") + game->blobs[romid].filename);
-					else
-						continue;
-				}
-				switch (game->blobs[romid].blob_type)
-				{
-					case Normal:
+				case Copy:
+					if (!cached)
+					{
+						u8 *dst = (u8 *)CurrentCartridge->GetPtr(game->blobs[romid].offset, len);
+						u8 *src = (u8 *)CurrentCartridge->GetPtr(game->blobs[romid].src_offset, len);
+						if (dst == nullptr || src == nullptr)
+							throw NaomiCartException("Invalid ROM");
+						memcpy(dst, src, game->blobs[romid].length);
+						DEBUG_LOG(NAOMI, "Copied: %x bytes from %07x to %07x", game->blobs[romid].length, game->blobs[romid].src_offset, game->blobs[romid].offset);
+					}
+					break;
+
+				case Normal:
+				case InterleavedWord:
+					if (config::GGPOEnable)
+						md5.add((u8 *)CurrentCartridge->GetPtr(game->blobs[romid].offset, len), game->blobs[romid].length);
+					break;
+
+				case Key:
+					{
+						std::unique_ptr<ArchiveFile> file(openRomFile(archive.get(), parent_archive.get(), romid, game));
+						if (!file)
+							throw NaomiCartException(std::string("Cannot find ") + game->blobs[romid].filename);
+						u8 *buf = (u8 *)malloc(game->blobs[romid].length);
+						if (buf == nullptr)
+							throw NaomiCartException("Memory allocation failed");
+
+						u32 read = file->Read(buf, game->blobs[romid].length);
+						CurrentCartridge->SetKeyData(buf);
+						if (config::GGPOEnable)
+							md5.add(buf, game->blobs[romid].length);
+						DEBUG_LOG(NAOMI, "Loaded %s: %x bytes cart key", game->blobs[romid].filename, read);
+					}
+					break;
+
+				case Eeprom:
+					{
+						std::unique_ptr<ArchiveFile> file(openRomFile(archive.get(), parent_archive.get(), romid, game));
+						if (!file)
+							// Default eeprom file is optional
+							continue;
+						if (game->blobs[romid].length == 0x84)
 						{
-							u8 *dst = (u8 *)CurrentCartridge->GetPtr(game->blobs[romid].offset, len);
-							if (dst == nullptr)
-								throw NaomiCartException(std::string("Invalid ROM: truncated ") + game->blobs[romid].filename);
-							u32 read = file->Read(dst, game->blobs[romid].length);
+							// on-cart X76F100 security eeprom
+							u8 data[0x84];
+							u32 read = file->Read(data, sizeof(data));
 							if (config::GGPOEnable)
-								md5.add(dst, game->blobs[romid].length);
-							DEBUG_LOG(NAOMI, "Mapped %s: %x bytes at %07x", game->blobs[romid].filename, read, game->blobs[romid].offset);
+								md5.add(data, sizeof(data));
+							setGameSerialId(data);
+							DEBUG_LOG(NAOMI, "Loaded %s: %x bytes rom serial eeprom", game->blobs[romid].filename, read);
 						}
-						break;
-
-					case InterleavedWord:
+						else
 						{
-							u8 *buf = (u8 *)malloc(game->blobs[romid].length);
-							if (buf == nullptr)
+							naomi_default_eeprom = (u8 *)malloc(game->blobs[romid].length);
+							if (naomi_default_eeprom == nullptr)
 								throw NaomiCartException("Memory allocation failed");
 
-							u32 read = file->Read(buf, game->blobs[romid].length);
-							u16 *to = (u16 *)CurrentCartridge->GetPtr(game->blobs[romid].offset, len);
-							if (to == nullptr)
-								throw NaomiCartException(std::string("Invalid ROM: truncated ") + game->blobs[romid].filename);
-							u16 *from = (u16 *)buf;
-							for (int i = game->blobs[romid].length / 2; --i >= 0; to++)
-								*to++ = *from++;
-							free(buf);
+							u32 read = file->Read(naomi_default_eeprom, game->blobs[romid].length);
 							if (config::GGPOEnable)
-								md5.add((u8*)CurrentCartridge->GetPtr(game->blobs[romid].offset, len), game->blobs[romid].length);
-							DEBUG_LOG(NAOMI, "Mapped %s: %x bytes (interleaved word) at %07x", game->blobs[romid].filename, read, game->blobs[romid].offset);
+								md5.add(naomi_default_eeprom, game->blobs[romid].length);
+							DEBUG_LOG(NAOMI, "Loaded %s: %x bytes default eeprom", game->blobs[romid].filename, read);
 						}
-						break;
+					}
+					break;
 
-					case Key:
-						{
-							u8 *buf = (u8 *)malloc(game->blobs[romid].length);
-							if (buf == nullptr)
-								throw NaomiCartException("Memory allocation failed");
-
-							u32 read = file->Read(buf, game->blobs[romid].length);
-							CurrentCartridge->SetKeyData(buf);
-							if (config::GGPOEnable)
-								md5.add(buf, game->blobs[romid].length);
-							DEBUG_LOG(NAOMI, "Loaded %s: %x bytes cart key", game->blobs[romid].filename, read);
-						}
-						break;
-
-					case Eeprom:
-						{
-							if (game->blobs[romid].length == 0x84)
-							{
-								// on-cart X76F100 security eeprom
-								u8 data[0x84];
-								u32 read = file->Read(data, sizeof(data));
-								if (config::GGPOEnable)
-									md5.add(data, sizeof(data));
-								setGameSerialId(data);
-								DEBUG_LOG(NAOMI, "Loaded %s: %x bytes rom serial eeprom", game->blobs[romid].filename, read);
-							}
-							else
-							{
-								naomi_default_eeprom = (u8 *)malloc(game->blobs[romid].length);
-								if (naomi_default_eeprom == nullptr)
-									throw NaomiCartException("Memory allocation failed");
-
-								u32 read = file->Read(naomi_default_eeprom, game->blobs[romid].length);
-								if (config::GGPOEnable)
-									md5.add(naomi_default_eeprom, game->blobs[romid].length);
-								DEBUG_LOG(NAOMI, "Loaded %s: %x bytes default eeprom", game->blobs[romid].filename, read);
-							}
-						}
-						break;
-
-					default:
-						die("Unknown blob type\n");
-						break;
-				}
+				default:
+					die("Unknown blob type\n");
+					break;
 			}
 		}
+		// Files found by name may not match the ROM set definition
+		if (cacheable && !cached && foundByCrc)
+			saveRomCache(game);
+		INFO_LOG(NAOMI, "ROM loaded in %.0f ms%s", (os_GetSeconds() - startTime) * 1000.0, cached ? " from cache" : "");
 		if (naomi_default_eeprom == NULL && game->eeprom_dump != NULL)
 			naomi_default_eeprom = game->eeprom_dump;
 		if (game->rotation_flag == ROT270)
@@ -817,10 +1052,50 @@ Cartridge::Cartridge(u32 size)
 
 Cartridge::~Cartridge()
 {
-	if (RomPtr != NULL)
+	if (RomMapped)
+	{
+#ifdef _WIN32
+		UnmapViewOfFile(RomPtr);
+#elif !defined(__SWITCH__)
+		munmap(RomPtr, RomSize);
+#endif
+	}
+	else if (RomPtr != NULL)
 		free(RomPtr);
 }
 
+bool Cartridge::MapRomImage(FILE *file, size_t offset)
+{
+	if (RomSize == 0)
+		return false;
+#if defined(_WIN32)
+	HANDLE fileHandle = (HANDLE)_get_osfhandle(_fileno(file));
+	HANDLE mapping = CreateFileMapping(fileHandle, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+	if (mapping == NULL)
+		return false;
+	void *p = MapViewOfFile(mapping, FILE_MAP_COPY, (DWORD)((u64)offset >> 32), (DWORD)offset, RomSize);
+	// The view keeps a reference to the mapping
+	CloseHandle(mapping);
+	if (p == nullptr)
+		return false;
+#elif !defined(__SWITCH__)
+	void *p = mmap(nullptr, RomSize, PROT_READ | PROT_WRITE, MAP_PRIVATE, fileno(file), offset);
+	if (p == MAP_FAILED)
+		return false;
+#else
+	// No file mapping: read the image
+	if (fseek(file, offset, SEEK_SET) != 0)
+		return false;
+	return fread(RomPtr, RomSize, 1, file) == 1;
+#endif
+#if defined(_WIN32) || !defined(__SWITCH__)
+	free(RomPtr);
+	RomPtr = (u8 *)p;
+	RomMapped = true;
+	return true;
+#endif
+}
+
 bool Cartridge::Read(u32 offset, u32 size, void* dst)
 {
 	offset &= 0x1FFFFFFF;
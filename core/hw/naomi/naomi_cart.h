@@ -70,12 +70,18 @@ public:
 	virtual void SetKey(u32 key) { }
 	virtual void SetKeyData(u8 *key_data) { }
 	virtual bool GetBootId(RomBootID *bootId) = 0;
+	// Replaces the ROM content with a copy-on-write mapping of the file at the given offset.
+	// The offset must be a multiple of 64 KB.
+	bool MapRomImage(FILE *file, size_t offset);
+	const u8 *GetRomPtr() const { return RomPtr; }
+	u32 GetRomSize() const { return RomSize; }
 
 	const Game *game = nullptr;
 
 protected:
 	u8* RomPtr;
 	u32 RomSize;
+	bool RomMapped = false;
 };
 
 class NaomiCartridge : public Cartridge
@@ -31,6 +31,7 @@
 #include "network/naomi_network.h"
 #include "emulator.h"
 #include "rend/gui.h"
+#include "replay.h"
 
 #include <chrono>
 #include <memory>
@@ -74,8 +75,17 @@ void NaomiM3Comm::connectNetwork()
 {
 	gui_display_notification("Network started", 5000);
 	packet_number = 0;
-	slot_count = naomiNetwork.getSlotCount();
-	slot_id = naomiNetwork.getSlotId();
+	if (replay::playing())
+	{
+		replay::playNetworkSlots(slot_count, slot_id);
+	}
+	else
+	{
+		slot_count = naomiNetwork.getSlotCount();
+		slot_id = naomiNetwork.getSlotId();
+		if (replay::recording())
+			replay::recordNetworkSlots(slot_count, slot_id);
+	}
 	if (slot_count >= 2)
 	{
 		connectedState();
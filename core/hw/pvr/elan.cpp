@@ -65,6 +65,13 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#if HOST_CPU == CPU_X86 || HOST_CPU == CPU_X64
+#include <xmmintrin.h>
+#define ELAN_SSE
+#elif HOST_CPU == CPU_ARM64 || (HOST_CPU == CPU_ARM && defined(__ARM_NEON__))
+#include <arm_neon.h>
+#define ELAN_NEON
+#endif
 
 namespace elan {
 
@@ -611,6 +618,42 @@ static void setModelColors(glm::vec4& baseCol0, glm::vec4& offsetCol0, glm::vec4
 		offsetCol1 = gmpSpecularColor1;
 }
 
+// Packed colors that are constant for all the vertices of a list
+struct ListColors
+{
+	u32 baseCol0;
+	u32 offsetCol0;
+	u32 baseCol1;
+	u32 offsetCol1;
+	bool modelBaseCol0;	// vertex base colors are overridden by the model colors
+	bool modelBaseCol1;
+};
+static ListColors listColors;
+
+static void updateListColors()
+{
+	glm::vec4 baseCol0(1);
+	glm::vec4 offsetCol0(0);
+	glm::vec4 baseCol1(1);
+	glm::vec4 offsetCol1(0);
+	setModelColors(baseCol0, offsetCol0, baseCol1, offsetCol1);
+	listColors.baseCol0 = packColor(baseCol0);
+	listColors.offsetCol0 = packColor(offsetCol0);
+	listColors.baseCol1 = packColor(baseCol1);
+	listColors.offsetCol1 = packColor(offsetCol1);
+	listColors.modelBaseCol0 = curGmp != nullptr && curGmp->paramSelect.d0;
+	listColors.modelBaseCol1 = curGmp != nullptr && curGmp->paramSelect.d1;
+}
+
+// Same as packColor(unpackColor(argb)), which is lossless, without the float round trip
+static u32 repackColor(u32 argb)
+{
+	if (packColor == packColorBGRA)
+		return argb;
+	else
+		return (argb & 0xff00ff00) | ((argb >> 16) & 0xff) | ((argb & 0xff) << 16);
+}
+
 template <typename T>
 static void convertVertex(const T& vs, Vertex& vd);
 
@@ -620,16 +663,10 @@ void convertVertex(const N2_VERTEX& vs, Vertex& vd)
 	setCoords(vd, vs.x, vs.y, vs.z);
 	setNormal(vd, vs);
 	SetEnvMapUV(vd);
-	glm::vec4 baseCol0(1);
-	glm::vec4 offsetCol0(0);
-	glm::vec4 baseCol1(1);
-	glm::vec4 offsetCol1(0);
-	setModelColors(baseCol0, offsetCol0, baseCol1, offsetCol1);
-
-	*(u32 *)vd.col = packColor(baseCol0);
-	*(u32 *)vd.spc = packColor(offsetCol0);
-	*(u32 *)vd.col1 = packColor(baseCol1);
-	*(u32 *)vd.spc1 = packColor(offsetCol1);
+	*(u32 *)vd.col = listColors.baseCol0;
+	*(u32 *)vd.spc = listColors.offsetCol0;
+	*(u32 *)vd.col1 = listColors.baseCol1;
+	*(u32 *)vd.spc1 = listColors.offsetCol1;
 }
 
 template<>
@@ -638,15 +675,10 @@ void convertVertex(const N2_VERTEX_VR& vs, Vertex& vd)
 	setCoords(vd, vs.x, vs.y, vs.z);
 	setNormal(vd, vs);
 	SetEnvMapUV(vd);
-	glm::vec4 baseCol0 = unpackColor(vs.rgb.argb0);
-	glm::vec4 offsetCol0(0);
-	glm::vec4 baseCol1 = unpackColor(vs.rgb.argb1);
-	glm::vec4 offsetCol1(0);
-	setModelColors(baseCol0, offsetCol0, baseCol1, offsetCol1);
-	*(u32 *)vd.col = packColor(baseCol0);
-	*(u32 *)vd.spc = packColor(offsetCol0);
-	*(u32 *)vd.col1 = packColor(baseCol1);
-	*(u32 *)vd.spc1 = packColor(offsetCol1);
+	*(u32 *)vd.col = listColors.modelBaseCol0 ? listColors.baseCol0 : repackColor(vs.rgb.argb0);
+	*(u32 *)vd.spc = listColors.offsetCol0;
+	*(u32 *)vd.col1 = listColors.modelBaseCol1 ? listColors.baseCol1 : repackColor(vs.rgb.argb1);
+	*(u32 *)vd.spc1 = listColors.offsetCol1;
 }
 
 template<>
@@ -655,15 +687,10 @@ void convertVertex(const N2_VERTEX_VU& vs, Vertex& vd)
 	setCoords(vd, vs.x, vs.y, vs.z);
 	setNormal(vd, vs);
 	setUV(vs, vd);
-	glm::vec4 baseCol0(1);
-	glm::vec4 offsetCol0(0);
-	glm::vec4 baseCol1(1);
-	glm::vec4 offsetCol1(0);
-	setModelColors(baseCol0, offsetCol0, baseCol1, offsetCol1);
-	*(u32 *)vd.col = packColor(baseCol0);
-	*(u32 *)vd.spc = packColor(offsetCol0);
-	*(u32 *)vd.col1 = packColor(baseCol1);
-	*(u32 *)vd.spc1 = packColor(offsetCol1);
+	*(u32 *)vd.col = listColors.baseCol0;
+	*(u32 *)vd.spc = listColors.offsetCol0;
+	*(u32 *)vd.col1 = listColors.baseCol1;
+	*(u32 *)vd.spc1 = listColors.offsetCol1;
 }
 
 template<>
@@ -672,15 +699,10 @@ void convertVertex(const N2_VERTEX_VUR& vs, Vertex& vd)
 	setCoords(vd, vs.x, vs.y, vs.z);
 	setNormal(vd, vs);
 	setUV(vs, vd);
-	glm::vec4 baseCol0 = unpackColor(vs.rgb.argb0);
-	glm::vec4 offsetCol0(0);
-	glm::vec4 baseCol1 = unpackColor(vs.rgb.argb1);
-	glm::vec4 offsetCol1(0);
-	setModelColors(baseCol0, offsetCol0, baseCol1, offsetCol1);
-	*(u32 *)vd.col = packColor(baseCol0);
-	*(u32 *)vd.spc = packColor(offsetCol0);
-	*(u32 *)vd.col1 = packColor(baseCol1);
-	*(u32 *)vd.spc1 = packColor(offsetCol1);
+	*(u32 *)vd.col = listColors.modelBaseCol0 ? listColors.baseCol0 : repackColor(vs.rgb.argb0);
+	*(u32 *)vd.spc = listColors.offsetCol0;
+	*(u32 *)vd.col1 = listColors.modelBaseCol1 ? listColors.baseCol1 : repackColor(vs.rgb.argb1);
+	*(u32 *)vd.spc1 = listColors.offsetCol1;
 }
 
 template<>
@@ -689,13 +711,8 @@ void convertVertex(const N2_VERTEX_VUB& vs, Vertex& vd)
 	setCoords(vd, vs.x, vs.y, vs.z);
 	setNormal(vd, vs);
 	setUV(vs, vd);
-	glm::vec4 baseCol0(1);
-	glm::vec4 offsetCol0(0);
-	glm::vec4 baseCol1(1);
-	glm::vec4 offsetCol1(0);
-	setModelColors(baseCol0, offsetCol0, baseCol1, offsetCol1);
-	*(u32 *)vd.col = packColor(baseCol0);
-	*(u32 *)vd.col1 = packColor(baseCol1);
+	*(u32 *)vd.col = listColors.baseCol0;
+	*(u32 *)vd.col1 = listColors.baseCol1;
 	// Stuff the bump map normals and parameters in the specular colors
 	vd.spc[0] = vs.bump.tangent.x;
 	vd.spc[1] = vs.bump.tangent.y;
@@ -720,6 +737,36 @@ void convertVertex(const N2_VERTEX_VUB& vs, Vertex& vd)
 template <typename T>
 static void boundingBox(const T* vertices, u32 count, glm::vec3& min, glm::vec3& max)
 {
+#if defined(ELAN_SSE)
+	__m128 vmin = _mm_set1_ps(1e38f);
+	__m128 vmax = _mm_set1_ps(-1e38f);
+	for (u32 i = 0; i < count; i++)
+	{
+		__m128 pos = _mm_setr_ps(vertices[i].x, vertices[i].y, vertices[i].z, 0.f);
+		// operand order matters: NaN coordinates are ignored like glm::min/max do
+		vmin = _mm_min_ps(pos, vmin);
+		vmax = _mm_max_ps(pos, vmax);
+	}
+	alignas(16) float fmin[4];
+	alignas(16) float fmax[4];
+	_mm_store_ps(fmin, vmin);
+	_mm_store_ps(fmax, vmax);
+	min = { fmin[0], fmin[1], fmin[2] };
+	max = { fmax[0], fmax[1], fmax[2] };
+#elif defined(ELAN_NEON)
+	float32x4_t vmin = vdupq_n_f32(1e38f);
+	float32x4_t vmax = vdupq_n_f32(-1e38f);
+	for (u32 i = 0; i < count; i++)
+	{
+		const float xyz[4] { vertices[i].x, vertices[i].y, vertices[i].z, 0.f };
+		float32x4_t pos = vld1q_f32(xyz);
+		// ignore NaN coordinates like glm::min/max do
+		vmin = vbslq_f32(vcltq_f32(pos, vmin), pos, vmin);
+		vmax = vbslq_f32(vcgtq_f32(pos, vmax), pos, vmax);
+	}
+	min = { vgetq_lane_f32(vmin, 0), vgetq_lane_f32(vmin, 1), vgetq_lane_f32(vmin, 2) };
+	max = { vgetq_lane_f32(vmax, 0), vgetq_lane_f32(vmax, 1), vgetq_lane_f32(vmax, 2) };
+#else
 	min = { 1e38f, 1e38f, 1e38f };
 	max = { -1e38f, -1e38f, -1e38f };
 	for (u32 i = 0; i < count; i++)
@@ -728,6 +775,7 @@ static void boundingBox(const T* vertices, u32 count, glm::vec3& min, glm::vec3&
 		min = glm::min(min, pos);
 		max = glm::max(max, pos);
 	}
+#endif
 	glm::vec4 center((min + max) / 2.f, 1);
 	glm::vec4 extents(max - glm::vec3(center), 0);
 	// transform
@@ -761,17 +809,62 @@ static bool isBetweenNearAndFar(const T* vertices, u32 count, bool& needNearClip
 	return true;
 }
 
+// Distance to the near plane in view space of each vertex, computed 4 vertices at a time
+template <typename T>
+static void nearPlaneDistances(const T* vertices, u32 count, float *dist)
+{
+	u32 i = 0;
+#if defined(ELAN_SSE)
+	const __m128 m02 = _mm_set1_ps(curMatrix[0][2]);
+	const __m128 m12 = _mm_set1_ps(curMatrix[1][2]);
+	const __m128 m22 = _mm_set1_ps(curMatrix[2][2]);
+	const __m128 m32 = _mm_set1_ps(curMatrix[3][2]);
+	const __m128 nearp = _mm_set1_ps(nearPlane);
+	const __m128 signMask = _mm_set1_ps(-0.f);
+	for (; i + 4 <= count; i += 4)
+	{
+		const T *v = &vertices[i];
+		__m128 x = _mm_setr_ps(v[0].x, v[1].x, v[2].x, v[3].x);
+		__m128 y = _mm_setr_ps(v[0].y, v[1].y, v[2].y, v[3].y);
+		__m128 z = _mm_setr_ps(v[0].z, v[1].z, v[2].z, v[3].z);
+		__m128 vz = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, m02), _mm_mul_ps(y, m12)), _mm_mul_ps(z, m22)), m32);
+		_mm_storeu_ps(&dist[i], _mm_sub_ps(_mm_xor_ps(vz, signMask), nearp));
+	}
+#elif defined(ELAN_NEON)
+	const float32x4_t m02 = vdupq_n_f32(curMatrix[0][2]);
+	const float32x4_t m12 = vdupq_n_f32(curMatrix[1][2]);
+	const float32x4_t m22 = vdupq_n_f32(curMatrix[2][2]);
+	const float32x4_t m32 = vdupq_n_f32(curMatrix[3][2]);
+	const float32x4_t nearp = vdupq_n_f32(nearPlane);
+	for (; i + 4 <= count; i += 4)
+	{
+		const T *v = &vertices[i];
+		const float fx[4] { v[0].x, v[1].x, v[2].x, v[3].x };
+		const float fy[4] { v[0].y, v[1].y, v[2].y, v[3].y };
+		const float fz[4] { v[0].z, v[1].z, v[2].z, v[3].z };
+		// no fused multiply-add to match the scalar results
+		float32x4_t vz = vaddq_f32(vaddq_f32(vaddq_f32(vmulq_f32(vld1q_f32(fx), m02), vmulq_f32(vld1q_f32(fy), m12)),
+				vmulq_f32(vld1q_f32(fz), m22)), m32);
+		vst1q_f32(&dist[i], vsubq_f32(vnegq_f32(vz), nearp));
+	}
+#endif
+	for (; i < count; i++)
+	{
+		const T& v = vertices[i];
+		float z = v.x * curMatrix[0][2] + v.y * curMatrix[1][2] + v.z * curMatrix[2][2] + curMatrix[3][2];
+		dist[i] = -z - nearPlane;
+	}
+}
+
 class TriangleStripClipper
 {
 public:
 	TriangleStripClipper(bool enabled) : enabled(enabled) {}
 
-	void add(const Vertex& vtx)
+	void add(const Vertex& vtx, float dist)
 	{
 		if (enabled)
 		{
-			float z = vtx.x * curMatrix[0][2] + vtx.y * curMatrix[1][2] + vtx.z * curMatrix[2][2] + curMatrix[3][2];
-			float dist = -z - nearPlane;
 			clip(vtx, dist);
 			count++;
 		}
@@ -913,8 +1006,19 @@ static void sendVertices(const ICHList *list, const T* vtx, bool needClipping)
 	Vertex taVtx;
 	verify(list->vertexSize() > 0);
 
+	static std::vector<float> nearDist;
+	if (needClipping)
+	{
+		if (nearDist.size() < list->vtxCount)
+			nearDist.resize(list->vtxCount);
+		nearPlaneDistances(vtx, list->vtxCount, nearDist.data());
+	}
+	updateListColors();
+
 	Vertex fanCenterVtx{};
 	Vertex fanLastVtx{};
+	float fanCenterDist = 0.f;
+	float fanLastDist = 0.f;
 	bool stripStart = true;
 	int outStripIndex = 0;
 	TriangleStripClipper clipper(needClipping);
@@ -922,21 +1026,23 @@ static void sendVertices(const ICHList *list, const T* vtx, bool needClipping)
 	for (u32 i = 0; i < list->vtxCount; i++)
 	{
 		convertVertex(*vtx, taVtx);
+		const float dist = needClipping ? nearDist[i] : 0.f;
 
 		if (stripStart)
 		{
 			// Center vertex if triangle fan
 			//verify(vtx->header.isFirstOrSecond()); This fails for some strips: strip=1 fan=0 (soul surfer)
 			fanCenterVtx = taVtx;
+			fanCenterDist = dist;
 			if (outStripIndex > 0)
 			{
 				// use degenerate triangles to link strips
-				clipper.add(fanLastVtx);
-				clipper.add(taVtx);
+				clipper.add(fanLastVtx, fanLastDist);
+				clipper.add(taVtx, dist);
 				outStripIndex += 2;
 				if (outStripIndex & 1)
 				{
-					clipper.add(taVtx);
+					clipper.add(taVtx, dist);
 					outStripIndex++;
 				}
 			}
@@ -945,22 +1051,23 @@ static void sendVertices(const ICHList *list, const T* vtx, bool needClipping)
 		else if (vtx->header.isFan())
 		{
 			// use degenerate triangles to link strips
-			clipper.add(fanLastVtx);
-			clipper.add(fanCenterVtx);
+			clipper.add(fanLastVtx, fanLastDist);
+			clipper.add(fanCenterVtx, fanCenterDist);
 			outStripIndex += 2;
 			if (outStripIndex & 1)
 			{
-				clipper.add(fanCenterVtx);
+				clipper.add(fanCenterVtx, fanCenterDist);
 				outStripIndex++;
 			}
 			// Triangle fan
-			clipper.add(fanCenterVtx);
-			clipper.add(fanLastVtx);
+			clipper.add(fanCenterVtx, fanCenterDist);
+			clipper.add(fanLastVtx, fanLastDist);
 			outStripIndex += 2;
 		}
-		clipper.add(taVtx);
+		clipper.add(taVtx, dist);
 		outStripIndex++;
 		fanLastVtx = taVtx;
+		fanLastDist = dist;
 		if (vtx->header.endOfStrip)
 			stripStart = true;
 
@@ -1765,6 +1872,14 @@ static void DYNACALL write_elancmd(u32 addr, u32 data)
 	}
 }
 
+void executeCommands(u8 *data, int size)
+{
+	try {
+		executeCommand<true>(data, size);
+	} catch (const TAParserException& e) {
+	}
+}
+
 template<typename T>
 static T DYNACALL read_elanram(u32 addr)
 {
@@ -28,6 +28,9 @@ void term();
 void vmem_init();
 void vmem_map(u32 base);
 
+// Executes a command buffer as if it was written to the command register
+void executeCommands(u8 *data, int size);
+
 void serialize(Serializer& ser);
 void deserialize(Deserializer& deser);
 
@@ -80,10 +80,16 @@ void serialize(Serializer& ser)
 	ser << ta_fsm_cl;
 	ser << taRenderPass;
 
+	ser.beginSection(Serializer::Section::TaContext);
 	SerializeTAContext(ser);
+	ser.endSection();
 
 	if (!ser.rollback())
+	{
+		ser.beginSection(Serializer::Section::Vram);
 		vram.serialize(ser);
+		ser.endSection();
+	}
 	elan::serialize(ser);
 }
 
@@ -108,7 +114,10 @@ void deserialize(Deserializer& deser)
 		DeserializeTAContext(deser);
 
 	if (!deser.rollback())
-		vram.deserialize(deser);
+		// Only the textures whose VRAM has changed are invalidated
+		vram.deserialize(deser, [](u32 offset) {
+			VramLockedWriteOffset(offset);
+		});
 	elan::deserialize(deser);
 	pal_needs_update = true;
 }
@@ -28,15 +28,14 @@
 static bool is_vertex_inf(const Vertex& vtx)
 {
 	// manic panic ghosts needs 1.0e25f for x and y
-	return std::isnan(vtx.x) || fabsf(vtx.x) > 1e25f
-			|| std::isnan(vtx.y) || fabsf(vtx.y) > 1e25f
-			|| std::isnan(vtx.z) || vtx.z > 3.4e37f;
+	// NaN comparisons are false. Avoid short-circuits so that this compiles without branches.
+	return !((fabsf(vtx.x) <= 1e25f) & (fabsf(vtx.y) <= 1e25f) & (vtx.z <= 3.4e37f));
 }
 
 struct IndexTrig
 {
 	IndexTrig() = default;
-	IndexTrig(u32 pid, u32 v0, u32 v1, u32 v2) : pid(pid), z(0) {
+	IndexTrig(u32 pid, u32 v0, u32 v1, u32 v2, f32 z) : pid(pid), z(z) {
 		vid[0] = v0;
 		vid[1] = v1;
 		vid[2] = v2;
@@ -47,22 +46,103 @@ struct IndexTrig
 	f32 z;
 };
 
-static float minZ(const Vertex *v, const u32 *mod)
+static float getProjectedZ(const Vertex *v, const float *mat)
 {
-	return std::min(std::min(v[mod[0]].z, v[mod[1]].z), v[mod[2]].z);
+	// -1 / z
+	return -1 / (mat[2] * v->x + mat[1 * 4 + 2] * v->y + mat[2 * 4 + 2] * v->z + mat[3 * 4 + 2]);
 }
 
-static bool operator<(const IndexTrig& left, const IndexTrig& right)
+//
+// Maps a float to an unsigned int so that integer and float comparisons give the same result.
+// -0 and +0 map to the same value.
+//
+static u32 floatKey(float f)
 {
-	return left.z < right.z;
+	u32 u;
+	memcpy(&u, &f, sizeof(u));
+	if (u == 0x80000000)
+		u = 0;
+	return (u & 0x80000000) ? ~u : u | 0x80000000;
 }
 
-static float getProjectedZ(const Vertex *v, const float *mat)
+//
+// LSD radix sort on the upper 32 bits of the keys.
+// Sort keys are the float key of the triangle z in the upper 32 bits and the triangle index in the lower 32 bits,
+// and must be sorted by index on entry. Sorting them gives the same order as a stable sort on z.
+//
+static void radixSort(std::vector<u64>& keys, std::vector<u64>& buffer)
 {
-	// -1 / z
-	return -1 / (mat[2] * v->x + mat[1 * 4 + 2] * v->y + mat[2 * 4 + 2] * v->z + mat[3 * 4 + 2]);
+	constexpr int Bits = 11;
+	constexpr u32 Buckets = 1 << Bits;
+	constexpr int Passes = (32 + Bits - 1) / Bits;
+	const size_t n = keys.size();
+
+	u32 histogram[Passes][Buckets] {};
+	for (u64 k : keys)
+		for (int pass = 0; pass < Passes; pass++)
+			histogram[pass][(k >> (32 + pass * Bits)) & (Buckets - 1)]++;
+
+	buffer.resize(n);
+	u64 *src = keys.data();
+	u64 *dst = buffer.data();
+	for (int pass = 0; pass < Passes; pass++)
+	{
+		const int shift = 32 + pass * Bits;
+		u32 *offsets = histogram[pass];
+		// Nothing to do if all keys have the same digit
+		if (offsets[(src[0] >> shift) & (Buckets - 1)] == n)
+			continue;
+		u32 sum = 0;
+		for (u32 i = 0; i < Buckets; i++)
+		{
+			u32 count = offsets[i];
+			offsets[i] = sum;
+			sum += count;
+		}
+		for (size_t i = 0; i < n; i++)
+		{
+			const u64 k = src[i];
+			dst[offsets[(k >> shift) & (Buckets - 1)]++] = k;
+		}
+		std::swap(src, dst);
+	}
+	if (src != keys.data())
+		keys.swap(buffer);
+}
+
+//
+// Insertion sort of almost sorted keys.
+// Gives up and returns false as soon as it gets slower than a radix sort,
+// that is when keys move by more than one position every other key on average.
+//
+static bool insertionSort(std::vector<u64>& keys)
+{
+	size_t moves = 0;
+	for (size_t i = 1; i < keys.size(); i++)
+	{
+		const u64 k = keys[i];
+		size_t j = i;
+		for (; j > 0 && keys[j - 1] > k; j--)
+			keys[j] = keys[j - 1];
+		keys[j] = k;
+		moves += i - j;
+		if (moves > i / 2 + 64)
+			return false;
+	}
+	return true;
 }
 
+//
+// The triangles of a render pass and their order in the previous frame.
+// When a game draws the same geometry again, the previous order is almost right
+// and can be fixed with an insertion sort.
+//
+struct SortCache
+{
+	std::vector<u64> triangles;		// pid << 32 | last vertex index
+	std::vector<u64> keys;			// sorted keys
+};
+
 void sortTriangles(rend_context& ctx, RenderPass& pass, const RenderPass& previousPass)
 {
 	int first = previousPass.tr_count;
@@ -73,7 +153,7 @@ void sortTriangles(rend_context& ctx, RenderPass& pass, const RenderPass& previo
 	const PolyParam * const pp_base = &ctx.global_param_tr[first];
 	const PolyParam * const pp_end = pp_base + count;
 
-	//make lists of all triangles, with their pid and vid
+	//make lists of all triangles, with their pid, vid and min z
 	static std::vector<IndexTrig> triangleList;
 
 	int vtx_count = ctx.verts.size() - pp_base->first;
@@ -85,17 +165,22 @@ void sortTriangles(rend_context& ctx, RenderPass& pass, const RenderPass& previo
 		if (pp->count < 3)
 			continue;
 
-		const Vertex *v0 = &ctx.verts[pp->first];
-		const Vertex *v1 = &ctx.verts[pp->first + 1];
-		float z0 = 0, z1 = 0;
+		const Vertex *vtx = &ctx.verts[pp->first];
+		const Vertex *v0 = vtx;
+		const Vertex *v1 = vtx + 1;
+		float z0, z1;
+		const bool naomi2 = pp->isNaomi2();
+		const float *mat = naomi2 ? ctx.matrices[pp->mvMatrix].mat : nullptr;
 
-		if (pp->isNaomi2())
+		if (naomi2)
 		{
-			z0 = getProjectedZ(v0, ctx.matrices[pp->mvMatrix].mat);
-			z1 = getProjectedZ(v1, ctx.matrices[pp->mvMatrix].mat);
+			z0 = getProjectedZ(v0, mat);
+			z1 = getProjectedZ(v1, mat);
 		}
 		else
 		{
+			z0 = v0->z;
+			z1 = v1->z;
 			if (is_vertex_inf(*v0))
 				v0 = nullptr;
 			if (is_vertex_inf(*v1))
@@ -103,59 +188,113 @@ void sortTriangles(rend_context& ctx, RenderPass& pass, const RenderPass& previo
 		}
 		for (u32 i = 2; i < pp->count; i++)
 		{
-			const Vertex *v2 = &ctx.verts[pp->first + i];
-			if (!pp->isNaomi2() && is_vertex_inf(*v2))
-				v2 = nullptr;
-			if (v0 != nullptr && v1 != nullptr && v2 != nullptr)
+			const Vertex *v2 = vtx + i;
+			float z2;
+			if (naomi2)
 			{
-				triangleList.emplace_back((u32)(pp - pp_base),
-						(u32)(v0 - &ctx.verts[0]), (u32)(v1 - &ctx.verts[0]), (u32)(v2 - &ctx.verts[0]));
-				if (pp->isNaomi2())
-				{
-					float z2 = getProjectedZ(v2, ctx.matrices[pp->mvMatrix].mat);
-					triangleList.back().z = std::min(z0, std::min(z1, z2));
-					z0 = z1;
-					z1 = z2;
-				}
-				else
-				{
-					triangleList.back().z = minZ(&ctx.verts[0], triangleList.back().vid);
-				}
+				z2 = getProjectedZ(v2, mat);
 			}
+			else
+			{
+				z2 = v2->z;
+				if (is_vertex_inf(*v2))
+					v2 = nullptr;
+			}
+			if (v0 != nullptr && v1 != nullptr && v2 != nullptr)
+				triangleList.emplace_back((u32)(pp - pp_base),
+						(u32)(v0 - &ctx.verts[0]), (u32)(v1 - &ctx.verts[0]), (u32)(v2 - &ctx.verts[0]),
+						std::min(z0, std::min(z1, z2)));
 			if (i & 1)
+			{
 				v1 = v2;
+				z1 = z2;
+			}
 			else
+			{
 				v0 = v2;
+				z0 = z2;
+			}
 		}
 	}
 
 	//sort them
-	std::stable_sort(triangleList.begin(), triangleList.end());
-
-	//Merge pids/draw cmds if two different pids are actually equal
-	for (size_t k = 1; k < triangleList.size(); k++)
-		if (triangleList[k].pid != triangleList[k - 1].pid)
+	static std::vector<u32> zKeys;
+	static std::vector<u64> sortKeys;
+	static std::vector<u64> radixBuffer;
+	static std::vector<SortCache> sortCaches;
+	const size_t trigCount = triangleList.size();
+
+	SortCache *cache = nullptr;
+	const size_t passIndex = &pass - ctx.render_passes.data();
+	if (passIndex < ctx.render_passes.size())
+	{
+		if (sortCaches.size() <= passIndex)
+			sortCaches.resize(passIndex + 1);
+		cache = &sortCaches[passIndex];
+	}
+	bool sameTriangles = cache != nullptr && cache->triangles.size() == trigCount;
+	if (cache != nullptr)
+		cache->triangles.resize(trigCount);
+	zKeys.resize(trigCount);
+	for (size_t i = 0; i < trigCount; i++)
+	{
+		zKeys[i] = floatKey(triangleList[i].z);
+		if (cache != nullptr)
 		{
-			const PolyParam& curPoly = pp_base[triangleList[k].pid];
-			const PolyParam& prevPoly = pp_base[triangleList[k - 1].pid];
-			if (curPoly.equivalentIgnoreCullingDirection(prevPoly)
-					&& (curPoly.isp.CullMode < 2 || curPoly.isp.CullMode == prevPoly.isp.CullMode))
-				triangleList[k].pid = triangleList[k - 1].pid;
+			const u64 id = ((u64)triangleList[i].pid << 32) | triangleList[i].vid[2];
+			sameTriangles = sameTriangles && cache->triangles[i] == id;
+			cache->triangles[i] = id;
+		}
+	}
+	bool sorted = false;
+	if (sameTriangles)
+	{
+		// Start from the previous order with the new z values
+		sortKeys.swap(cache->keys);
+		for (u64& key : sortKeys)
+		{
+			const u32 index = (u32)key;
+			key = ((u64)zKeys[index] << 32) | index;
 		}
+		sorted = insertionSort(sortKeys);
+	}
+	if (!sorted)
+	{
+		sortKeys.resize(trigCount);
+		for (size_t i = 0; i < trigCount; i++)
+			sortKeys[i] = ((u64)zKeys[i] << 32) | i;
+		if (trigCount < 256)
+			std::sort(sortKeys.begin(), sortKeys.end());
+		else
+			radixSort(sortKeys, radixBuffer);
+	}
+	if (cache != nullptr)
+		cache->keys = sortKeys;
 
 	//re-assemble them into drawing commands
+	//and merge pids/draw cmds if two different pids are actually equal
 
 	int idx = -1;
 	int idxSize = ctx.idx.size();
+	ctx.idx.resize(idxSize + trigCount * 3);
+	u32 *pidx = &ctx.idx[idxSize];
 
-	for (size_t i = 0; i < triangleList.size(); i++)
+	for (size_t i = 0; i < trigCount; i++)
 	{
-		int pid = triangleList[i].pid;
-		u32* midx = triangleList[i].vid;
+		const IndexTrig& trig = triangleList[(u32)sortKeys[i]];
+		int pid = trig.pid;
+		if (idx != -1 && pid != idx)
+		{
+			const PolyParam& curPoly = pp_base[pid];
+			const PolyParam& prevPoly = pp_base[idx];
+			if (curPoly.equivalentIgnoreCullingDirection(prevPoly)
+					&& (curPoly.isp.CullMode < 2 || curPoly.isp.CullMode == prevPoly.isp.CullMode))
+				pid = idx;
+		}
 
-		ctx.idx.emplace_back(midx[0]);
-		ctx.idx.emplace_back(midx[1]);
-		ctx.idx.emplace_back(midx[2]);
+		*pidx++ = trig.vid[0];
+		*pidx++ = trig.vid[1];
+		*pidx++ = trig.vid[2];
 
 		if (idx != pid)
 		{
@@ -172,10 +311,10 @@ void sortTriangles(rend_context& ctx, RenderPass& pass, const RenderPass& previo
 		}
 	}
 
-	if (!triangleList.empty())
+	if (trigCount != 0)
 	{
 		SortedTriangle& last = ctx.sortedTriangles.back();
-		last.count = idxSize + triangleList.size() * 3 - last.first;
+		last.count = idxSize + trigCount * 3 - last.first;
 	}
 	else
 	{
@@ -12,6 +12,11 @@
 
 #include <algorithm>
 #include <utility>
+#if HOST_CPU == CPU_X64
+#include <emmintrin.h>
+#elif HOST_CPU == CPU_ARM64
+#include <arm_neon.h>
+#endif
 
 #define TACALL DYNACALL
 #ifdef NDEBUG
@@ -25,6 +30,46 @@ static u8 float_to_satu8(float val) {
 	return f32_su8_tbl[(u32&)val >> 16];
 }
 
+// Converts a float color in A, R, G, B order to saturated u8 and stores the components at the given indices.
+// Same result as float_to_satu8 on each component.
+template<int Red, int Green, int Blue, int Alpha>
+static void float_to_satu8x4(u8 *to, const f32 *argb)
+{
+#if HOST_CPU == CPU_X64
+	// index of the source component for each destination byte
+	constexpr auto src = [](int i) { return i == Red ? 1 : i == Green ? 2 : i == Blue ? 3 : 0; };
+	// the lookup table only uses the 16 upper bits
+	__m128 v = _mm_and_ps(_mm_loadu_ps(argb), _mm_castsi128_ps(_mm_set1_epi32(0xffff0000)));
+	const __m128 one = _mm_set1_ps(1.f);
+	const __m128 nan = _mm_cmpunord_ps(v, v);
+	v = _mm_min_ps(_mm_max_ps(v, _mm_setzero_ps()), one);
+	// NaN is converted to 255
+	v = _mm_or_ps(_mm_andnot_ps(nan, v), _mm_and_ps(nan, one));
+	v = _mm_shuffle_ps(v, v, _MM_SHUFFLE(src(3), src(2), src(1), src(0)));
+	__m128i i = _mm_cvttps_epi32(_mm_mul_ps(v, _mm_set1_ps(255.f)));
+	i = _mm_packs_epi32(i, i);
+	i = _mm_packus_epi16(i, i);
+	u32 packed = _mm_cvtsi128_si32(i);
+	memcpy(to, &packed, sizeof(packed));
+#elif HOST_CPU == CPU_ARM64
+	float32x4_t v = vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(vld1q_f32(argb)), vdupq_n_u32(0xffff0000)));
+	const float32x4_t one = vdupq_n_f32(1.f);
+	const uint32x4_t notNan = vceqq_f32(v, v);
+	v = vminq_f32(vmaxq_f32(v, vdupq_n_f32(0.f)), one);
+	v = vbslq_f32(notNan, v, one);
+	uint32x4_t i = vcvtq_u32_f32(vmulq_f32(v, vdupq_n_f32(255.f)));
+	to[Alpha] = (u8)vgetq_lane_u32(i, 0);
+	to[Red] = (u8)vgetq_lane_u32(i, 1);
+	to[Green] = (u8)vgetq_lane_u32(i, 2);
+	to[Blue] = (u8)vgetq_lane_u32(i, 3);
+#else
+	to[Alpha] = float_to_satu8(argb[0]);
+	to[Red] = float_to_satu8(argb[1]);
+	to[Green] = float_to_satu8(argb[2]);
+	to[Blue] = float_to_satu8(argb[3]);
+#endif
+}
+
 static TA_context *vd_ctx;
 #define vd_rc (vd_ctx->rend)
 
@@ -182,24 +227,17 @@ template<int Red = 0, int Green = 1, int Blue = 2, int Alpha = 3>
 class TAParserTempl : public BaseTAParser
 {
 	//part : 0 fill all data , 1 fill upper 32B , 2 fill lower 32B
-	//Poly decoder , will be moved to pvr code
+	//Decodes a vertex of the given type into cv. The switch is resolved at compile time.
 	template <u32 poly_type,u32 part>
-	static Ta_Dma* TACALL ta_handle_poly(Ta_Dma* data,Ta_Dma* data_end)
+	static void decodePolyVertex(Vertex* cv, Ta_Dma* data)
 	{
 		TA_VertexParam* vp=(TA_VertexParam*)data;
-		u32 rv=0;
-
-		if constexpr (part == 2)
-		{
-			TaCmd=ta_main;
-		}
 
 		switch (poly_type)
 		{
 #define ver_32B_def(num) \
-case num : {\
-AppendPolyVertex##num(&vp->vtx##num);\
-rv=SZ32; }\
+case num : \
+AppendPolyVertex##num(cv, &vp->vtx##num);\
 break;
 
 			//32b , always in one pass :)
@@ -219,21 +257,12 @@ break;
 case num : {\
 /*process first half*/\
 	if constexpr (part != 2)\
-	{\
-	rv+=SZ32;\
-	AppendPolyVertex##num##A(&vp->vtx##num##A);\
-	}\
+		AppendPolyVertex##num##A(cv, &vp->vtx##num##A);\
 	/*process second half*/\
 	if constexpr (part == 0)\
-	{\
-	AppendPolyVertex##num##B(&vp->vtx##num##B);\
-	rv+=SZ32;\
-	}\
+		AppendPolyVertex##num##B(cv, &vp->vtx##num##B);\
 	else if constexpr (part == 2)\
-	{\
-	AppendPolyVertex##num##B((TA_Vertex##num##B*)data);\
-	rv+=SZ32;\
-	}\
+		AppendPolyVertex##num##B(cv, (TA_Vertex##num##B*)data);\
 	}\
 	break;
 
@@ -247,9 +276,17 @@ case num : {\
 			ver_64B_def(14);//(Textured, Intensity, 16bit UV, with Two Volumes)
 #undef ver_64B_def
 		}
+	}
 
-		return data+rv;
-	};
+	//Second half of a 64B vertex received separately
+	template <u32 poly_type>
+	static Ta_Dma* TACALL ta_poly_B_data(Ta_Dma* data,Ta_Dma* data_end)
+	{
+		TaCmd=ta_main;
+		decodePolyVertex<poly_type,2>(&vd_rc.verts.back(), data);
+
+		return data+SZ32;
+	}
 
 	//Code Splitter/routers
 
@@ -316,38 +353,41 @@ case num : {\
 	{
 		verify(data < data_end);
 
-					//If SZ64  && 32 bytes
-#define IS_FIST_HALF (poly_size != SZ32 && data == data_end - SZ32)
-
-		if (IS_FIST_HALF)
-			goto fist_half;
-
-		do
+		bool strip_end = false;
+		f32 z_max = vd_rc.fZ_max;
+		//Whole strip, or as much of it as available
+		while (data <= data_end - poly_size)
 		{
 			verify(data->pcw.ParaType == ParamType_Vertex_Parameter);
-			ta_handle_poly<poly_type,0>(data, 0);
-			if (data->pcw.EndOfStrip)
-				goto strip_end;
+			Vertex* cv = &vd_rc.verts.emplace_back();
+			decodePolyVertex<poly_type,0>(cv, data);
+			update_fz(z_max, cv->z);
+			strip_end = data->pcw.EndOfStrip;
 			data += poly_size;
-		} while (data <= data_end - poly_size);
-			
-		if (IS_FIST_HALF)
+			if (strip_end)
+				break;
+		}
+		vd_rc.fZ_max = z_max;
+
+		if (strip_end)
 		{
-		fist_half:
-			ta_handle_poly<poly_type,1>(data,0);
-			if (data->pcw.EndOfStrip) EndPolyStrip();
-			TaCmd=ta_handle_poly<poly_type,2>;
-					
+			TaCmd=ta_main;
+			EndPolyStrip();
+		}
+		//If SZ64  && 32 bytes
+		else if (poly_size != SZ32 && data == data_end - SZ32)
+		{
+			Vertex* cv = &vd_rc.verts.emplace_back();
+			decodePolyVertex<poly_type,1>(cv, data);
+			update_fz(cv->z);
+			if (data->pcw.EndOfStrip)
+				EndPolyStrip();
+			TaCmd=ta_poly_B_data<poly_type>;
+
 			data+=SZ32;
 		}
-			
-		return data;
 
-strip_end:
-		TaCmd=ta_main;
-		if (data->pcw.EndOfStrip)
-			EndPolyStrip();
-		return data+poly_size;
+		return data;
 	}
 
 	static void TACALL AppendPolyParam2Full(void* vpp)
@@ -547,15 +587,8 @@ private:
 
 	#define glob_param_bdc(pp) glob_param_bdc_( (TA_PolyParam0*)pp)
 
-	#define poly_float_color_(to,a,r,g,b) \
-		to[Red] = float_to_satu8(r);	\
-		to[Green] = float_to_satu8(g);	\
-		to[Blue] = float_to_satu8(b);	\
-		to[Alpha] = float_to_satu8(a);
-
-
 	#define poly_float_color(to,src) \
-		poly_float_color_(to,pp->src##A,pp->src##R,pp->src##G,pp->src##B)
+		float_to_satu8x4<Red, Green, Blue, Alpha>(to, &pp->src##A)
 
 	// Poly param handling
 
@@ -640,28 +673,23 @@ private:
 		}
 	}
 	
-	static inline void update_fz(float z)
+	static inline void update_fz(float& zmax, float z)
 	{
-		if ((s32&)vd_rc.fZ_max<(s32&)z && (s32&)z<0x49800000)
-			vd_rc.fZ_max=z;
+		if ((s32&)zmax<(s32&)z && (s32&)z<0x49800000)
+			zmax=z;
 	}
 
-		//Poly Vertex handlers
-		//Append vertex base
-	template<class T>
-	static Vertex* vert_cvt_base_(T* vtx)
+	static inline void update_fz(float z)
 	{
-		f32 invW = vtx->xyz[2];
-		vd_rc.verts.emplace_back();
-		Vertex* cv = &vd_rc.verts.back();
-		cv->x = vtx->xyz[0];
-		cv->y = vtx->xyz[1];
-		cv->z = invW;
-		update_fz(invW);
-		return cv;
+		update_fz(vd_rc.fZ_max, z);
 	}
 
-	#define vert_cvt_base Vertex* cv=vert_cvt_base_((TA_Vertex0*)vtx)
+		//Poly Vertex handlers
+		//Vertex position. The vertex is allocated by the caller, which also updates fZ_max
+	#define vert_cvt_base \
+		cv->x = vtx->xyz[0];\
+		cv->y = vtx->xyz[1];\
+		cv->z = vtx->xyz[2];
 
 		//Resume vertex base (for B part)
 	#define vert_res_base \
@@ -694,18 +722,12 @@ private:
 		to[Alpha] = (u8)(t);      \
 		}
 
-	#define vert_float_color_(to,a,r,g,b) \
-		to[Red] = float_to_satu8(r); \
-		to[Green] = float_to_satu8(g); \
-		to[Blue] = float_to_satu8(b); \
-		to[Alpha] = float_to_satu8(a);
-
 		//Macros to make thins easier ;)
 	#define vert_packed_color(to,src) \
 		vert_packed_color_(cv->to,vtx->src);
 
 	#define vert_float_color(to,src) \
-		vert_float_color_(cv->to,vtx->src##A,vtx->src##R,vtx->src##G,vtx->src##B)
+		float_to_satu8x4<Red, Green, Blue, Alpha>(cv->to, &vtx->src##A)
 
 		//Intensity handling
 
@@ -743,7 +765,7 @@ private:
 
 
 	//(Non-Textured, Packed Color)
-	static void AppendPolyVertex0(TA_Vertex0* vtx)
+	static void AppendPolyVertex0(Vertex *cv, TA_Vertex0* vtx)
 	{
 		vert_cvt_base;
 
@@ -751,7 +773,7 @@ private:
 	}
 
 	//(Non-Textured, Floating Color)
-	static void AppendPolyVertex1(TA_Vertex1* vtx)
+	static void AppendPolyVertex1(Vertex *cv, TA_Vertex1* vtx)
 	{
 		vert_cvt_base;
 
@@ -759,7 +781,7 @@ private:
 	}
 
 	//(Non-Textured, Intensity)
-	static void AppendPolyVertex2(TA_Vertex2* vtx)
+	static void AppendPolyVertex2(Vertex *cv, TA_Vertex2* vtx)
 	{
 		vert_cvt_base;
 
@@ -767,7 +789,7 @@ private:
 	}
 
 	//(Textured, Packed Color)
-	static void AppendPolyVertex3(TA_Vertex3* vtx)
+	static void AppendPolyVertex3(Vertex *cv, TA_Vertex3* vtx)
 	{
 		vert_cvt_base;
 
@@ -778,7 +800,7 @@ private:
 	}
 
 	//(Textured, Packed Color, 16bit UV)
-	static void AppendPolyVertex4(TA_Vertex4* vtx)
+	static void AppendPolyVertex4(Vertex *cv, TA_Vertex4* vtx)
 	{
 		vert_cvt_base;
 
@@ -789,7 +811,7 @@ private:
 	}
 
 	//(Textured, Floating Color)
-	static void AppendPolyVertex5A(TA_Vertex5A* vtx)
+	static void AppendPolyVertex5A(Vertex *cv, TA_Vertex5A* vtx)
 	{
 		vert_cvt_base;
 
@@ -798,16 +820,14 @@ private:
 		vert_uv_32(u,v);
 	}
 
-	static void AppendPolyVertex5B(TA_Vertex5B* vtx)
+	static void AppendPolyVertex5B(Vertex *cv, TA_Vertex5B* vtx)
 	{
-		vert_res_base;
-
 		vert_float_color(col,Base);
 		vert_float_color(spc,Offs);
 	}
 
 	//(Textured, Floating Color, 16bit UV)
-	static void AppendPolyVertex6A(TA_Vertex6A* vtx)
+	static void AppendPolyVertex6A(Vertex *cv, TA_Vertex6A* vtx)
 	{
 		vert_cvt_base;
 
@@ -816,16 +836,14 @@ private:
 		vert_uv_16(u,v);
 	}
 
-	static void AppendPolyVertex6B(TA_Vertex6B* vtx)
+	static void AppendPolyVertex6B(Vertex *cv, TA_Vertex6B* vtx)
 	{
-		vert_res_base;
-
 		vert_float_color(col,Base);
 		vert_float_color(spc,Offs);
 	}
 
 	//(Textured, Intensity)
-	static void AppendPolyVertex7(TA_Vertex7* vtx)
+	static void AppendPolyVertex7(Vertex *cv, TA_Vertex7* vtx)
 	{
 		vert_cvt_base;
 
@@ -836,7 +854,7 @@ private:
 	}
 
 	//(Textured, Intensity, 16bit UV)
-	static void AppendPolyVertex8(TA_Vertex8* vtx)
+	static void AppendPolyVertex8(Vertex *cv, TA_Vertex8* vtx)
 	{
 		vert_cvt_base;
 
@@ -848,7 +866,7 @@ private:
 	}
 
 	//(Non-Textured, Packed Color, with Two Volumes)
-	static void AppendPolyVertex9(TA_Vertex9* vtx)
+	static void AppendPolyVertex9(Vertex *cv, TA_Vertex9* vtx)
 	{
 		vert_cvt_base;
 
@@ -857,7 +875,7 @@ private:
 	}
 
 	//(Non-Textured, Intensity,	with Two Volumes)
-	static void AppendPolyVertex10(TA_Vertex10* vtx)
+	static void AppendPolyVertex10(Vertex *cv, TA_Vertex10* vtx)
 	{
 		vert_cvt_base;
 
@@ -866,7 +884,7 @@ private:
 	}
 
 	//(Textured, Packed Color,	with Two Volumes)	
-	static void AppendPolyVertex11A(TA_Vertex11A* vtx)
+	static void AppendPolyVertex11A(Vertex *cv, TA_Vertex11A* vtx)
 	{
 		vert_cvt_base;
 
@@ -876,10 +894,8 @@ private:
 		vert_uv_32(u0,v0);
 	}
 
-	static void AppendPolyVertex11B(TA_Vertex11B* vtx)
+	static void AppendPolyVertex11B(Vertex *cv, TA_Vertex11B* vtx)
 	{
-		vert_res_base;
-
 		vert_packed_color(col1, BaseCol1);
 		vert_packed_color(spc1, OffsCol1);
 
@@ -887,7 +903,7 @@ private:
 	}
 
 	//(Textured, Packed Color, 16bit UV, with Two Volumes)
-	static void AppendPolyVertex12A(TA_Vertex12A* vtx)
+	static void AppendPolyVertex12A(Vertex *cv, TA_Vertex12A* vtx)
 	{
 		vert_cvt_base;
 
@@ -897,10 +913,8 @@ private:
 		vert_uv_16(u0,v0);
 	}
 
-	static void AppendPolyVertex12B(TA_Vertex12B* vtx)
+	static void AppendPolyVertex12B(Vertex *cv, TA_Vertex12B* vtx)
 	{
-		vert_res_base;
-
 		vert_packed_color(col1, BaseCol1);
 		vert_packed_color(spc1, OffsCol1);
 
@@ -908,7 +922,7 @@ private:
 	}
 
 	//(Textured, Intensity,	with Two Volumes)
-	static void AppendPolyVertex13A(TA_Vertex13A* vtx)
+	static void AppendPolyVertex13A(Vertex *cv, TA_Vertex13A* vtx)
 	{
 		vert_cvt_base;
 
@@ -918,10 +932,8 @@ private:
 		vert_uv_32(u0,v0);
 	}
 
-	static void AppendPolyVertex13B(TA_Vertex13B* vtx)
+	static void AppendPolyVertex13B(Vertex *cv, TA_Vertex13B* vtx)
 	{
-		vert_res_base;
-
 		vert_face_base_color1(BaseInt1);
 		vert_face_offs_color1(OffsInt1);
 
@@ -929,7 +941,7 @@ private:
 	}
 
 	//(Textured, Intensity, 16bit UV, with Two Volumes)
-	static void AppendPolyVertex14A(TA_Vertex14A* vtx)
+	static void AppendPolyVertex14A(Vertex *cv, TA_Vertex14A* vtx)
 	{
 		vert_cvt_base;
 
@@ -939,10 +951,8 @@ private:
 		vert_uv_16(u0,v0);
 	}
 
-	static void AppendPolyVertex14B(TA_Vertex14B* vtx)
+	static void AppendPolyVertex14B(Vertex *cv, TA_Vertex14B* vtx)
 	{
-		vert_res_base;
-
 		vert_face_base_color1(BaseInt1);
 		vert_face_offs_color1(OffsInt1);
 
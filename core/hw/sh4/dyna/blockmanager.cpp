@@ -4,6 +4,7 @@
 */
 
 #include <algorithm>
+#include <cinttypes>
 #include <set>
 #include <map>
 #include "blockmanager.h"
@@ -16,6 +17,8 @@
 #include "hw/sh4/sh4_sched.h"
 #include "hw/sh4/modules/mmu.h"
 #include "oslib/virtmem.h"
+#include "oslib/perfjit.h"
+#include "cfg/option.h"
 
 #if defined(__unix__) && defined(DYNA_OPROF)
 #include <opagent.h>
@@ -39,6 +42,8 @@ static bm_Map blkmap;
 // Stats
 u32 protected_blocks;
 u32 unprotected_blocks;
+bm_CacheStats bm_stats;
+static u32 statsSeconds;
 
 #define FPCA(x) ((DynarecCodeEntryPtr&)sh4rcb.fpcb[(x>>1)&FPCB_MASK])
 
@@ -174,6 +179,15 @@ void bm_AddBlock(RuntimeBlockInfo* blk)
 		die("Duplicated block");
 	}
 	blkmap[(void*)block->code] = block;
+	bm_stats.compiledBlocks++;
+	bm_stats.compiledBytes += block->host_code_size;
+
+	if (perfjit::enabled())
+	{
+		char name[32];
+		snprintf(name, sizeof(name), "sh4_%08X", block->vaddr);
+		perfjit::codeLoad(CC_RW2RX((void *)block->code), block->host_code_size, name);
+	}
 
 	verify((void*)bm_GetCode(block->addr) == (void*)ngen_FailedToFindBlock);
 	FPCA(block->addr) = (DynarecCodeEntryPtr)CC_RW2RX(block->code);
@@ -218,9 +232,32 @@ void bm_DiscardBlock(RuntimeBlockInfo* block)
 	block_ptr->Discard();
 }
 
+void bm_DiscardCodeRange(void *start, void *end)
+{
+	std::vector<RuntimeBlockInfo*> blocks;
+	for (auto it = blkmap.lower_bound(start); it != blkmap.end() && it->first < end; ++it)
+		blocks.push_back(it->second.get());
+	for (RuntimeBlockInfo *block : blocks)
+		bm_DiscardBlock(block);
+	bm_stats.segmentsReused++;
+	bm_stats.evictedBlocks += blocks.size();
+}
+
 void bm_Periodical_1s()
 {
 	bm_CleanupDeletedBlocks();
+
+	if (++statsSeconds < 60)
+		return;
+	statsSeconds = 0;
+	if (bm_stats.cacheClears != 0 || bm_stats.segmentsReused != 0 || bm_stats.blockCheckFails != 0)
+		INFO_LOG(DYNAREC, "Code cache last minute: %d clears, %d segments reused, %d blocks evicted, %d block check failures, "
+				"%d blocks compiled (%d KB)", bm_stats.cacheClears, bm_stats.segmentsReused, bm_stats.evictedBlocks,
+				bm_stats.blockCheckFails, bm_stats.compiledBlocks, (int)(bm_stats.compiledBytes / 1024));
+	bm_stats = {};
+
+	if (config::DynarecBlockCounters)
+		bm_WriteHotBlocks(get_writable_data_path("hotblocks.txt"), 100);
 }
 
 void bm_vmem_pagefill(void** ptr, u32 size_bytes)
@@ -260,6 +297,9 @@ void bm_Reset()
 	{
 		virtmem::region_unlock(&mem_b[0], RAM_SIZE);
 	}
+#ifdef FAST_MMU
+	shadowmmu::unlockRam(0, RAM_SIZE);
+#endif
 }
 
 void bm_LockPage(u32 addr, u32 size)
@@ -269,6 +309,10 @@ void bm_LockPage(u32 addr, u32 size)
 		virtmem::region_lock(addrspace::ram_base + 0x0C000000 + addr, size);
 	else
 		virtmem::region_lock(&mem_b[addr], size);
+#ifdef FAST_MMU
+	// MMU shadow pages are aliases of the same RAM
+	shadowmmu::lockRam(addr, size);
+#endif
 }
 
 void bm_UnlockPage(u32 addr, u32 size)
@@ -278,6 +322,9 @@ void bm_UnlockPage(u32 addr, u32 size)
 		virtmem::region_unlock(addrspace::ram_base + 0x0C000000 + addr, size);
 	else
 		virtmem::region_unlock(&mem_b[addr], size);
+#ifdef FAST_MMU
+	shadowmmu::unlockRam(addr, size);
+#endif
 }
 
 void bm_ResetCache()
@@ -364,7 +411,8 @@ void bm_WriteBlockMap(const std::string& file)
 		INFO_LOG(DYNAREC, "Writing block map !");
 		for (const auto& [_, block] : blkmap)
 		{
-			fprintf(f, "block: %d:%08X:%p:%d:%d:%d\n", block->BlockType, block->addr, block->code, block->host_code_size, block->guest_cycles, block->guest_opcodes);
+			fprintf(f, "block: %d:%08X:%p:%d:%d:%d:%" PRIu64 "\n", block->BlockType, block->addr, block->code, block->host_code_size,
+					block->guest_cycles, block->guest_opcodes, block->runCount);
 			for(size_t j = 0; j < block->oplist.size(); j++)
 				fprintf(f,"\top: %zd:%d:%s\n", j, block->oplist[j].guest_offs, block->oplist[j].dissasm().c_str());
 		}
@@ -373,6 +421,70 @@ void bm_WriteBlockMap(const std::string& file)
 	}
 }
 
+// Reads the code from its physical address so that no MMU exception can be raised.
+// Blocks don't cross page boundaries when the MMU is on.
+static void printGuestCode(FILE *f, const RuntimeBlockInfo *block)
+{
+	const u8 *code = GetMemPtr(block->addr, block->sh4_code_size);
+	if (code == nullptr)
+	{
+		// Not in system RAM
+		for (size_t i = 0; i < block->oplist.size(); i++)
+			fprintf(f, "\top: %zd:%d:%s\n", i, block->oplist[i].guest_offs, block->oplist[i].dissasm().c_str());
+		return;
+	}
+	for (u32 offset = 0; offset < block->sh4_code_size; offset += 2)
+	{
+		const u32 pc = block->vaddr + offset;
+		const u16 op = *(const u16 *)&code[offset];
+		char temp[128];
+		OpDesc[op]->Disassemble(temp, pc, op);
+		fprintf(f, "\t%08X: %04X %s\n", pc, op, temp);
+	}
+}
+
+void bm_WriteHotBlocks(const std::string& file, size_t count)
+{
+	std::vector<RuntimeBlockInfo*> blocks;
+	u64 totalCycles = 0;
+	for (const auto& [_, block] : blkmap)
+	{
+		if (block->runCount == 0)
+			continue;
+		blocks.push_back(block.get());
+		totalCycles += block->runCount * block->guest_cycles;
+	}
+	if (blocks.empty())
+		return;
+	// Sort by estimated SH4 cycles
+	count = std::min(count, blocks.size());
+	std::partial_sort(blocks.begin(), blocks.begin() + count, blocks.end(),
+			[](const RuntimeBlockInfo *a, const RuntimeBlockInfo *b) {
+		return a->runCount * a->guest_cycles > b->runCount * b->guest_cycles;
+	});
+
+	FILE *f = nowide::fopen(file.c_str(), "w");
+	if (f == nullptr)
+	{
+		WARN_LOG(DYNAREC, "Can't create %s", file.c_str());
+		return;
+	}
+	fprintf(f, "%zd blocks executed, %" PRIu64 " estimated SH4 cycles\n\n", blocks.size(), totalCycles);
+	for (size_t i = 0; i < count; i++)
+	{
+		const RuntimeBlockInfo *block = blocks[i];
+		u64 cycles = block->runCount * block->guest_cycles;
+		fprintf(f, "#%zd vaddr %08X paddr %08X: %" PRIu64 " runs, %" PRIu64 " cycles (%.2f%%), %d SH4 ops, %d host bytes%s\n",
+				i + 1, block->vaddr, block->addr, block->runCount, cycles, cycles * 100.0 / totalCycles,
+				block->guest_opcodes, block->host_code_size, block->read_only ? "" : ", checked");
+		printGuestCode(f, block);
+	}
+	fclose(f);
+	const RuntimeBlockInfo *hottest = blocks[0];
+	INFO_LOG(DYNAREC, "Hottest block %08X: %.2f%% of the SH4 cycles. Report written to %s", hottest->vaddr,
+			hottest->runCount * hottest->guest_cycles * 100.0 / totalCycles, file.c_str());
+}
+
 void sh4_jitsym(FILE* out)
 {
 	for (const auto& [_, block] : blkmap)
@@ -483,6 +595,23 @@ void bm_RamWriteAccess(u32 addr)
 	}
 }
 
+void bm_DiscardPage(u32 addr)
+{
+	addr &= RAM_MASK;
+	std::set<RuntimeBlockInfo*>& block_list = blocks_per_page[addr / PAGE_SIZE];
+	std::vector<RuntimeBlockInfo*> list_copy(block_list.begin(), block_list.end());
+	for (auto& block : list_copy)
+		bm_DiscardBlock(block);
+	// Blocks compiled later will lock it again
+	bm_UnlockPage(addr);
+}
+
+bool bm_RamPageHasBlocks(u32 addr)
+{
+	addr &= RAM_MASK;
+	return !blocks_per_page[addr / PAGE_SIZE].empty();
+}
+
 u32 bm_getRamOffset(void *p)
 {
 #ifndef __SWITCH__
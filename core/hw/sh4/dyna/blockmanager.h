@@ -29,6 +29,8 @@ struct RuntimeBlockInfo
 	bool has_fpu_op;
 	u32 blockcheck_failures;
 	bool temp_block;
+	// incremented by the block code if config::DynarecBlockCounters was set when compiled
+	u64 runCount;
 
 	u32 BranchBlock; //if not 0xFFFFFFFF then jump target
 	u32 NextBlock;   //if not 0xFFFFFFFF then next block (by position)
@@ -69,6 +71,8 @@ struct RuntimeBlockInfo
 };
 
 void bm_WriteBlockMap(const std::string& file);
+// Writes the most executed blocks with their SH4 code
+void bm_WriteHotBlocks(const std::string& file, size_t count);
 
 DynarecCodeEntryPtr DYNACALL bm_GetCodeByVAddr(u32 addr);
 RuntimeBlockInfoPtr bm_GetBlock(void* dynarec_code);
@@ -77,6 +81,8 @@ RuntimeBlockInfoPtr DYNACALL bm_GetBlock(u32 addr);
 
 void bm_AddBlock(RuntimeBlockInfo* blk);
 void bm_DiscardBlock(RuntimeBlockInfo* block);
+// Discards all the blocks whose code starts in [start, end) (RW addresses)
+void bm_DiscardCodeRange(void *start, void *end);
 void bm_Reset();
 void bm_ResetCache();
 void bm_ResetTempCache(bool full);
@@ -88,6 +94,10 @@ void bm_Term();
 void bm_vmem_pagefill(void** ptr,u32 size_bytes);
 bool bm_RamWriteAccess(void *p);
 void bm_RamWriteAccess(u32 addr);
+// Discards the blocks compiled from a RAM page and unlocks it without marking it as unprotected
+void bm_DiscardPage(u32 addr);
+// Returns true if blocks have been compiled from this RAM page
+bool bm_RamPageHasBlocks(u32 addr);
 static inline bool bm_IsRamPageProtected(u32 addr)
 {
 	extern bool unprotected_pages[RAM_SIZE_MAX/PAGE_SIZE];
@@ -98,3 +108,15 @@ void bm_LockPage(u32 addr, u32 size = PAGE_SIZE);
 void bm_UnlockPage(u32 addr, u32 size = PAGE_SIZE);
 u32 bm_getRamOffset(void *p);
 
+// Code cache statistics, reported every minute
+struct bm_CacheStats
+{
+	u32 cacheClears;
+	u32 segmentsReused;
+	u32 evictedBlocks;
+	u32 blockCheckFails;
+	u32 compiledBlocks;
+	u64 compiledBytes;
+};
+extern bm_CacheStats bm_stats;
+
@@ -18,6 +18,11 @@
 constexpr u32 CODE_SIZE = 10_MB;
 constexpr u32 TEMP_CODE_SIZE = 1_MB;
 constexpr u32 FULL_SIZE = CODE_SIZE + TEMP_CODE_SIZE;
+// The main buffer is filled one segment at a time. When full, the oldest segment is reused
+// and only its blocks are discarded.
+constexpr u32 CODE_SEGMENTS = 8;
+constexpr u32 SEGMENT_SIZE = CODE_SIZE / CODE_SEGMENTS;
+static_assert(SEGMENT_SIZE % PAGE_SIZE == 0, "Segments must be page-aligned");
 
 #if defined(_WIN32) || FEAT_SHREC != DYNAREC_JIT || defined(TARGET_IPHONE) || defined(TARGET_ARM_MAC)
 static u8 *SH4_TCB;
@@ -52,9 +57,15 @@ void *Sh4CodeBuffer::get()
 void Sh4CodeBuffer::advance(u32 size)
 {
 	if (tempBuffer)
+	{
 		tempLastAddr += size;
+	}
 	else
+	{
 		lastAddr += size;
+		if (!compilingBlock)
+			pinnedSegments |= 1 << segment;
+	}
 }
 
 u32 Sh4CodeBuffer::getFreeSpace()
@@ -62,7 +73,7 @@ u32 Sh4CodeBuffer::getFreeSpace()
 	if (tempBuffer)
 		return TEMP_CODE_SIZE - tempLastAddr;
 	else
-		return CODE_SIZE - lastAddr;
+		return (segment + 1) * SEGMENT_SIZE - lastAddr;
 }
 
 void *Sh4CodeBuffer::getBase()
@@ -78,9 +89,30 @@ u32 Sh4CodeBuffer::getSize()
 void Sh4CodeBuffer::reset(bool temporary)
 {
 	if (temporary)
+	{
 		tempLastAddr = 0;
+	}
 	else
+	{
 		lastAddr = 0;
+		segment = 0;
+		pinnedSegments = 0;
+	}
+}
+
+bool Sh4CodeBuffer::nextSegment(u32& start, u32& end)
+{
+	for (u32 i = 1; i <= CODE_SEGMENTS; i++)
+	{
+		u32 next = (segment + i) % CODE_SEGMENTS;
+		if (pinnedSegments & (1 << next))
+			continue;
+		segment = next;
+		start = lastAddr = segment * SEGMENT_SIZE;
+		end = start + SEGMENT_SIZE;
+		return true;
+	}
+	return false;
 }
 
 static void clear_temp_cache(bool full)
@@ -93,12 +125,26 @@ static void clear_temp_cache(bool full)
 static void recSh4_ClearCache()
 {
 	INFO_LOG(DYNAREC, "recSh4:Dynarec Cache clear at %08X free space %d", next_pc, codeBuffer.getFreeSpace());
+	bm_stats.cacheClears++;
 	codeBuffer.reset(false);
 	bm_ResetCache();
 	smc_hotspots.clear();
 	clear_temp_cache(true);
 }
 
+// Reuses the oldest code segment
+static void evictCodeSegment()
+{
+	u32 start, end;
+	if (!codeBuffer.nextSegment(start, end))
+	{
+		recSh4_ClearCache();
+		return;
+	}
+	DEBUG_LOG(DYNAREC, "recSh4:Reusing code segment %x-%x at %08X", start, end, next_pc);
+	bm_DiscardCodeRange(CodeCache + start, CodeCache + end);
+}
+
 static void recSh4_Run()
 {
 	sh4_int_bCpuRun = true;
@@ -127,6 +173,7 @@ bool RuntimeBlockInfo::Setup(u32 rpc,fpscr_t rfpu_cfg)
 	BlockType = BET_SCL_Intr;
 	has_fpu_op = false;
 	temp_block = false;
+	runCount = 0;
 	
 	vaddr = rpc;
 	if (vaddr & 1)
@@ -171,8 +218,11 @@ DynarecCodeEntryPtr rdv_CompilePC(u32 blockcheck_failures)
 {
 	const u32 pc = next_pc;
 
-	if (codeBuffer.getFreeSpace() < 32_KB || pc == 0x8c0000e0 || pc == 0xac010000 || pc == 0xac008300)
+	if (pc == 0x8c0000e0 || pc == 0xac010000 || pc == 0xac008300)
+		// A new program is being loaded. DMA transfers bypass the RAM write protection.
 		recSh4_ClearCache();
+	else if (codeBuffer.getFreeSpace() < 32_KB)
+		evictCodeSegment();
 
 	RuntimeBlockInfo* rbi = sh4Dynarec->allocateBlock();
 
@@ -193,7 +243,9 @@ DynarecCodeEntryPtr rdv_CompilePC(u32 blockcheck_failures)
 	}
 	bool do_opts = !rbi->temp_block;
 	bool block_check = !rbi->read_only;
+	codeBuffer.setCompilingBlock(true);
 	sh4Dynarec->compile(rbi, block_check, do_opts);
+	codeBuffer.setCompilingBlock(false);
 	verify(rbi->code != nullptr);
 
 	bm_AddBlock(rbi);
@@ -230,27 +282,23 @@ void (*ngen_FailedToFindBlock)() = &ngen_FailedToFindBlock_internal;
 DynarecCodeEntryPtr DYNACALL rdv_BlockCheckFail(u32 addr)
 {
 	DEBUG_LOG(DYNAREC, "rdv_BlockCheckFail @ %08x", addr);
+	bm_stats.blockCheckFails++;
 	u32 blockcheck_failures = 0;
-	if (mmu_enabled())
+	// Only discard the modified block. Other blocks have their own check.
+	RuntimeBlockInfoPtr block = bm_GetBlock(addr);
+	if (block)
 	{
-		RuntimeBlockInfoPtr block = bm_GetBlock(addr);
-		if (block)
+		blockcheck_failures = block->blockcheck_failures + 1;
+		if (blockcheck_failures > 5)
 		{
-			blockcheck_failures = block->blockcheck_failures + 1;
-			if (blockcheck_failures > 5)
-			{
-				bool inserted = smc_hotspots.insert(addr).second;
-				if (inserted)
-					DEBUG_LOG(DYNAREC, "rdv_BlockCheckFail SMC hotspot @ %08x fails %d", addr, blockcheck_failures);
-			}
-			bm_DiscardBlock(block.get());
+			bool inserted = smc_hotspots.insert(addr).second;
+			if (inserted)
+				DEBUG_LOG(DYNAREC, "rdv_BlockCheckFail SMC hotspot @ %08x fails %d", addr, blockcheck_failures);
 		}
+		bm_DiscardBlock(block.get());
 	}
-	else
-	{
+	if (!mmu_enabled())
 		next_pc = addr;
-		recSh4_ClearCache();
-	}
 	return (DynarecCodeEntryPtr)CC_RW2RX(rdv_CompilePC(blockcheck_failures));
 }
 
@@ -299,6 +347,9 @@ void* DYNACALL rdv_LinkBlock(u8* code,u32 dpc)
 	}
 
 	DynarecCodeEntryPtr rv = rdv_FindOrCompile();  // Returns rx ptr
+	if (!stale_block && bm_GetBlock(code) != rbi)
+		// The code segment of this block has been reused
+		stale_block = true;
 
 	if (!mmu_enabled() && !stale_block)
 	{
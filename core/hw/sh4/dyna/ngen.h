@@ -61,6 +61,7 @@ public:
 	// Advance the buffer position by 'size' bytes.
 	void advance(u32 size);
 	// Return the available free space in bytes.
+	// The main buffer is divided in segments and this only returns the free space in the current one.
 	u32 getFreeSpace();
 	// Return a pointer to the beginning of the code buffer.
 	void *getBase();
@@ -73,11 +74,21 @@ public:
 	void useTempBuffer(bool enable) { tempBuffer = enable; }
 	// Reset main or temp code buffer position to 0 (internal use)
 	void reset(bool temporary);
+	// Move to the oldest segment of the main buffer that only holds blocks, and return its offset range.
+	// Its blocks must be discarded before emitting new code.
+	// Returns false if no segment can be reused (internal use)
+	bool nextSegment(u32& start, u32& end);
+	// Set while a block is compiled. Segments holding any other code (main loop, handlers)
+	// are never reused. (internal use)
+	void setCompilingBlock(bool compiling) { compilingBlock = compiling; }
 
 private:
 	u32 lastAddr = 0;
+	u32 segment = 0;
+	u32 pinnedSegments = 0;
 	u32 tempLastAddr = 0;
 	bool tempBuffer = false;
+	bool compilingBlock = false;
 };
 
 class Sh4Dynarec
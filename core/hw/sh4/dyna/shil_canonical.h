@@ -22,6 +22,7 @@
 	#define shil_compile(code)
 #elif  SHIL_MODE==1
 #include "hw/sh4/sh4_interrupts.h"
+#include "hw/sh4/sh4_interpreter.h"
 	//generate structs ...
 	#define SHIL_START
 	#define SHIL_END
@@ -1146,6 +1147,22 @@ shil_compile
 )
 shil_opc_end()
 
+// shop_idle: idle loop. Skip to the next scheduled event if the loop branch is taken
+shil_opc(idle)
+shil_canonical
+(
+void,f1,(u32 cond, u32 taken),
+	if (cond == taken)
+		SkipIdleCycles();
+)
+shil_compile
+(
+	shil_cf_arg_u32(rs2);
+	shil_cf_arg_u32(rs1);
+	shil_cf(f1);
+)
+shil_opc_end()
+
 SHIL_END
 
 
@@ -26,6 +26,7 @@
 #include "decoder.h"
 #include "hw/sh4/modules/mmu.h"
 #include "hw/sh4/sh4_mem.h"
+#include "cfg/option.h"
 
 class SSAOptimizer
 {
@@ -50,6 +51,8 @@ public:
 		DeadRegisterPass();
 		IdentityMovePass();
 		SingleBranchTargetPass();
+		if (config::IdleLoopSkip)
+			IdleLoopPass();
 
 #if DEBUG
 		if (stats.prop_constants > 0 || stats.dead_code_ops > 0 || stats.constant_ops_replaced > 0
@@ -753,6 +756,95 @@ private:
 		}
 	}
 
+	// A block is an idle loop if it branches back to itself, has no side effect
+	// and only recomputes its state from main RAM reads and registers it doesn't modify.
+	// Each iteration is then identical until an external event changes memory,
+	// so the remaining cycles until the next scheduled event can be skipped.
+	void IdleLoopPass()
+	{
+		if (block->BranchBlock != block->vaddr || mmu_enabled())
+			return;
+		shil_param cond;
+		u32 taken;
+		switch (block->BlockType)
+		{
+		case BET_Cond_0:
+		case BET_Cond_1:
+			cond = shil_param(block->has_jcond ? reg_pc_dyn : reg_sr_T);
+			taken = block->BlockType == BET_Cond_1 ? 1 : 0;
+			break;
+		case BET_StaticJump:
+			cond = shil_param(1);
+			taken = 1;
+			break;
+		default:
+			return;
+		}
+
+		bool written[sh4_reg_count] {};
+		for (const shil_opcode& op : block->oplist)
+		{
+			switch (op.op)
+			{
+			case shop_readm:
+				// Only main RAM reads at a constant address. Other addresses may be registers
+				// that change by themselves (TMU counters, SCIF, GD-ROM, ASIC status...)
+				if (!op.rs1.is_imm() || op.rs3.is_reg() || !IsOnRam(op.rs1._imm))
+					return;
+				break;
+			case shop_mov32:
+			case shop_jcond:
+			case shop_and:
+			case shop_or:
+			case shop_xor:
+			case shop_not:
+			case shop_add:
+			case shop_sub:
+			case shop_neg:
+			case shop_shl:
+			case shop_shr:
+			case shop_sar:
+			case shop_ext_s8:
+			case shop_ext_s16:
+			case shop_swaplb:
+			case shop_swap:
+			case shop_test:
+			case shop_seteq:
+			case shop_setge:
+			case shop_setgt:
+			case shop_setae:
+			case shop_setab:
+				break;
+			default:
+				return;
+			}
+			if (op.rd.is_reg())
+				for (u32 i = 0; i < op.rd.count(); i++)
+					written[op.rd._reg + i] = true;
+			if (op.rd2.is_reg())
+				for (u32 i = 0; i < op.rd2.count(); i++)
+					written[op.rd2._reg + i] = true;
+		}
+		// Values read on entry must not be modified by the loop
+		for (const shil_opcode& op : block->oplist)
+			for (const shil_param *param : { &op.rs1, &op.rs2, &op.rs3 })
+				if (param->is_reg())
+					for (u32 i = 0; i < param->count(); i++)
+						if (param->version[i] == 0 && written[param->_reg + i])
+							return;
+
+		shil_opcode idleOp;
+		idleOp.op = shop_idle;
+		idleOp.size = 0;
+		idleOp.rs1 = cond;
+		idleOp.rs2 = shil_param(taken);
+		idleOp.guest_offs = block->oplist.empty() ? 0 : block->oplist.back().guest_offs;
+		idleOp.delay_slot = false;
+		block->oplist.push_back(idleOp);
+		AddVersionPass();
+		INFO_LOG(DYNAREC, "Idle loop detected at %08x", block->vaddr);
+	}
+
 	RuntimeBlockInfo* block;
 	std::set<RegValue> writeback_values;
 
@@ -188,6 +188,17 @@ int UpdateSystem_INTC()
 		return 0;
 }
 
+// Called by idle loops: end the current timeslice and skip
+// the whole timeslices preceding the next scheduled event
+void SkipIdleCycles()
+{
+	int slices = (Sh4cntx.sh4_sched_next - 1) / SH4_TIMESLICE;
+	if (slices > 0)
+		Sh4cntx.sh4_sched_next -= slices * SH4_TIMESLICE;
+	if (Sh4cntx.cycle_counter > 0)
+		Sh4cntx.cycle_counter = 0;
+}
+
 static void sh4_int_resetcache() {
 }
 
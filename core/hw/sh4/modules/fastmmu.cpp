@@ -188,6 +188,7 @@ bool UTLB_Sync(u32 entry)
 	lru_address = tlb_entry.Address.VPN << 10;
 
 	cache_entry(tlb_entry);
+	shadowmmu::sync(tlb_entry);
 
 	if (!mmu_enabled() && (tlb_entry.Address.VPN & (0xFC000000 >> 10)) == (0xE0000000 >> 10))
 	{
@@ -321,5 +322,6 @@ void mmu_flush_table()
 	lru_entry = nullptr;
 	flush_cache();
 	mmuAddressLUTFlush(true);
+	shadowmmu::flush(true);
 }
 #endif 	// FAST_MMU
@@ -439,6 +439,9 @@ retry_ITLB_Match:
 
 void mmu_set_state()
 {
+#ifdef FAST_MMU
+	const bool wasOn = mmuOn;
+#endif
 	if (CCN_MMUCR.AT == 1)
 	{
 		// Detect if we're running Windows CE
@@ -454,6 +457,10 @@ void mmu_set_state()
 	{
 		mmuOn = false;
 	}
+#ifdef FAST_MMU
+	if (mmuOn != wasOn)
+		shadowmmu::reset();
+#endif
 
 	SetMemoryHandlers();
 	setSqwHandler();
@@ -484,6 +491,7 @@ void MMU_init()
 	// pre-fill kernel memory
 	for (u32 vpn = std::size(mmuAddressLUT) / 2; vpn < std::size(mmuAddressLUT); vpn++)
 		mmuAddressLUT[vpn] = vpn << 12;
+	shadowmmu::init();
 #endif
 }
 
@@ -499,6 +507,9 @@ void MMU_reset()
 
 void MMU_term()
 {
+#ifdef FAST_MMU
+	shadowmmu::term();
+#endif
 }
 
 #ifndef FAST_MMU
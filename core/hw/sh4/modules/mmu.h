@@ -132,6 +132,45 @@ static inline void mmuAddressLUTFlush(bool full)
 }
 #endif
 
+#ifdef FAST_MMU
+//
+// Shadow page table.
+// SH4 virtual pages that map to system RAM are mapped at the same offset of a 4 GB host
+// address range, so that translated accesses are direct host loads and stores.
+// Pages are mapped when their UTLB entry is loaded or on the first access fault, and are
+// unmapped when the TLB is flushed or the ASID changes.
+// Pages that are write-protected in the main RAM view (compiled code, memory watchers)
+// are mapped read-only, and writes to them are handled like writes to the main view.
+//
+namespace shadowmmu
+{
+
+enum class Fault {
+	NotHandled,		// not a shadow page table address
+	Mapped,			// the page is now mapped: retry the access
+	SlowPath,		// use the slow path for this access (TLB miss)
+	SlowPathAlways	// the address can't be mapped (not in RAM, 1 KB page)
+};
+
+extern u8 *base;
+
+void init();
+void term();
+// true if the dynarec should access memory through the shadow page table
+bool enabled();
+// Unmaps the translated pages. Only slot 0 if !full.
+void flush(bool full);
+// Unmaps all pages, including the untranslated ones
+void reset();
+void sync(const TLB_Entry& entry);
+Fault handleFault(u32 vaddr, bool write);
+// Called when a range of the main RAM view is write-protected or unprotected
+void lockRam(u32 addr, u32 size);
+void unlockRam(u32 addr, u32 size);
+
+}
+#endif
+
 #if FEAT_SHREC == DYNAREC_JIT
 static inline u32 DYNACALL mmuDynarecLookup(u32 vaddr, u32 write, u32 pc)
 {
@@ -0,0 +1,275 @@
+/*
+	Copyright 2024 flyinghead
+
+	This file is part of Flycast.
+
+    Flycast is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    Flycast is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Flycast.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include "mmu.h"
+#include "hw/sh4/sh4_mem.h"
+#include "hw/sh4/dyna/blockmanager.h"
+#include "hw/mem/addrspace.h"
+#include "hw/mem/mem_watch.h"
+#include "oslib/virtmem.h"
+#include "cfg/option.h"
+
+#include <algorithm>
+#include <vector>
+
+#ifdef FAST_MMU
+
+namespace shadowmmu
+{
+
+constexpr u64 AreaSize = 0x100000000ull;
+// Windows CE maps the current process in slot 0, which is flushed when the ASID changes
+constexpr u32 Slot0Size = 32_MB;
+
+enum PageState : u8 {
+	Unmapped,
+	ReadOnly,
+	Writable
+};
+
+u8 *base;
+static std::vector<u8> pageState;
+static u32 mappedPages;
+// RAM page of each mapped page
+static std::vector<u16> ramPages;
+// Mapped pages of each RAM page
+static std::vector<u32> aliases[RAM_SIZE_MAX / PAGE_SIZE];
+// RAM pages that are write-protected in the main RAM view
+static bool lockedPages[RAM_SIZE_MAX / PAGE_SIZE];
+// stats
+static u64 faults;
+static u64 flushes;
+
+void init()
+{
+#if HOST_CPU == CPU_X64 && FEAT_SHREC == DYNAREC_JIT
+	if (base != nullptr || !addrspace::virtmemEnabled())
+		return;
+	base = (u8 *)virtmem::reserve_view_area(AreaSize);
+	if (base != nullptr)
+	{
+		pageState.assign(AreaSize / PAGE_SIZE, Unmapped);
+		ramPages.assign(AreaSize / PAGE_SIZE, 0);
+		INFO_LOG(SH4, "MMU shadow page table at %p", base);
+	}
+#endif
+}
+
+void term()
+{
+	if (base == nullptr)
+		return;
+	if (faults != 0)
+		INFO_LOG(SH4, "MMU shadow page table: %llu faults, %llu flushes",
+				(unsigned long long)faults, (unsigned long long)flushes);
+	virtmem::release_view_area(base, AreaSize);
+	base = nullptr;
+	pageState = std::vector<u8>();
+	ramPages = std::vector<u16>();
+	for (auto& list : aliases)
+		list.clear();
+	memset(lockedPages, 0, sizeof(lockedPages));
+	mappedPages = 0;
+	faults = 0;
+	flushes = 0;
+}
+
+bool enabled()
+{
+	return base != nullptr && mmu_enabled() && config::MmuShadowPages;
+}
+
+static void removeAlias(u32 page)
+{
+	std::vector<u32>& list = aliases[ramPages[page]];
+	auto it = std::find(list.begin(), list.end(), page);
+	*it = list.back();
+	list.pop_back();
+}
+
+static void unmapRange(u32 start, u64 size)
+{
+	if (mappedPages == 0)
+		return;
+	const u32 first = start / PAGE_SIZE;
+	const u32 last = first + (u32)(size / PAGE_SIZE);
+	u32 count = 0;
+	for (u32 page = first; page < last; page++)
+	{
+		if (pageState[page] == Unmapped)
+			continue;
+		removeAlias(page);
+		pageState[page] = Unmapped;
+		count++;
+	}
+	if (count == 0)
+		return;
+	virtmem::unmap_view(base + start, size);
+	mappedPages -= count;
+}
+
+void flush(bool full)
+{
+	if (base == nullptr)
+		return;
+	flushes++;
+	if (full)
+	{
+		unmapRange(0, 0x80000000);			// U0
+		unmapRange(0xC0000000, 0x20000000);	// P3
+	}
+	else
+	{
+		unmapRange(0, Slot0Size);
+	}
+}
+
+void reset()
+{
+	if (base != nullptr)
+		unmapRange(0, AreaSize);
+}
+
+static bool mapPage(u32 vaddr, u32 paddr, bool write)
+{
+	const u32 page = vaddr / PAGE_SIZE;
+	const u32 ramPage = (paddr & RAM_MASK) / PAGE_SIZE;
+	if (write && lockedPages[ramPage])
+	{
+		// Same handling as a write to the main RAM view: memory watchers, then code protection.
+		// The page is unlocked if the write is allowed.
+		u8 *p = addrspace::ram_base + 0x0C000000 + ramPage * PAGE_SIZE;
+		if (!memwatch::writeAccess(p))
+			bm_RamWriteAccess(p);
+	}
+	const PageState state = lockedPages[ramPage] ? ReadOnly : Writable;
+	if (pageState[page] != Unmapped && ramPages[page] != ramPage)
+	{
+		// Stale translation
+		removeAlias(page);
+		pageState[page] = Unmapped;
+		mappedPages--;
+	}
+	if (pageState[page] == state)
+		return false;
+	if (!addrspace::mapRamPage(base + page * PAGE_SIZE, paddr, state == Writable))
+		return false;
+	if (pageState[page] == Unmapped)
+	{
+		mappedPages++;
+		ramPages[page] = ramPage;
+		aliases[ramPage].push_back(page);
+	}
+	pageState[page] = state;
+	return true;
+}
+
+void lockRam(u32 addr, u32 size)
+{
+	if (base == nullptr)
+		return;
+	for (u32 ramPage = addr / PAGE_SIZE; ramPage < (addr + size) / PAGE_SIZE; ramPage++)
+	{
+		lockedPages[ramPage] = true;
+		for (u32 page : aliases[ramPage])
+			if (pageState[page] == Writable)
+			{
+				addrspace::mapRamPage(base + page * PAGE_SIZE, ramPage * PAGE_SIZE, false);
+				pageState[page] = ReadOnly;
+			}
+	}
+}
+
+void unlockRam(u32 addr, u32 size)
+{
+	if (base == nullptr)
+		return;
+	// Read-only aliases are made writable on the next write fault
+	memset(&lockedPages[addr / PAGE_SIZE], 0, size / PAGE_SIZE);
+}
+
+static Fault translate(u32 vaddr, u32& paddr)
+{
+	const u32 area = vaddr >> 29;
+	if (area == 7)
+		// P4
+		return Fault::SlowPathAlways;
+	if (fast_reg_lut[area] != 0)
+	{
+		// P1, P2
+		paddr = vaddr & 0x1FFFFFFF;
+	}
+	else
+	{
+		if ((vaddr & 0xFC000000) == 0x7C000000)
+			// On-chip RAM
+			return Fault::SlowPathAlways;
+		const TLB_Entry *entry;
+		if (mmu_full_lookup(vaddr, &entry, paddr) != MmuError::NONE)
+			return Fault::SlowPath;
+		if (entry->Data.SZ1 == 0 && entry->Data.SZ0 == 0)
+			// 1 KB pages are smaller than host pages
+			return Fault::SlowPathAlways;
+	}
+	if ((paddr & 0x1C000000) != 0x0C000000)
+		// Not in system RAM
+		return Fault::SlowPathAlways;
+
+	return Fault::Mapped;
+}
+
+Fault handleFault(u32 vaddr, bool write)
+{
+	if (base == nullptr)
+		return Fault::NotHandled;
+	faults++;
+	u32 paddr;
+	Fault rc = translate(vaddr, paddr);
+	if (rc != Fault::Mapped)
+		return rc;
+	if (!mapPage(vaddr, paddr, write))
+		return Fault::SlowPath;
+
+	return Fault::Mapped;
+}
+
+void sync(const TLB_Entry& entry)
+{
+	if (base == nullptr)
+		return;
+	const u32 sz = entry.Data.SZ1 * 2 + entry.Data.SZ0;
+	const u32 size = sz == 3 ? 1_MB : sz == 2 ? 64_KB : PAGE_SIZE;
+	const u32 vaddr = (entry.Address.VPN << 10) & ~(size - 1);
+	if (fast_reg_lut[vaddr >> 29] != 0)
+		return;
+	// Drop the previous translation
+	unmapRange(vaddr, size);
+
+	if (!enabled() || sz == 0 || sz == 3 || entry.Data.V == 0
+			|| (entry.Data.SH == 0 && entry.Address.ASID != CCN_PTEH.ASID))
+		// 1 MB pages are mapped on demand
+		return;
+	const u32 paddr = entry.Data.PPN << 10;
+	if ((paddr & 0x1C000000) != 0x0C000000)
+		return;
+	for (u32 offset = 0; offset < size; offset += PAGE_SIZE)
+		mapPage(vaddr + offset, paddr + offset, false);
+}
+
+}
+#endif
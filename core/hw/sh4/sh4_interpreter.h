@@ -40,3 +40,4 @@ void ExecuteDelayslot_RTE();
 
 int UpdateSystem();
 int UpdateSystem_INTC();
+void SkipIdleCycles();
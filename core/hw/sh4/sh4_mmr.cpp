@@ -13,6 +13,7 @@
 #include "sh4_interrupts.h"
 #include "sh4_sched.h"
 #include "sh4_interpreter.h"
+#include "dyna/blockmanager.h"
 
 #include <array>
 #include <map>
@@ -681,7 +682,11 @@ void serialize(Serializer& ser)
 	ocache.Serialize(ser);
 
 	if (!ser.rollback())
+	{
+		ser.beginSection(Serializer::Section::Ram);
 		mem_b.serialize(ser);
+		ser.endSection();
+	}
 
 	interrupts_serialize(ser);
 
@@ -747,7 +752,11 @@ void deserialize(Deserializer& deser)
 		ocache.Reset(true);
 
 	if (!deser.rollback())
-		mem_b.deserialize(deser);
+		mem_b.deserialize(deser, [](u32 offset) {
+#if FEAT_SHREC != DYNAREC_NONE
+			bm_DiscardPage(offset);
+#endif
+		});
 
 	interrupts_deserialize(deser);
 
@@ -4,6 +4,8 @@
 #include "stdclass.h"
 #include "hw/sh4/sh4_sched.h"
 #include "serialize.h"
+#include "replay.h"
+#include <mutex>
 
 Disc* chd_parse(const char* file, std::vector<u8> *digest);
 Disc* gdi_parse(const char* file, std::vector<u8> *digest);
@@ -13,6 +15,8 @@ Disc* ioctl_parse(const char* file, std::vector<u8> *digest);
 
 static u32 NullDriveDiscType;
 Disc* disc;
+// Sectors may be read by the GD-ROM read ahead thread
+static std::mutex discMutex;
 static int schedId = -1;
 
 constexpr Disc* (*drivers[])(const char* path, std::vector<u8> *digest)
@@ -102,7 +106,11 @@ static bool loadDisk(const std::string& path)
 
 	//try all drivers
 	std::vector<u8> digest;
-	disc = OpenDisc(path, config::GGPOEnable ? &digest : nullptr);
+	Disc *newDisc = OpenDisc(path, config::GGPOEnable ? &digest : nullptr);
+	{
+		std::lock_guard<std::mutex> _(discMutex);
+		disc = newDisc;
+	}
 
 	if (disc != NULL)
 	{
@@ -143,6 +151,8 @@ bool InitDrive(const std::string& path)
 
 void DiscOpenLid()
 {
+	if (replay::recording())
+		replay::recordLidOpen();
 	TermDrive();
 	NullDriveDiscType = Open;
 	gd_setdisc();
@@ -167,6 +177,7 @@ static bool doDiscSwap(const std::string& path)
 void TermDrive()
 {
 	sh4_sched_request(schedId, -1);
+	std::lock_guard<std::mutex> _(discMutex);
 	delete disc;
 	disc = nullptr;
 }
@@ -194,6 +205,7 @@ static u32 createTrackInfoFirstLast(const Track& track, u32 tracknum)
 
 void libGDR_ReadSector(u8 *buff, u32 startSector, u32 sectorCount, u32 sectorSize)
 {
+	std::lock_guard<std::mutex> _(discMutex);
 	if (disc != nullptr)
 		disc->ReadSectors(startSector, sectorCount, buff, sectorSize);
 }
@@ -350,6 +362,8 @@ bool DiscSwap(const std::string& path)
 {
 	if (!doDiscSwap(path))
 		throw FlycastException("This media cannot be loaded");
+	if (replay::recording())
+		replay::recordDiscSwap(path);
 	// Drive is busy after the lid was closed
 	sns_asc = 4;
 	sns_ascq = 1;
@@ -141,6 +141,21 @@ void destroy()
 	NOTICE_LOG(VMEM, "virtmem::destroy done");
 }
 
+// Not supported
+void *reserve_view_area(size_t size) {
+	return nullptr;
+}
+
+void release_view_area(void *start, size_t size) {
+}
+
+bool map_view(void *dest, size_t size, size_t offset, bool writable) {
+	return false;
+}
+
+void unmap_view(void *dest, size_t size) {
+}
+
 // Flush (unmap) the FPCB array
 void reset_mem(void *ptr, unsigned size)
 {
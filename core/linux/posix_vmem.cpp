@@ -205,6 +205,29 @@ void destroy()
 	}
 }
 
+void *reserve_view_area(size_t size)
+{
+	if (vmem_fd < 0)
+		return nullptr;
+	return mem_region_reserve(nullptr, size);
+}
+
+void release_view_area(void *start, size_t size)
+{
+	mem_region_release(start, size);
+}
+
+bool map_view(void *dest, size_t size, size_t offset, bool writable)
+{
+	return mem_region_map_file((void *)(uintptr_t)vmem_fd, dest, size, offset, writable) != nullptr;
+}
+
+void unmap_view(void *dest, size_t size)
+{
+	// Replace the views with an inaccessible anonymous mapping so that the range stays reserved
+	mmap(dest, size, PROT_NONE, MAP_FIXED | MAP_PRIVATE | MAP_ANON, -1, 0);
+}
+
 // Resets a chunk of memory by deleting its data and setting its protection back.
 void reset_mem(void *ptr, unsigned size_bytes) {
 	// Mark them as non accessible.
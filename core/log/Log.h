@@ -49,6 +49,7 @@ static const char LOG_LEVEL_TO_CHAR[7] = "-NEWID";
 
 }  // namespace LogTypes
 
+// Use the *_LOG macros: fmt and file must be string literals
 void GenericLog(LogTypes::LOG_LEVELS level, LogTypes::LOG_TYPE type, const char* file, int line,
 		const char* fmt, ...)
 #if defined(__GNUC__) && !defined(__MINGW32__)
@@ -65,11 +66,13 @@ __attribute__((format(printf, 5, 6)))
 #endif  // logging
 
 // Let the compiler optimize this out
+// The async log trace keeps the format and __FILE__ pointers instead of copying the strings.
+// Prepending "" makes any format that isn't a string literal a compile error.
 #define GENERIC_LOG(t, v, ...)                                                                     \
 		do                                                                                               \
 		{                                                                                                \
 			if (v <= MAX_LOGLEVEL)                                                                         \
-			GenericLog(v, t, __FILE__, __LINE__, __VA_ARGS__);                                           \
+			GenericLog(v, t, __FILE__, __LINE__, "" __VA_ARGS__);                                        \
 		} while (0)
 
 #define ERROR_LOG(t, ...)                                                                          \
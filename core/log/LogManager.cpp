@@ -5,6 +5,7 @@
 #include "LogManager.h"
 
 #include <algorithm>
+#include <atomic>
 #include <cstdarg>
 #include <cstring>
 #include <locale>
@@ -12,10 +13,13 @@
 #include <ostream>
 #include <string>
 #include <fstream>
+#include <thread>
 
 #include "ConsoleListener.h"
 #include "InMemoryListener.h"
 #include "Log.h"
+#include "LogRing.h"
+#include "LogTrace.h"
 #include "StringUtil.h"
 #include "cfg/cfg.h"
 #include "oslib/oslib.h"
@@ -61,6 +65,197 @@ private:
 	bool m_enable;
 };
 
+// Return the current time formatted as Minutes:Seconds:Milliseconds
+// in the form 00:00:000.
+static std::string GetTimeFormatted()
+{
+	double now = os_GetSeconds();
+	u32 minutes = (u32)now / 60;
+	u32 seconds = (u32)now % 60;
+	u32 ms = (now - (u32)now) * 1000;
+	return StringFromFormat("%02d:%02d:%03d", minutes, seconds, ms);
+}
+
+//
+// Asynchronous logging: each thread pushes its log records into its own lock-free ring
+// and a writer thread forwards them to the listeners or to the binary trace file.
+//
+class LogManager::AsyncWriter
+{
+public:
+	AsyncWriter(LogManager *manager, size_t ringSize, const std::string& tracePath)
+		: manager(manager), ringSize(ringSize)
+	{
+		generation = ++lastGeneration;
+		if (!tracePath.empty())
+		{
+			std::vector<std::string> typeNames;
+			for (int i = 0; i < LogTypes::NUMBER_OF_LOGS; i++)
+				typeNames.emplace_back(manager->GetShortName((LogTypes::LOG_TYPE)i));
+			if (!traceWriter.open(tracePath, typeNames))
+				WARN_LOG(COMMON, "Can't create log trace file %s", tracePath.c_str());
+		}
+		running = true;
+		thread = std::thread([this]() { run(); });
+	}
+
+	~AsyncWriter()
+	{
+		running = false;
+		thread.join();
+		drainAll();
+		traceWriter.close();
+	}
+
+	bool isTracing() const {
+		return traceWriter.isOpen();
+	}
+
+	void push(LogTypes::LOG_LEVELS level, const std::string& msg) {
+		getRing()->push(TextTag | level, msg.c_str(), (u32)msg.size() + 1);
+	}
+
+	void trace(LogTypes::LOG_LEVELS level, LogTypes::LOG_TYPE type, const char* file,
+			int line, const char* format, va_list args)
+	{
+		u8 record[sizeof(logtrace::Event) + MaxArgsSize];
+		logtrace::Event event;
+		event.timestamp = (u64)(os_GetSeconds() * 1000000.0);
+		event.format = format;
+		event.file = file;
+		event.line = line;
+		event.type = (u8)type;
+		event.level = (u8)level;
+		event.argsSize = (u16)logtrace::encodeArgs(format, args, record + sizeof(event), MaxArgsSize);
+		memcpy(record, &event, sizeof(event));
+		getRing()->push(TraceTag, record, sizeof(event) + event.argsSize);
+	}
+
+	u64 droppedCount()
+	{
+		std::lock_guard<std::mutex> _(ringsMutex);
+		return droppedRetired + droppedLive();
+	}
+
+private:
+	static constexpr u32 TextTag = 0x100;
+	static constexpr u32 TraceTag = 0x200;
+	static constexpr u32 MaxArgsSize = 512;
+
+	struct ThreadRing
+	{
+		std::shared_ptr<LogRing> ring;
+		u32 generation = 0;
+	};
+
+	LogRing *getRing()
+	{
+		ThreadRing& tr = threadRing;
+		if (tr.ring == nullptr || tr.generation != generation)
+		{
+			tr.ring = std::make_shared<LogRing>(ringSize);
+			tr.generation = generation;
+			std::lock_guard<std::mutex> _(ringsMutex);
+			rings.push_back(tr.ring);
+		}
+		return tr.ring.get();
+	}
+
+	u64 droppedLive()
+	{
+		u64 count = 0;
+		for (const auto& ring : rings)
+			count += ring->droppedCount();
+		return count;
+	}
+
+	void run()
+	{
+		while (running)
+		{
+			if (!drainAll())
+				std::this_thread::sleep_for(std::chrono::milliseconds(2));
+		}
+	}
+
+	bool drainAll()
+	{
+		std::vector<std::shared_ptr<LogRing>> curRings;
+		{
+			std::lock_guard<std::mutex> _(ringsMutex);
+			curRings = rings;
+		}
+		bool drained = false;
+		for (const auto& ring : curRings)
+		{
+			ring->drain([this, &drained](u32 tag, const u8 *data, u32 size) {
+				drained = true;
+				if (tag == TraceTag)
+				{
+					logtrace::Event event;
+					memcpy(&event, data, sizeof(event));
+					traceWriter.write(event, data + sizeof(event));
+				}
+				else
+				{
+					dispatch((LogTypes::LOG_LEVELS)(tag & ~TextTag), (const char *)data);
+				}
+			});
+		}
+		if (drained)
+			traceWriter.flush();
+		curRings.clear();
+
+		std::lock_guard<std::mutex> _(ringsMutex);
+		// Free the rings of terminated threads
+		for (auto it = rings.begin(); it != rings.end(); )
+		{
+			if (it->use_count() == 1 && (*it)->empty())
+			{
+				droppedRetired += (*it)->droppedCount();
+				it = rings.erase(it);
+			}
+			else
+				++it;
+		}
+		u64 dropped = droppedRetired + droppedLive();
+		if (dropped != reportedDrops)
+		{
+			std::string msg = StringFromFormat("%s Log ring overflow: %llu messages dropped\n",
+					GetTimeFormatted().c_str(), (unsigned long long)(dropped - reportedDrops));
+			reportedDrops = dropped;
+			dispatch(LogTypes::LWARNING, msg.c_str());
+		}
+
+		return drained;
+	}
+
+	void dispatch(LogTypes::LOG_LEVELS level, const char *msg)
+	{
+		// Listeners can be registered or enabled by the emu thread while the writer is running
+		std::lock_guard<std::mutex> _(manager->m_listeners_mutex);
+		for (auto listener_id : manager->m_listener_ids)
+			if (manager->m_listeners[listener_id])
+				manager->m_listeners[listener_id]->Log(level, msg);
+	}
+
+	LogManager *manager;
+	const size_t ringSize;
+	u32 generation;
+	std::mutex ringsMutex;
+	std::vector<std::shared_ptr<LogRing>> rings;
+	u64 droppedRetired = 0;
+	u64 reportedDrops = 0;
+	logtrace::Writer traceWriter;
+	std::thread thread;
+	std::atomic<bool> running;
+
+	static thread_local ThreadRing threadRing;
+	static std::atomic<u32> lastGeneration;
+};
+thread_local LogManager::AsyncWriter::ThreadRing LogManager::AsyncWriter::threadRing;
+std::atomic<u32> LogManager::AsyncWriter::lastGeneration;
+
 void GenericLog(LogTypes::LOG_LEVELS level, LogTypes::LOG_TYPE type, const char* file, int line,
 		const char* fmt, ...)
 {
@@ -161,26 +356,38 @@ LogManager::LogManager()
 	}
 
 	m_path_cutoff_point = DeterminePathCutOffPoint();
+
+	bool binaryTrace = cfgLoadBool("log", "BinaryTrace", false);
+	if (cfgLoadBool("log", "Async", false) || binaryTrace)
+	{
+		// ring size per thread in KB, rounded up to a power of 2
+		size_t ringSize = 64 * 1024;
+		size_t wantedSize = (size_t)std::max(cfgLoadInt("log", "AsyncBufferSize", 256), 64) * 1024;
+		while (ringSize < wantedSize)
+			ringSize <<= 1;
+		std::string tracePath;
+		if (binaryTrace)
+		{
+#if defined(__ANDROID__) || defined(__APPLE__) || defined(TARGET_UWP)
+			tracePath = get_writable_data_path("flycast.trace");
+#else
+			tracePath = "flycast.trace";
+#endif
+		}
+		m_async_writer = std::make_unique<AsyncWriter>(this, ringSize, tracePath);
+	}
 }
 
 LogManager::~LogManager()
 {
+	// Flush pending messages before the listeners go away
+	m_async_writer.reset();
 	// The log window listener pointer is owned by the GUI code.
 	delete m_listeners[LogListener::CONSOLE_LISTENER];
 	delete m_listeners[LogListener::FILE_LISTENER];
 	delete m_listeners[LogListener::IN_MEMORY_LISTENER];
 }
 
-// Return the current time formatted as Minutes:Seconds:Milliseconds
-// in the form 00:00:000.
-static std::string GetTimeFormatted()
-{
-	double now = os_GetSeconds();
-	u32 minutes = (u32)now / 60;
-	u32 seconds = (u32)now % 60;
-	u32 ms = (now - (u32)now) * 1000;
-	return StringFromFormat("%02d:%02d:%03d", minutes, seconds, ms);
-}
 
 void LogManager::Log(LogTypes::LOG_LEVELS level, LogTypes::LOG_TYPE type, const char* file,
 		int line, const char* format, va_list args)
@@ -191,7 +398,19 @@ void LogManager::Log(LogTypes::LOG_LEVELS level, LogTypes::LOG_TYPE type, const
 void LogManager::LogWithFullPath(LogTypes::LOG_LEVELS level, LogTypes::LOG_TYPE type,
 		const char* file, int line, const char* format, va_list args)
 {
-	if (!IsEnabled(type, level) || !static_cast<bool>(m_listener_ids))
+	if (!IsEnabled(type, level))
+		return;
+	if (m_async_writer != nullptr && m_async_writer->isTracing())
+	{
+		va_list traceArgs;
+		va_copy(traceArgs, args);
+		m_async_writer->trace(level, type, file, line, format, traceArgs);
+		va_end(traceArgs);
+		// Only errors and warnings are also sent to the listeners
+		if (level > LogTypes::LWARNING)
+			return;
+	}
+	if (!static_cast<bool>(m_listener_ids))
 		return;
 
 	char temp[MAX_MSGLEN];
@@ -201,6 +420,11 @@ void LogManager::LogWithFullPath(LogTypes::LOG_LEVELS level, LogTypes::LOG_TYPE
 			StringFromFormat("%s %s:%u %c[%s]: %s\n", GetTimeFormatted().c_str(), file,
 					line, LogTypes::LOG_LEVEL_TO_CHAR[(int)level], GetShortName(type), temp);
 
+	if (m_async_writer != nullptr)
+	{
+		m_async_writer->push(level, msg);
+		return;
+	}
 	for (auto listener_id : m_listener_ids)
 		if (m_listeners[listener_id])
 			m_listeners[listener_id]->Log(level, msg.c_str());
@@ -239,11 +463,13 @@ const char* LogManager::GetFullName(LogTypes::LOG_TYPE type) const
 
 void LogManager::RegisterListener(LogListener::LISTENER id, LogListener* listener)
 {
+	std::lock_guard<std::mutex> _(m_listeners_mutex);
 	m_listeners[id] = listener;
 }
 
 void LogManager::EnableListener(LogListener::LISTENER id, bool enable)
 {
+	std::lock_guard<std::mutex> _(m_listeners_mutex);
 	m_listener_ids[id] = enable;
 }
 
@@ -252,6 +478,13 @@ bool LogManager::IsListenerEnabled(LogListener::LISTENER id) const
 	return m_listener_ids[id];
 }
 
+u64 LogManager::GetDroppedMessages() const
+{
+	if (m_async_writer == nullptr)
+		return 0;
+	return m_async_writer->droppedCount();
+}
+
 // Singleton. Ugh.
 static LogManager* s_log_manager;
 
@@ -6,6 +6,8 @@
 
 #include <array>
 #include <cstdarg>
+#include <memory>
+#include <mutex>
 
 #include "BitSet.h"
 #include "Log.h"
@@ -53,7 +55,13 @@ public:
   void EnableListener(LogListener::LISTENER id, bool enable);
   bool IsListenerEnabled(LogListener::LISTENER id) const;
 
+  // Asynchronous logging
+  bool IsAsync() const { return m_async_writer != nullptr; }
+  u64 GetDroppedMessages() const;
+
 private:
+  class AsyncWriter;
+
   struct LogContainer
   {
 	  LogContainer() : m_short_name(NULL), m_full_name(NULL) {}
@@ -77,5 +85,8 @@ private:
   std::array<LogContainer, LogTypes::NUMBER_OF_LOGS> m_log{};
   std::array<LogListener*, LogListener::NUMBER_OF_LISTENERS> m_listeners{};
   BitSet32 m_listener_ids;
+  // Protects m_listeners and m_listener_ids against the async writer thread
+  std::mutex m_listeners_mutex;
   size_t m_path_cutoff_point = 0;
+  std::unique_ptr<AsyncWriter> m_async_writer;
 };
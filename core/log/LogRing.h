@@ -0,0 +1,117 @@
+/*
+	Copyright 2024 flyinghead
+
+	This file is part of Flycast.
+
+    Flycast is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    Flycast is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Flycast.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#pragma once
+#include "types.h"
+#include <atomic>
+#include <cstring>
+#include <vector>
+
+//
+// Single producer, single consumer lock-free ring of variable-size records.
+// Each record is an 8-byte header (payload size, tag) followed by the payload
+// padded to 8 bytes. Records never wrap around the end of the buffer.
+//
+class LogRing
+{
+public:
+	// size must be a power of 2
+	LogRing(size_t size) : buffer(size), mask(size - 1) {}
+
+	// Producer side. Returns false and counts a drop if there's not enough room.
+	bool push(u32 tag, const void *data, u32 size)
+	{
+		const size_t recSize = HeaderSize + align(size);
+		const size_t capacity = buffer.size();
+		if (recSize > capacity / 2)
+		{
+			dropped.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+		size_t h = head.load(std::memory_order_relaxed);
+		const size_t t = tail.load(std::memory_order_acquire);
+		size_t offset = h & mask;
+		const size_t toEnd = capacity - offset;
+		const size_t needed = recSize <= toEnd ? recSize : toEnd + recSize;
+		if (capacity - (h - t) < needed)
+		{
+			dropped.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+		if (recSize > toEnd)
+		{
+			// skip to the beginning of the buffer
+			writeHeader(offset, (u32)(toEnd - HeaderSize), PaddingTag);
+			h += toEnd;
+			offset = 0;
+		}
+		writeHeader(offset, size, tag);
+		memcpy(&buffer[offset + HeaderSize], data, size);
+		head.store(h + recSize, std::memory_order_release);
+
+		return true;
+	}
+
+	// Consumer side. Calls f(tag, data, size) for each pending record.
+	template<typename F>
+	void drain(F f)
+	{
+		size_t t = tail.load(std::memory_order_relaxed);
+		const size_t h = head.load(std::memory_order_acquire);
+		while (t != h)
+		{
+			const size_t offset = t & mask;
+			u32 size, tag;
+			memcpy(&size, &buffer[offset], sizeof(size));
+			memcpy(&tag, &buffer[offset + 4], sizeof(tag));
+			if (tag != PaddingTag)
+				f(tag, &buffer[offset + HeaderSize], size);
+			t += HeaderSize + align(size);
+		}
+		tail.store(t, std::memory_order_release);
+	}
+
+	bool empty() const {
+		return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+	}
+
+	u64 droppedCount() const {
+		return dropped.load(std::memory_order_relaxed);
+	}
+
+	static constexpr u32 PaddingTag = ~0u;
+
+private:
+	static constexpr size_t HeaderSize = 8;
+
+	static size_t align(size_t size) {
+		return (size + 7) & ~(size_t)7;
+	}
+
+	void writeHeader(size_t offset, u32 size, u32 tag)
+	{
+		memcpy(&buffer[offset], &size, sizeof(size));
+		memcpy(&buffer[offset + 4], &tag, sizeof(tag));
+	}
+
+	std::vector<u8> buffer;
+	const size_t mask;
+	alignas(64) std::atomic<size_t> head{};	// written by the producer
+	alignas(64) std::atomic<size_t> tail{};	// written by the consumer
+	std::atomic<u64> dropped{};
+};
@@ -0,0 +1,551 @@
+/*
+	Copyright 2024 flyinghead
+
+	This file is part of Flycast.
+
+    Flycast is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    Flycast is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Flycast.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include "LogTrace.h"
+#include "Log.h"
+#include <cstring>
+#include <memory>
+
+namespace logtrace
+{
+
+// File layout:
+// header: magic, version, log type count, { u8 length, short name } * log type count
+// records: u8 kind followed by
+//   FormatDef: u32 id, u32 line, u16 file length, u16 format length, file, format
+//   Event: u64 timestamp, u32 format id, u8 type, u8 level, u16 args size, args
+constexpr u32 MAGIC = 0x544c4346;	// 'FCLT'
+constexpr u32 VERSION = 1;
+enum RecordKind : u8 {
+	FormatDef,
+	EventRec,
+};
+
+enum LengthModifier {
+	LenNone,
+	LenHH,
+	LenH,
+	LenL,
+	LenLL,
+	LenZ,
+	LenJ,
+	LenT,
+	LenBigL,
+};
+
+struct Spec
+{
+	const char *start;		// points to '%'
+	size_t size;			// including the conversion char
+	size_t modifierOffset;	// offset of the length modifier from start
+	size_t modifierSize;
+	char conversion;
+	LengthModifier modifier;
+	int stars;				// width and precision passed as arguments
+};
+
+// Finds the next conversion specification. "%%" is treated as literal text.
+static bool nextSpec(const char *p, Spec& spec)
+{
+	while (true)
+	{
+		p = strchr(p, '%');
+		if (p == nullptr)
+			return false;
+		if (p[1] == '%') {
+			p += 2;
+			continue;
+		}
+		break;
+	}
+	spec.start = p;
+	spec.stars = 0;
+	const char *q = p + 1;
+	while (*q != 0 && strchr("-+ #0'", *q) != nullptr)
+		q++;
+	if (*q == '*') {
+		spec.stars++;
+		q++;
+	}
+	while (*q >= '0' && *q <= '9')
+		q++;
+	if (*q == '.')
+	{
+		q++;
+		if (*q == '*') {
+			spec.stars++;
+			q++;
+		}
+		while (*q >= '0' && *q <= '9')
+			q++;
+	}
+	spec.modifierOffset = q - p;
+	spec.modifier = LenNone;
+	switch (*q)
+	{
+	case 'h':
+		spec.modifier = q[1] == 'h' ? LenHH : LenH;
+		break;
+	case 'l':
+		spec.modifier = q[1] == 'l' ? LenLL : LenL;
+		break;
+	case 'z':
+		spec.modifier = LenZ;
+		break;
+	case 'j':
+		spec.modifier = LenJ;
+		break;
+	case 't':
+		spec.modifier = LenT;
+		break;
+	case 'L':
+		spec.modifier = LenBigL;
+		break;
+	default:
+		break;
+	}
+	if (spec.modifier == LenHH || spec.modifier == LenLL)
+		q += 2;
+	else if (spec.modifier != LenNone)
+		q++;
+	spec.modifierSize = (q - p) - spec.modifierOffset;
+	spec.conversion = *q;
+	spec.size = *q == 0 ? q - p : q - p + 1;
+
+	return true;
+}
+
+class ArgWriter
+{
+public:
+	ArgWriter(u8 *out, u32 size) : out(out), end(out + size), p(out) {}
+
+	template<typename T>
+	bool put(T v)
+	{
+		if (p + sizeof(T) > end)
+			return false;
+		memcpy(p, &v, sizeof(T));
+		p += sizeof(T);
+		return true;
+	}
+
+	bool putString(const char *s)
+	{
+		if (s == nullptr)
+			s = "(null)";
+		size_t len = std::min<size_t>(strlen(s), 255);
+		if (p + len + 1 > end)
+			return false;
+		*p++ = (u8)len;
+		memcpy(p, s, len);
+		p += len;
+		return true;
+	}
+
+	u32 size() const { return (u32)(p - out); }
+
+private:
+	u8 *out;
+	u8 *end;
+	u8 *p;
+};
+
+u32 encodeArgs(const char *format, va_list args, u8 *out, u32 outSize)
+{
+	ArgWriter writer(out, outSize);
+	Spec spec;
+	const char *p = format;
+	while (nextSpec(p, spec))
+	{
+		p = spec.start + spec.size;
+		bool ok = true;
+		for (int i = 0; i < spec.stars && ok; i++)
+			ok = writer.put<s64>(va_arg(args, int));
+		if (!ok)
+			break;
+		switch (spec.conversion)
+		{
+		case 'd':
+		case 'i':
+			switch (spec.modifier)
+			{
+			// Promoted to int: truncate here so that the decoder prints the converted value
+			case LenHH: ok = writer.put<s64>((signed char)va_arg(args, int)); break;
+			case LenH: ok = writer.put<s64>((short)va_arg(args, int)); break;
+			case LenL: ok = writer.put<s64>(va_arg(args, long)); break;
+			case LenLL: ok = writer.put<s64>(va_arg(args, long long)); break;
+			case LenZ: ok = writer.put<s64>((s64)va_arg(args, size_t)); break;
+			case LenJ: ok = writer.put<s64>(va_arg(args, intmax_t)); break;
+			case LenT: ok = writer.put<s64>(va_arg(args, ptrdiff_t)); break;
+			default: ok = writer.put<s64>(va_arg(args, int)); break;
+			}
+			break;
+		case 'u':
+		case 'o':
+		case 'x':
+		case 'X':
+		case 'c':
+			switch (spec.modifier)
+			{
+			case LenHH: ok = writer.put<u64>((unsigned char)va_arg(args, unsigned int)); break;
+			case LenH: ok = writer.put<u64>((unsigned short)va_arg(args, unsigned int)); break;
+			case LenL: ok = writer.put<u64>(va_arg(args, unsigned long)); break;
+			case LenLL: ok = writer.put<u64>(va_arg(args, unsigned long long)); break;
+			case LenZ: ok = writer.put<u64>(va_arg(args, size_t)); break;
+			case LenJ: ok = writer.put<u64>(va_arg(args, uintmax_t)); break;
+			case LenT: ok = writer.put<u64>((u64)va_arg(args, ptrdiff_t)); break;
+			default: ok = writer.put<u64>(va_arg(args, unsigned int)); break;
+			}
+			break;
+		case 'f':
+		case 'F':
+		case 'e':
+		case 'E':
+		case 'g':
+		case 'G':
+		case 'a':
+		case 'A':
+			if (spec.modifier == LenBigL)
+				ok = writer.put<double>((double)va_arg(args, long double));
+			else
+				ok = writer.put<double>(va_arg(args, double));
+			break;
+		case 's':
+			ok = writer.putString(va_arg(args, const char *));
+			break;
+		case 'p':
+			ok = writer.put<u64>((u64)(uintptr_t)va_arg(args, void *));
+			break;
+		case 'n':
+			(void)va_arg(args, void *);
+			break;
+		default:
+			// unknown conversion: stop here
+			ok = false;
+			break;
+		}
+		if (!ok)
+			break;
+	}
+	return writer.size();
+}
+
+std::string formatArgs(const char *format, const u8 *args, u32 argsSize)
+{
+	std::string out;
+	const u8 *end = args + argsSize;
+	auto get = [&](auto& v) {
+		if (args + sizeof(v) > end)
+			return false;
+		memcpy(&v, args, sizeof(v));
+		args += sizeof(v);
+		return true;
+	};
+	auto appendLiteral = [&out](const char *from, const char *to) {
+		for (; from < to; from++)
+		{
+			out += *from;
+			if (from[0] == '%' && from + 1 < to && from[1] == '%')
+				from++;
+		}
+	};
+	char buf[512];
+	Spec spec;
+	const char *p = format;
+	while (nextSpec(p, spec))
+	{
+		appendLiteral(p, spec.start);
+		p = spec.start + spec.size;
+
+		int star[2] {};
+		bool ok = true;
+		for (int i = 0; i < spec.stars && ok; i++)
+		{
+			s64 v = 0;
+			ok = get(v);
+			star[i] = (int)v;
+		}
+		// Rebuild the conversion specification without its length modifier
+		std::string fmt(spec.start, spec.modifierOffset);
+		const char conv = spec.conversion;
+		int rc = -1;
+		auto print = [&](auto v) {
+			if (spec.stars == 0)
+				rc = snprintf(buf, sizeof(buf), fmt.c_str(), v);
+			else if (spec.stars == 1)
+				rc = snprintf(buf, sizeof(buf), fmt.c_str(), star[0], v);
+			else
+				rc = snprintf(buf, sizeof(buf), fmt.c_str(), star[0], star[1], v);
+		};
+		if (ok)
+		{
+			switch (conv)
+			{
+			case 'd':
+			case 'i':
+				{
+					s64 v;
+					if ((ok = get(v))) {
+						fmt += "ll";
+						fmt += conv;
+						print((long long)v);
+					}
+				}
+				break;
+			case 'u':
+			case 'o':
+			case 'x':
+			case 'X':
+				{
+					u64 v;
+					if ((ok = get(v))) {
+						fmt += "ll";
+						fmt += conv;
+						print((unsigned long long)v);
+					}
+				}
+				break;
+			case 'c':
+				{
+					u64 v;
+					if ((ok = get(v))) {
+						fmt += conv;
+						print((int)v);
+					}
+				}
+				break;
+			case 'f':
+			case 'F':
+			case 'e':
+			case 'E':
+			case 'g':
+			case 'G':
+			case 'a':
+			case 'A':
+				{
+					double v;
+					if ((ok = get(v))) {
+						fmt += conv;
+						print(v);
+					}
+				}
+				break;
+			case 's':
+				{
+					u8 len;
+					if ((ok = get(len) && args + len <= end))
+					{
+						std::string s((const char *)args, len);
+						args += len;
+						fmt += conv;
+						print(s.c_str());
+					}
+				}
+				break;
+			case 'p':
+				{
+					u64 v;
+					if ((ok = get(v))) {
+						fmt += conv;
+						print((void *)(uintptr_t)v);
+					}
+				}
+				break;
+			case 'n':
+				rc = 0;
+				break;
+			default:
+				ok = false;
+				break;
+			}
+		}
+		if (!ok)
+		{
+			// truncated or unsupported
+			out += "...";
+			return out;
+		}
+		if (rc > 0)
+			out.append(buf, std::min<size_t>(rc, sizeof(buf) - 1));
+	}
+	appendLiteral(p, p + strlen(p));
+	return out;
+}
+
+bool Writer::open(const std::string& path, const std::vector<std::string>& typeNames)
+{
+	close();
+	file = nowide::fopen(path.c_str(), "wb");
+	if (file == nullptr)
+		return false;
+	u32 header[2] { MAGIC, VERSION };
+	std::fwrite(header, sizeof(header), 1, file);
+	u8 count = (u8)typeNames.size();
+	std::fwrite(&count, 1, 1, file);
+	for (const std::string& name : typeNames)
+	{
+		u8 len = (u8)std::min<size_t>(name.length(), 255);
+		std::fwrite(&len, 1, 1, file);
+		std::fwrite(name.data(), 1, len, file);
+	}
+	return true;
+}
+
+void Writer::close()
+{
+	if (file != nullptr)
+		std::fclose(file);
+	file = nullptr;
+	formatIds.clear();
+}
+
+u32 Writer::getFormatId(const Event& event)
+{
+	auto it = formatIds.find(event.format);
+	if (it != formatIds.end())
+		return it->second;
+	u32 id = (u32)formatIds.size();
+	formatIds[event.format] = id;
+
+	u8 kind = FormatDef;
+	u16 fileLen = (u16)std::min<size_t>(strlen(event.file), 0xffff);
+	u16 formatLen = (u16)std::min<size_t>(strlen(event.format), 0xffff);
+	std::fwrite(&kind, sizeof(kind), 1, file);
+	std::fwrite(&id, sizeof(id), 1, file);
+	std::fwrite(&event.line, sizeof(event.line), 1, file);
+	std::fwrite(&fileLen, sizeof(fileLen), 1, file);
+	std::fwrite(&formatLen, sizeof(formatLen), 1, file);
+	std::fwrite(event.file, 1, fileLen, file);
+	std::fwrite(event.format, 1, formatLen, file);
+
+	return id;
+}
+
+void Writer::write(const Event& event, const u8 *args)
+{
+	if (file == nullptr)
+		return;
+	u32 formatId = getFormatId(event);
+	u8 kind = EventRec;
+	std::fwrite(&kind, sizeof(kind), 1, file);
+	std::fwrite(&event.timestamp, sizeof(event.timestamp), 1, file);
+	std::fwrite(&formatId, sizeof(formatId), 1, file);
+	std::fwrite(&event.type, sizeof(event.type), 1, file);
+	std::fwrite(&event.level, sizeof(event.level), 1, file);
+	std::fwrite(&event.argsSize, sizeof(event.argsSize), 1, file);
+	std::fwrite(args, 1, event.argsSize, file);
+}
+
+void Writer::flush()
+{
+	if (file != nullptr)
+		std::fflush(file);
+}
+
+bool decodeLogTrace(const std::string& path, FILE *out)
+{
+	FILE *f = nowide::fopen(path.c_str(), "rb");
+	if (f == nullptr)
+		return false;
+	std::unique_ptr<FILE, decltype(&std::fclose)> closer(f, std::fclose);
+
+	u32 header[2];
+	if (std::fread(header, sizeof(header), 1, f) != 1 || header[0] != MAGIC || header[1] != VERSION)
+		return false;
+	u8 typeCount;
+	if (std::fread(&typeCount, 1, 1, f) != 1)
+		return false;
+	std::vector<std::string> typeNames;
+	for (int i = 0; i < typeCount; i++)
+	{
+		u8 len;
+		char name[256];
+		if (std::fread(&len, 1, 1, f) != 1 || std::fread(name, 1, len, f) != len)
+			return false;
+		typeNames.emplace_back(name, len);
+	}
+	struct Format
+	{
+		std::string file;
+		u32 line;
+		std::string format;
+	};
+	std::vector<Format> formats;
+	std::vector<u8> args;
+	u8 kind;
+	while (std::fread(&kind, sizeof(kind), 1, f) == 1)
+	{
+		if (kind == FormatDef)
+		{
+			u32 id;
+			Format format;
+			u16 fileLen, formatLen;
+			if (std::fread(&id, sizeof(id), 1, f) != 1
+					|| std::fread(&format.line, sizeof(format.line), 1, f) != 1
+					|| std::fread(&fileLen, sizeof(fileLen), 1, f) != 1
+					|| std::fread(&formatLen, sizeof(formatLen), 1, f) != 1)
+				break;
+			format.file.resize(fileLen);
+			format.format.resize(formatLen);
+			if (std::fread(&format.file[0], 1, fileLen, f) != fileLen
+					|| std::fread(&format.format[0], 1, formatLen, f) != formatLen)
+				break;
+			if (id >= formats.size())
+				formats.resize(id + 1);
+			formats[id] = std::move(format);
+		}
+		else if (kind == EventRec)
+		{
+			u64 timestamp;
+			u32 formatId;
+			u8 type, level;
+			u16 argsSize;
+			if (std::fread(&timestamp, sizeof(timestamp), 1, f) != 1
+					|| std::fread(&formatId, sizeof(formatId), 1, f) != 1
+					|| std::fread(&type, sizeof(type), 1, f) != 1
+					|| std::fread(&level, sizeof(level), 1, f) != 1
+					|| std::fread(&argsSize, sizeof(argsSize), 1, f) != 1)
+				break;
+			args.resize(argsSize);
+			if (argsSize > 0 && std::fread(args.data(), 1, argsSize, f) != argsSize)
+				break;
+			if (formatId >= formats.size())
+			{
+				std::fprintf(out, "Unknown format id %d\n", formatId);
+				continue;
+			}
+			const Format& format = formats[formatId];
+			u32 seconds = (u32)(timestamp / 1000000);
+			std::string msg = formatArgs(format.format.c_str(), args.data(), argsSize);
+			std::fprintf(out, "%02d:%02d:%03d %s:%u %c[%s]: %s\n", seconds / 60, seconds % 60, (u32)(timestamp / 1000 % 1000),
+					format.file.c_str(), format.line,
+					level < sizeof(LogTypes::LOG_LEVEL_TO_CHAR) ? LogTypes::LOG_LEVEL_TO_CHAR[level] : '?',
+					type < typeNames.size() ? typeNames[type].c_str() : "?",
+					msg.c_str());
+		}
+		else
+		{
+			std::fprintf(out, "Corrupted trace file\n");
+			return false;
+		}
+	}
+	return true;
+}
+
+}
@@ -0,0 +1,74 @@
+/*
+	Copyright 2024 flyinghead
+
+	This file is part of Flycast.
+
+    Flycast is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    Flycast is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Flycast.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#pragma once
+#include "types.h"
+#include <cstdarg>
+#include <cstdio>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+//
+// Compact binary log trace.
+// Messages aren't formatted when logged: the raw printf arguments are stored along
+// with a format id. Format strings are written once per trace file and the trace
+// is converted to text offline with decodeLogTrace().
+//
+namespace logtrace
+{
+
+// In-memory record produced by the logging threads
+struct Event
+{
+	u64 timestamp;		// microseconds
+	const char *format;	// string literals, valid for the lifetime of the process
+	const char *file;
+	u32 line;
+	u8 type;
+	u8 level;
+	u16 argsSize;
+	// followed by argsSize bytes of encoded arguments
+};
+
+// Encodes the printf arguments of the given format. Returns the number of bytes written.
+u32 encodeArgs(const char *format, va_list args, u8 *out, u32 outSize);
+
+// Formats an event with its encoded arguments
+std::string formatArgs(const char *format, const u8 *args, u32 argsSize);
+
+class Writer
+{
+public:
+	bool open(const std::string& path, const std::vector<std::string>& typeNames);
+	void close();
+	bool isOpen() const { return file != nullptr; }
+	void write(const Event& event, const u8 *args);
+	void flush();
+
+private:
+	u32 getFormatId(const Event& event);
+
+	FILE *file = nullptr;
+	std::unordered_map<const char *, u32> formatIds;
+};
+
+// Converts a binary trace file to text. Returns false if the file can't be read.
+bool decodeLogTrace(const std::string& path, FILE *out);
+
+}
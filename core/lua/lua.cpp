@@ -21,8 +21,14 @@
 #ifdef USE_LUA
 #include <lua.hpp>
 #include <LuaBridge/LuaBridge.h>
+#include <map>
+#include <vector>
 #include "rend/gui.h"
 #include "hw/mem/addrspace.h"
+#include "hw/mem/mem_watch.h"
+#include "hw/aica/aica_if.h"
+#include "hw/pvr/pvr_mem.h"
+#include "cheat_search.h"
 #include "cfg/option.h"
 #include "emulator.h"
 #include "input/gamepad_device.h"
@@ -41,11 +47,29 @@ using namespace luabridge;
 static std::recursive_mutex mutex;
 using lock_guard = std::lock_guard<std::recursive_mutex>;
 
+static void checkWatches();
+static void resetWatches();
+
 static void emuEventCallback(Event event, void *)
 {
 	if (L == nullptr)
 		return;
 	lock_guard lock(mutex);
+	switch (event)
+	{
+	case Event::Start:
+	case Event::LoadState:
+		memwatch::scriptWatcher.invalidate();
+		break;
+	case Event::Terminate:
+		resetWatches();
+		break;
+	case Event::VBlank:
+		checkWatches();
+		break;
+	default:
+		break;
+	}
 	try {
 		LuaRef v = LuaRef::getGlobal(L, CallbackTable);
 		if (!v.isTable())
@@ -113,6 +137,299 @@ static LuaRef readMemoryTable(u32 address, int count, lua_State* L)
 	return t;
 }
 
+// Copies length bytes from the SH4 address space. Memory-mapped areas are copied directly.
+static void readMemory(u8 *dst, u32 address, u32 length)
+{
+	while (length > 0)
+	{
+		u32 chunk = std::min(length, PAGE_SIZE - (address & PAGE_MASK));
+		bool ismem;
+		void *p = addrspace::readConst(address, ismem, 1);
+		if (ismem)
+		{
+			memcpy(dst, p, chunk);
+		}
+		else
+		{
+			for (u32 i = 0; i < chunk; i++)
+				dst[i] = addrspace::read8(address + i);
+		}
+		dst += chunk;
+		address += chunk;
+		length -= chunk;
+	}
+}
+
+// Copies length bytes from a memory region, wrapping around at its end
+static void readRegion(u8 *dst, const u8 *region, u32 mask, u32 offset, u32 length)
+{
+	while (length > 0)
+	{
+		offset &= mask;
+		u32 chunk = std::min(length, mask + 1 - offset);
+		memcpy(dst, region + offset, chunk);
+		dst += chunk;
+		offset += chunk;
+		length -= chunk;
+	}
+}
+
+static u32 checkBlockLength(lua_State *L, int arg)
+{
+	lua_Integer length = luaL_checkinteger(L, arg);
+	luaL_argcheck(L, length >= 0 && length <= (lua_Integer)16_MB, arg, "invalid length");
+	return (u32)length;
+}
+
+// Returns a memory block as a string
+static int readMemoryBlock(lua_State *L)
+{
+	u32 address = (u32)luaL_checkinteger(L, 1);
+	u32 length = checkBlockLength(L, 2);
+	luaL_Buffer b;
+	readMemory((u8 *)luaL_buffinitsize(L, &b, length), address, length);
+	luaL_pushresultsize(&b, length);
+	return 1;
+}
+
+static int readVramBlock(lua_State *L)
+{
+	u32 offset = (u32)luaL_checkinteger(L, 1);
+	u32 length = checkBlockLength(L, 2);
+	if (VRAM_SIZE == 0)
+		luaL_error(L, "No VRAM");
+	luaL_Buffer b;
+	readRegion((u8 *)luaL_buffinitsize(L, &b, length), &vram[0], VRAM_MASK, offset, length);
+	luaL_pushresultsize(&b, length);
+	return 1;
+}
+
+static int readAramBlock(lua_State *L)
+{
+	u32 offset = (u32)luaL_checkinteger(L, 1);
+	u32 length = checkBlockLength(L, 2);
+	if (ARAM_SIZE == 0)
+		luaL_error(L, "No ARAM");
+	luaL_Buffer b;
+	readRegion((u8 *)luaL_buffinitsize(L, &b, length), &aica::aica_ram[0], ARAM_MASK, offset, length);
+	luaL_pushresultsize(&b, length);
+	return 1;
+}
+
+//
+// Memory watches
+// Watched ranges of system RAM are write-protected so that only the ranges written to
+// since the last vblank are compared with their previous content.
+// Other memory areas are compared every vblank.
+//
+struct MemoryWatch
+{
+	u32 address;
+	u32 size;
+	LuaRef callback;
+	bool armed;
+	bool inRam;
+	u32 ramOffset;
+	std::vector<u8> data;
+};
+static std::map<int, MemoryWatch> watches;
+static int nextWatchId = 1;
+
+static void armWatch(MemoryWatch& watch)
+{
+	u32 offset = watch.address & RAM_MASK;
+	watch.inRam = (watch.address & 0x1C000000) == 0x0C000000
+			&& offset + watch.size <= RAM_SIZE
+			&& memwatch::ScriptRamWatcher::enabled();
+	watch.data.resize(watch.size);
+	if (watch.inRam)
+	{
+		watch.ramOffset = offset;
+		memcpy(watch.data.data(), &mem_b[offset], watch.size);
+		memwatch::scriptWatcher.watch(offset, watch.size);
+	}
+	else
+	{
+		readMemory(watch.data.data(), watch.address, watch.size);
+	}
+	watch.armed = true;
+}
+
+static void disarmWatch(MemoryWatch& watch)
+{
+	if (watch.armed && watch.inRam)
+		memwatch::scriptWatcher.unwatch(watch.ramOffset, watch.size);
+	watch.armed = false;
+}
+
+static void checkWatches()
+{
+	if (watches.empty())
+		return;
+	std::vector<int> changed;
+	std::vector<u8> buffer;
+	for (auto& it : watches)
+	{
+		MemoryWatch& watch = it.second;
+		if (!watch.armed)
+		{
+			armWatch(watch);
+			continue;
+		}
+		if (watch.inRam)
+		{
+			// Rollback netplay unprotects all the RAM
+			if (!config::GGPOEnable && !memwatch::scriptWatcher.isDirty(watch.ramOffset, watch.size))
+				continue;
+			if (memcmp(watch.data.data(), &mem_b[watch.ramOffset], watch.size) == 0)
+				continue;
+			memcpy(watch.data.data(), &mem_b[watch.ramOffset], watch.size);
+		}
+		else
+		{
+			buffer.resize(watch.size);
+			readMemory(buffer.data(), watch.address, watch.size);
+			if (buffer == watch.data)
+				continue;
+			std::swap(buffer, watch.data);
+		}
+		changed.push_back(it.first);
+	}
+	memwatch::scriptWatcher.protect();
+
+	for (int id : changed)
+	{
+		// a callback may have removed another watch
+		auto it = watches.find(id);
+		if (it == watches.end())
+			continue;
+		// the callback may remove this watch
+		LuaRef callback = it->second.callback;
+		u32 address = it->second.address;
+		std::string data((const char *)it->second.data.data(), it->second.data.size());
+		try {
+			callback(address, data);
+		} catch (const LuaException& e) {
+			WARN_LOG(COMMON, "Lua exception[watch %08x]: %s", address, e.what());
+		}
+	}
+}
+
+static void resetWatches()
+{
+	for (auto& it : watches)
+		disarmWatch(it.second);
+	memwatch::scriptWatcher.reset();
+}
+
+// watch(address, size, callback): calls callback(address, data) at vblank when the memory range has changed
+static int addWatch(lua_State *L)
+{
+	u32 address = (u32)luaL_checkinteger(L, 1);
+	u32 size = checkBlockLength(L, 2);
+	luaL_argcheck(L, size > 0, 2, "invalid size");
+	luaL_checktype(L, 3, LUA_TFUNCTION);
+	lock_guard lock(mutex);
+	int id = nextWatchId++;
+	watches.emplace(id, MemoryWatch{ address, size, LuaRef::fromStack(L, 3), false, false, 0, {} });
+	lua_pushinteger(L, id);
+	return 1;
+}
+
+static void removeWatch(int id)
+{
+	lock_guard lock(mutex);
+	auto it = watches.find(id);
+	if (it == watches.end())
+		return;
+	disarmWatch(it->second);
+	watches.erase(it);
+}
+
+//
+// Memory search
+//
+static void searchStart(const std::string& region, const std::string& type, lua_State *L)
+{
+	CheatSearch::Region r = CheatSearch::Region::Ram;
+	if (region == "ram")
+		r = CheatSearch::Region::Ram;
+	else if (region == "aram")
+		r = CheatSearch::Region::Aram;
+	else
+		luaL_error(L, "Invalid region: %s", region.c_str());
+	CheatSearch::ValueType t = CheatSearch::ValueType::U32;
+	if (type == "u8")
+		t = CheatSearch::ValueType::U8;
+	else if (type == "u16")
+		t = CheatSearch::ValueType::U16;
+	else if (type == "u32")
+		t = CheatSearch::ValueType::U32;
+	else if (type == "float")
+		t = CheatSearch::ValueType::Float;
+	else
+		luaL_error(L, "Invalid value type: %s", type.c_str());
+	cheatSearch.start(r, t);
+}
+
+static u32 searchValue(lua_State *L, int arg)
+{
+	if (cheatSearch.valueType() != CheatSearch::ValueType::Float)
+		return (u32)luaL_optinteger(L, arg, 0);
+	float f = (float)luaL_optnumber(L, arg, 0);
+	u32 bits;
+	memcpy(&bits, &f, sizeof(bits));
+	return bits;
+}
+
+// filter(compare, value)
+static int searchFilter(lua_State *L)
+{
+	static const char * const compares[] = { "eq", "ne", "gt", "lt", "changed", "unchanged",
+			"increased", "decreased", "increasedBy", "decreasedBy", nullptr };
+	int compare = luaL_checkoption(L, 1, nullptr, compares);
+	if (!cheatSearch.isActive())
+		luaL_error(L, "No search started");
+	cheatSearch.filter((CheatSearch::Compare)compare, searchValue(L, 2));
+	return 0;
+}
+
+static u32 searchCount() {
+	return (u32)cheatSearch.candidateCount();
+}
+
+static bool searchBusy() {
+	return cheatSearch.busy();
+}
+
+// Returns a table of address -> value
+static int searchResults(lua_State *L)
+{
+	size_t maxCount = (size_t)luaL_optinteger(L, 1, 100);
+	std::vector<CheatSearch::Result> results = cheatSearch.results(maxCount);
+	const bool isFloat = cheatSearch.valueType() == CheatSearch::ValueType::Float;
+	lua_createtable(L, 0, (int)results.size());
+	for (const CheatSearch::Result& result : results)
+	{
+		lua_pushinteger(L, result.address);
+		if (isFloat)
+		{
+			float f;
+			memcpy(&f, &result.value, sizeof(f));
+			lua_pushnumber(L, f);
+		}
+		else {
+			lua_pushinteger(L, result.value);
+		}
+		lua_rawset(L, -3);
+	}
+	return 1;
+}
+
+static void searchReset() {
+	cheatSearch.reset();
+}
+
 #define CONFIG_ACCESSORS(Config) 	\
 template<typename T>				\
 static T get ## Config() {			\
@@ -535,10 +852,23 @@ static void luaRegister(lua_State *L)
 				.addFunction("readTable16", readMemoryTable<u16>)
 				.addFunction("readTable32", readMemoryTable<u32>)
 				.addFunction("readTable64", readMemoryTable<u64>)
+				.addFunction("readBlock", readMemoryBlock)
+				.addFunction("readVram", readVramBlock)
+				.addFunction("readAram", readAramBlock)
 				.addFunction("write8", addrspace::writet<u8>)
 				.addFunction("write16", addrspace::writet<u16>)
 				.addFunction("write32", addrspace::writet<u32>)
 				.addFunction("write64", addrspace::writet<u64>)
+				.addFunction("watch", addWatch)
+				.addFunction("unwatch", removeWatch)
+				.beginNamespace("search")
+					.addFunction("start", searchStart)
+					.addFunction("filter", searchFilter)
+					.addFunction("count", searchCount)
+					.addFunction("busy", searchBusy)
+					.addFunction("results", searchResults)
+					.addFunction("reset", searchReset)
+				.endNamespace()
 			.endNamespace()
 
 			.beginNamespace("input")
@@ -633,6 +963,8 @@ void term()
     EventManager::unlisten(Event::Terminate, emuEventCallback);
     EventManager::unlisten(Event::LoadState, emuEventCallback);
     EventManager::unlisten(Event::VBlank, emuEventCallback);
+	resetWatches();
+	watches.clear();
 	lua_close(L);
 	L = nullptr;
 }
@@ -23,6 +23,7 @@
 #include "input/keyboard_device.h"
 #include "input/mouse.h"
 #include "cfg/option.h"
+#include "replay.h"
 #include <algorithm>
 
 void UpdateInputState();
@@ -34,6 +35,11 @@ bool inRollback;
 
 static void getLocalInput(MapleInputState inputState[4])
 {
+	if (replay::playing())
+	{
+		replay::playInput(inputState);
+		return;
+	}
 	if (!config::ThreadedRendering)
 		UpdateInputState();
 	std::lock_guard<std::mutex> lock(relPosMutex);
@@ -66,6 +72,8 @@ static void getLocalInput(MapleInputState inputState[4])
 		mo_y_delta[player] -= relY;
 		mo_wheel_delta[player] -= wheel;
 	}
+	if (replay::recording())
+		replay::recordInput(inputState);
 }
 
 }
@@ -22,6 +22,7 @@
 #include "miniupnp.h"
 #include "cfg/option.h"
 #include "emulator.h"
+#include "replay.h"
 
 #include <algorithm>
 #include <atomic>
@@ -63,20 +64,30 @@ public:
 
 	bool receive(u8 *data, u32 size, u16 *packetNumber)
 	{
+		if (replay::playing())
+			return replay::playNetworkReceive(data, size, *packetNumber);
 		poll();
 		if (receivedData.empty())
+		{
+			if (replay::recording())
+				replay::recordNetworkReceive(nullptr, 0, 0);
 			return false;
+		}
 
 		size = std::min(size, (u32)receivedData.size());
 		memcpy(data, receivedData.data(), size);
 		receivedData.erase(receivedData.begin(), receivedData.begin() + size);
 		*packetNumber = this->packetNumber;
+		if (replay::recording())
+			replay::recordNetworkReceive(data, size, *packetNumber);
 
 		return true;
 	}
 
 	void send(u8 *data, u32 size, u16 packetNumber)
 	{
+		if (replay::playing())
+			return;
 		verify(size < sizeof(Packet::data.payload));
 		Packet packet(Data);
 		memcpy(packet.data.payload, data, size);
@@ -9,6 +9,7 @@
 #include "oslib/oslib.h"
 #include "debug/gdb_server.h"
 #include "archive/rzip.h"
+#include "archive/statefile.h"
 #include "rend/mainui.h"
 #include "input/gamepad_device.h"
 #include "lua/lua.h"
@@ -106,54 +107,110 @@ void dc_savestate(int index)
     	return;
 	}
 
+	double startTime = os_GetSeconds();
+	std::vector<Serializer::SectionMark> sections;
 	ser = Serializer(data, ser.size());
+	ser.recordSections(&sections);
 	dc_serialize(ser);
 
 	std::string filename = hostfs::getSavestatePath(index, true);
-#if 0
-	FILE *f = nowide::fopen(filename.c_str(), "wb");
-
-	if ( f == NULL )
+	if (config::SectionedSavestates)
 	{
-		WARN_LOG(SAVESTATE, "Failed to save state - could not open %s for writing", filename.c_str());
-		gui_display_notification("Cannot open save file", 2000);
-		free(data);
-    	return;
+		if (!statefile::save(filename, (const u8 *)data, ser.size(), sections))
+		{
+			WARN_LOG(SAVESTATE, "Failed to save state - error writing %s", filename.c_str());
+			gui_display_notification("Error saving state", 2000);
+			free(data);
+			return;
+		}
 	}
+	else
+	{
+#if 0
+		FILE *f = nowide::fopen(filename.c_str(), "wb");
+
+		if ( f == NULL )
+		{
+			WARN_LOG(SAVESTATE, "Failed to save state - could not open %s for writing", filename.c_str());
+			gui_display_notification("Cannot open save file", 2000);
+			free(data);
+	    	return;
+		}
 
-	std::fwrite(data, 1, ser.size(), f);
-	std::fclose(f);
+		std::fwrite(data, 1, ser.size(), f);
+		std::fclose(f);
 #else
-	RZipFile zipFile;
-	if (!zipFile.Open(filename, true))
-	{
-		WARN_LOG(SAVESTATE, "Failed to save state - could not open %s for writing", filename.c_str());
-		gui_display_notification("Cannot open save file", 2000);
-		free(data);
-    	return;
-	}
-	if (zipFile.Write(data, ser.size()) != ser.size())
-	{
-		WARN_LOG(SAVESTATE, "Failed to save state - error writing %s", filename.c_str());
-		gui_display_notification("Error saving state", 2000);
+		RZipFile zipFile;
+		if (!zipFile.Open(filename, true))
+		{
+			WARN_LOG(SAVESTATE, "Failed to save state - could not open %s for writing", filename.c_str());
+			gui_display_notification("Cannot open save file", 2000);
+			free(data);
+	    	return;
+		}
+		if (zipFile.Write(data, ser.size()) != ser.size())
+		{
+			WARN_LOG(SAVESTATE, "Failed to save state - error writing %s", filename.c_str());
+			gui_display_notification("Error saving state", 2000);
+			zipFile.Close();
+			free(data);
+	    	return;
+		}
 		zipFile.Close();
-		free(data);
-    	return;
-	}
-	zipFile.Close();
 #endif
+	}
 
 	free(data);
-	NOTICE_LOG(SAVESTATE, "Saved state to %s size %d", filename.c_str(), (int)ser.size());
+	NOTICE_LOG(SAVESTATE, "Saved state to %s size %d in %.0f ms", filename.c_str(), (int)ser.size(),
+			(os_GetSeconds() - startTime) * 1000.0);
 	gui_display_notification("State saved", 1000);
 }
 
+static void loadState(const void *data, u32 total_size, const std::string& filename, double startTime)
+{
+	try {
+		Deserializer deser(data, total_size);
+		dc_loadstate(deser);
+		NOTICE_LOG(SAVESTATE, "Loaded state ver %d from %s size %d in %.0f ms", deser.version(), filename.c_str(), total_size,
+				(os_GetSeconds() - startTime) * 1000.0);
+		if (deser.size() != total_size)
+			WARN_LOG(SAVESTATE, "Savestate size %d but only %d bytes used", total_size, (int)deser.size());
+	} catch (const Deserializer::Exception& e) {
+		ERROR_LOG(SAVESTATE, "%s", e.what());
+	}
+	EventManager::event(Event::LoadState);
+}
+
 void dc_loadstate(int index)
 {
 	u32 total_size = 0;
 	FILE *f = nullptr;
 
 	std::string filename = hostfs::getSavestatePath(index, false);
+	double startTime = os_GetSeconds();
+	f = nowide::fopen(filename.c_str(), "rb");
+	if (f != nullptr && statefile::isStateFile(f))
+	{
+		if (index == -1 && config::GGPOEnable)
+			MD5Sum().add(f)
+					.getDigest(settings.network.md5.savestate);
+		std::vector<u8> state;
+		bool rc = statefile::load(f, state);
+		std::fclose(f);
+		if (!rc)
+		{
+			WARN_LOG(SAVESTATE, "Failed to load state - I/O error");
+			gui_display_notification("Failed to load state - I/O error", 2000);
+			return;
+		}
+		loadState(state.data(), (u32)state.size(), filename, startTime);
+		return;
+	}
+	if (f != nullptr)
+	{
+		std::fclose(f);
+		f = nullptr;
+	}
 	RZipFile zipFile;
 	if (zipFile.Open(filename, false))
 	{
@@ -216,18 +273,8 @@ void dc_loadstate(int index)
 		return;
 	}
 
-	try {
-		Deserializer deser(data, total_size);
-		dc_loadstate(deser);
-	    NOTICE_LOG(SAVESTATE, "Loaded state ver %d from %s size %d", deser.version(), filename.c_str(), total_size);
-		if (deser.size() != total_size)
-			WARN_LOG(SAVESTATE, "Savestate size %d but only %d bytes used", total_size, (int)deser.size());
-	} catch (const Deserializer::Exception& e) {
-		ERROR_LOG(SAVESTATE, "%s", e.what());
-	}
-
+	loadState(data, total_size, filename, startTime);
 	free(data);
-	EventManager::event(Event::LoadState);
 }
 
 #endif
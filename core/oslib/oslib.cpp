@@ -22,6 +22,7 @@
 #include "cfg/option.h"
 #include "nowide/fstream.hpp"
 #include "storage.h"
+#include <sys/stat.h>
 #ifndef _WIN32
 #include <unistd.h>
 #endif
@@ -139,6 +140,20 @@ std::string getTextureDumpPath()
 
 }
 
+s64 os_GetFileSize(FILE *file)
+{
+#ifdef _WIN32
+	struct _stat64 st;
+	if (_fstat64(_fileno(file), &st) != 0)
+		return -1;
+#else
+	struct stat st;
+	if (fstat(fileno(file), &st) != 0)
+		return -1;
+#endif
+	return st.st_size;
+}
+
 #ifdef USE_BREAKPAD
 
 #include "rend/boxart/http_client.h"
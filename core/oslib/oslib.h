@@ -72,5 +72,8 @@ static inline void freeAligned(void *p)
 #endif
 }
 
+// 64-bit size of an open file, or -1 on error. ftell returns a 32-bit long on Windows.
+s64 os_GetFileSize(FILE *file);
+
 void registerCrash(const char *directory, const char *path);
 void uploadCrashes(const std::string& directory);
@@ -0,0 +1,189 @@
+/*
+	Copyright 2024 flyinghead
+
+	This file is part of Flycast.
+
+    Flycast is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    Flycast is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Flycast.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include "perfjit.h"
+#include "cfg/option.h"
+
+#if defined(__linux__)
+#include <cstdio>
+#include <cstring>
+#include <elf.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace perfjit
+{
+
+// See tools/perf/Documentation/jitdump-specification.txt in the linux kernel tree
+struct DumpHeader
+{
+	u32 magic;
+	u32 version;
+	u32 totalSize;
+	u32 elfMach;
+	u32 pad1;
+	u32 pid;
+	u64 timestamp;
+	u64 flags;
+};
+
+struct CodeLoadRecord
+{
+	u32 id;
+	u32 totalSize;
+	u64 timestamp;
+	u32 pid;
+	u32 tid;
+	u64 vma;
+	u64 codeAddr;
+	u64 codeSize;
+	u64 codeIndex;
+	// followed by the null-terminated name and the code
+};
+
+constexpr u32 JitDumpMagic = 0x4A695444;
+constexpr u32 JitCodeLoad = 0;
+
+static bool initialized;
+static FILE *mapFile;
+static FILE *dumpFile;
+static u64 codeIndex;
+
+static u64 timestamp()
+{
+	// Must match perf record -k 1
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (u64)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static void openDumpFile(int pid)
+{
+	char path[64];
+	snprintf(path, sizeof(path), "/tmp/jit-%d.dump", pid);
+	int fd = open(path, O_CREAT | O_TRUNC | O_RDWR, 0666);
+	if (fd == -1)
+	{
+		WARN_LOG(DYNAREC, "Can't create %s: errno %d", path, errno);
+		return;
+	}
+	// perf finds the dump file through this executable mapping
+	long pageSize = sysconf(_SC_PAGESIZE);
+	if (mmap(nullptr, pageSize, PROT_READ | PROT_EXEC, MAP_PRIVATE, fd, 0) == MAP_FAILED)
+	{
+		WARN_LOG(DYNAREC, "Can't map %s: errno %d", path, errno);
+		close(fd);
+		return;
+	}
+	dumpFile = fdopen(fd, "wb");
+	if (dumpFile == nullptr)
+	{
+		close(fd);
+		return;
+	}
+	DumpHeader header{};
+	header.magic = JitDumpMagic;
+	header.version = 1;
+	header.totalSize = sizeof(header);
+#if HOST_CPU == CPU_X64
+	header.elfMach = EM_X86_64;
+#elif HOST_CPU == CPU_ARM64
+	header.elfMach = EM_AARCH64;
+#elif HOST_CPU == CPU_X86
+	header.elfMach = EM_386;
+#elif HOST_CPU == CPU_ARM
+	header.elfMach = EM_ARM;
+#endif
+	header.pid = pid;
+	header.timestamp = timestamp();
+	fwrite(&header, sizeof(header), 1, dumpFile);
+	fflush(dumpFile);
+}
+
+static void init()
+{
+	initialized = true;
+	if (!config::DynarecPerfMap)
+		return;
+	int pid = getpid();
+	char path[64];
+	snprintf(path, sizeof(path), "/tmp/perf-%d.map", pid);
+	mapFile = fopen(path, "w");
+	if (mapFile == nullptr)
+		WARN_LOG(DYNAREC, "Can't create %s: errno %d", path, errno);
+	openDumpFile(pid);
+	if (enabled())
+		NOTICE_LOG(DYNAREC, "Exporting dynarec symbols for perf to /tmp");
+}
+
+bool enabled()
+{
+	if (!initialized)
+		init();
+	return mapFile != nullptr || dumpFile != nullptr;
+}
+
+void codeLoad(const void *code, size_t size, const char *name)
+{
+	if (!enabled())
+		return;
+	// The files are never closed so flush each record in case of crash
+	if (mapFile != nullptr)
+	{
+		fprintf(mapFile, "%zx %zx %s\n", (size_t)code, size, name);
+		fflush(mapFile);
+	}
+	if (dumpFile != nullptr)
+	{
+		size_t nameLen = strlen(name) + 1;
+		CodeLoadRecord record{};
+		record.id = JitCodeLoad;
+		record.totalSize = (u32)(sizeof(record) + nameLen + size);
+		record.timestamp = timestamp();
+		record.pid = getpid();
+		record.tid = (u32)syscall(SYS_gettid);
+		record.vma = (uintptr_t)code;
+		record.codeAddr = (uintptr_t)code;
+		record.codeSize = size;
+		record.codeIndex = codeIndex++;
+		fwrite(&record, sizeof(record), 1, dumpFile);
+		fwrite(name, nameLen, 1, dumpFile);
+		fwrite(code, size, 1, dumpFile);
+		fflush(dumpFile);
+	}
+}
+
+}
+
+#else
+
+namespace perfjit
+{
+
+bool enabled() {
+	return false;
+}
+
+void codeLoad(const void *code, size_t size, const char *name) {
+}
+
+}
+#endif
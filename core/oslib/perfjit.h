@@ -0,0 +1,36 @@
+/*
+	Copyright 2024 flyinghead
+
+	This file is part of Flycast.
+
+    Flycast is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    Flycast is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Flycast.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#pragma once
+#include "types.h"
+
+//
+// Export of the dynarec symbols to the Linux perf profiler.
+// /tmp/perf-<pid>.map is used by "perf report" to name the generated code.
+// /tmp/jit-<pid>.dump is in the jitdump format and must be merged with "perf inject --jit"
+// on a "perf record -k 1" profile. It also holds the generated code for annotation.
+// Enabled with config::DynarecPerfMap. Does nothing on other platforms.
+//
+namespace perfjit
+{
+
+bool enabled();
+// Declares a new piece of generated code. code is the executable address.
+void codeLoad(const void *code, size_t size, const char *name);
+
+}
@@ -0,0 +1,230 @@
+/*
+	Copyright 2024 flyinghead
+
+	This file is part of Flycast.
+
+    Flycast is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    Flycast is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Flycast.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include "savefile.h"
+#include "oslib.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace savefile
+{
+
+// Writes are grouped until no new write has been received for this long (in seconds)...
+constexpr double WriteDelay = 0.5;
+// ...but pending data is never kept longer than this
+constexpr double MaxWriteDelay = 2.0;
+
+static std::mutex mutex;
+static std::condition_variable cond;		// wakes up the writer thread
+static std::condition_variable flushedCond;	// signaled when pending data has been written
+static std::thread thread;
+static bool stopping;
+// Content of the changed files
+static std::unordered_map<std::string, std::vector<u8>> files;
+// Files that couldn't be written, reported by the next write
+static std::unordered_set<std::string> failedFiles;
+static u64 pending;
+static bool writing;
+static double firstWriteTime;
+static double lastWriteTime;
+static u64 flushRequested;
+static u64 flushCompleted;
+// stats
+static u64 filesWritten;
+static u64 bytesWritten;
+static u64 writeCount;
+
+static bool syncFile(FILE *f)
+{
+	if (std::fflush(f) != 0)
+		return false;
+#ifdef _WIN32
+	return _commit(_fileno(f)) == 0;
+#else
+	return fsync(fileno(f)) == 0;
+#endif
+}
+
+static bool writeFile(const std::string& path, const std::vector<u8>& data)
+{
+	std::string tmpPath = path + ".tmp";
+	FILE *f = nowide::fopen(tmpPath.c_str(), "wb");
+	if (f == nullptr)
+	{
+		WARN_LOG(COMMON, "Can't create save file %s", tmpPath.c_str());
+		return false;
+	}
+	bool ok = std::fwrite(data.data(), 1, data.size(), f) == data.size();
+	ok = ok && syncFile(f);
+	std::fclose(f);
+	if (!ok)
+	{
+		WARN_LOG(COMMON, "Error writing save file %s", tmpPath.c_str());
+		nowide::remove(tmpPath.c_str());
+		return false;
+	}
+#ifdef _WIN32
+	nowide::remove(path.c_str());
+#endif
+	if (nowide::rename(tmpPath.c_str(), path.c_str()) != 0)
+	{
+		WARN_LOG(COMMON, "Can't rename save file %s", tmpPath.c_str());
+		return false;
+	}
+	return true;
+}
+
+static void run()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	for (;;)
+	{
+		if (pending == 0)
+		{
+			flushCompleted = flushRequested;
+			flushedCond.notify_all();
+			if (stopping)
+				break;
+			cond.wait(lock);
+			continue;
+		}
+		if (flushRequested == flushCompleted && !stopping)
+		{
+			double now = os_GetSeconds();
+			double due = std::min(lastWriteTime + WriteDelay, firstWriteTime + MaxWriteDelay);
+			if (now < due)
+			{
+				cond.wait_for(lock, std::chrono::duration<double>(due - now));
+				continue;
+			}
+		}
+		// Take the changed files. Any new write will copy the whole file again.
+		std::vector<std::pair<std::string, std::vector<u8>>> snapshot;
+		for (auto& file : files)
+			snapshot.emplace_back(file.first, std::move(file.second));
+		files.clear();
+		pending = 0;
+		u64 generation = flushRequested;
+		writing = true;
+		lock.unlock();
+
+		std::vector<std::pair<const std::string *, bool>> results;
+		for (const auto& file : snapshot)
+		{
+			results.emplace_back(&file.first, writeFile(file.first, file.second));
+			bytesWritten += file.second.size();
+		}
+		filesWritten += snapshot.size();
+		writeCount++;
+
+		lock.lock();
+		for (const auto& result : results)
+		{
+			if (result.second)
+				failedFiles.erase(*result.first);
+			else
+				failedFiles.insert(*result.first);
+		}
+		writing = false;
+		if (pending == 0)
+			flushCompleted = generation;
+		flushedCond.notify_all();
+	}
+}
+
+bool write(const std::string& path, const u8 *image, u32 size)
+{
+	std::lock_guard<std::mutex> _(mutex);
+	double now = os_GetSeconds();
+	if (files.empty())
+		firstWriteTime = now;
+	lastWriteTime = now;
+	std::vector<u8>& data = files[path];
+	pending -= data.size();
+	data.assign(image, image + size);
+	pending += size;
+
+	if (!thread.joinable())
+	{
+		stopping = false;
+		thread = std::thread(run);
+	}
+	cond.notify_one();
+
+	return failedFiles.erase(path) == 0;
+}
+
+void flush()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	if ((pending == 0 && !writing) || !thread.joinable())
+		return;
+	u64 generation = ++flushRequested;
+	cond.notify_one();
+	flushedCond.wait(lock, [generation]() { return flushCompleted >= generation; });
+}
+
+u64 pendingBytes()
+{
+	std::lock_guard<std::mutex> _(mutex);
+	return pending;
+}
+
+static void stopThread()
+{
+	{
+		std::lock_guard<std::mutex> _(mutex);
+		stopping = true;
+		cond.notify_one();
+	}
+	if (thread.joinable())
+		thread.join();
+}
+
+// Writes the pending data and joins the thread at exit if a save was written after term()
+static struct Terminator
+{
+	~Terminator() {
+		stopThread();
+	}
+} terminator;
+
+void term()
+{
+	stopThread();
+	if (writeCount != 0)
+		INFO_LOG(COMMON, "Save files: %llu bytes in %llu files written in %llu batches",
+				(unsigned long long)bytesWritten, (unsigned long long)filesWritten, (unsigned long long)writeCount);
+	bytesWritten = 0;
+	filesWritten = 0;
+	writeCount = 0;
+}
+
+}
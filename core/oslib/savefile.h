@@ -0,0 +1,46 @@
+/*
+	Copyright 2024 flyinghead
+
+	This file is part of Flycast.
+
+    Flycast is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    Flycast is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Flycast.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#pragma once
+#include "types.h"
+#include <string>
+
+//
+// Write-behind persistence of save files (VMU, flash, EEPROM, nvmem).
+// Writes are copied in memory and the changed files are written to disk by a background
+// thread, so that consecutive writes to the same file are coalesced. Each file is written
+// whole to a temporary file that is synced and then renamed over the original, so a crash
+// never leaves a partially written save.
+//
+namespace savefile
+{
+
+// Records that the file at path has changed. image points to the whole content of the file.
+// Returns false if the previous write of this file to disk failed. The error is only reported once.
+bool write(const std::string& path, const u8 *image, u32 size);
+
+// Writes all pending data to disk and waits for completion
+void flush();
+
+// Size of the changed files not written to disk yet
+u64 pendingBytes();
+
+// Flushes pending data and stops the writer thread. A later write starts it again.
+void term();
+
+}
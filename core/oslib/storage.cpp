@@ -189,6 +189,7 @@ public:
 		}
 		info.isDirectory = S_ISDIR(st.st_mode);
 		info.size = st.st_size;
+		info.updateTime = st.st_mtime;
 #else // _WIN32
 		nowide::wstackstring wname;
 		if (wname.convert(path.c_str()))
@@ -198,6 +199,7 @@ public:
 			{
 				info.isDirectory = (fileAttribs.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
 				info.size = fileAttribs.nFileSizeLow + ((u64)fileAttribs.nFileSizeHigh << 32);
+				info.updateTime = fileAttribs.ftLastWriteTime.dwLowDateTime + ((u64)fileAttribs.ftLastWriteTime.dwHighDateTime << 32);
 			}
 			else
 			{
@@ -35,6 +35,7 @@ struct FileInfo
 	bool isDirectory = false;
 	size_t size = 0;
 	bool isWritable = false;
+	u64 updateTime = 0;		// Last modification time if known, only set by getFileInfo()
 };
 
 class StorageException : public FlycastException
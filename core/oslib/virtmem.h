@@ -36,6 +36,15 @@ void release_jit_block(void *code_area, size_t size);
 // Release a jit block previously allocated by prepare_jit_block (with dual RW and RX areas)
 void release_jit_block(void *code_area1, void *code_area2, size_t size);
 
+// Reserves an inaccessible host address range where views of the memory file can be mapped.
+// Returns nullptr if not supported.
+void *reserve_view_area(size_t size);
+void release_view_area(void *start, size_t size);
+// Maps size bytes of the memory file at the given offset into a view area
+bool map_view(void *dest, size_t size, size_t offset, bool writable);
+// Makes a range of a view area inaccessible again
+void unmap_view(void *dest, size_t size);
+
 bool region_lock(void *start, std::size_t len);
 bool region_unlock(void *start, std::size_t len);
 bool region_set_exec(void *start, std::size_t len);
@@ -43,6 +43,8 @@ using namespace vixl::aarch64;
 #include "hw/mem/addrspace.h"
 #include "arm64_unwind.h"
 #include "oslib/virtmem.h"
+#include "oslib/perfjit.h"
+#include "cfg/option.h"
 
 #undef do_sqw_nommu
 
@@ -274,6 +276,13 @@ public:
 
 		Sub(w1, w1, block->guest_cycles);
 		Str(w1, sh4_context_mem_operand(&Sh4cntx.cycle_counter));
+		if (config::DynarecBlockCounters)
+		{
+			Mov(x9, reinterpret_cast<uintptr_t>(&block->runCount));
+			Ldr(x10, MemOperand(x9));
+			Add(x10, x10, 1);
+			Str(x10, MemOperand(x9));
+		}
 
 		for (size_t i = 0; i < block->oplist.size(); i++)
 		{
@@ -1571,6 +1580,7 @@ public:
 		Ret();
 
 		FinalizeCode();
+		perfjit::codeLoad(CC_RW2RX(GetBuffer()->GetStartAddress<void *>()), GetBuffer()->GetSizeInBytes(), "sh4_mainloop");
 		codeBuffer.advance(GetBuffer()->GetSizeInBytes());
 
 		size_t unwindSize = unwinder.end(codeBuffer.getSize() - 128, (ptrdiff_t)CC_RW2RX(0));
@@ -20,6 +20,7 @@ using namespace Xbyak::util;
 #include "xbyak_base.h"
 #include "oslib/unwind_info.h"
 #include "oslib/virtmem.h"
+#include "oslib/perfjit.h"
 
 static void (*mainloop)();
 static void (*handleException)();
@@ -47,6 +48,8 @@ namespace MemType {
 		Fast,
 		StoreQueue,
 		Slow,
+		Shadow,		// MMU shadow page table
+		ShadowSlow,	// MMU translation then slow path
 		Count
 	};
 }
@@ -146,6 +149,11 @@ public:
 		}
 		mov(rax, (uintptr_t)&p_sh4rcb->cntx.cycle_counter);
 		sub(dword[rax], block->guest_cycles);
+		if (config::DynarecBlockCounters)
+		{
+			mov(rax, (uintptr_t)&block->runCount);
+			add(qword[rax], 1);
+		}
 
 		regalloc.DoAlloc(block);
 
@@ -228,10 +236,19 @@ public:
 							add(call_regs[0], dword[rax]);
 						}
 					}
-					genMmuLookup(block, op, 0);
+					int memType = optimise ? MemType::Fast : MemType::Slow;
+					if (shadowmmu::enabled())
+					{
+						mov(call_regs[2], block->vaddr + op.guest_offs - (op.delay_slot ? 2 : 0));	// pc
+						memType = MemType::Shadow;
+					}
+					else
+					{
+						genMmuLookup(block, op, 0);
+					}
 
 					int size = op.size == 1 ? MemSize::S8 : op.size == 2 ? MemSize::S16 : op.size == 4 ? MemSize::S32 : MemSize::S64;
-					GenCall((void (*)())MemHandlers[optimise ? MemType::Fast : MemType::Slow][size][MemOp::R], mmu_enabled());
+					GenCall((void (*)())MemHandlers[memType][size][MemOp::R], mmu_enabled());
 
 #if ALLOC_F64 == false
 					if (size == MemSize::S64)
@@ -265,7 +282,16 @@ public:
 							add(call_regs[0], dword[rax]);
 						}
 					}
-					genMmuLookup(block, op, 1);
+					int memType = optimise ? MemType::Fast : MemType::Slow;
+					if (shadowmmu::enabled())
+					{
+						mov(call_regs[2], block->vaddr + op.guest_offs - (op.delay_slot ? 2 : 0));	// pc
+						memType = MemType::Shadow;
+					}
+					else
+					{
+						genMmuLookup(block, op, 1);
+					}
 
 #if ALLOC_F64 == false
 					if (op.size == 8)
@@ -278,7 +304,7 @@ public:
 						shil_param_to_host_reg(op.rs2, call_regs64[1]);
 
 					int size = op.size == 1 ? MemSize::S8 : op.size == 2 ? MemSize::S16 : op.size == 4 ? MemSize::S32 : MemSize::S64;
-					GenCall((void (*)())MemHandlers[optimise ? MemType::Fast : MemType::Slow][size][MemOp::W], mmu_enabled());
+					GenCall((void (*)())MemHandlers[memType][size][MemOp::W], mmu_enabled());
 				}
 			}
 			break;
@@ -750,6 +776,7 @@ public:
 		ready();
 		mainloop = (void (*)())getCode();
 		handleException = (void(*)())handleExceptionLabel.getAddress();
+		perfjit::codeLoad(getCode(), getSize(), "sh4_mainloop");
 
 		codeBuffer.advance(getSize());
 	}
@@ -769,6 +796,8 @@ public:
 		{
 			for (int op = 0; op < MemOp::Count; op++)
 			{
+				if ((void *)MemHandlers[MemType::Shadow][size][op] == ca)
+					return rewriteShadowAccess(context, retAddr, size, op);
 				if ((void *)MemHandlers[MemType::Fast][size][op] != ca)
 					continue;
 
@@ -803,6 +832,33 @@ public:
 	}
 
 private:
+	bool rewriteShadowAccess(host_context_t &context, u8 *retAddr, int size, int op)
+	{
+		u32 memAddress = context.r9;
+		shadowmmu::Fault fault = shadowmmu::handleFault(memAddress, op == MemOp::W);
+		if (fault == shadowmmu::Fault::NotHandled)
+			return false;
+		if (fault == shadowmmu::Fault::Mapped)
+			// retry the access
+			return true;
+		if (fault == shadowmmu::Fault::SlowPathAlways)
+		{
+			// this access will never be mapped
+			const u8 *start = getCurr();
+			call(MemHandlers[MemType::ShadowSlow][size][op]);
+			verify(getCurr() - start == 5);
+			ready();
+		}
+		// Continue in the translating handler as if it had been called by the block
+		context.pc = (uintptr_t)MemHandlers[MemType::ShadowSlow][size][op];
+#ifdef _WIN32
+		context.rcx = memAddress;
+#else
+		context.rdi = memAddress;
+#endif
+		return true;
+	}
+
 	void genMmuLookup(const RuntimeBlockInfo* block, const shil_opcode& op, u32 write)
 	{
 		if (mmu_enabled())
@@ -1112,6 +1168,13 @@ private:
 				for (int op = 0; op < MemOp::Count; op++)
 				{
 					MemHandlers[type][size][op] = getCurr();
+					if (type == MemType::Shadow || type == MemType::ShadowSlow)
+					{
+						if (shadowmmu::base == nullptr)
+							continue;
+						genShadowHandler(type, size, op);
+						continue;
+					}
 					if (type == MemType::Fast && addrspace::virtmemEnabled())
 					{
 						mov(rax, (uintptr_t)addrspace::ram_base);
@@ -1229,6 +1292,65 @@ private:
 		MemHandlerEnd = getCurr();
 	}
 
+	void genShadowHandler(int type, int size, int op)
+	{
+		if (type == MemType::Shadow)
+		{
+			// Virtual address used as an offset in the shadow page table.
+			// Faults are handled by rewriteShadowAccess().
+			mov(rax, (uintptr_t)shadowmmu::base);
+			mov(r9, call_regs64[0]);
+
+			switch (size)
+			{
+			case MemSize::S8:
+				if (op == MemOp::R)
+					movsx(eax, byte[rax + call_regs64[0]]);
+				else
+					mov(byte[rax + call_regs64[0]], call_regs[1].cvt8());
+				break;
+
+			case MemSize::S16:
+				if (op == MemOp::R)
+					movsx(eax, word[rax + call_regs64[0]]);
+				else
+					mov(word[rax + call_regs64[0]], call_regs[1].cvt16());
+				break;
+
+			case MemSize::S32:
+				if (op == MemOp::R)
+					mov(eax, dword[rax + call_regs64[0]]);
+				else
+					mov(dword[rax + call_regs64[0]], call_regs[1]);
+				break;
+
+			case MemSize::S64:
+				if (op == MemOp::R)
+					mov(rax, qword[rax + call_regs64[0]]);
+				else
+					mov(qword[rax + call_regs64[0]], call_regs64[1]);
+				break;
+			}
+			ret();
+		}
+		else
+		{
+			// Translate the address, then tail call the slow path.
+			// call_regs[2] holds the guest pc.
+			sub(rsp, STACK_ALIGN + 16);
+			mov(qword[rsp + STACK_ALIGN], call_regs64[1]);
+			mov(call_regs[1], op == MemOp::W ? 1 : 0);
+			call((const void *)mmuDynarecLookup);
+			mov(call_regs[0], eax);
+			mov(call_regs64[1], qword[rsp + STACK_ALIGN]);
+			add(rsp, STACK_ALIGN + 16);
+			if (op == MemOp::W && size >= MemSize::S32)
+				jmp(MemHandlers[MemType::StoreQueue][size][op]);
+			else
+				jmp(MemHandlers[MemType::Slow][size][op]);
+		}
+	}
+
 	void saveXmmRegisters()
 	{
 #ifndef _WIN32
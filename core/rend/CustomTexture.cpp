@@ -33,54 +33,85 @@
 
 CustomTexture custom_texture;
 
-void CustomTexture::LoaderThread()
+// Name of the texture pack in the custom textures directory
+static const char *PackFileName = "textures.fctex";
+
+void CustomTexture::LoaderThread(bool loadMap)
 {
-	LoadMap();
-	while (initialized)
+	if (loadMap)
 	{
-		BaseTextureCacheData *texture;
-		
-		do {
-			texture = nullptr;
-			{
-				std::unique_lock<std::mutex> lock(work_queue_mutex);
-				if (!work_queue.empty())
-				{
-					texture = work_queue.back();
-					work_queue.pop_back();
-				}
-			}
-			
-			if (texture != nullptr)
-			{
-				texture->ComputeHash();
-				if (texture->custom_image_data != nullptr)
-				{
-					free(texture->custom_image_data);
-					texture->custom_image_data = nullptr;
-				}
-				if (!texture->dirty)
-				{
-					int width, height;
-					u8 *image_data = LoadCustomTexture(texture->texture_hash, width, height);
-					if (image_data == nullptr && texture->old_vqtexture_hash != 0)
-						image_data = LoadCustomTexture(texture->old_vqtexture_hash, width, height);
-					if (image_data == nullptr)
-						image_data = LoadCustomTexture(texture->old_texture_hash, width, height);
-					if (image_data != nullptr)
-					{
-						texture->custom_width = width;
-						texture->custom_height = height;
-						texture->custom_image_data = image_data;
-					}
-				}
-				texture->custom_load_in_progress--;
-			}
+		LoadMap();
+		{
+			std::lock_guard<std::mutex> lock(work_queue_mutex);
+			map_loaded = true;
+		}
+		work_available.notify_all();
+	}
+	while (true)
+	{
+		BaseTextureCacheData *texture = nullptr;
+		{
+			std::unique_lock<std::mutex> lock(work_queue_mutex);
+			work_available.wait(lock, [&]() {
+				if (!initialized)
+					return true;
+				if (map_loaded)
+					texture = NextTexture();
+				return texture != nullptr;
+			});
+			if (!initialized)
+				break;
+		}
+		ProcessTexture(texture);
+		{
+			std::lock_guard<std::mutex> lock(work_queue_mutex);
+			in_progress.erase(std::find(in_progress.begin(), in_progress.end(), texture));
+		}
+		// Another update of this texture may be waiting
+		work_available.notify_all();
+	}
+}
 
-		} while (texture != nullptr);
-		
-		wakeup_thread.Wait();
+// Must be called with work_queue_mutex held
+BaseTextureCacheData *CustomTexture::NextTexture()
+{
+	// Oldest request first. A texture already being loaded by another thread must wait.
+	for (auto it = work_queue.rbegin(); it != work_queue.rend(); ++it)
+	{
+		BaseTextureCacheData *texture = *it;
+		if (std::find(in_progress.begin(), in_progress.end(), texture) != in_progress.end())
+			continue;
+		work_queue.erase(std::next(it).base());
+		in_progress.push_back(texture);
+		return texture;
 	}
+	return nullptr;
+}
+
+void CustomTexture::ProcessTexture(BaseTextureCacheData *texture)
+{
+	texture->ComputeHash();
+	if (texture->custom_image_data != nullptr)
+	{
+		free(texture->custom_image_data);
+		texture->custom_image_data = nullptr;
+	}
+	if (!texture->dirty)
+	{
+		int width, height;
+		u8 *image_data = LoadCustomTexture(texture->texture_hash, width, height);
+		if (image_data == nullptr && texture->old_vqtexture_hash != 0)
+			image_data = LoadCustomTexture(texture->old_vqtexture_hash, width, height);
+		if (image_data == nullptr)
+			image_data = LoadCustomTexture(texture->old_texture_hash, width, height);
+		if (image_data != nullptr)
+		{
+			texture->custom_width = width;
+			texture->custom_height = height;
+			texture->custom_image_data = image_data;
+		}
+	}
+	texture->custom_load_in_progress--;
 }
 
 std::string CustomTexture::GetGameId()
@@ -113,7 +144,10 @@ bool CustomTexture::Init()
 					NOTICE_LOG(RENDERER, "Found custom textures directory: %s", textures_path.c_str());
 					custom_textures_available = true;
 					flycast::closedir(dir);
-					loader_thread.Start();
+					// png decoding is slow so several threads are used. The first one loads the texture map.
+					unsigned threadCount = std::min(std::max(std::thread::hardware_concurrency() / 2, 1u), 4u);
+					for (unsigned i = 0; i < threadCount; i++)
+						loader_threads.emplace_back(&CustomTexture::LoaderThread, this, i == 0);
 				}
 			}
 		}
@@ -125,19 +159,39 @@ void CustomTexture::Terminate()
 {
 	if (initialized)
 	{
-		initialized = false;
 		{
 			std::unique_lock<std::mutex> lock(work_queue_mutex);
+			initialized = false;
 			work_queue.clear();
 		}
-		wakeup_thread.Set();
-		loader_thread.WaitToEnd();
+		work_available.notify_all();
+		for (std::thread& thread : loader_threads)
+			thread.join();
+		loader_threads.clear();
+		in_progress.clear();
+		map_loaded = false;
+		cancel_pack = true;
+		if (pack_task.valid())
+			pack_task.get();
+		texture_pack.close();
 		texture_map.clear();
 	}
 }
 
 u8* CustomTexture::LoadCustomTexture(u32 hash, int& width, int& height)
 {
+	if (texture_pack.isOpen())
+	{
+		const u8 *pixels = texture_pack.find(hash, width, height);
+		if (pixels == nullptr)
+			return nullptr;
+		// The texture cache owns and frees the image data
+		size_t size = (size_t)width * height * 4;
+		u8 *imgData = (u8 *)malloc(size);
+		if (imgData != nullptr)
+			memcpy(imgData, pixels, size);
+		return imgData;
+	}
 	auto it = texture_map.find(hash);
 	if (it == texture_map.end())
 		return nullptr;
@@ -162,7 +216,7 @@ void CustomTexture::LoadCustomTextureAsync(BaseTextureCacheData *texture_data)
 		std::unique_lock<std::mutex> lock(work_queue_mutex);
 		work_queue.insert(work_queue.begin(), texture_data);
 	}
-	wakeup_thread.Set();
+	work_available.notify_one();
 }
 
 void CustomTexture::DumpTexture(u32 hash, int w, int h, TextureType textype, void *src_buffer)
@@ -317,5 +371,22 @@ void CustomTexture::LoadMap()
 		}
 		texture_map[hash] = item.path;
 	}
+	// The pack is only used if the directory content hasn't changed since it was built
+	const std::string packPath = textures_path + PackFileName;
+	if (!texture_map.empty() && texture_pack.open(packPath, TexturePack::sourceHash(texture_map)))
+	{
+		NOTICE_LOG(RENDERER, "Loaded texture pack %s: %d textures", packPath.c_str(), texture_pack.size());
+		texture_map.clear();
+		custom_textures_available = texture_pack.size() != 0;
+		return;
+	}
 	custom_textures_available = !texture_map.empty();
+	if (custom_textures_available && config::PackCustomTextures)
+	{
+		// Build the texture pack in the background. It will be used next time.
+		cancel_pack = false;
+		pack_task = std::async(std::launch::async, [this, packPath]() {
+			return TexturePack::create(packPath, texture_map, cancel_pack);
+		});
+	}
 }
@@ -19,16 +19,20 @@
 #pragma once
 
 #include "TexCache.h"
+#include "texture_pack.h"
 #include "stdclass.h"
 
+#include <atomic>
+#include <condition_variable>
+#include <future>
 #include <string>
+#include <thread>
 #include <vector>
 #include <map>
 #include <mutex>
 
 class CustomTexture {
 public:
-	CustomTexture() : loader_thread(loader_thread_func, this) {}
 	~CustomTexture() { Terminate(); }
 	u8* LoadCustomTexture(u32 hash, int& width, int& height);
 	void LoadCustomTextureAsync(BaseTextureCacheData *texture_data);
@@ -37,20 +41,26 @@ public:
 
 private:
 	bool Init();
-	void LoaderThread();
+	void LoaderThread(bool loadMap);
+	BaseTextureCacheData *NextTexture();
+	void ProcessTexture(BaseTextureCacheData *texture);
 	std::string GetGameId();
 	void LoadMap();
 	
-	static void *loader_thread_func(void *param) { ((CustomTexture *)param)->LoaderThread(); return NULL; }
-	
 	bool initialized = false;
 	bool custom_textures_available = false;
 	std::string textures_path;
-	cThread loader_thread;
-	cResetEvent wakeup_thread;
+	std::vector<std::thread> loader_threads;
+	std::condition_variable work_available;
 	std::vector<BaseTextureCacheData *> work_queue;
+	// textures being loaded
+	std::vector<BaseTextureCacheData *> in_progress;
 	std::mutex work_queue_mutex;
+	bool map_loaded = false;
 	std::map<u32, std::string> texture_map;
+	TexturePack texture_pack;
+	std::future<bool> pack_task;
+	std::atomic<bool> cancel_pack { false };
 };
 
 extern CustomTexture custom_texture;
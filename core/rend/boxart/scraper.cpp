@@ -25,6 +25,9 @@
 #include "reios/reios.h"
 #include "pvrparser.h"
 #include <stb_image_write.h>
+#include <atomic>
+#include <future>
+#include <mutex>
 #include <random>
 
 bool Scraper::downloadImage(const std::string& url, const std::string& localName)
@@ -64,6 +67,8 @@ std::string Scraper::makeUniqueFilename(const std::string& url)
 	static std::random_device randomDev;
 	static std::mt19937 mt(randomDev());
 	static std::uniform_int_distribution<int> dist(1, 1000000000);
+	static std::mutex mutex;
+	std::lock_guard<std::mutex> lock(mutex);
 
 	std::string extension = get_file_extension(url);
 	std::string path;
@@ -212,3 +217,17 @@ void OfflineScraper::scrape(GameBoxart& item)
 		}
 	}
 }
+
+void OfflineScraper::scrape(std::vector<GameBoxart>& items)
+{
+	const size_t threadCount = std::min<size_t>(items.size(), 4);
+	std::atomic<size_t> next { 0 };
+	std::vector<std::future<void>> workers;
+	for (size_t i = 0; i < threadCount; i++)
+		workers.push_back(std::async(std::launch::async, [&]() {
+			for (size_t idx = next++; idx < items.size(); idx = next++)
+				scrape(items[idx]);
+		}));
+	for (auto& worker : workers)
+		worker.get();
+}
@@ -124,4 +124,6 @@ class OfflineScraper : public Scraper
 {
 public:
 	void scrape(GameBoxart& item) override;
+	// Disc headers are parsed concurrently
+	void scrape(std::vector<GameBoxart>& items) override;
 };
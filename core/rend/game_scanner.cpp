@@ -0,0 +1,295 @@
+/*
+	Copyright 2024 flyinghead
+
+	This file is part of Flycast.
+
+    Flycast is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    Flycast is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Flycast.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "game_scanner.h"
+#include "oslib/oslib.h"
+#include "json.hpp"
+
+#include <algorithm>
+#include <chrono>
+
+using namespace nlohmann;
+
+constexpr int IndexVersion = 1;
+static const char *IndexFileName = "gamelist.json";
+
+static bool isGameFile(const std::string& name)
+{
+	if (name.substr(0, 2) == "._")
+		// Ignore Mac OS turds
+		return false;
+	std::string extension = get_file_extension(name);
+	return extension == "zip" || extension == "7z"
+			|| extension == "bin" || extension == "lst" || extension == "dat"
+			|| extension == "chd" || extension == "gdi" || extension == "cdi" || extension == "cue";
+}
+
+void GameScanner::loadIndex()
+{
+	indexLoaded = true;
+	std::string path = get_writable_data_path(IndexFileName);
+	FILE *f = nowide::fopen(path.c_str(), "rt");
+	if (f == nullptr)
+		return;
+	std::string content;
+	char buf[4096];
+	while (true)
+	{
+		size_t n = fread(buf, 1, sizeof(buf), f);
+		if (n == 0)
+			break;
+		content.append(buf, n);
+	}
+	fclose(f);
+
+	try {
+		json v = json::parse(content);
+		if (v.at("version").get<int>() != IndexVersion)
+			return;
+		for (const auto& jdir : v.at("directories"))
+		{
+			IndexedDirectory& dir = index[jdir.at("path").get<std::string>()];
+			dir.updateTime = jdir.at("time").get<u64>();
+			dir.subdirs = jdir.at("subdirs").get<std::vector<std::string>>();
+			for (const auto& jfile : jdir.at("files"))
+				dir.files.emplace_back(jfile.at("name").get<std::string>(), jfile.at("path").get<std::string>(), false);
+		}
+		DEBUG_LOG(COMMON, "Loaded game index: %d directories", (int)index.size());
+	} catch (const std::exception& e) {
+		WARN_LOG(COMMON, "Invalid game index %s: %s", path.c_str(), e.what());
+		index.clear();
+	}
+}
+
+void GameScanner::saveIndex()
+{
+	json dirs = json::array();
+	for (const auto& pair : index)
+	{
+		json files = json::array();
+		for (const hostfs::FileInfo& file : pair.second.files)
+			files.push_back({ { "name", file.name }, { "path", file.path } });
+		dirs.push_back({
+			{ "path", pair.first },
+			{ "time", pair.second.updateTime },
+			{ "subdirs", pair.second.subdirs },
+			{ "files", files },
+		});
+	}
+	json v = {
+		{ "version", IndexVersion },
+		{ "directories", dirs },
+	};
+	std::string path = get_writable_data_path(IndexFileName);
+	FILE *f = nowide::fopen(path.c_str(), "wt");
+	if (f == nullptr)
+	{
+		WARN_LOG(COMMON, "Can't save game index to %s: error %d", path.c_str(), errno);
+		return;
+	}
+	std::string serialized = v.dump();
+	fwrite(serialized.c_str(), 1, serialized.size(), f);
+	fclose(f);
+	indexDirty = false;
+}
+
+// Returns the indexed directory content, listing it again if it has been modified
+const GameScanner::IndexedDirectory *GameScanner::getDirectory(const std::string& path)
+{
+	u64 updateTime = 0;
+	try {
+		updateTime = hostfs::storage().getFileInfo(path).updateTime;
+	} catch (const hostfs::StorageException& e) {
+		// Not supported by this storage
+	}
+	auto it = index.find(path);
+	if (it != index.end() && updateTime != 0 && it->second.updateTime == updateTime)
+	{
+		it->second.visited = true;
+		return &it->second;
+	}
+	std::vector<hostfs::FileInfo> content;
+	try {
+		content = hostfs::storage().listContent(path);
+	} catch (const hostfs::StorageException& e) {
+		if (it != index.end())
+		{
+			index.erase(it);
+			indexDirty = true;
+		}
+		return nullptr;
+	}
+	IndexedDirectory& dir = index[path];
+	dir.updateTime = updateTime;
+	dir.subdirs.clear();
+	dir.files.clear();
+	dir.visited = true;
+	for (const hostfs::FileInfo& item : content)
+	{
+		if (item.isDirectory)
+			dir.subdirs.push_back(item.path);
+		else if (isGameFile(item.name))
+			dir.files.emplace_back(item.name, item.path, false);
+	}
+	indexDirty = true;
+
+	return &dir;
+}
+
+void GameScanner::add_game(const hostfs::FileInfo& item, std::vector<GameMedia>& games, std::vector<GameMedia>& arcadeGames)
+{
+	std::string fileName(item.name);
+	std::string gameName(get_file_basename(item.name));
+	std::string extension = get_file_extension(item.name);
+	if (extension == "zip" || extension == "7z")
+	{
+		string_tolower(gameName);
+		auto it = arcade_games.find(gameName);
+		if (it == arcade_games.end())
+			return;
+		gameName = it->second->description;
+		fileName = fileName + " (" + gameName + ")";
+		arcadeGames.push_back(GameMedia{ fileName, item.path, item.name, gameName });
+		return;
+	}
+	else if (extension == "bin" || extension == "lst" || extension == "dat")
+	{
+		if (!config::HideLegacyNaomiRoms)
+			arcadeGames.push_back(GameMedia{ fileName, item.path, item.name, gameName });
+		return;
+	}
+	else if (extension == "chd" || extension == "gdi")
+	{
+		// Hide arcade gdroms
+		std::string basename = gameName;
+		string_tolower(basename);
+		if (arcade_gdroms.count(basename) != 0)
+			return;
+	}
+	games.push_back(GameMedia{ fileName, item.path, item.name, gameName });
+}
+
+void GameScanner::add_game_directory(const std::string& path, std::vector<GameMedia>& games, std::vector<GameMedia>& arcadeGames)
+{
+	using the_clock = std::chrono::steady_clock;
+	const bool progressive = game_list.empty();
+	the_clock::time_point lastPublish = the_clock::now();
+	std::vector<std::string> dirs { path };
+	while (!dirs.empty() && running)
+	{
+		std::string dirPath = dirs.back();
+		dirs.pop_back();
+		const IndexedDirectory *dir = getDirectory(dirPath);
+		if (dir == nullptr)
+			continue;
+		if (games.empty() && arcadeGames.empty())
+		{
+			++empty_folders_scanned;
+			if (empty_folders_scanned > 1000)
+				content_path_looks_incorrect = true;
+		}
+		else
+		{
+			content_path_looks_incorrect = false;
+		}
+		for (const hostfs::FileInfo& item : dir->files)
+			add_game(item, games, arcadeGames);
+		dirs.insert(dirs.end(), dir->subdirs.rbegin(), dir->subdirs.rend());
+
+		// Without an index, show the games found so far
+		if (progressive && the_clock::now() - lastPublish >= std::chrono::milliseconds(500))
+		{
+			publish(games, arcadeGames);
+			lastPublish = the_clock::now();
+		}
+	}
+}
+
+// Sorts the games and makes them visible to the UI. Arcade games are listed last.
+void GameScanner::publish(std::vector<GameMedia> games, const std::vector<GameMedia>& arcadeGames)
+{
+	const size_t consoleCount = games.size();
+	games.insert(games.end(), arcadeGames.begin(), arcadeGames.end());
+	std::stable_sort(games.begin(), games.begin() + consoleCount);
+	std::stable_sort(games.begin() + consoleCount, games.end());
+
+	std::lock_guard<std::mutex> guard(mutex);
+	game_list = std::move(games);
+}
+
+void GameScanner::scan()
+{
+	if (arcade_games.empty())
+		for (int gameid = 0; Games[gameid].name != nullptr; gameid++)
+		{
+			const Game *game = &Games[gameid];
+			arcade_games[game->name] = game;
+			if (game->gdrom_name != nullptr)
+				arcade_gdroms.insert(game->gdrom_name);
+		}
+	std::vector<GameMedia> games;
+	std::vector<GameMedia> arcadeGames;
+	if (!indexLoaded)
+		loadIndex();
+	// Show the indexed games right away
+	for (const auto& path : config::ContentPath.get())
+	{
+		std::vector<std::string> dirs { path };
+		while (!dirs.empty())
+		{
+			auto it = index.find(dirs.back());
+			dirs.pop_back();
+			if (it == index.end())
+				continue;
+			for (const hostfs::FileInfo& item : it->second.files)
+				add_game(item, games, arcadeGames);
+			dirs.insert(dirs.end(), it->second.subdirs.begin(), it->second.subdirs.end());
+		}
+	}
+	publish(games, arcadeGames);
+	games.clear();
+	arcadeGames.clear();
+
+	for (auto& pair : index)
+		pair.second.visited = false;
+	for (const auto& path : config::ContentPath.get())
+	{
+		add_game_directory(path, games, arcadeGames);
+		if (!running)
+			break;
+	}
+	if (running)
+	{
+		publish(games, arcadeGames);
+		// Forget the directories that aren't part of the library anymore
+		for (auto it = index.begin(); it != index.end(); )
+		{
+			if (!it->second.visited)
+			{
+				it = index.erase(it);
+				indexDirty = true;
+			}
+			else
+				++it;
+		}
+		if (indexDirty)
+			saveIndex();
+		scan_done = true;
+	}
+	running = false;
+}
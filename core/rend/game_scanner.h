@@ -40,10 +40,24 @@ static bool operator<(const GameMedia &left, const GameMedia &right)
 	return left.name < right.name;
 }
 
+//
+// Game library scanner.
+// The content of each scanned directory is saved in an index (gamelist.json) that is loaded on startup
+// so the library can be displayed immediately. Only the directories whose modification time has changed
+// are listed again. Storages that don't report modification times are always listed.
+//
 class GameScanner
 {
+	// Directory content relevant to the library
+	struct IndexedDirectory
+	{
+		u64 updateTime = 0;
+		std::vector<std::string> subdirs;
+		std::vector<hostfs::FileInfo> files;
+		bool visited = false;
+	};
+
 	std::vector<GameMedia> game_list;
-	std::vector<GameMedia> arcade_game_list;
 	std::mutex mutex;
 	std::mutex threadMutex;
 	std::unique_ptr<std::thread> scan_thread;
@@ -51,85 +65,19 @@ class GameScanner
 	bool running = false;
 	std::unordered_map<std::string, const Game*> arcade_games;
 	std::unordered_set<std::string> arcade_gdroms;
+	std::unordered_map<std::string, IndexedDirectory> index;
+	bool indexLoaded = false;
+	bool indexDirty = false;
 
-	void insert_game(const GameMedia& game)
-	{
-		std::lock_guard<std::mutex> guard(mutex);
-		game_list.insert(std::upper_bound(game_list.begin(), game_list.end(), game), game);
-	}
+	void loadIndex();
+	void saveIndex();
+	const IndexedDirectory *getDirectory(const std::string& path);
+	void add_game(const hostfs::FileInfo& item, std::vector<GameMedia>& games, std::vector<GameMedia>& arcadeGames);
+	void add_game_directory(const std::string& path, std::vector<GameMedia>& games, std::vector<GameMedia>& arcadeGames);
+	void publish(std::vector<GameMedia> games, const std::vector<GameMedia>& arcadeGames);
+	void scan();
 
-	void insert_arcade_game(const GameMedia& game)
-	{
-		arcade_game_list.insert(std::upper_bound(arcade_game_list.begin(), arcade_game_list.end(), game), game);
-	}
-
-	void add_game_directory(const std::string& path)
-	{
-        hostfs::DirectoryTree tree(path);
-        std::string emptyParentPath;
-        for (const hostfs::FileInfo& item : tree)
-        {
-            if (!running)
-                break;
-            
-            if (game_list.empty())
-            {
-            	// This won't work for android content uris
-            	size_t slash = get_last_slash_pos(item.path);
-            	std::string parentPath;
-            	if (slash != 0 && slash != std::string::npos)
-            		parentPath = item.path.substr(0, slash);
-            	else
-            		parentPath = item.path;
-                if (parentPath != emptyParentPath)
-                {
-                    ++empty_folders_scanned;
-                    emptyParentPath = parentPath;
-                    if (empty_folders_scanned > 1000)
-                        content_path_looks_incorrect = true;
-                }
-            }
-            else
-            {
-                content_path_looks_incorrect = false;
-            }
-            
-        	if (item.name.substr(0, 2) == "._")
-        		// Ignore Mac OS turds
-        		continue;
-        	std::string fileName(item.name);
-            std::string gameName(get_file_basename(item.name));
-			std::string extension = get_file_extension(item.name);
-			if (extension == "zip" || extension == "7z")
-			{
-				string_tolower(gameName);
-				auto it = arcade_games.find(gameName);
-				if (it == arcade_games.end())
-					continue;
-				gameName = it->second->description;
-				fileName = fileName + " (" + gameName + ")";
-				insert_arcade_game(GameMedia{ fileName, item.path, item.name, gameName });
-				continue;
-			}
-			else if (extension == "bin" || extension == "lst" || extension == "dat")
-			{
-				if (!config::HideLegacyNaomiRoms)
-					insert_arcade_game(GameMedia{ fileName, item.path, item.name, gameName });
-				continue;
-			}
-			else if (extension == "chd" || extension == "gdi")
-			{
-				// Hide arcade gdroms
-				std::string basename = gameName;
-				string_tolower(basename);
-				if (arcade_gdroms.count(basename) != 0)
-					continue;
-			}
-			else if (extension != "cdi" && extension != "cue")
-				continue;
-			insert_game(GameMedia{ fileName, item.path, item.name, gameName });
-		}
-	}
+	friend class GameScannerTest;
 
 public:
 	~GameScanner()
@@ -161,38 +109,8 @@ public:
 			scan_thread->join();
 		running = true;
 		scan_thread = std::unique_ptr<std::thread>(
-			new std::thread([this]()
-			{
-				if (arcade_games.empty())
-					for (int gameid = 0; Games[gameid].name != nullptr; gameid++)
-					{
-						const Game *game = &Games[gameid];
-						arcade_games[game->name] = game;
-						if (game->gdrom_name != nullptr)
-							arcade_gdroms.insert(game->gdrom_name);
-					}
-				{
-					std::lock_guard<std::mutex> guard(mutex);
-					game_list.clear();
-				}
-				arcade_game_list.clear();
-				for (const auto& path : config::ContentPath.get())
-				{
-					try {
-						add_game_directory(path);
-					} catch (const hostfs::StorageException& e) {
-						// ignore
-					}
-					if (!running)
-						break;
-				}
-				{
-					std::lock_guard<std::mutex> guard(mutex);
-					game_list.insert(game_list.end(), arcade_game_list.begin(), arcade_game_list.end());
-				}
-				if (running)
-					scan_done = true;
-				running = false;
+			new std::thread([this]() {
+				scan();
 			}));
 	}
 
@@ -2307,6 +2307,12 @@ static void gui_display_settings()
 #endif
 		    	OptionCheckbox("Load Custom Textures", config::CustomTextures,
 		    			"Load custom/high-res textures from data/textures/<game id>");
+		    	{
+		    		DisabledScope scope(!config::CustomTextures);
+		    		OptionCheckbox("Pack Custom Textures", config::PackCustomTextures,
+		    				"Convert custom textures to a single pre-decoded file for faster loading. "
+		    				"Delete textures.fctex in the texture directory to rebuild it");
+		    	}
 		    }
 #ifdef VIDEO_ROUTING
 #ifdef __APPLE__
@@ -2637,6 +2643,12 @@ static void gui_display_settings()
 				OptionSlider("SH4 Clock", config::Sh4Clock, 100, 300,
 						"Over/Underclock the main SH4 CPU. Default is 200 MHz. Other values may crash, freeze or trigger unexpected nuclear reactions.",
 						"%d MHz");
+				OptionCheckbox("Idle Loop Skipping", config::IdleLoopSkip,
+						"Skip ahead to the next hardware event when the SH4 or the ARM7 spins in a polling loop. May break some games");
+#if HOST_CPU == CPU_X64 && !defined(_WIN32)
+				OptionCheckbox("MMU Shadow Page Table", config::MmuShadowPages,
+						"Map the memory pages translated by the SH4 MMU directly into host memory. Speeds up Windows CE games");
+#endif
 		    }
 	    	ImGui::Spacing();
 		    header("Other");
@@ -2667,6 +2679,20 @@ static void gui_display_settings()
 				}
 	            ImGui::SameLine();
 	            ShowHelpMarker("Log debug information to flycast.log");
+
+	            bool asyncLog = cfgLoadBool("log", "Async", false);
+	            bool newAsyncLog = asyncLog;
+				ImGui::Checkbox("Asynchronous Logging", &newAsyncLog);
+				if (asyncLog != newAsyncLog)
+				{
+					cfgSaveBool("log", "Async", newAsyncLog);
+					LogManager::Shutdown();
+					LogManager::Init();
+				}
+	            ImGui::SameLine();
+	            ShowHelpMarker("Write log messages on a background thread. Messages may be dropped if too many are logged");
+	            if (LogManager::GetInstance()->IsAsync())
+	            	ImGui::Text("Dropped log messages: %llu", (unsigned long long)LogManager::GetInstance()->GetDroppedMessages());
 #ifdef SENTRY_UPLOAD
 	            OptionCheckbox("Automatically Report Crashes", config::UploadCrashLogs,
 	            		"Automatically upload crash reports to sentry.io to help in troubleshooting. No personal information is included.");
@@ -20,11 +20,15 @@
 #include "imgui.h"
 #include "gui_util.h"
 #include "cheats.h"
+#include "cheat_search.h"
+#include "hw/sh4/sh4_mem.h"
+#include "hw/aica/aica_if.h"
 #ifdef __ANDROID__
 #include "oslib/storage.h"
 #endif
 
 static bool addingCheat;
+static bool searchingCheat;
 
 static void addCheat()
 {
@@ -70,6 +74,162 @@ static void addCheat()
 	ImGui::End();
 }
 
+static u32 currentValue(u32 address, CheatSearch::ValueType type)
+{
+	const u8 *p = (address & 0xFF000000) == 0x8C000000 ? &mem_b[address & RAM_MASK] : &aica::aica_ram[address & ARAM_MASK];
+	u32 value = 0;
+	memcpy(&value, p, CheatSearch::valueSize(type));
+	return value;
+}
+
+static std::string formatValue(u32 value, CheatSearch::ValueType type)
+{
+	char buf[32];
+	if (type == CheatSearch::ValueType::Float)
+	{
+		float f;
+		memcpy(&f, &value, sizeof(f));
+		snprintf(buf, sizeof(buf), "%g", f);
+	}
+	else {
+		snprintf(buf, sizeof(buf), "%u (%x)", value, value);
+	}
+	return buf;
+}
+
+static bool parseValue(const char *s, CheatSearch::ValueType type, u32& value)
+{
+	char *end;
+	if (type == CheatSearch::ValueType::Float)
+	{
+		float f = strtof(s, &end);
+		memcpy(&value, &f, sizeof(value));
+	}
+	else {
+		value = strtoul(s, &end, 0);
+	}
+	return end != s;
+}
+
+static void searchCheat()
+{
+	static int region;
+	static int valueType = 2;
+	static int compare;
+	static char valueText[32];
+	static std::vector<CheatSearch::Result> results;
+	static u64 candidates;
+	static bool resultsStale;
+	constexpr size_t MaxResults = 100;
+
+	centerNextWindow();
+	ImGui::SetNextWindowSize(min(ImGui::GetIO().DisplaySize, ScaledVec2(600.f, 400.f)));
+
+	ImGui::Begin("##main", nullptr, ImGuiWindowFlags_NoResize | ImGuiWindowFlags_NoTitleBar
+			| ImGuiWindowFlags_NoMove | ImGuiWindowFlags_AlwaysAutoResize);
+
+	ImGui::PushStyleVar(ImGuiStyleVar_FramePadding, ScaledVec2(20, 8));
+	ImGui::AlignTextToFramePadding();
+	ImGui::Indent(10 * settings.display.uiScale);
+	ImGui::Text("MEMORY SEARCH");
+
+	ImGui::SameLine(ImGui::GetWindowContentRegionMax().x - ImGui::CalcTextSize("Close").x - ImGui::GetStyle().FramePadding.x * 2.f);
+	if (ImGui::Button("Close"))
+		searchingCheat = false;
+
+	ImGui::Unindent(10 * settings.display.uiScale);
+	ImGui::PopStyleVar();
+
+	const bool busy = cheatSearch.busy();
+	if (resultsStale && !busy)
+	{
+		candidates = cheatSearch.candidateCount();
+		results = cheatSearch.results(MaxResults);
+		resultsStale = false;
+	}
+	const CheatSearch::ValueType type = cheatSearch.valueType();
+
+	ImGui::BeginChild(ImGui::GetID("search"), ImVec2(0, 0), ImGuiChildFlags_Border, ImGuiWindowFlags_DragScrolling | ImGuiWindowFlags_NavFlattened);
+	{
+		if (busy)
+			ImGui::BeginDisabled();
+		const char *regions[] = { "System RAM", "Sound RAM" };
+		ImGui::Combo("Memory", &region, regions, IM_ARRAYSIZE(regions));
+		const char *types[] = { "8-bit", "16-bit", "32-bit", "Float" };
+		ImGui::Combo("Value Type", &valueType, types, IM_ARRAYSIZE(types));
+		if (ImGui::Button("New Search"))
+		{
+			cheatSearch.start((CheatSearch::Region)region, (CheatSearch::ValueType)valueType);
+			resultsStale = true;
+		}
+		if (cheatSearch.isActive())
+		{
+			const char *compares[] = { "Equal to", "Not equal to", "Greater than", "Less than",
+					"Changed", "Unchanged", "Increased", "Decreased", "Increased by", "Decreased by" };
+			ImGui::Combo("Compare", &compare, compares, IM_ARRAYSIZE(compares));
+			CheatSearch::Compare cmp = (CheatSearch::Compare)compare;
+			const bool needValue = cmp < CheatSearch::Compare::Changed || cmp >= CheatSearch::Compare::IncreasedBy;
+			if (needValue)
+				ImGui::InputText("Value", valueText, sizeof(valueText), ImGuiInputTextFlags_CharsNoBlank, nullptr, nullptr);
+			if (ImGui::Button("Filter"))
+			{
+				u32 value = 0;
+				if (needValue && !parseValue(valueText, type, value))
+					gui_error("Invalid value");
+				else
+				{
+					cheatSearch.filter(cmp, value);
+					resultsStale = true;
+				}
+			}
+		}
+		if (busy)
+		{
+			ImGui::EndDisabled();
+			ImGui::Text("Searching...");
+		}
+		else if (cheatSearch.isActive())
+		{
+			ImGui::Text("%llu candidates (%.1f ms)", (unsigned long long)candidates, cheatSearch.lastPassTime());
+			if (candidates <= MaxResults)
+			{
+				for (const CheatSearch::Result& result : results)
+				{
+					ImGui::PushID(result.address);
+					ImGui::AlignTextToFramePadding();
+					ImGui::Text("%08x: %s -> %s", result.address, formatValue(result.value, type).c_str(),
+							formatValue(currentValue(result.address, type), type).c_str());
+					// Only RAM addresses can be patched by cheat codes
+					if ((result.address & 0xFF000000) == 0x8C000000)
+					{
+						ImGui::SameLine();
+						if (ImGui::Button("Add Cheat"))
+						{
+							char code[32];
+							const u32 size = CheatSearch::valueSize(type);
+							snprintf(code, sizeof(code), "%02x%06x %08x", size == 1 ? 0 : size == 2 ? 1 : 2,
+									result.address & 0xffffff, currentValue(result.address, type));
+							char name[32];
+							snprintf(name, sizeof(name), "Value at %08x", result.address);
+							try {
+								cheatManager.addGameSharkCheat(name, code);
+							} catch (const FlycastException& e) {
+								gui_error(e.what());
+							}
+						}
+					}
+					ImGui::PopID();
+				}
+			}
+		}
+	}
+	scrollWhenDraggingOnVoid();
+	windowDragScroll();
+
+	ImGui::EndChild();
+	ImGui::End();
+}
+
 static void cheatFileSelected(bool cancelled, std::string path)
 {
 	if (!cancelled)
@@ -83,6 +243,11 @@ void gui_cheats()
 		addCheat();
 		return;
 	}
+	if (searchingCheat)
+	{
+		searchCheat();
+		return;
+	}
     centerNextWindow();
     ImGui::SetNextWindowSize(min(ImGui::GetIO().DisplaySize, ScaledVec2(600.f, 400.f)));
 
@@ -94,8 +259,12 @@ void gui_cheats()
     ImGui::Indent(10 * settings.display.uiScale);
     ImGui::Text("CHEATS");
 
-	ImGui::SameLine(ImGui::GetWindowContentRegionMax().x - ImGui::CalcTextSize("Add").x  - ImGui::CalcTextSize("Close").x - ImGui::GetStyle().FramePadding.x * 6.f
-    	- ImGui::CalcTextSize("Load").x - ImGui::GetStyle().ItemSpacing.x * 2);
+	ImGui::SameLine(ImGui::GetWindowContentRegionMax().x - ImGui::CalcTextSize("Search").x - ImGui::CalcTextSize("Add").x
+		- ImGui::CalcTextSize("Close").x - ImGui::GetStyle().FramePadding.x * 8.f
+    	- ImGui::CalcTextSize("Load").x - ImGui::GetStyle().ItemSpacing.x * 3);
+	if (ImGui::Button("Search"))
+		searchingCheat = true;
+	ImGui::SameLine();
 	if (ImGui::Button("Add"))
 		addingCheat = true;
 	ImGui::SameLine();
@@ -0,0 +1,272 @@
+/*
+	Copyright 2024 flyinghead
+
+	This file is part of Flycast.
+
+    Flycast is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    Flycast is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Flycast.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "texture_pack.h"
+#include "oslib/oslib.h"
+#include "oslib/storage.h"
+#include <stb_image.h>
+#include <xxhash.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <future>
+#include <limits>
+#include <thread>
+#include <vector>
+#ifdef _WIN32
+#include <windows.h>
+#include <io.h>
+#elif !defined(__SWITCH__)
+#include <sys/mman.h>
+#endif
+
+static const u8 Magic[8] = { 'F', 'C', 'T', 'E', 'X', 'P', 'A', 'K' };
+constexpr u32 FormatVersion = 2;
+// Alignment of the pixel data
+constexpr u64 Alignment = 64;
+
+bool TexturePack::open(const std::string& path, u64 sourceHash)
+{
+	close();
+	FILE *file = nowide::fopen(path.c_str(), "rb");
+	if (file == nullptr)
+		return false;
+	const s64 fileSize = os_GetFileSize(file);
+	if (fileSize < (s64)sizeof(Header) || (u64)fileSize > std::numeric_limits<size_t>::max())
+	{
+		std::fclose(file);
+		return false;
+	}
+	dataSize = (size_t)fileSize;
+#if defined(_WIN32)
+	HANDLE fileHandle = (HANDLE)_get_osfhandle(_fileno(file));
+	HANDLE mapping = CreateFileMapping(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (mapping != NULL)
+	{
+		data = (u8 *)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, dataSize);
+		// The view keeps a reference to the mapping
+		CloseHandle(mapping);
+	}
+#elif !defined(__SWITCH__)
+	void *p = mmap(nullptr, dataSize, PROT_READ, MAP_SHARED, fileno(file), 0);
+	if (p != MAP_FAILED)
+		data = (u8 *)p;
+#else
+	// No file mapping: read the whole file
+	data = (u8 *)malloc(dataSize);
+	std::fseek(file, 0, SEEK_SET);
+	if (data != nullptr && std::fread(data, dataSize, 1, file) != 1)
+	{
+		free(data);
+		data = nullptr;
+	}
+#endif
+	std::fclose(file);
+	if (data == nullptr)
+	{
+		WARN_LOG(RENDERER, "Can't map texture pack %s", path.c_str());
+		return false;
+	}
+
+	const Header *header = (const Header *)data;
+	if (memcmp(header->magic, Magic, sizeof(Magic)) || header->version != FormatVersion
+			|| header->count > (dataSize - sizeof(Header)) / sizeof(Entry))
+	{
+		WARN_LOG(RENDERER, "Invalid texture pack %s", path.c_str());
+		close();
+		return false;
+	}
+	if (header->sourceHash != sourceHash)
+	{
+		INFO_LOG(RENDERER, "Texture pack %s is out of date", path.c_str());
+		close();
+		return false;
+	}
+	count = header->count;
+	entries = (const Entry *)(data + sizeof(Header));
+	for (u32 i = 0; i < count; i++)
+	{
+		const Entry& entry = entries[i];
+		if ((i > 0 && entry.hash <= entries[i - 1].hash)
+				|| entry.width == 0 || entry.height == 0 || entry.width > 16384 || entry.height > 16384
+				|| entry.offset > dataSize || (u64)entry.width * entry.height * 4 > dataSize - entry.offset)
+		{
+			WARN_LOG(RENDERER, "Invalid texture pack %s: bad entry %d", path.c_str(), i);
+			close();
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void TexturePack::close()
+{
+	if (data == nullptr)
+		return;
+#if defined(_WIN32)
+	UnmapViewOfFile(data);
+#elif !defined(__SWITCH__)
+	munmap(data, dataSize);
+#else
+	free(data);
+#endif
+	data = nullptr;
+	dataSize = 0;
+	entries = nullptr;
+	count = 0;
+}
+
+const u8 *TexturePack::find(u32 hash, int& width, int& height) const
+{
+	const Entry *end = entries + count;
+	const Entry *entry = std::lower_bound(entries, end, hash, [](const Entry& e, u32 hash) {
+		return e.hash < hash;
+	});
+	if (entry == end || entry->hash != hash)
+		return nullptr;
+	width = entry->width;
+	height = entry->height;
+
+	return data + entry->offset;
+}
+
+bool TexturePack::create(const std::string& path, const std::map<u32, std::string>& images,
+		const std::atomic<bool>& cancel)
+{
+	// Computed before decoding so that images modified meanwhile invalidate the pack
+	const u64 hash = sourceHash(images);
+	std::string tmpPath = path + ".tmp";
+	FILE *file = nowide::fopen(tmpPath.c_str(), "wb");
+	if (file == nullptr)
+	{
+		WARN_LOG(RENDERER, "Can't create texture pack %s: error %d", tmpPath.c_str(), errno);
+		return false;
+	}
+	// The index is written last, once the image sizes are known
+	std::vector<Entry> index;
+	index.reserve(images.size());
+	u64 offset = sizeof(Header) + images.size() * sizeof(Entry);
+	bool success = std::fseek(file, (long)offset, SEEK_SET) == 0;
+
+	// Images are decoded in parallel in batches and written in order
+	struct Image
+	{
+		u32 hash;
+		const std::string *path;
+		int width = 0;
+		int height = 0;
+		u8 *pixels = nullptr;
+	};
+	const size_t batchSize = std::max(std::thread::hardware_concurrency(), 1u);
+	std::vector<Image> batch;
+	auto it = images.begin();
+	while (it != images.end() && success && !cancel)
+	{
+		batch.clear();
+		std::vector<std::future<void>> tasks;
+		for (; it != images.end() && batch.size() < batchSize; ++it)
+			batch.push_back({ it->first, &it->second });
+		for (Image& image : batch)
+		{
+			tasks.push_back(std::async(std::launch::async, [&image]() {
+				FILE *f = nowide::fopen(image.path->c_str(), "rb");
+				if (f == nullptr)
+					return;
+				int n;
+				stbi_set_flip_vertically_on_load(1);
+				image.pixels = stbi_load_from_file(f, &image.width, &image.height, &n, STBI_rgb_alpha);
+				std::fclose(f);
+			}));
+		}
+		for (auto& task : tasks)
+			task.get();
+		for (Image& image : batch)
+		{
+			if (image.pixels == nullptr)
+			{
+				INFO_LOG(RENDERER, "Texture pack: can't decode image %08x", image.hash);
+				continue;
+			}
+			if (success)
+			{
+				const u64 size = (u64)image.width * image.height * 4;
+				const u64 padding = (Alignment - offset % Alignment) % Alignment;
+				static const u8 zeros[Alignment] {};
+				success = (padding == 0 || std::fwrite(zeros, padding, 1, file) == 1)
+						&& std::fwrite(image.pixels, size, 1, file) == 1;
+				offset += padding;
+				index.push_back({ image.hash, (u32)image.width, (u32)image.height, 0, offset });
+				offset += size;
+			}
+			stbi_image_free(image.pixels);
+		}
+	}
+	if (success && !cancel)
+	{
+		// Entries are sorted since images is
+		Header header{};
+		memcpy(header.magic, Magic, sizeof(Magic));
+		header.version = FormatVersion;
+		header.count = (u32)index.size();
+		header.sourceHash = hash;
+		success = std::fseek(file, 0, SEEK_SET) == 0
+				&& std::fwrite(&header, sizeof(header), 1, file) == 1
+				&& (index.empty() || std::fwrite(index.data(), sizeof(Entry), index.size(), file) == index.size());
+	}
+	success = std::fclose(file) == 0 && success && !cancel;
+	if (success)
+	{
+		nowide::remove(path.c_str());
+		success = nowide::rename(tmpPath.c_str(), path.c_str()) == 0;
+	}
+	if (!success)
+	{
+		nowide::remove(tmpPath.c_str());
+		return false;
+	}
+	INFO_LOG(RENDERER, "Texture pack %s created: %d images, %d MB", path.c_str(), (int)index.size(), (int)(offset / 1_MB));
+
+	return true;
+}
+
+u64 TexturePack::sourceHash(const std::map<u32, std::string>& images)
+{
+	XXH64_state_t *state = XXH64_createState();
+	XXH64_reset(state, 0);
+	for (const auto& [hash, path] : images)
+	{
+		u64 size = 0;
+		u64 updateTime = 0;
+		try {
+			hostfs::FileInfo info = hostfs::storage().getFileInfo(path);
+			size = info.size;
+			updateTime = info.updateTime;
+		} catch (const hostfs::StorageException& e) {
+		}
+		XXH64_update(state, &hash, sizeof(hash));
+		XXH64_update(state, path.c_str(), path.length() + 1);
+		XXH64_update(state, &size, sizeof(size));
+		XXH64_update(state, &updateTime, sizeof(updateTime));
+	}
+	const u64 digest = XXH64_digest(state);
+	XXH64_freeState(state);
+
+	return digest;
+}
@@ -0,0 +1,75 @@
+/*
+	Copyright 2024 flyinghead
+
+	This file is part of Flycast.
+
+    Flycast is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    Flycast is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Flycast.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+#include "types.h"
+
+#include <atomic>
+#include <map>
+#include <string>
+
+//
+// Packed custom textures.
+// A single file holding the decoded RGBA images of a texture directory, with an index sorted by hash.
+// The file is memory-mapped and finding an image is a binary search in the index.
+// The header holds a hash of the source image names, sizes and modification times so that
+// a pack older than its directory content isn't used.
+//
+class TexturePack
+{
+public:
+	~TexturePack() { close(); }
+
+	// Fails if the pack wasn't created from images with the given source hash
+	bool open(const std::string& path, u64 sourceHash);
+	void close();
+	bool isOpen() const { return data != nullptr; }
+	u32 size() const { return count; }
+	// Returns the RGBA pixels of the image with the given hash, or nullptr if not found.
+	// The image is flipped vertically, like the custom textures loaded from png files.
+	const u8 *find(u32 hash, int& width, int& height) const;
+
+	// Decodes the given images and saves them as a texture pack.
+	// Returns false on error or if cancel has been set.
+	static bool create(const std::string& path, const std::map<u32, std::string>& images,
+			const std::atomic<bool>& cancel);
+	// Hash of the names, sizes and modification times of the given image files
+	static u64 sourceHash(const std::map<u32, std::string>& images);
+
+private:
+	struct Header
+	{
+		u8 magic[8];
+		u32 version;
+		u32 count;
+		u64 sourceHash;
+	};
+	struct Entry
+	{
+		u32 hash;
+		u32 width;
+		u32 height;
+		u32 reserved;
+		u64 offset;		// of the pixels from the start of the file
+	};
+
+	u8 *data = nullptr;
+	size_t dataSize = 0;
+	const Entry *entries = nullptr;
+	u32 count = 0;
+};
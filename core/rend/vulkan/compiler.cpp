@@ -20,24 +20,38 @@
 */
 #include "compiler.h"
 #include "vulkan_context.h"
+#include "oslib/oslib.h"
 
 #include <glslang/Public/ResourceLimits.h>
 #include <glslang/Public/ShaderLang.h>
 #include <glslang/SPIRV/GlslangToSpv.h>
+#include <xxhash.h>
+
+#include <algorithm>
 
 int ShaderCompiler::initCount;
+static SpirvCache spirvCache;
+
+static u64 getTimeUs()
+{
+	return (u64)(os_GetSeconds() * 1000000.0);
+}
 
 void ShaderCompiler::Init()
 {
 	if (initCount++ == 0) {
 		bool rc = glslang::InitializeProcess();
 		verify(rc);
+		spirvCache.LoadAsync(hostfs::getShaderCachePath("vulkan_spirv.cache"));
 	}
 }
 void ShaderCompiler::Term()
 {
 	if (--initCount == 0)
+	{
+		spirvCache.Term();
 		glslang::FinalizeProcess();
+	}
 	initCount = std::max(initCount, 0);
 }
 
@@ -66,7 +80,7 @@ static EShLanguage translateShaderStage(vk::ShaderStageFlagBits stage)
 	}
 }
 
-static bool GLSLtoSPV(const vk::ShaderStageFlagBits shaderType, std::string const& glslShader, std::vector<unsigned int> &spvShader)
+bool ShaderCompiler::CompileSpirv(vk::ShaderStageFlagBits shaderType, std::string const& glslShader, std::vector<unsigned int> &spvShader)
 {
 	EShLanguage stage = translateShaderStage(shaderType);
 
@@ -107,9 +121,208 @@ static bool GLSLtoSPV(const vk::ShaderStageFlagBits shaderType, std::string cons
 vk::UniqueShaderModule ShaderCompiler::Compile(vk::ShaderStageFlagBits shaderStage, std::string const& shaderText)
 {
 	std::vector<unsigned int> shaderSPV;
-	bool ok = GLSLtoSPV(shaderStage, shaderText, shaderSPV);
-	verify(ok);
+	if (!spirvCache.Lookup(shaderStage, shaderText, shaderSPV))
+	{
+		u64 start = getTimeUs();
+		bool ok = CompileSpirv(shaderStage, shaderText, shaderSPV);
+		verify(ok);
+		spirvCache.Add(shaderStage, shaderText, shaderSPV, getTimeUs() - start);
+	}
 
 	return VulkanContext::Instance()->GetDevice().createShaderModuleUnique
 			(vk::ShaderModuleCreateInfo(vk::ShaderModuleCreateFlags(), shaderSPV));
 }
+
+u64 SpirvCache::hash(vk::ShaderStageFlagBits stage, const std::string& source)
+{
+	return XXH64(source.data(), source.size(), (u32)stage);
+}
+
+void SpirvCache::LoadAsync(const std::string& path)
+{
+	this->path = path;
+	hits = misses = 0;
+	hitTime = compileTime = 0;
+	evictions = 0;
+	useCounter = 0;
+	// The first lookup waits for the file to be read
+	loadThread = std::thread([this]() { load(); });
+}
+
+void SpirvCache::Term()
+{
+	waitLoaded();
+	if (dirty)
+		save();
+	if (hits + misses > 0)
+		INFO_LOG(RENDERER, "SPIR-V cache: %d hits (%.1f us avg), %d misses (%.1f us avg glslang compile)",
+				hits, hits == 0 ? 0.0 : (double)hitTime / hits,
+				misses, misses == 0 ? 0.0 : (double)compileTime / misses);
+	if (evictions > 0)
+		INFO_LOG(RENDERER, "SPIR-V cache: %d shaders evicted", evictions);
+	std::lock_guard<std::mutex> _(mutex);
+	entries.clear();
+	dirty = false;
+}
+
+void SpirvCache::waitLoaded()
+{
+	std::lock_guard<std::mutex> _(loadMutex);
+	if (loadThread.joinable())
+		loadThread.join();
+}
+
+bool SpirvCache::Lookup(vk::ShaderStageFlagBits stage, const std::string& source, std::vector<unsigned int>& spirv)
+{
+	u64 start = getTimeUs();
+	waitLoaded();
+	u64 key = hash(stage, source);
+	std::lock_guard<std::mutex> _(mutex);
+	auto it = entries.find(key);
+	if (it == entries.end() || it->second.stage != (u32)stage || it->second.sourceSize != source.size())
+		return false;
+	spirv = it->second.spirv;
+	it->second.lastUse = ++useCounter;
+	hits++;
+	hitTime += getTimeUs() - start;
+	return true;
+}
+
+void SpirvCache::Add(vk::ShaderStageFlagBits stage, const std::string& source, const std::vector<unsigned int>& spirv, u64 time)
+{
+	std::lock_guard<std::mutex> _(mutex);
+	misses++;
+	compileTime += time;
+	const u64 key = hash(stage, source);
+	if (entries.size() >= MAX_ENTRIES && entries.count(key) == 0)
+		evict();
+	Entry& entry = entries[key];
+	entry.stage = (u32)stage;
+	entry.sourceSize = (u32)source.size();
+	entry.spirv = spirv;
+	entry.lastUse = ++useCounter;
+	dirty = true;
+}
+
+size_t SpirvCache::size()
+{
+	waitLoaded();
+	std::lock_guard<std::mutex> _(mutex);
+	return entries.size();
+}
+
+// Removes the least recently used entry. Called with the mutex held.
+void SpirvCache::evict()
+{
+	auto lru = std::min_element(entries.begin(), entries.end(), [](const auto& a, const auto& b) {
+		return a.second.lastUse < b.second.lastUse;
+	});
+	if (lru == entries.end())
+		return;
+	DEBUG_LOG(RENDERER, "SPIR-V cache full: evicting shader %016llx", (unsigned long long)lru->first);
+	entries.erase(lru);
+	evictions++;
+}
+
+// File layout:
+// header: magic, version, glslang generator version, entry count
+// index: { u64 hash, u32 stage, u32 source size, u32 spir-v word count } * entry count
+// data: spir-v words of each entry, in index order
+void SpirvCache::load()
+{
+	FILE *f = nowide::fopen(path.c_str(), "rb");
+	if (f == nullptr)
+		return;
+	const s64 fileSize = os_GetFileSize(f);
+	u32 header[4];
+	if (std::fread(header, sizeof(header), 1, f) != 1
+			|| header[0] != MAGIC || header[1] != VERSION
+			|| header[2] != (u32)glslang::GetSpirvGeneratorVersion()
+			|| header[3] > MAX_ENTRIES)
+	{
+		WARN_LOG(RENDERER, "Ignoring invalid or outdated SPIR-V cache %s", path.c_str());
+		std::fclose(f);
+		return;
+	}
+	struct IndexEntry {
+		u64 hash;
+		u32 stage;
+		u32 sourceSize;
+		u32 wordCount;
+		u32 padding;
+	};
+	std::vector<IndexEntry> index(header[3]);
+	if (!index.empty() && std::fread(index.data(), sizeof(IndexEntry), index.size(), f) != index.size())
+	{
+		WARN_LOG(RENDERER, "Truncated SPIR-V cache index %s", path.c_str());
+		std::fclose(f);
+		return;
+	}
+	// The word counts must fit in what's left of the file
+	s64 remaining = fileSize - (s64)sizeof(header) - (s64)(sizeof(IndexEntry) * index.size());
+	std::unordered_map<u64, Entry> loaded;
+	for (const IndexEntry& ie : index)
+	{
+		if ((s64)ie.wordCount * (s64)sizeof(unsigned int) > remaining)
+		{
+			WARN_LOG(RENDERER, "Invalid SPIR-V cache %s", path.c_str());
+			std::fclose(f);
+			return;
+		}
+		remaining -= (s64)ie.wordCount * sizeof(unsigned int);
+		Entry entry;
+		entry.stage = ie.stage;
+		entry.sourceSize = ie.sourceSize;
+		entry.lastUse = 0;
+		entry.spirv.resize(ie.wordCount);
+		if (std::fread(entry.spirv.data(), sizeof(unsigned int), ie.wordCount, f) != ie.wordCount)
+		{
+			WARN_LOG(RENDERER, "Truncated SPIR-V cache %s", path.c_str());
+			std::fclose(f);
+			return;
+		}
+		loaded[ie.hash] = std::move(entry);
+	}
+	std::fclose(f);
+
+	std::lock_guard<std::mutex> _(mutex);
+	for (auto& it : loaded)
+		entries.emplace(it.first, std::move(it.second));
+	INFO_LOG(RENDERER, "SPIR-V cache loaded from %s: %d shaders", path.c_str(), (int)loaded.size());
+}
+
+void SpirvCache::save()
+{
+	std::string tmpPath = path + ".tmp";
+	FILE *f = nowide::fopen(tmpPath.c_str(), "wb");
+	if (f == nullptr)
+	{
+		WARN_LOG(RENDERER, "Can't create SPIR-V cache %s", tmpPath.c_str());
+		return;
+	}
+	std::lock_guard<std::mutex> _(mutex);
+	u32 header[4] { MAGIC, VERSION, (u32)glslang::GetSpirvGeneratorVersion(), (u32)entries.size() };
+	bool ok = std::fwrite(header, sizeof(header), 1, f) == 1;
+	for (const auto& it : entries)
+	{
+		u32 index[4] { it.second.stage, it.second.sourceSize, (u32)it.second.spirv.size(), 0 };
+		ok = ok && std::fwrite(&it.first, sizeof(it.first), 1, f) == 1
+				&& std::fwrite(index, sizeof(index), 1, f) == 1;
+	}
+	for (const auto& it : entries)
+		ok = ok && std::fwrite(it.second.spirv.data(), sizeof(unsigned int), it.second.spirv.size(), f) == it.second.spirv.size();
+	std::fclose(f);
+	if (!ok)
+	{
+		WARN_LOG(RENDERER, "Error writing SPIR-V cache %s", tmpPath.c_str());
+		nowide::remove(tmpPath.c_str());
+		return;
+	}
+#ifdef _WIN32
+	nowide::remove(path.c_str());
+#endif
+	if (nowide::rename(tmpPath.c_str(), path.c_str()) != 0)
+		WARN_LOG(RENDERER, "Can't rename SPIR-V cache %s", tmpPath.c_str());
+	else
+		dirty = false;
+}
@@ -21,12 +21,69 @@
 #pragma once
 #include "vulkan.h"
 
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
 class ShaderCompiler
 {
 public:
 	static void Init();
 	static void Term();
 	static vk::UniqueShaderModule Compile(vk::ShaderStageFlagBits shaderStage, std::string const& shaderText);
+	// GLSL to SPIR-V compilation with glslang, without cache
+	static bool CompileSpirv(vk::ShaderStageFlagBits shaderStage, std::string const& shaderText, std::vector<unsigned int>& spirv);
 private:
 	static int initCount;
 };
+
+// Persistent cache of the SPIR-V generated by glslang, keyed by a hash of the GLSL source and shader stage.
+// Only the glslang step is cached: shader modules and pipelines are still created on first use.
+// There is no warm-up pass: shaders aren't compiled ahead of time, the cache file is only read asynchronously.
+class SpirvCache
+{
+public:
+	// Starts reading the cache file on a background thread. Lookups wait until it's read.
+	void LoadAsync(const std::string& path);
+	// Saves the cache file if new shaders were added
+	void Term();
+	bool Lookup(vk::ShaderStageFlagBits stage, const std::string& source, std::vector<unsigned int>& spirv);
+	void Add(vk::ShaderStageFlagBits stage, const std::string& source, const std::vector<unsigned int>& spirv, u64 compileTime);
+	size_t size();
+
+	static constexpr size_t MAX_ENTRIES = 4096;
+
+private:
+	struct Entry
+	{
+		u32 stage;
+		u32 sourceSize;
+		std::vector<unsigned int> spirv;
+		u64 lastUse;	// 0 for entries loaded from the cache file and not used since
+	};
+
+	void load();
+	void save();
+	void waitLoaded();
+	void evict();
+	static u64 hash(vk::ShaderStageFlagBits stage, const std::string& source);
+
+	static constexpr u32 MAGIC = 0x56505346;	// 'FSPV'
+	static constexpr u32 VERSION = 1;
+
+	std::string path;
+	std::mutex mutex;
+	std::unordered_map<u64, Entry> entries;
+	u64 useCounter = 0;
+	std::thread loadThread;
+	std::mutex loadMutex;
+	bool dirty = false;
+	u32 evictions = 0;
+	// statistics
+	u32 hits = 0;
+	u32 misses = 0;
+	u64 hitTime = 0;
+	u64 compileTime = 0;
+};
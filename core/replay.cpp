@@ -0,0 +1,1010 @@
+/*
+	Copyright 2024 flyinghead
+
+	This file is part of Flycast.
+
+    Flycast is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    Flycast is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Flycast.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "replay.h"
+#include "archive/statefile.h"
+#include "oslib/oslib.h"
+#include "emulator.h"
+#include "cfg/option.h"
+#include "hw/sh4/sh4_mem.h"
+#include "hw/sh4/sh4_sched.h"
+#include "imgread/common.h"
+#ifndef LIBRETRO
+#include "rend/mainui.h"
+#endif
+#include <xxhash.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#ifdef _WIN32
+#include <windows.h>
+#include <io.h>
+#elif !defined(__SWITCH__)
+#include <sys/mman.h>
+#endif
+
+namespace replay
+{
+
+static const u8 Magic[8] = { 'F', 'C', 'R', 'E', 'P', 'L', 'A', 'Y' };
+constexpr u32 FormatVersion = 1;
+
+// At the end of the file, after the stream and the game path
+struct Trailer
+{
+	u8 magic[8];
+	u32 version;
+	u32 frameCount;
+	u64 streamOffset;
+	u64 streamSize;
+	u32 gamePathSize;
+	u32 reserved;
+};
+
+enum EventType : u8
+{
+	Input,
+	Rtc,
+	NetworkPacket,
+	NetworkSlots,
+	ModemByte,
+	Media,
+	Checksum,
+};
+
+// Maple input state fields, delta-encoded
+constexpr int InputFields = 1 + PJTI_Count + PJAI_Count + 1 + 2 + 3 + 1 + 6;
+
+static void getFields(const MapleInputState& state, s64 *f)
+{
+	*f++ = state.kcode;
+	for (u16 v : state.halfAxes)
+		*f++ = v;
+	for (s16 v : state.fullAxes)
+		*f++ = v;
+	*f++ = state.mouseButtons;
+	*f++ = state.absPos.x;
+	*f++ = state.absPos.y;
+	*f++ = state.relPos.x;
+	*f++ = state.relPos.y;
+	*f++ = state.relPos.wheel;
+	*f++ = state.keyboard.shift;
+	for (u8 v : state.keyboard.key)
+		*f++ = v;
+}
+
+static void setFields(MapleInputState& state, const s64 *f)
+{
+	state.kcode = (u32)*f++;
+	for (u16& v : state.halfAxes)
+		v = (u16)*f++;
+	for (s16& v : state.fullAxes)
+		v = (s16)*f++;
+	state.mouseButtons = (u8)*f++;
+	state.absPos.x = (int)*f++;
+	state.absPos.y = (int)*f++;
+	state.relPos.x = (s16)*f++;
+	state.relPos.y = (s16)*f++;
+	state.relPos.wheel = (s16)*f++;
+	state.keyboard.shift = (u8)*f++;
+	for (u8& v : state.keyboard.key)
+		v = (u8)*f++;
+}
+
+static void writeVarint(std::vector<u8>& out, u64 v)
+{
+	while (v >= 0x80)
+	{
+		out.push_back((u8)v | 0x80);
+		v >>= 7;
+	}
+	out.push_back((u8)v);
+}
+
+static u64 zigzag(s64 v) {
+	return ((u64)v << 1) ^ (u64)(v >> 63);
+}
+
+static s64 unzigzag(u64 v) {
+	return (s64)(v >> 1) ^ -(s64)(v & 1);
+}
+
+namespace {
+
+class StreamReader
+{
+public:
+	StreamReader(const u8 *p, const u8 *end) : p(p), end(end) {}
+
+	u64 varint()
+	{
+		u64 v = 0;
+		for (int shift = 0; shift < 64; shift += 7)
+		{
+			if (p == end) {
+				ok = false;
+				return 0;
+			}
+			u8 b = *p++;
+			v |= (u64)(b & 0x7f) << shift;
+			if ((b & 0x80) == 0)
+				return v;
+		}
+		ok = false;
+		return 0;
+	}
+
+	u8 byte()
+	{
+		if (p == end) {
+			ok = false;
+			return 0;
+		}
+		return *p++;
+	}
+
+	const u8 *bytes(u64 size)
+	{
+		if (size > (u64)(end - p)) {
+			ok = false;
+			return nullptr;
+		}
+		const u8 *data = p;
+		p += size;
+		return data;
+	}
+
+	const u8 *p;
+	const u8 *end;
+	bool ok = true;
+};
+
+}
+
+bool Recorder::open(const std::string& path, const std::string& gamePath,
+		const u8 *state, size_t stateSize, const std::vector<Serializer::SectionMark>& sections)
+{
+	close();
+	if (!statefile::save(path, state, stateSize, sections))
+		return false;
+	file = nowide::fopen(path.c_str(), "ab");
+	if (file == nullptr)
+		return false;
+	const s64 stateFileSize = os_GetFileSize(file);
+	if (stateFileSize < 0)
+	{
+		std::fclose(file);
+		file = nullptr;
+		return false;
+	}
+	streamOffset = (u64)stateFileSize;
+	streamSize = 0;
+	this->gamePath = gamePath;
+	frameEvents.clear();
+	eventCount = 0;
+	buffer.clear();
+	frameNum = 0;
+	lastRecordFrame = 0;
+	inputPolls = 0;
+	networkPolls = 0;
+	modemPolls = 0;
+	for (MapleInputState& s : inputState)
+		s = MapleInputState();
+	lastRtc = 0;
+	lastPacketNumber = 0;
+	error = false;
+
+	return true;
+}
+
+bool Recorder::close()
+{
+	if (file == nullptr)
+		return true;
+	// Partial last frame
+	if (eventCount != 0)
+		endFrame();
+	flush();
+	buffer.insert(buffer.end(), gamePath.begin(), gamePath.end());
+	Trailer trailer{};
+	memcpy(trailer.magic, Magic, sizeof(Magic));
+	trailer.version = FormatVersion;
+	trailer.frameCount = frameNum;
+	trailer.streamOffset = streamOffset;
+	trailer.streamSize = streamSize;
+	trailer.gamePathSize = (u32)gamePath.size();
+	if (std::fwrite(buffer.data(), 1, buffer.size(), file) != buffer.size()
+			|| std::fwrite(&trailer, sizeof(trailer), 1, file) != 1)
+		error = true;
+	buffer.clear();
+	if (std::fclose(file) != 0)
+		error = true;
+	file = nullptr;
+
+	return !error;
+}
+
+void Recorder::beginEvent(u8 type)
+{
+	frameEvents.push_back(type);
+	eventCount++;
+}
+
+void Recorder::input(const MapleInputState state[4])
+{
+	s64 oldFields[4][InputFields];
+	s64 newFields[4][InputFields];
+	u8 portMask = 0;
+	for (int port = 0; port < 4; port++)
+	{
+		getFields(inputState[port], oldFields[port]);
+		getFields(state[port], newFields[port]);
+		if (memcmp(oldFields[port], newFields[port], sizeof(newFields[port])))
+			portMask |= 1 << port;
+	}
+	if (portMask == 0)
+	{
+		inputPolls++;
+		return;
+	}
+	beginEvent(Input);
+	writeVarint(frameEvents, inputPolls);
+	inputPolls = 0;
+	frameEvents.push_back(portMask);
+	for (int port = 0; port < 4; port++)
+	{
+		if ((portMask & (1 << port)) == 0)
+			continue;
+		u32 fieldMask = 0;
+		for (int i = 0; i < InputFields; i++)
+			if (newFields[port][i] != oldFields[port][i])
+				fieldMask |= 1 << i;
+		writeVarint(frameEvents, fieldMask);
+		for (int i = 0; i < InputFields; i++)
+			if (fieldMask & (1 << i))
+				writeVarint(frameEvents, zigzag(newFields[port][i] - oldFields[port][i]));
+		inputState[port] = state[port];
+	}
+}
+
+void Recorder::rtc(u32 time)
+{
+	beginEvent(Rtc);
+	writeVarint(frameEvents, zigzag((s64)time - lastRtc));
+	lastRtc = time;
+}
+
+void Recorder::networkReceive(const u8 *data, u32 size, u16 packetNumber)
+{
+	if (data == nullptr)
+	{
+		networkPolls++;
+		return;
+	}
+	beginEvent(NetworkPacket);
+	writeVarint(frameEvents, networkPolls);
+	networkPolls = 0;
+	writeVarint(frameEvents, zigzag((s16)(packetNumber - lastPacketNumber)));
+	lastPacketNumber = packetNumber;
+	writeVarint(frameEvents, size);
+	frameEvents.insert(frameEvents.end(), data, data + size);
+}
+
+void Recorder::networkSlots(int count, int id)
+{
+	beginEvent(NetworkSlots);
+	writeVarint(frameEvents, zigzag(count));
+	writeVarint(frameEvents, zigzag(id));
+}
+
+void Recorder::modemRead(int c)
+{
+	if (c < 0)
+	{
+		modemPolls++;
+		return;
+	}
+	beginEvent(ModemByte);
+	writeVarint(frameEvents, modemPolls);
+	modemPolls = 0;
+	frameEvents.push_back((u8)c);
+}
+
+void Recorder::mediaChange(const MediaChange& change)
+{
+	beginEvent(Media);
+	writeVarint(frameEvents, change.cycle);
+	frameEvents.push_back(change.openLid);
+	writeVarint(frameEvents, change.path.size());
+	frameEvents.insert(frameEvents.end(), change.path.begin(), change.path.end());
+}
+
+void Recorder::checksum(u64 hash)
+{
+	beginEvent(Checksum);
+	u8 bytes[8];
+	memcpy(bytes, &hash, sizeof(bytes));
+	frameEvents.insert(frameEvents.end(), std::begin(bytes), std::end(bytes));
+}
+
+void Recorder::endFrame()
+{
+	if (eventCount != 0)
+	{
+		writeVarint(buffer, frameNum - lastRecordFrame);
+		writeVarint(buffer, eventCount);
+		buffer.insert(buffer.end(), frameEvents.begin(), frameEvents.end());
+		lastRecordFrame = frameNum;
+		frameEvents.clear();
+		eventCount = 0;
+		if (buffer.size() >= 64_KB)
+			flush();
+	}
+	frameNum++;
+	inputPolls = 0;
+	networkPolls = 0;
+	modemPolls = 0;
+}
+
+bool Recorder::flush()
+{
+	if (!buffer.empty())
+	{
+		if (std::fwrite(buffer.data(), 1, buffer.size(), file) != buffer.size())
+			error = true;
+		streamSize += buffer.size();
+		buffer.clear();
+	}
+	return !error;
+}
+
+bool Player::open(const std::string& path)
+{
+	close();
+	FILE *file = nowide::fopen(path.c_str(), "rb");
+	if (file == nullptr)
+		return false;
+	const s64 fileSize = os_GetFileSize(file);
+	if (fileSize < (s64)sizeof(Trailer) || (u64)fileSize > std::numeric_limits<size_t>::max())
+	{
+		std::fclose(file);
+		return false;
+	}
+	dataSize = (size_t)fileSize;
+#if defined(_WIN32)
+	HANDLE fileHandle = (HANDLE)_get_osfhandle(_fileno(file));
+	HANDLE mapping = CreateFileMapping(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (mapping != NULL)
+	{
+		data = (u8 *)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, dataSize);
+		// The view keeps a reference to the mapping
+		CloseHandle(mapping);
+	}
+#elif !defined(__SWITCH__)
+	void *p = mmap(nullptr, dataSize, PROT_READ, MAP_SHARED, fileno(file), 0);
+	if (p != MAP_FAILED)
+		data = (u8 *)p;
+#else
+	// No file mapping: read the whole file
+	data = (u8 *)malloc(dataSize);
+	std::fseek(file, 0, SEEK_SET);
+	if (data != nullptr && std::fread(data, dataSize, 1, file) != 1)
+	{
+		free(data);
+		data = nullptr;
+	}
+#endif
+	std::fclose(file);
+	if (data == nullptr)
+	{
+		WARN_LOG(COMMON, "Can't map replay file %s", path.c_str());
+		return false;
+	}
+
+	Trailer trailer;
+	memcpy(&trailer, data + dataSize - sizeof(Trailer), sizeof(Trailer));
+	const u64 streamLimit = dataSize - sizeof(Trailer);
+	if (memcmp(trailer.magic, Magic, sizeof(Magic)) || trailer.version != FormatVersion
+			|| trailer.streamOffset > streamLimit
+			|| trailer.streamSize > streamLimit - trailer.streamOffset
+			|| trailer.gamePathSize != streamLimit - trailer.streamOffset - trailer.streamSize)
+	{
+		WARN_LOG(COMMON, "Invalid replay file %s", path.c_str());
+		close();
+		return false;
+	}
+	this->path = path;
+	pos = data + trailer.streamOffset;
+	streamEnd = pos + trailer.streamSize;
+	gamePath = std::string((const char *)streamEnd, trailer.gamePathSize);
+	frames = trailer.frameCount;
+	frameNum = 0;
+	error.clear();
+	for (MapleInputState& s : decodeState)
+		s = MapleInputState();
+	for (MapleInputState& s : inputState)
+		s = MapleInputState();
+	lastRtc = 0;
+	lastPacketNumber = 0;
+
+	StreamReader reader(pos, streamEnd);
+	nextRecordFrame = pos < streamEnd ? (u32)reader.varint() : ~0u;
+	pos = reader.p;
+	if (!reader.ok || !decodeFrame())
+	{
+		WARN_LOG(COMMON, "Invalid replay file %s: %s", path.c_str(), error.c_str());
+		close();
+		return false;
+	}
+
+	return true;
+}
+
+void Player::close()
+{
+	if (data == nullptr)
+		return;
+#if defined(_WIN32)
+	UnmapViewOfFile(data);
+#elif !defined(__SWITCH__)
+	munmap(data, dataSize);
+#else
+	free(data);
+#endif
+	data = nullptr;
+	dataSize = 0;
+	pos = nullptr;
+	streamEnd = nullptr;
+	inputs.clear();
+	packets.clear();
+	frames = 0;
+}
+
+bool Player::loadState(std::vector<u8>& state) const
+{
+	FILE *file = nowide::fopen(path.c_str(), "rb");
+	if (file == nullptr)
+		return false;
+	bool rc = statefile::isStateFile(file) && statefile::load(file, state);
+	std::fclose(file);
+
+	return rc;
+}
+
+void Player::diverge(const std::string& reason)
+{
+	if (error.empty())
+		error = "frame " + std::to_string(frameNum) + ": " + reason;
+}
+
+bool Player::decodeFrame()
+{
+	inputs.clear();
+	rtcs.clear();
+	packets.clear();
+	slots.clear();
+	modemBytes.clear();
+	media.clear();
+	hasChecksum = false;
+	inputIndex = 0;
+	rtcIndex = 0;
+	packetIndex = 0;
+	slotIndex = 0;
+	modemIndex = 0;
+	inputPolls = 0;
+	networkPolls = 0;
+	modemPolls = 0;
+	if (frameNum != nextRecordFrame)
+		return true;
+
+	StreamReader reader(pos, streamEnd);
+	u64 count = reader.varint();
+	for (u64 i = 0; i < count && reader.ok; i++)
+	{
+		switch (reader.byte())
+		{
+		case Input:
+			{
+				InputEvent event;
+				event.polls = (u32)reader.varint();
+				u8 portMask = reader.byte();
+				for (int port = 0; port < 4; port++)
+				{
+					if ((portMask & (1 << port)) == 0)
+						continue;
+					s64 fields[InputFields];
+					getFields(decodeState[port], fields);
+					u64 fieldMask = reader.varint();
+					for (int f = 0; f < InputFields; f++)
+						if (fieldMask & (1ull << f))
+							fields[f] += unzigzag(reader.varint());
+					setFields(decodeState[port], fields);
+				}
+				memcpy(event.state, decodeState, sizeof(event.state));
+				inputs.push_back(event);
+			}
+			break;
+
+		case Rtc:
+			lastRtc += (u32)unzigzag(reader.varint());
+			rtcs.push_back(lastRtc);
+			break;
+
+		case NetworkPacket:
+			{
+				NetworkEvent event;
+				event.polls = (u32)reader.varint();
+				lastPacketNumber += (u16)unzigzag(reader.varint());
+				event.packetNumber = lastPacketNumber;
+				u64 size = reader.varint();
+				event.data = reader.bytes(size);
+				event.size = (u32)size;
+				packets.push_back(event);
+			}
+			break;
+
+		case NetworkSlots:
+			{
+				int count = (int)unzigzag(reader.varint());
+				int id = (int)unzigzag(reader.varint());
+				slots.emplace_back(count, id);
+			}
+			break;
+
+		case ModemByte:
+			{
+				ModemEvent event;
+				event.polls = (u32)reader.varint();
+				event.c = reader.byte();
+				modemBytes.push_back(event);
+			}
+			break;
+
+		case Media:
+			{
+				MediaChange change;
+				change.cycle = reader.varint();
+				change.openLid = reader.byte() != 0;
+				u64 size = reader.varint();
+				const u8 *p = reader.bytes(size);
+				if (p != nullptr)
+					change.path = std::string((const char *)p, size);
+				media.push_back(change);
+			}
+			break;
+
+		case Checksum:
+			{
+				const u8 *p = reader.bytes(sizeof(checksum));
+				if (p != nullptr)
+					memcpy(&checksum, p, sizeof(checksum));
+				hasChecksum = true;
+			}
+			break;
+
+		default:
+			reader.ok = false;
+			break;
+		}
+	}
+	if (reader.ok)
+	{
+		if (reader.p < streamEnd)
+		{
+			u64 delta = reader.varint();
+			if (delta == 0)
+				reader.ok = false;
+			nextRecordFrame += (u32)delta;
+		}
+		else {
+			nextRecordFrame = ~0u;
+		}
+	}
+	pos = reader.p;
+	if (!reader.ok)
+	{
+		diverge("invalid stream");
+		return false;
+	}
+
+	return true;
+}
+
+void Player::input(MapleInputState state[4])
+{
+	if (inputIndex < inputs.size() && inputs[inputIndex].polls == inputPolls)
+	{
+		memcpy(inputState, inputs[inputIndex].state, sizeof(inputState));
+		inputIndex++;
+		inputPolls = 0;
+	}
+	else {
+		inputPolls++;
+	}
+	memcpy(state, inputState, sizeof(inputState));
+}
+
+u32 Player::rtc()
+{
+	if (rtcIndex == rtcs.size())
+	{
+		diverge("unexpected RTC read");
+		return lastRtc;
+	}
+	return rtcs[rtcIndex++];
+}
+
+bool Player::networkReceive(u8 *data, u32 size, u16& packetNumber)
+{
+	if (packetIndex == packets.size() || packets[packetIndex].polls != networkPolls)
+	{
+		networkPolls++;
+		return false;
+	}
+	const NetworkEvent& event = packets[packetIndex++];
+	networkPolls = 0;
+	if (event.size > size)
+		diverge("network packet too large");
+	memcpy(data, event.data, std::min(size, event.size));
+	packetNumber = event.packetNumber;
+
+	return true;
+}
+
+void Player::networkSlots(int& count, int& id)
+{
+	if (slotIndex == slots.size())
+	{
+		diverge("unexpected network start");
+		count = 0;
+		id = 0;
+		return;
+	}
+	count = slots[slotIndex].first;
+	id = slots[slotIndex].second;
+	slotIndex++;
+}
+
+int Player::modemRead()
+{
+	if (modemIndex == modemBytes.size() || modemBytes[modemIndex].polls != modemPolls)
+	{
+		modemPolls++;
+		return -1;
+	}
+	modemPolls = 0;
+	return modemBytes[modemIndex++].c;
+}
+
+bool Player::endFrame(const std::function<u64()>& ramChecksum)
+{
+	if (inputIndex != inputs.size())
+		diverge("missed input change");
+	else if (rtcIndex != rtcs.size())
+		diverge("missed RTC read");
+	else if (packetIndex != packets.size())
+		diverge("missed network packet");
+	else if (slotIndex != slots.size())
+		diverge("missed network start");
+	else if (modemIndex != modemBytes.size())
+		diverge("missed modem data");
+	else if (hasChecksum && ramChecksum() != checksum)
+		diverge("RAM checksum mismatch");
+	if (diverged())
+		return false;
+	frameNum++;
+
+	return decodeFrame();
+}
+
+bool isRecording;
+bool isPlaying;
+
+// RAM checksum interval in frames
+constexpr u32 ChecksumInterval = 60;
+
+static Recorder recorder;
+static Player player;
+static bool listening;
+static u64 frameStart;
+static int schedId = -1;
+static size_t mediaIndex;
+static bool exitWhenDone;
+static double playbackStart;
+static std::string pendingRecording;
+static std::string pendingPlayback;
+
+static u64 ramChecksum() {
+	return XXH64(&mem_b[0], RAM_SIZE, 0);
+}
+
+static void finishPlayback()
+{
+	if (player.diverged())
+		ERROR_LOG(COMMON, "Replay diverged at %s", player.getError().c_str());
+	else
+	{
+		const double duration = os_GetSeconds() - playbackStart;
+		NOTICE_LOG(COMMON, "Replay finished: %d frames in %.2f s (%.1f fps)", player.frame(), duration,
+				duration > 0 ? player.frame() / duration : 0.0);
+	}
+	stopPlayback();
+#ifndef LIBRETRO
+	if (exitWhenDone)
+		mainui_stop();
+#endif
+}
+
+static void applyMediaChange(const MediaChange& change)
+{
+	try {
+		if (change.openLid)
+			DiscOpenLid();
+		else
+			DiscSwap(change.path);
+	} catch (const FlycastException& e) {
+		ERROR_LOG(COMMON, "Replay media change failed: %s", e.what());
+	}
+}
+
+// Applies the media changes of the frame at their recorded cycle
+static int mediaCallback(int tag, int cycles, int jitter, void *arg)
+{
+	const std::vector<MediaChange>& media = player.mediaChanges();
+	const u64 now = sh4_sched_now64() - frameStart;
+	while (mediaIndex < media.size() && media[mediaIndex].cycle <= now)
+		applyMediaChange(media[mediaIndex++]);
+	if (mediaIndex == media.size())
+		return 0;
+	return (int)std::min<u64>(media[mediaIndex].cycle - now, SH4_MAIN_CLOCK);
+}
+
+static void scheduleMediaChanges()
+{
+	mediaIndex = 0;
+	if (player.mediaChanges().empty())
+		return;
+	int cycles = mediaCallback(0, 0, 0, nullptr);
+	if (cycles != 0)
+		sh4_sched_request(schedId, cycles);
+}
+
+static void vblank(Event event, void *)
+{
+	if (isRecording)
+	{
+		if ((recorder.frame() + 1) % ChecksumInterval == 0)
+			recorder.checksum(ramChecksum());
+		recorder.endFrame();
+	}
+	else if (isPlaying)
+	{
+		frameStart = sh4_sched_now64();
+		if (!player.endFrame(ramChecksum) || player.finished())
+			finishPlayback();
+		else
+			scheduleMediaChanges();
+		return;
+	}
+	frameStart = sh4_sched_now64();
+}
+
+static void onEvent(Event event, void *)
+{
+	switch (event)
+	{
+	case Event::Start:
+		// Deferred requests
+		if (!pendingRecording.empty())
+		{
+			startRecording(pendingRecording);
+			pendingRecording.clear();
+		}
+		else if (!pendingPlayback.empty())
+		{
+			if (!startPlayback(pendingPlayback))
+			{
+				ERROR_LOG(COMMON, "Replay %s failed to start", pendingPlayback.c_str());
+#ifndef LIBRETRO
+				mainui_stop();
+#endif
+			}
+			pendingPlayback.clear();
+		}
+		break;
+	case Event::LoadState:
+		if (isRecording)
+		{
+			WARN_LOG(COMMON, "State loaded: replay recording stopped");
+			stopRecording();
+		}
+		break;
+	case Event::Terminate:
+		stopRecording();
+		stopPlayback();
+		break;
+	default:
+		break;
+	}
+}
+
+// The listeners are never unregistered since stopping can happen during an event broadcast
+static void listen()
+{
+	if (listening)
+		return;
+	listening = true;
+	EventManager::listen(Event::Start, onEvent);
+	EventManager::listen(Event::LoadState, onEvent);
+	EventManager::listen(Event::Terminate, onEvent);
+	EventManager::listen(Event::VBlank, vblank);
+}
+
+bool startRecording(const std::string& path)
+{
+	if (isRecording || isPlaying || config::GGPOEnable)
+		return false;
+	Serializer ser;
+	dc_serialize(ser);
+	std::vector<u8> state(ser.size());
+	std::vector<Serializer::SectionMark> sections;
+	ser = Serializer(state.data(), state.size());
+	ser.recordSections(&sections);
+	dc_serialize(ser);
+	if (!recorder.open(path, settings.content.path, state.data(), ser.size(), sections))
+	{
+		WARN_LOG(COMMON, "Can't create replay file %s", path.c_str());
+		return false;
+	}
+	listen();
+	frameStart = sh4_sched_now64();
+	isRecording = true;
+	NOTICE_LOG(COMMON, "Recording replay to %s", path.c_str());
+
+	return true;
+}
+
+void stopRecording()
+{
+	if (!isRecording)
+		return;
+	isRecording = false;
+	u32 frames = recorder.frame();
+	if (recorder.close())
+		NOTICE_LOG(COMMON, "Replay recorded: %d frames", frames);
+	else
+		ERROR_LOG(COMMON, "Replay recording failed: I/O error");
+}
+
+bool startPlayback(const std::string& path)
+{
+	if (isRecording || isPlaying || config::GGPOEnable)
+		return false;
+	if (!player.open(path))
+		return false;
+	std::vector<u8> state;
+	if (!player.loadState(state))
+	{
+		WARN_LOG(COMMON, "Can't load replay state from %s", path.c_str());
+		player.close();
+		return false;
+	}
+	try {
+		Deserializer deser(state.data(), state.size());
+		dc_loadstate(deser);
+	} catch (const Deserializer::Exception& e) {
+		ERROR_LOG(COMMON, "Invalid replay state: %s", e.what());
+		player.close();
+		return false;
+	}
+	EventManager::event(Event::LoadState);
+	if (schedId == -1)
+		schedId = sh4_sched_register(0, mediaCallback);
+	listen();
+	frameStart = sh4_sched_now64();
+	isPlaying = true;
+	// Unthrottled, no audio
+	settings.input.fastForwardMode = true;
+	playbackStart = os_GetSeconds();
+	NOTICE_LOG(COMMON, "Playing replay %s: %d frames", path.c_str(), player.frameCount());
+	scheduleMediaChanges();
+
+	return true;
+}
+
+void stopPlayback()
+{
+	if (!isPlaying)
+		return;
+	isPlaying = false;
+	sh4_sched_request(schedId, -1);
+	player.close();
+	settings.input.fastForwardMode = false;
+}
+
+void requestRecording(const std::string& path)
+{
+	pendingRecording = path;
+	pendingPlayback.clear();
+	listen();
+}
+
+std::string requestPlayback(const std::string& path)
+{
+	Player probe;
+	if (!probe.open(path))
+		return "";
+	pendingPlayback = path;
+	pendingRecording.clear();
+	exitWhenDone = true;
+	listen();
+
+	return probe.getGamePath();
+}
+
+void recordInput(const MapleInputState state[4]) {
+	recorder.input(state);
+}
+
+void recordRtc(u32 time) {
+	recorder.rtc(time);
+}
+
+void recordNetworkReceive(const u8 *data, u32 size, u16 packetNumber) {
+	recorder.networkReceive(data, size, packetNumber);
+}
+
+void recordNetworkSlots(int count, int id) {
+	recorder.networkSlots(count, id);
+}
+
+void recordModemRead(int c) {
+	recorder.modemRead(c);
+}
+
+void recordDiscSwap(const std::string& path) {
+	recorder.mediaChange({ sh4_sched_now64() - frameStart, false, path });
+}
+
+void recordLidOpen() {
+	recorder.mediaChange({ sh4_sched_now64() - frameStart, true, "" });
+}
+
+void playInput(MapleInputState state[4]) {
+	player.input(state);
+}
+
+u32 playRtc() {
+	return player.rtc();
+}
+
+bool playNetworkReceive(u8 *data, u32 size, u16& packetNumber) {
+	return player.networkReceive(data, size, packetNumber);
+}
+
+void playNetworkSlots(int& count, int& id) {
+	player.networkSlots(count, id);
+}
+
+int playModemRead() {
+	return player.modemRead();
+}
+
+}
@@ -0,0 +1,220 @@
+/*
+	Copyright 2024 flyinghead
+
+	This file is part of Flycast.
+
+    Flycast is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    Flycast is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Flycast.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+#include "types.h"
+#include "serialize.h"
+#include "hw/maple/maple_cfg.h"
+
+#include <functional>
+#include <string>
+#include <vector>
+
+//
+// Deterministic replay.
+// A replay file is a sectioned savestate of the initial state followed by the stream
+// of nondeterministic inputs: maple input, RTC reads, Naomi network packets, modem bytes
+// and disc swaps. Playing it back from the initial state reproduces the recorded session.
+//
+// The stream is a sequence of frame records, written only for the frames with events.
+// Each record has the number of frames since the previous record and the events of the frame
+// in the order they occurred. Input states are delta-encoded and all numbers are varints.
+// Sources that are polled (maple input, network, modem) only record a change, along with
+// the number of polls since the previous event of the same source in the frame.
+// A checksum of the main RAM is recorded every second to detect divergences.
+//
+namespace replay
+{
+
+struct MediaChange
+{
+	u64 cycle;		// relative to the start of the frame
+	bool openLid;	// otherwise swap the disc
+	std::string path;
+};
+
+class Recorder
+{
+public:
+	~Recorder() { close(); }
+
+	// Creates the replay file with the given initial state
+	bool open(const std::string& path, const std::string& gamePath,
+			const u8 *state, size_t stateSize, const std::vector<Serializer::SectionMark>& sections);
+	// Writes the last frame and the file trailer
+	bool close();
+	bool isOpen() const { return file != nullptr; }
+	u32 frame() const { return frameNum; }
+
+	void input(const MapleInputState state[4]);
+	void rtc(u32 time);
+	// data is null if nothing was received
+	void networkReceive(const u8 *data, u32 size, u16 packetNumber);
+	void networkSlots(int count, int id);
+	// c is -1 if nothing was received
+	void modemRead(int c);
+	void mediaChange(const MediaChange& change);
+	void checksum(u64 hash);
+	void endFrame();
+
+private:
+	void beginEvent(u8 type);
+	bool flush();
+
+	FILE *file = nullptr;
+	std::string gamePath;
+	u64 streamOffset = 0;
+	u64 streamSize = 0;
+	std::vector<u8> frameEvents;
+	u32 eventCount = 0;
+	std::vector<u8> buffer;
+	u32 frameNum = 0;
+	u32 lastRecordFrame = 0;
+	u32 inputPolls = 0;
+	u32 networkPolls = 0;
+	u32 modemPolls = 0;
+	MapleInputState inputState[4];
+	u32 lastRtc = 0;
+	u16 lastPacketNumber = 0;
+	bool error = false;
+};
+
+class Player
+{
+public:
+	~Player() { close(); }
+
+	// Maps the replay file and decodes the first frame
+	bool open(const std::string& path);
+	void close();
+	bool isOpen() const { return data != nullptr; }
+	// Reads the initial state
+	bool loadState(std::vector<u8>& state) const;
+	const std::string& getGamePath() const { return gamePath; }
+	u32 frameCount() const { return frames; }
+	u32 frame() const { return frameNum; }
+	bool finished() const { return frameNum >= frames; }
+	// Set when the emulator doesn't behave as recorded or the stream is corrupted
+	bool diverged() const { return !error.empty(); }
+	const std::string& getError() const { return error; }
+
+	void input(MapleInputState state[4]);
+	u32 rtc();
+	// Returns false if no packet was received
+	bool networkReceive(u8 *data, u32 size, u16& packetNumber);
+	void networkSlots(int& count, int& id);
+	int modemRead();
+	// Media changes of the current frame
+	const std::vector<MediaChange>& mediaChanges() const { return media; }
+	// Checks that all the events of the frame have been consumed and compares the RAM checksum if any.
+	// Then decodes the next frame. Returns false if the replay diverged.
+	bool endFrame(const std::function<u64()>& ramChecksum);
+
+private:
+	struct InputEvent
+	{
+		u32 polls;
+		MapleInputState state[4];
+	};
+	struct NetworkEvent
+	{
+		u32 polls;
+		u16 packetNumber;
+		const u8 *data;
+		u32 size;
+	};
+	struct ModemEvent
+	{
+		u32 polls;
+		u8 c;
+	};
+
+	bool decodeFrame();
+	void diverge(const std::string& reason);
+
+	std::string path;
+	u8 *data = nullptr;
+	size_t dataSize = 0;
+	const u8 *pos = nullptr;
+	const u8 *streamEnd = nullptr;
+	std::string gamePath;
+	u32 frames = 0;
+	u32 frameNum = 0;
+	u32 nextRecordFrame = 0;
+	std::string error;
+
+	// Reference for the deltas of the stream
+	MapleInputState decodeState[4];
+	u32 lastRtc = 0;
+	u16 lastPacketNumber = 0;
+	// Last input state replayed
+	MapleInputState inputState[4];
+
+	std::vector<InputEvent> inputs;
+	std::vector<u32> rtcs;
+	std::vector<NetworkEvent> packets;
+	std::vector<std::pair<int, int>> slots;
+	std::vector<ModemEvent> modemBytes;
+	std::vector<MediaChange> media;
+	bool hasChecksum = false;
+	u64 checksum = 0;
+	size_t inputIndex = 0;
+	size_t rtcIndex = 0;
+	size_t packetIndex = 0;
+	size_t slotIndex = 0;
+	size_t modemIndex = 0;
+	u32 inputPolls = 0;
+	u32 networkPolls = 0;
+	u32 modemPolls = 0;
+};
+
+// Starts recording to the given file. The emulator must be stopped.
+bool startRecording(const std::string& path);
+void stopRecording();
+// Loads the initial state of the replay and plays it back at full speed. The emulator must be stopped.
+bool startPlayback(const std::string& path);
+void stopPlayback();
+// Records or plays back the given file once the game is started, then exits when playback ends.
+// requestPlayback returns the path of the recorded game, or an empty string if the file is invalid.
+void requestRecording(const std::string& path);
+std::string requestPlayback(const std::string& path);
+
+static inline bool recording() {
+	extern bool isRecording;
+	return isRecording;
+}
+static inline bool playing() {
+	extern bool isPlaying;
+	return isPlaying;
+}
+
+void recordInput(const MapleInputState state[4]);
+void recordRtc(u32 time);
+void recordNetworkReceive(const u8 *data, u32 size, u16 packetNumber);
+void recordNetworkSlots(int count, int id);
+void recordModemRead(int c);
+void recordDiscSwap(const std::string& path);
+void recordLidOpen();
+
+void playInput(MapleInputState state[4]);
+u32 playRtc();
+bool playNetworkReceive(u8 *data, u32 size, u16& packetNumber);
+void playNetworkSlots(int& count, int& id);
+int playModemRead();
+
+}
@@ -21,6 +21,7 @@
 
 #include <cstring>
 #include <limits>
+#include <vector>
 
 class SerializeBase
 {
@@ -79,6 +80,21 @@ public:
 		Next = Current + 1,
 	};
 
+	// Large memory blocks of the state, stored separately in sectioned savestate files
+	enum class Section : u32 {
+		Devices,	// anything outside the other sections
+		Ram,
+		Vram,
+		Aram,
+		TaContext,
+	};
+	struct SectionMark
+	{
+		Section section;
+		size_t offset;
+		size_t size;
+	};
+
 	size_t size() const { return _size; }
 	bool rollback() const { return _rollback; }
 
@@ -156,17 +172,24 @@ public:
 
 	Version version() const { return _version; }
 
-private:
-	void doDeserialize(void *dest, size_t size)
+	// Returns a pointer to the next size bytes of the state and skips them
+	const u8 *consume(size_t size)
 	{
-		if (this->_size + size > limit)	// FIXME one more test vs. current
+		if (this->_size + size > limit)
 		{
 			WARN_LOG(SAVESTATE, "Savestate overflow: current %d limit %d sz %d", (int)this->_size, (int)limit, (int)size);
 			throw Exception("Invalid savestate");
 		}
-		memcpy(dest, data, size);
+		const u8 *p = data;
 		data += size;
 		this->_size += size;
+		return p;
+	}
+
+private:
+	void doDeserialize(void *dest, size_t size)
+	{
+		memcpy(dest, consume(size), size);
 	}
 
 	Version _version;
@@ -206,16 +229,41 @@ public:
 	}
 	void skip(size_t size)
 	{
-		if (data != nullptr)
+		if (data != nullptr && checkLimit(size))
 			data += size;
 		this->_size += size;
 	}
 	bool dryrun() const { return data == nullptr; }
+	// The state didn't fit in the buffer. size() is the required size.
+	bool overflow() const { return _overflow; }
+
+	// Records the position of the sections in marks
+	void recordSections(std::vector<SectionMark> *marks) {
+		this->marks = marks;
+	}
+	void beginSection(Section section)
+	{
+		if (marks != nullptr)
+			marks->push_back({ section, _size, 0 });
+	}
+	void endSection()
+	{
+		if (marks != nullptr)
+			marks->back().size = _size - marks->back().offset;
+	}
 
 private:
+	// Returns false if the data doesn't fit. Writing stops but the size keeps being counted.
+	bool checkLimit(size_t size)
+	{
+		if (!_overflow && this->_size + size > limit)
+			_overflow = true;
+		return !_overflow;
+	}
+
 	void doSerialize(const void *src, size_t size)
 	{
-		if (data != nullptr)
+		if (data != nullptr && checkLimit(size))
 		{
 			memcpy(data, src, size);
 			data += size;
@@ -224,6 +272,8 @@ private:
 	}
 
 	u8 *data;
+	bool _overflow = false;
+	std::vector<SectionMark> *marks = nullptr;
 };
 
 template<typename T>
@@ -193,6 +193,20 @@ void RamRegion::deserialize(Deserializer &deser) {
 	deser.deserialize(data, size);
 }
 
+void RamRegion::deserialize(Deserializer &deser, const std::function<void(u32)>& pageChanged)
+{
+	const u8 *src = deser.consume(size);
+	for (size_t offset = 0; offset < size; offset += PAGE_SIZE)
+	{
+		const size_t len = std::min<size_t>(PAGE_SIZE, size - offset);
+		if (memcmp(&data[offset], &src[offset], len) != 0)
+		{
+			pageChanged((u32)offset);
+			memcpy(&data[offset], &src[offset], len);
+		}
+	}
+}
+
 
 void RamRegion::alloc(size_t size)
 {
@@ -6,6 +6,7 @@
 #include <cctype>
 #include <condition_variable>
 #include <cstring>
+#include <functional>
 #include <mutex>
 #include <thread>
 #include <vector>
@@ -99,6 +100,9 @@ public:
 
 	void serialize(Serializer &ser) const;
 	void deserialize(Deserializer &deser);
+	// Only writes the pages that differ from the state.
+	// pageChanged is called with the offset of each of these pages before it is written.
+	void deserialize(Deserializer &deser, const std::function<void(u32)>& pageChanged);
 };
 
 static inline void string_tolower(std::string& s)
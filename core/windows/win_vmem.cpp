@@ -97,6 +97,21 @@ void destroy() {
 	CloseHandle(mem_handle);
 }
 
+// Views of the memory file can only be mapped with a 64 KB granularity
+void *reserve_view_area(size_t size) {
+	return nullptr;
+}
+
+void release_view_area(void *start, size_t size) {
+}
+
+bool map_view(void *dest, size_t size, size_t offset, bool writable) {
+	return false;
+}
+
+void unmap_view(void *dest, size_t size) {
+}
+
 // Resets a chunk of memory by deleting its data and setting its protection back.
 void reset_mem(void *ptr, unsigned size_bytes) {
 	VirtualFree(ptr, size_bytes, MEM_DECOMMIT);
@@ -55,6 +55,7 @@
 #include "hw/maple/maple_if.h"
 #include "hw/maple/maple_cfg.h"
 #include "hw/pvr/spg.h"
+#include "hw/pvr/ta_ctx.h"
 #include "hw/naomi/naomi_cart.h"
 #include "hw/naomi/card_reader.h"
 #include "imgread/common.h"
@@ -204,6 +205,13 @@ char vmu_dir_no_slash[PATH_MAX];
 char content_name[PATH_MAX];
 static char g_roms_dir[PATH_MAX];
 static std::mutex mtx_serialization;
+// State size returned to the frontend. It's only computed once per game, so it isn't an exact
+// upper bound: the number of TA contexts, the serial FIFOs, maple DMA and MIDI buffers vary
+// between frames. Some slack is added to the dry run size, and the size is recomputed
+// if a state still doesn't fit.
+static size_t stateSize;
+// One more TA context, plus variable-size FIFOs and buffers
+constexpr size_t StateSizeSlack = 4 + 4 + TA_DATA_SIZE + 64_KB;
 static bool gl_ctx_resetting = false;
 static bool is_dupe;
 static u64 startTime;
@@ -1208,6 +1216,7 @@ void retro_run()
 
 static bool loadGame()
 {
+	stateSize = 0;
 	try {
 		emu.loadGame(game_data.c_str());
 	} catch (const FlycastException& e) {
@@ -2209,6 +2218,7 @@ void retro_unload_game()
 {
 	INFO_LOG(COMMON, "Flycast unloading game");
 	emu.unloadGame();
+	stateSize = 0;
 	game_data.clear();
 	disk_paths.clear();
 	disk_labels.clear();
@@ -2231,12 +2241,21 @@ size_t retro_get_memory_size(unsigned type)
    return 0;
 }
 
+// Without threaded rendering, the emulator only runs inside retro_run() so it's already
+// stopped at a frame boundary. This is the path used by run-ahead and netplay every frame.
+static bool emuStopNeeded()
+{
+	return !first_run && config::ThreadedRendering;
+}
+
 size_t retro_serialize_size()
 {
-	DEBUG_LOG(SAVESTATE, "retro_serialize_size");
 	std::lock_guard<std::mutex> lock(mtx_serialization);
+	if (stateSize != 0)
+		return stateSize;
 
-	if (!first_run)
+	const bool stopEmu = emuStopNeeded();
+	if (stopEmu)
 		try {
 			emu.stop();
 		} catch (const FlycastException& e) {
@@ -2246,18 +2265,21 @@ size_t retro_serialize_size()
 
 	Serializer ser;
 	dc_serialize(ser);
-	if (!first_run)
+	if (stopEmu)
 		emu.start();
+	stateSize = ser.size() + StateSizeSlack;
+	DEBUG_LOG(SAVESTATE, "retro_serialize_size %d", (int)stateSize);
 
-	return ser.size();
+	return stateSize;
 }
 
 bool retro_serialize(void *data, size_t size)
 {
-	DEBUG_LOG(SAVESTATE, "retro_serialize %d bytes", (int)size);
 	std::lock_guard<std::mutex> lock(mtx_serialization);
+	const double start = os_GetSeconds();
 
-	if (!first_run)
+	const bool stopEmu = emuStopNeeded();
+	if (stopEmu)
 		try {
 			emu.stop();
 		} catch (const FlycastException& e) {
@@ -2267,18 +2289,26 @@ bool retro_serialize(void *data, size_t size)
 
 	Serializer ser(data, size);
 	dc_serialize(ser);
-	if (!first_run)
+	if (stopEmu)
 		emu.start();
+	if (ser.overflow())
+	{
+		WARN_LOG(SAVESTATE, "retro_serialize: state size %d larger than buffer size %d", (int)ser.size(), (int)size);
+		stateSize = std::max(stateSize, ser.size() + StateSizeSlack);
+		return false;
+	}
+	DEBUG_LOG(SAVESTATE, "retro_serialize %d bytes in %.3f ms", (int)ser.size(), (os_GetSeconds() - start) * 1000.0);
 
 	return true;
 }
 
 bool retro_unserialize(const void * data, size_t size)
 {
-	DEBUG_LOG(SAVESTATE, "retro_unserialize");
 	std::lock_guard<std::mutex> lock(mtx_serialization);
+	const double start = os_GetSeconds();
 
-	if (!first_run)
+	const bool stopEmu = emuStopNeeded();
+	if (stopEmu)
 		try {
 			emu.stop();
 		} catch (const FlycastException& e) {
@@ -2290,8 +2320,9 @@ bool retro_unserialize(const void * data, size_t size)
 		Deserializer deser(data, size);
 		dc_loadstate(deser);
 	    retro_audio_flush_buffer();
-		if (!first_run)
+		if (stopEmu)
 			emu.start();
+		DEBUG_LOG(SAVESTATE, "retro_unserialize %d bytes in %.3f ms", (int)deser.size(), (os_GetSeconds() - start) * 1000.0);
 
 		return true;
 	} catch (const Deserializer::Exception& e) {
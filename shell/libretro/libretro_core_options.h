@@ -779,6 +779,34 @@ struct retro_core_option_v2_definition option_defs_us[] = {
       },
       "100",
    },
+   {
+      CORE_OPTION_NAME "_idle_skip",
+      "Idle Loop Skipping",
+      NULL,
+      "Skip ahead to the next hardware event when the SH4 or the ARM7 spins in a polling loop. Reduces host CPU usage. May break some games.",
+      NULL,
+      "hacks",
+      {
+         { "disabled", NULL },
+         { "enabled",  NULL },
+         { NULL, NULL },
+      },
+      "disabled",
+   },
+   {
+      CORE_OPTION_NAME "_mmu_shadow_pages",
+      "MMU Shadow Page Table",
+      NULL,
+      "Map the memory pages translated by the SH4 MMU directly into host memory. Speeds up Windows CE games. Only used by the x86-64 dynarec on Linux, macOS and Android.",
+      NULL,
+      "hacks",
+      {
+         { "disabled", NULL },
+         { "enabled",  NULL },
+         { NULL, NULL },
+      },
+      "disabled",
+   },
    {
       CORE_OPTION_NAME "_custom_textures",
       "Load Custom Textures",
@@ -25,6 +25,10 @@ namespace config {
 
 Option<bool> DynarecEnabled("", true);
 IntOption Sh4Clock(CORE_OPTION_NAME "_sh4clock", 200);
+Option<bool> IdleLoopSkip(CORE_OPTION_NAME "_idle_skip", false);
+Option<bool> MmuShadowPages(CORE_OPTION_NAME "_mmu_shadow_pages", false);
+Option<bool> DynarecBlockCounters("", false);
+Option<bool> DynarecPerfMap("", false);
 
 // General
 
@@ -64,6 +68,7 @@ IntOption TextureUpscale(CORE_OPTION_NAME "_texupscale", 1);
 IntOption MaxFilteredTextureSize(CORE_OPTION_NAME "_texupscale_max_filtered_texture_size", 256);
 Option<float> ExtraDepthScale("", 1.f);
 Option<bool> CustomTextures(CORE_OPTION_NAME "_custom_textures");
+Option<bool> PackCustomTextures("");
 Option<bool> DumpTextures(CORE_OPTION_NAME "_dump_textures");
 Option<int> ScreenStretching("", 100);
 Option<bool> Fog(CORE_OPTION_NAME "_fog", true);
@@ -101,6 +106,10 @@ Option<bool> UseReios(CORE_OPTION_NAME "_hle_bios");
 
 Option<bool> OpenGlChecks("", false);
 Option<bool> FastGDRomLoad(CORE_OPTION_NAME "_gdrom_fast_loading", false);
+Option<bool> NaomiRomCache("", false);
+Option<bool> NaomiDecryptCache("", true);
+Option<bool> NaomiPredecrypt("", false);
+Option<bool> SectionedSavestates("", false);
 Option<bool> RamMod32MB(CORE_OPTION_NAME "_dc_32mb_mod", false);
 
 //Option<std::vector<std::string>, false> ContentPath("");
@@ -5,6 +5,10 @@
 #include "hw/aica/aica_if.h"
 #include "hw/arm7/arm7_rec.h"
 #include "emulator.h"
+#include "cfg/option.h"
+#include "hw/arm7/arm_mem.h"
+
+#include <chrono>
 
 static const u32 N_FLAG = 1 << 31;
 static const u32 Z_FLAG = 1 << 30;
@@ -28,6 +32,10 @@ protected:
 		Arm7Enabled = true;
 	}
 
+	void TearDown() override {
+		config::IdleLoopSkip.reset();
+	}
+
 	void PrepareOp(u32 op)
 	{
 		PrepareOps(1, &op);
@@ -38,7 +46,7 @@ protected:
 		arm_Reg[R15_ARM_NEXT].I = 0x1000;
 		for (int i = 0; i < count; i++)
 			*(u32*)&aica_ram[0x1000 + i * 4] = ops[i];
-		*(u32*)&aica_ram[0x1000 + count * 4] = 0xea000000 | ((u32)(-count * 4 - 8) << 2);	// b pc+8-12
+		*(u32*)&aica_ram[0x1000 + count * 4] = 0xea000000 | (((u32)(-count * 4 - 8) >> 2) & 0xffffff);	// b 0x1000
 		flush();
 		compile();
 	}
@@ -1082,4 +1090,97 @@ TEST_F(AicaArmTest, ConditionRegAllocTest)
 	ASSERT_EQ(arm_Reg[1].I, 0);
 	ASSERT_EQ(arm_Reg[2].I, 22);
 }
+
+TEST_F(AicaArmTest, BlockLinkTest)
+{
+	PrepareOp(0xe2800001);	// add r0, r0, #1
+	arm_Reg[0].I = 0;
+	RunOp();
+	ASSERT_EQ(arm_Reg[0].I, 1);
+
+	// The block jumps to itself until the timeslice is over
+	arm_Reg[0].I = 0;
+	arm_Reg[R15_ARM_NEXT].I = 0x1000;
+	arm_Reg[CYCL_CNT].I = 1000;
+	arm_mainloop(arm_Reg, EntryPoints);
+	ASSERT_GT(arm_Reg[0].I, 1);
+	ASSERT_LE((int)arm_Reg[CYCL_CNT].I, 0);
+	ASSERT_EQ((1000 - (int)arm_Reg[CYCL_CNT].I) % arm_Reg[0].I, 0);
+	ASSERT_EQ(arm_Reg[R15_ARM_NEXT].I, 0x1000);
+}
+
+TEST_F(AicaArmTest, IdleLoopTest)
+{
+	config::IdleLoopSkip.override(true);
+	PrepareOp(0xe5910000);	// ldr r0, [r1]
+	arm_Reg[1].I = 0x2000;
+	*(u32*)&aica_ram[0x2000] = 42;
+
+	// The loop only polls memory so the rest of the timeslice is skipped
+	arm_Reg[R15_ARM_NEXT].I = 0x1000;
+	arm_Reg[CYCL_CNT].I = 1000;
+	arm_mainloop(arm_Reg, EntryPoints);
+	ASSERT_EQ(arm_Reg[0].I, 42);
+	ASSERT_EQ(arm_Reg[CYCL_CNT].I, 0);
+	ASSERT_EQ(arm_Reg[R15_ARM_NEXT].I, 0x1000);
+}
+
+TEST_F(AicaArmTest, CodeWriteTest)
+{
+	PrepareOp(0xe3a00005);	// mov r0, #5
+	RunOp();
+	ASSERT_EQ(arm_Reg[0].I, 5);
+	// Another block at 0x2000: mov r1, #1; b 0x1000
+	*(u32*)&aica_ram[0x2000] = 0xe3a01001;
+	*(u32*)&aica_ram[0x2004] = 0xea000000 | (((u32)(0x1000 - 0x2004 - 8) >> 2) & 0xffffff);
+	arm_Reg[R15_ARM_NEXT].I = 0x2000;
+	compile();
+	void (*otherBlock)() = EntryPoints[0x2000 / 4];
+
+	// Data writes don't discard anything
+	writeMem<u32>(0x3000, 1);
+	arm_Reg[CYCL_CNT].I = 0;
+	run(1);
+	ASSERT_NE(arm_compilecode, EntryPoints[0x1000 / 4]);
+
+	// Only the block using the written word is discarded, before the next timeslice
+	writeMem<u32>(0x1000, 0xe3a00007);	// mov r0, #7
+	ASSERT_NE(arm_compilecode, EntryPoints[0x1000 / 4]);
+	arm_Reg[R15_ARM_NEXT].I = 0x2000;
+	arm_Reg[CYCL_CNT].I = 0;
+	run(1);
+	ASSERT_EQ(otherBlock, EntryPoints[0x2000 / 4]);
+	ASSERT_EQ(arm_Reg[0].I, 7);
+	ASSERT_EQ(arm_Reg[1].I, 1);
+
+	// The recompiled block is linked again
+	writeMem<u32>(0x1000, 0xe3a00009);	// mov r0, #9
+	arm_Reg[R15_ARM_NEXT].I = 0x2000;
+	arm_Reg[CYCL_CNT].I = 0;
+	run(1);
+	ASSERT_EQ(arm_Reg[0].I, 9);
+}
+
+// Run with --gtest_also_run_disabled_tests
+TEST_F(AicaArmTest, DISABLED_Benchmark)
+{
+	u32 ops[] = {
+		0xe2800001,	// add r0, r0, #1
+		0xe0822000,	// add r2, r2, r0
+		0xe3100001,	// tst r0, #1
+		0x12833001,	// addne r3, r3, #1
+	};
+	PrepareOps(std::size(ops), ops);
+	arm_Reg[0].I = 0;
+	arm_Reg[R15_ARM_NEXT].I = 0x1000;
+	arm_Reg[CYCL_CNT].I = 0;
+
+	constexpr u32 Samples = 44100 * 10;
+	const auto start = std::chrono::steady_clock::now();
+	run(Samples);
+	const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	// 4 ops and a branch per iteration
+	const double mips = arm_Reg[0].I * (std::size(ops) + 1) / seconds / 1000000.0;
+	printf("ARM7: %.1f MIPS, %.1fx real time\n", mips, Samples / 44100.0 / seconds);
+}
 }
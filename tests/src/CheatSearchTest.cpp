@@ -0,0 +1,110 @@
+#include "gtest/gtest.h"
+#include "types.h"
+#include "cheat_search.h"
+#include "oslib/oslib.h"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+class CheatSearchTest : public ::testing::Test {
+protected:
+	std::vector<u8> mem = std::vector<u8>(64_KB);
+
+	template<typename T>
+	void set(u32 offset, T v) {
+		memcpy(&mem[offset], &v, sizeof(T));
+	}
+};
+
+TEST_F(CheatSearchTest, Integer)
+{
+	CheatSearch search;
+	set<u32>(0x100, 10);
+	set<u32>(0x200, 10);
+	set<u32>(0x300, 10);
+	search.start(mem.data(), mem.size(), 0x8C000000, CheatSearch::ValueType::U32);
+	search.filter(CheatSearch::Compare::Equal, 10);
+	ASSERT_EQ(3u, search.candidateCount());
+
+	set<u32>(0x100, 12);
+	set<u32>(0x200, 9);
+	search.filter(CheatSearch::Compare::Changed);
+	ASSERT_EQ(2u, search.candidateCount());
+
+	set<u32>(0x100, 15);
+	set<u32>(0x200, 8);
+	search.filter(CheatSearch::Compare::Decreased);
+	std::vector<CheatSearch::Result> results = search.results(10);
+	ASSERT_EQ(1u, results.size());
+	ASSERT_EQ(0x8C000200u, results[0].address);
+	ASSERT_EQ(8u, results[0].value);
+}
+
+TEST_F(CheatSearchTest, Delta)
+{
+	CheatSearch search;
+	set<u8>(0x11, 200);
+	set<u8>(0x12, 200);
+	search.start(mem.data(), mem.size(), 0, CheatSearch::ValueType::U8);
+	search.wait();
+	set<u8>(0x11, 205);
+	set<u8>(0x12, 201);
+	search.filter(CheatSearch::Compare::IncreasedBy, 5);
+	std::vector<CheatSearch::Result> results = search.results(10);
+	ASSERT_EQ(1u, results.size());
+	ASSERT_EQ(0x11u, results[0].address);
+
+	// unsigned comparison and wrap-around
+	std::fill(mem.begin(), mem.end(), 0);
+	search.start(mem.data(), mem.size(), 0, CheatSearch::ValueType::U16);
+	search.wait();
+	set<u16>(0x20, 0xfffe);
+	search.filter(CheatSearch::Compare::Greater, 0x8000);
+	ASSERT_EQ(1u, search.candidateCount());
+	set<u16>(0x20, 1);
+	search.filter(CheatSearch::Compare::IncreasedBy, 3);
+	ASSERT_EQ(1u, search.candidateCount());
+}
+
+TEST_F(CheatSearchTest, Float)
+{
+	CheatSearch search;
+	set<float>(0x40, 1.5f);
+	search.start(mem.data(), mem.size(), 0, CheatSearch::ValueType::Float);
+	search.wait();
+	set<float>(0x40, 2.5f);
+	float f = 1.f;
+	u32 bits;
+	memcpy(&bits, &f, sizeof(bits));
+	search.filter(CheatSearch::Compare::IncreasedBy, bits);
+	std::vector<CheatSearch::Result> results = search.results(10);
+	ASSERT_EQ(1u, results.size());
+	ASSERT_EQ(0x40u, results[0].address);
+}
+
+// Run with --gtest_also_run_disabled_tests
+TEST_F(CheatSearchTest, DISABLED_Benchmark)
+{
+	std::vector<u8> ram(32_MB);
+	for (size_t i = 0; i < ram.size(); i++)
+		ram[i] = (u8)(i * 7);
+	CheatSearch search;
+	for (CheatSearch::ValueType type : { CheatSearch::ValueType::U8, CheatSearch::ValueType::U16,
+			CheatSearch::ValueType::U32, CheatSearch::ValueType::Float })
+	{
+		search.start(ram.data(), ram.size(), 0, type);
+		search.wait();
+		search.filter(CheatSearch::Compare::Unchanged);
+		search.wait();
+		double keepAll = search.lastPassTime();
+		search.filter(CheatSearch::Compare::Changed);
+		search.wait();
+		double dropAll = search.lastPassTime();
+		search.filter(CheatSearch::Compare::Changed);
+		search.wait();
+		printf("32 MB search, %d-byte values: %.2f ms (all kept), %.2f ms (all dropped), %.2f ms (no candidate)\n",
+				CheatSearch::valueSize(type), keepAll, dropAll, search.lastPassTime());
+		ASSERT_EQ(0u, search.candidateCount());
+	}
+}
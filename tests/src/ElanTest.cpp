@@ -0,0 +1,170 @@
+#include "gtest/gtest.h"
+#include "types.h"
+#include "hw/pvr/ta_ctx.h"
+#include "hw/pvr/elan.h"
+#include "hw/pvr/elan_struct.h"
+
+#include <chrono>
+#include <cstring>
+#include <vector>
+
+using namespace elan;
+
+class ElanTest : public ::testing::Test {
+protected:
+	void SetUp() override
+	{
+		ram.resize(ERAM_SIZE_MAX);
+		RAM = ram.data();
+		ERAM_SIZE = ERAM_SIZE_MAX;
+		ctx.Alloc();
+		ta_ctx = &ctx;
+		ta_parse_reset();
+		elan::reset(true);
+	}
+
+	void TearDown() override
+	{
+		ta_ctx = nullptr;
+		RAM = nullptr;
+		ERAM_SIZE = 0;
+	}
+
+	template<typename T>
+	T& add(u32& offset, elan::PCW::Command command)
+	{
+		T& cmd = *(T *)&RAM[offset];
+		cmd.pcw.naomi2 = 1;
+		cmd.pcw.n2Command = command;
+		offset += sizeof(T);
+		return cmd;
+	}
+
+	// Projection, instance matrix and model at address 0, pointing to the geometry at GeomAddr.
+	// Returns the size of the commands.
+	u32 scene(u32 geomSize, float z)
+	{
+		u32 offset = 0;
+		ProjMatrix& proj = add<ProjMatrix>(offset, elan::PCW::projMatrix);
+		proj.fx = 579.411194f;
+		proj.tx = -320.f;
+		proj.fy = -579.411194f;
+		proj.ty = -240.f;
+
+		// Identity with a z translation
+		InstanceMatrix& mat = add<InstanceMatrix>(offset, elan::PCW::matrixOrLight);
+		mat.id1 = 0xf;
+		mat.id2 = 0x7f;
+		mat.lm00 = mat.lm11 = mat.lm22 = 1.f;
+		mat.tm00 = -1.f;
+		mat.tm11 = 1.f;
+		mat.tm22 = -1.f;
+		mat.tm32 = -z;
+		mat._near = 1.f;
+		mat._far = 1000.f;
+
+		Model& model = add<Model>(offset, elan::PCW::model);
+		model.param.cwCulling = 1;
+		model.offset = GeomAddr;
+		model.size = geomSize;
+
+		return offset;
+	}
+
+	// Textured strip of count vertices on the z=0 plane
+	void strip(u32& offset, u32 count, float x)
+	{
+		ICHList& list = add<ICHList>(offset, elan::PCW::ich);
+		list.pcw.texture = 1;
+		list.pcw.gouraud = 1;
+		list.flags = ICHList::VTX_TYPE_VU;
+		list.vtxCount = count;
+		N2_VERTEX_VU *vtx = (N2_VERTEX_VU *)&RAM[offset];
+		for (u32 i = 0; i < count; i++)
+		{
+			vtx[i].header.nz = 127;
+			vtx[i].header.strip = i >= 2;
+			vtx[i].header.endOfStrip = i == count - 1;
+			vtx[i].x = x + (float)(i / 2);
+			vtx[i].y = (float)(i & 1);
+			vtx[i].z = 0.f;
+			vtx[i].uv.u = (float)(i / 2);
+			vtx[i].uv.v = (float)(i & 1);
+		}
+		offset += sizeof(N2_VERTEX_VU) * count;
+	}
+
+	void execute(u32 size)
+	{
+		ctx.rend.Clear();
+		ta_parse_reset();
+		executeCommands(RAM, size);
+	}
+
+	static constexpr u32 GeomAddr = 0x10000;
+
+	std::vector<u8> ram;
+	TA_context ctx;
+};
+
+TEST_F(ElanTest, Strip)
+{
+	u32 geomEnd = GeomAddr;
+	strip(geomEnd, 4, 0.f);
+	execute(scene(geomEnd - GeomAddr, -10.f));
+
+	// the first one is the background polygon
+	ASSERT_EQ(2u, ctx.rend.global_param_op.size());
+	const PolyParam& pp = ctx.rend.global_param_op[1];
+	ASSERT_EQ(4u, pp.count);
+	ASSERT_TRUE(pp.pcw.Texture);
+	const Vertex *vtx = &ctx.rend.verts[pp.first];
+	for (int i = 0; i < 4; i++)
+	{
+		ASSERT_EQ((float)(i / 2), vtx[i].x);
+		ASSERT_EQ((float)(i & 1), vtx[i].y);
+		ASSERT_EQ((float)(i / 2), vtx[i].u);
+		ASSERT_FLOAT_EQ(1.f, vtx[i].nz);
+	}
+}
+
+TEST_F(ElanTest, NearPlane)
+{
+	// Behind the camera
+	u32 geomEnd = GeomAddr;
+	strip(geomEnd, 4, 0.f);
+	execute(scene(geomEnd - GeomAddr, 10.f));
+	ASSERT_EQ(1u, ctx.rend.global_param_op.size());
+
+	// Crossing the near plane at x = 0.5: clipped
+	const u32 size = scene(geomEnd - GeomAddr, 0.f);
+	InstanceMatrix& mat = *(InstanceMatrix *)&RAM[sizeof(ProjMatrix)];
+	mat.tm02 = 2.f;	// z = -2x
+	execute(size);
+	ASSERT_EQ(2u, ctx.rend.global_param_op.size());
+	const PolyParam& pp = ctx.rend.global_param_op[1];
+	ASSERT_LT(0u, pp.count);
+	for (u32 i = 0; i < pp.count; i++)
+		ASSERT_LE(0.5f - 1e-5f, ctx.rend.verts[pp.first + i].x);
+}
+
+// Vertices processed per second.
+// Run with --gtest_also_run_disabled_tests
+TEST_F(ElanTest, DISABLED_Benchmark)
+{
+	constexpr int Lists = 1000;
+	constexpr int Vertices = 64;
+	constexpr int Count = 100;
+	u32 geomEnd = GeomAddr;
+	for (int i = 0; i < Lists; i++)
+		strip(geomEnd, Vertices, (float)(i % 32) - 16.f);
+	const u32 size = scene(geomEnd - GeomAddr, -50.f);
+	execute(size);
+	ASSERT_EQ((size_t)Lists + 1, ctx.rend.global_param_op.size());
+
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < Count; i++)
+		execute(size);
+	const double time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	printf("%.1f Mvertices/s\n", (double)Lists * Vertices * Count / time / 1000000.0);
+}
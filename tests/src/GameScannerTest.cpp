@@ -0,0 +1,191 @@
+#include "gtest/gtest.h"
+#include "types.h"
+
+#ifndef LIBRETRO
+#include "stdclass.h"
+#include "rend/game_scanner.h"
+#include "rend/boxart/scraper.h"
+#include "json.hpp"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+using namespace nlohmann;
+
+class GameScannerTest : public ::testing::Test {
+protected:
+	void SetUp() override
+	{
+		savedDataDir = get_writable_data_path("");
+		make_directory(contentDir);
+		make_directory(contentDir + "sub");
+		make_directory(dataDir);
+		for (const auto& file : files)
+			createFile(contentDir + file);
+		set_user_data_dir(dataDir);
+		config::ContentPath.override({ contentDir });
+	}
+
+	void TearDown() override
+	{
+		config::ContentPath.reset();
+		set_user_data_dir(savedDataDir);
+		for (const auto& file : files)
+			nowide::remove((contentDir + file).c_str());
+		nowide::remove((contentDir + "sub").c_str());
+		nowide::remove(contentDir.c_str());
+		nowide::remove(indexPath().c_str());
+		nowide::remove(dataDir.c_str());
+	}
+
+	static void createFile(const std::string& path)
+	{
+		FILE *f = nowide::fopen(path.c_str(), "wb");
+		ASSERT_NE(nullptr, f);
+		std::fclose(f);
+	}
+
+	std::string indexPath() const {
+		return dataDir + "gamelist.json";
+	}
+
+	json readIndex()
+	{
+		FILE *f = nowide::fopen(indexPath().c_str(), "rt");
+		if (f == nullptr)
+			return json();
+		std::string content;
+		char buf[1024];
+		size_t n;
+		while ((n = std::fread(buf, 1, sizeof(buf), f)) > 0)
+			content.append(buf, n);
+		std::fclose(f);
+		return json::parse(content);
+	}
+
+	void writeIndex(const std::string& content)
+	{
+		FILE *f = nowide::fopen(indexPath().c_str(), "wt");
+		ASSERT_NE(nullptr, f);
+		std::fputs(content.c_str(), f);
+		std::fclose(f);
+	}
+
+	// Adds a game file that doesn't exist to the indexed content of the root directory
+	void addGhostGame(u64 updateTime)
+	{
+		json index = readIndex();
+		for (auto& dir : index["directories"])
+			if (dir["path"] == contentDir)
+			{
+				dir["files"].push_back({ { "name", "ghost.cdi" }, { "path", contentDir + "ghost.cdi" } });
+				if (updateTime != 0)
+					dir["time"] = updateTime;
+			}
+		writeIndex(index.dump());
+	}
+
+	// Scans the library synchronously and returns the file names of the games found
+	static std::vector<std::string> scan(GameScanner& scanner)
+	{
+		scanner.running = true;
+		scanner.scan();
+		std::vector<std::string> names;
+		for (const GameMedia& game : scanner.get_game_list())
+			names.push_back(game.fileName);
+		return names;
+	}
+
+	const std::string contentDir = "gamescanner_test/";
+	const std::string dataDir = "gamescanner_data/";
+	const std::vector<std::string> files { "game1.cdi", "readme.txt", "sub/game2.gdi" };
+	const std::vector<std::string> games { "game1.cdi", "game2.gdi" };
+	std::string savedDataDir;
+};
+
+TEST_F(GameScannerTest, NoIndex)
+{
+	GameScanner scanner;
+	ASSERT_EQ(games, scan(scanner));
+	json index = readIndex();
+	ASSERT_EQ(2u, index["directories"].size());
+}
+
+TEST_F(GameScannerTest, UpToDateIndex)
+{
+	{
+		GameScanner scanner;
+		scan(scanner);
+	}
+	// The directory hasn't changed so its indexed content is used
+	addGhostGame(0);
+	GameScanner scanner;
+	ASSERT_EQ(std::vector<std::string>({ "game1.cdi", "game2.gdi", "ghost.cdi" }), scan(scanner));
+}
+
+TEST_F(GameScannerTest, StaleIndex)
+{
+	{
+		GameScanner scanner;
+		scan(scanner);
+	}
+	// The directory has been modified since it was indexed
+	addGhostGame(1);
+	GameScanner scanner;
+	ASSERT_EQ(games, scan(scanner));
+	// and the index is updated
+	for (const auto& dir : readIndex()["directories"])
+		ASSERT_EQ(1u, dir["files"].size());
+}
+
+TEST_F(GameScannerTest, CorruptIndex)
+{
+	writeIndex("{ \"version\": 1, \"directories\": [ { \"path\": ");
+	GameScanner scanner;
+	ASSERT_EQ(games, scan(scanner));
+	// rewritten
+	ASSERT_EQ(2u, readIndex()["directories"].size());
+
+	// valid json but wrong content
+	writeIndex("{ \"version\": 1, \"directories\": [ { \"path\": 42 } ] }");
+	GameScanner scanner2;
+	ASSERT_EQ(games, scan(scanner2));
+}
+
+TEST_F(GameScannerTest, OfflineScraper)
+{
+	// Arcade games aren't parsed, and the missing discs are flagged as scraped
+	std::vector<GameBoxart> items(20);
+	for (size_t i = 0; i < items.size(); i++)
+	{
+		GameBoxart& item = items[i];
+		if (i % 2 == 0)
+		{
+			item.fileName = "game" + std::to_string(i) + ".zip";
+			item.searchName = "Game " + std::to_string(i) + " (Japan) [!]";
+		}
+		else
+		{
+			item.fileName = "game" + std::to_string(i) + ".cdi";
+			item.gamePath = contentDir + "nodisc" + std::to_string(i) + ".cdi";
+			item.searchName = "Game " + std::to_string(i);
+		}
+	}
+	OfflineScraper scraper;
+	scraper.scrape(items);
+	for (size_t i = 0; i < items.size(); i++)
+	{
+		const GameBoxart& item = items[i];
+		ASSERT_TRUE(item.parsed);
+		if (i % 2 == 0) {
+			ASSERT_EQ("Game " + std::to_string(i), item.searchName);
+		}
+		else
+		{
+			ASSERT_TRUE(item.scraped);
+			ASSERT_TRUE(item.searchName.empty());
+		}
+	}
+}
+#endif
@@ -0,0 +1,89 @@
+#include "gtest/gtest.h"
+#include "types.h"
+#include "log/LogRing.h"
+#include "log/LogTrace.h"
+
+#include <cstdarg>
+#include <cstdio>
+
+class LogTraceTest : public ::testing::Test {
+protected:
+	// Encodes the arguments, decodes them and compares with the printf output
+	void roundTrip(const char *format, ...)
+	{
+		va_list args;
+		va_start(args, format);
+		va_list args2;
+		va_copy(args2, args);
+		u8 buf[512];
+		u32 size = logtrace::encodeArgs(format, args, buf, sizeof(buf));
+		va_end(args);
+		char expected[512];
+		vsnprintf(expected, sizeof(expected), format, args2);
+		va_end(args2);
+
+		ASSERT_EQ(std::string(expected), logtrace::formatArgs(format, buf, size));
+	}
+};
+
+TEST_F(LogTraceTest, Format)
+{
+	roundTrip("no args");
+	roundTrip("100%% done");
+	roundTrip("%d %i %u %x %08X", -5, 42, 3000000000u, 0xbeef, 0x1234);
+	roundTrip("%ld %lld %zd %llx", -123456789L, -1234567890123LL, (size_t)77, 0x123456789abcULL);
+	roundTrip("%c%c %s [%10s] %.2s", 'o', 'k', "string", "right", "truncated");
+	roundTrip("%f %.3f %e %g", 3.5, 1.0 / 3.0, 12345.678, 0.0001);
+	roundTrip("%*d|%-*d|%.*f", 6, 42, 4, 7, 2, 2.71828);
+	roundTrip("%s and %s", "one", "two");
+	// Arguments are promoted to int and converted back by printf
+	roundTrip("%hhx %hhd %hx %hd %hu", 0x1234, 200, 0x123456, 70000, -1);
+}
+
+TEST_F(LogTraceTest, Truncated)
+{
+	u8 buf[8];
+	u32 size = [&](const char *format, ...) {
+		va_list args;
+		va_start(args, format);
+		u32 size = logtrace::encodeArgs(format, args, buf, sizeof(buf));
+		va_end(args);
+		return size;
+	}("%d %d", 1, 2);
+	ASSERT_EQ(8u, size);
+	ASSERT_EQ(std::string("1 ..."), logtrace::formatArgs("%d %d", buf, size));
+}
+
+TEST_F(LogTraceTest, Ring)
+{
+	LogRing ring(256);
+	char msg[40];
+	int pushed = 0;
+	int received = 0;
+	// push and drain enough records to wrap around several times
+	for (int loop = 0; loop < 20; loop++)
+	{
+		for (int i = 0; i < 3; i++)
+		{
+			int len = snprintf(msg, sizeof(msg), "message %d", pushed);
+			ASSERT_TRUE(ring.push(1, msg, len + 1));
+			pushed++;
+		}
+		ring.drain([&](u32 tag, const u8 *data, u32 size) {
+			ASSERT_EQ(1u, tag);
+			snprintf(msg, sizeof(msg), "message %d", received);
+			ASSERT_STREQ(msg, (const char *)data);
+			received++;
+		});
+		ASSERT_TRUE(ring.empty());
+	}
+	ASSERT_EQ(pushed, received);
+	ASSERT_EQ(0u, ring.droppedCount());
+
+	// overflow
+	char big[100] {};
+	ASSERT_TRUE(ring.push(2, big, sizeof(big)));
+	ASSERT_TRUE(ring.push(2, big, sizeof(big)));
+	ASSERT_FALSE(ring.push(2, big, sizeof(big)));
+	ASSERT_EQ(1u, ring.droppedCount());
+}
@@ -0,0 +1,90 @@
+#include "gtest/gtest.h"
+#include "types.h"
+#include "hw/mem/addrspace.h"
+#include "hw/mem/mem_watch.h"
+#include "emulator.h"
+
+#if FEAT_SHREC != DYNAREC_NONE && !defined(TARGET_NO_EXCEPTIONS) && !defined(_WIN32)
+#include "hw/sh4/dyna/blockmanager.h"
+#include "hw/sh4/sh4_mem.h"
+
+#include <csignal>
+
+class MemWatchTest : public ::testing::Test {
+protected:
+	void SetUp() override
+	{
+		if (!addrspace::reserve())
+			die("addrspace::reserve failed");
+		emu.init();
+		mem_map_default();
+		dc_reset(true);
+		if (!addrspace::virtmemEnabled())
+			GTEST_SKIP();
+		faults = 0;
+	}
+
+	void TearDown() override {
+		memwatch::scriptWatcher.reset();
+	}
+
+	// Writes to the main RAM view, handling the faults like the fault handler does
+	static void write32(u32 offset, u32 data)
+	{
+		struct sigaction act {};
+		struct sigaction oldAct;
+		act.sa_sigaction = faultHandler;
+		act.sa_flags = SA_SIGINFO;
+		sigaction(SIGSEGV, &act, &oldAct);
+		*(volatile u32 *)(addrspace::ram_base + 0x0C000000 + offset) = data;
+		sigaction(SIGSEGV, &oldAct, nullptr);
+	}
+
+	static void faultHandler(int sig, siginfo_t *si, void *context)
+	{
+		if (!memwatch::writeAccess(si->si_addr) && !bm_RamWriteAccess(si->si_addr))
+			abort();
+		faults++;
+	}
+
+	static int faults;
+};
+
+int MemWatchTest::faults;
+
+TEST_F(MemWatchTest, ScriptWatch)
+{
+	constexpr u32 Offset = 0x20000;
+	memwatch::scriptWatcher.watch(Offset, 4);
+	write32(Offset, 1);
+	ASSERT_EQ(1, faults);
+	ASSERT_TRUE(memwatch::scriptWatcher.isDirty(Offset, 4));
+	// code compiled from this page later can still be write-protected
+	ASSERT_TRUE(bm_IsRamPageProtected(Offset));
+
+	memwatch::scriptWatcher.protect();
+	write32(Offset, 2);
+	ASSERT_EQ(2, faults);
+	write32(Offset, 3);
+	ASSERT_EQ(2, faults);
+}
+
+TEST_F(MemWatchTest, Unwatch)
+{
+	constexpr u32 Offset = 0x20000;
+	// never written to
+	memwatch::scriptWatcher.watch(Offset, 4);
+	memwatch::scriptWatcher.unwatch(Offset, 4);
+	write32(Offset, 1);
+	ASSERT_EQ(0, faults);
+
+	// written to then protected again
+	memwatch::scriptWatcher.watch(Offset, 4);
+	write32(Offset, 2);
+	memwatch::scriptWatcher.protect();
+	memwatch::scriptWatcher.reset();
+	write32(Offset, 3);
+	ASSERT_EQ(1, faults);
+	ASSERT_TRUE(bm_IsRamPageProtected(Offset));
+}
+#endif
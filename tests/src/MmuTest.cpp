@@ -19,6 +19,7 @@
 #include "gtest/gtest.h"
 #include "types.h"
 #include "hw/mem/addrspace.h"
+#include "hw/mem/mem_watch.h"
 #include "emulator.h"
 #include "hw/sh4/modules/mmu.h"
 #include "hw/sh4/sh4_core.h"
@@ -233,3 +234,124 @@ TEST_F(MmuTest, TestErrors)
 	ASSERT_EQ(MmuError::FIRSTWRITE, err);
 #endif
 }
+
+#if defined(FAST_MMU) && FEAT_SHREC == DYNAREC_JIT && HOST_CPU == CPU_X64 && !defined(_WIN32)
+#include "hw/sh4/dyna/blockmanager.h"
+#include "hw/sh4/dyna/ngen.h"
+#include "hw/sh4/sh4_mem.h"
+#include "cfg/option.h"
+#include "oslib/oslib.h"
+#include <csignal>
+
+class ShadowMmuTest : public MmuTest {
+protected:
+	void SetUp() override
+	{
+		MmuTest::SetUp();
+		if (shadowmmu::base == nullptr)
+			GTEST_SKIP();
+		mem_map_default();
+		// The block manager lookup table is allocated on write faults
+		os_InstallFaultHandler();
+		config::MmuShadowPages.override(true);
+		// Windows CE signature to enable the MMU
+		static const char magic[] = { 'S', 0, 'H', 0, '-', 0, '4', 0, ' ', 0, 'K', 0, 'e', 0, 'r', 0, 'n', 0, 'e', 0, 'l', 0 };
+		memcpy(GetMemPtr(0x8c0110a8, sizeof(magic)), magic, sizeof(magic));
+		mmu_set_state();
+		ASSERT_TRUE(shadowmmu::enabled());
+		memset(UTLB, 0, sizeof(UTLB));
+		faults = 0;
+	}
+
+	void TearDown() override
+	{
+		CCN_MMUCR.AT = 0;
+		mmu_set_state();
+		config::MmuShadowPages.reset();
+		os_UninstallFaultHandler();
+	}
+
+	// Maps a 4 KB page and loads it in the shadow page table
+	void mapPage(u32 vaddr, u32 paddr)
+	{
+		UTLB[0].Address.VPN = vaddr >> 10;
+		UTLB[0].Data.SZ0 = 1;
+		UTLB[0].Data.V = 1;
+		UTLB[0].Data.PR = 3;
+		UTLB[0].Data.D = 1;
+		UTLB[0].Data.SH = 1;
+		UTLB[0].Data.PPN = (paddr & 0x1FFFFFFF) >> 10;
+		UTLB_Sync(0);
+	}
+
+	// Writes through the shadow page table, handling the faults like the dynarec does
+	static void write16(u32 vaddr, u16 data)
+	{
+		struct sigaction act {};
+		struct sigaction oldAct;
+		act.sa_sigaction = faultHandler;
+		act.sa_flags = SA_SIGINFO;
+		sigaction(SIGSEGV, &act, &oldAct);
+		*(volatile u16 *)(shadowmmu::base + vaddr) = data;
+		sigaction(SIGSEGV, &oldAct, nullptr);
+	}
+
+	static void faultHandler(int sig, siginfo_t *si, void *context)
+	{
+		u8 *addr = (u8 *)si->si_addr;
+		if (addr < shadowmmu::base || addr >= shadowmmu::base + 0x100000000ull
+				|| shadowmmu::handleFault((u32)(addr - shadowmmu::base), true) != shadowmmu::Fault::Mapped)
+			abort();
+		faults++;
+	}
+
+	static int faults;
+};
+
+int ShadowMmuTest::faults;
+
+TEST_F(ShadowMmuTest, CodeWrite)
+{
+	constexpr u32 CodeAddr = 0x8C010000;
+	constexpr u32 VAddr = 0x02000000;
+	u16 *code = (u16 *)GetMemPtr(CodeAddr, 4);
+	code[0] = 0x000B;	// rts
+	code[1] = 0x0009;	// nop
+	// Not write-protected yet
+	mapPage(VAddr, CodeAddr);
+	write16(VAddr + 4, 0x0009);
+	ASSERT_EQ(0, faults);
+
+	ASSERT_NE(nullptr, rdv_FailedToFindBlock(CodeAddr));
+	ASSERT_NE(nullptr, bm_GetBlock(CodeAddr));
+	write16(VAddr, 0x0009);
+	ASSERT_EQ(1, faults);
+	ASSERT_EQ(nullptr, bm_GetBlock(CodeAddr));
+	ASSERT_EQ(0x0009, code[0]);
+
+	// The page is writable again
+	write16(VAddr + 2, 0x0009);
+	ASSERT_EQ(1, faults);
+}
+
+TEST_F(ShadowMmuTest, ScriptWatch)
+{
+	constexpr u32 RamOffset = 0x20000;
+	constexpr u32 VAddr = 0x02000000;
+	mapPage(VAddr, 0x0C000000 + RamOffset);
+	memwatch::scriptWatcher.watch(RamOffset + 0x100, 4);
+	ASSERT_FALSE(memwatch::scriptWatcher.isDirty(RamOffset + 0x100, 4));
+
+	write16(VAddr + 0x100, 42);
+	ASSERT_EQ(1, faults);
+	ASSERT_TRUE(memwatch::scriptWatcher.isDirty(RamOffset + 0x100, 4));
+	ASSERT_EQ(42, *(u16 *)GetMemPtr(0x8C000000 + RamOffset + 0x100, 2));
+
+	memwatch::scriptWatcher.protect();
+	ASSERT_FALSE(memwatch::scriptWatcher.isDirty(RamOffset + 0x100, 4));
+	write16(VAddr + 0x102, 43);
+	ASSERT_EQ(2, faults);
+	ASSERT_TRUE(memwatch::scriptWatcher.isDirty(RamOffset + 0x100, 4));
+	memwatch::scriptWatcher.reset();
+}
+#endif
@@ -0,0 +1,255 @@
+#include "gtest/gtest.h"
+#include "types.h"
+#include "hw/naomi/awcartridge.h"
+#include "hw/naomi/awave_regs.h"
+#include "hw/naomi/m1cartridge.h"
+#include "hw/naomi/m4cartridge.h"
+#include "hw/naomi/naomi_regs.h"
+#include "cfg/option.h"
+#include "oslib/oslib.h"
+
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <vector>
+
+template<typename T>
+class TestCartridge : public T
+{
+public:
+	TestCartridge(u32 size, u32 seed) : T(size)
+	{
+		std::mt19937 rng(seed);
+		for (u32 i = 0; i < size; i++)
+			this->RomPtr[i] = (u8)rng();
+	}
+
+	u8 *rom() { return this->RomPtr; }
+
+	// Reads size bytes through the DMA interface, at most maxChunk bytes at a time
+	std::vector<u8> dma(u32 size, u32 maxChunk = 0x10000)
+	{
+		std::vector<u8> data;
+		while (data.size() < size)
+		{
+			u32 chunk = std::min<u32>(size - data.size(), maxChunk);
+			const u8 *p = (const u8 *)this->GetDmaPtr(chunk);
+			if (chunk == 0)
+				break;
+			data.insert(data.end(), p, p + chunk);
+			this->AdvancePtr(chunk);
+		}
+		return data;
+	}
+};
+
+class NaomiCartTest : public ::testing::Test
+{
+protected:
+	void TearDown() override {
+		config::NaomiDecryptCache.reset();
+		config::NaomiPredecrypt.reset();
+	}
+
+	template<typename T>
+	static void setDmaOffset(T& cart, u32 offset)
+	{
+		cart.WriteMem(NAOMI_DMA_OFFSETH_addr, offset >> 16, 2);
+		cart.WriteMem(NAOMI_DMA_OFFSETL_addr, offset & 0xffff, 2);
+	}
+
+	static std::unique_ptr<TestCartridge<M4Cartridge>> makeM4(bool cached, bool prefetch = false)
+	{
+		config::NaomiDecryptCache = cached;
+		config::NaomiPredecrypt = prefetch;
+		auto cart = std::make_unique<TestCartridge<M4Cartridge>>(RomSize, 42);
+		std::mt19937 rng(43);
+		u8 *keyData = (u8 *)malloc(2048);
+		for (int i = 0; i < 2048; i++)
+			keyData[i] = (u8)rng();
+		cart->SetKeyData(keyData);
+		cart->SetKey(0x5504);
+		cart->Init();
+		// encrypted transfers
+		cart->WriteMem(NAOMI_ROM_OFFSETH_addr, 0x4000, 2);
+		return cart;
+	}
+
+	static std::unique_ptr<TestCartridge<AWCartridge>> makeAW(bool cached, bool prefetch = false)
+	{
+		config::NaomiDecryptCache = cached;
+		config::NaomiPredecrypt = prefetch;
+		auto cart = std::make_unique<TestCartridge<AWCartridge>>(RomSize, 44);
+		cart->SetKey(0x9c);
+		cart->Init();
+		return cart;
+	}
+
+	static void setEprOffset(AWCartridge& cart, u32 offset)
+	{
+		cart.WriteMem(AW_EPR_OFFSETH_addr, offset >> 17, 2);
+		cart.WriteMem(AW_EPR_OFFSETL_addr, (offset >> 1) & 0xffff, 2);
+	}
+
+	static constexpr u32 RomSize = 1_MB;
+};
+
+TEST_F(NaomiCartTest, M4Cache)
+{
+	auto ref = makeM4(false);
+	auto cart = makeM4(true);
+	// aligned and unaligned transfers, last one crossing pages
+	for (u32 offset : { 0u, 0x20u, 0x1002u, 0x3ff0u, 0x7fe0u })
+		for (u32 chunk : { 32u, 1000u, 0x8000u })
+		{
+			setDmaOffset(*ref, offset);
+			setDmaOffset(*cart, offset);
+			std::vector<u8> expected = ref->dma(0x12000, chunk);
+			ASSERT_EQ(0x12000u, expected.size());
+			ASSERT_EQ(expected, cart->dma(0x12000, chunk)) << "offset " << offset << " chunk " << chunk;
+		}
+	// PIO reads
+	for (u32 offset : { 0x100u, 0x4002u })
+	{
+		ref->WriteMem(NAOMI_ROM_OFFSETH_addr, 0xc000 | (offset >> 16), 2);
+		ref->WriteMem(NAOMI_ROM_OFFSETL_addr, offset & 0xffff, 2);
+		cart->WriteMem(NAOMI_ROM_OFFSETH_addr, 0xc000 | (offset >> 16), 2);
+		cart->WriteMem(NAOMI_ROM_OFFSETL_addr, offset & 0xffff, 2);
+		for (int i = 0; i < 100; i++)
+			ASSERT_EQ(ref->ReadMem(NAOMI_ROM_DATA_addr, 2), cart->ReadMem(NAOMI_ROM_DATA_addr, 2));
+	}
+}
+
+TEST_F(NaomiCartTest, AWCache)
+{
+	auto ref = makeAW(false);
+	auto cart = makeAW(true, true);
+	for (u32 offset : { 0u, 0x20u, 0x3ffeu, 0x10000u })
+	{
+		setEprOffset(*ref, offset);
+		setEprOffset(*cart, offset);
+		std::vector<u8> expected = ref->dma(0x8000);
+		ASSERT_FALSE(expected.empty());
+		ASSERT_EQ(expected, cart->dma(0x8000)) << "offset " << offset;
+	}
+}
+
+// Writes a random M1 compressed stream that doesn't end, for a null key
+static void writeM1Stream(u8 *rom, u32 size, u32 seed)
+{
+	std::mt19937 rng(seed);
+	std::vector<bool> bits;
+	auto put = [&bits](u32 v, int count) {
+		for (int i = count - 1; i >= 0; i--)
+			bits.push_back((v >> i) & 1);
+	};
+	// dictionary
+	for (int i = 0; i < 111; i++)
+		put(rng() & 0xff, 8);
+	while (bits.size() < size * 8)
+	{
+		switch (rng() % 5)
+		{
+		case 0:
+			{
+				put(0, 2);
+				u32 addr = rng() & 3;
+				put(addr, 2);
+				if (addr == 0)
+					put(rng() & 0xff, 8);
+				break;
+			}
+		case 1:
+			put(2, 3);
+			put(rng() & 3, 2);
+			break;
+		case 2:
+			put(3, 3);
+			put(rng() & 7, 3);
+			break;
+		case 3:
+			put(2, 2);
+			put(rng() & 31, 5);
+			break;
+		case 4:
+			// 63 ends the stream
+			put(3, 2);
+			put(rng() % 63, 6);
+			break;
+		}
+	}
+	for (u32 i = 0; i + 4 <= size; i += 4)
+	{
+		u32 v = 0;
+		for (int j = 0; j < 32; j++)
+			v = (v << 1) | bits[i * 8 + j];
+		rom[i] = (u8)v;
+		rom[i + 1] = (u8)(v >> 8);
+		rom[i + 2] = (u8)(v ^ (v >> 16));
+		rom[i + 3] = (u8)((v >> 8) ^ (v >> 24));
+	}
+}
+
+TEST_F(NaomiCartTest, M1Cache)
+{
+	TestCartridge<M1Cartridge> ref(RomSize, 45);
+	TestCartridge<M1Cartridge> cart(RomSize, 45);
+	for (auto c : { &ref, &cart })
+	{
+		writeM1Stream(c->rom(), RomSize / 2, 46);
+		writeM1Stream(c->rom() + RomSize / 2, RomSize / 2, 47);
+	}
+	auto start = [](TestCartridge<M1Cartridge>& c, u32 offset, bool cached) {
+		config::NaomiDecryptCache = cached;
+		setDmaOffset(c, offset);
+	};
+
+	for (u32 offset : { 0u, RomSize / 2 })
+	{
+		start(ref, offset, false);
+		std::vector<u8> expected = ref.dma(0x20000);
+		ASSERT_EQ(0x20000u, expected.size());
+		// The first transfer is decompressed and recorded, the next ones are replayed
+		// with different chunk sizes.
+		for (u32 chunk : { 0x8000u, 1000u, 0x8000u, 0x3000u })
+		{
+			start(cart, offset, true);
+			ASSERT_EQ(expected, cart.dma(0x20000, chunk)) << "offset " << offset << " chunk " << chunk;
+		}
+		// Longer than the recorded output
+		start(ref, offset, false);
+		expected = ref.dma(0x30000);
+		start(cart, offset, true);
+		ASSERT_EQ(expected, cart.dma(0x30000, 0x5000));
+	}
+}
+
+// Run with --gtest_also_run_disabled_tests
+TEST_F(NaomiCartTest, DISABLED_Throughput)
+{
+	auto measure = [](const char *name, auto& cart, auto setOffset) {
+		double start = os_GetSeconds();
+		u64 total = 0;
+		for (int i = 0; i < 20; i++)
+		{
+			setOffset(*cart);
+			total += cart->dma(RomSize / 2).size();
+		}
+		double duration = os_GetSeconds() - start;
+		printf("%s: %.1f MB/s\n", name, total / duration / 1_MB);
+	};
+	auto m4Offset = [](auto& cart) { setDmaOffset(cart, 0x100); };
+	auto awOffset = [](auto& cart) { setEprOffset(cart, 0x100); };
+	{
+		auto cart = makeM4(false);
+		measure("M4 per-word", cart, m4Offset);
+		cart = makeM4(true);
+		measure("M4 cached", cart, m4Offset);
+	}
+	{
+		auto cart = makeAW(false);
+		measure("AW per-word", cart, awOffset);
+		cart = makeAW(true);
+		measure("AW cached", cart, awOffset);
+	}
+}
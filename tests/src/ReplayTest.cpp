@@ -0,0 +1,243 @@
+#include "gtest/gtest.h"
+#include "types.h"
+#include "replay.h"
+#include "oslib/oslib.h"
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+using namespace replay;
+
+class ReplayTest : public ::testing::Test {
+protected:
+	void SetUp() override
+	{
+		for (size_t i = 0; i < state.size(); i++)
+			state[i] = (u8)(i / 16);
+	}
+
+	void TearDown() override {
+		nowide::remove(path.c_str());
+	}
+
+	void open(Recorder& recorder) {
+		ASSERT_TRUE(recorder.open(path, "game.chd", state.data(), state.size(), {}));
+	}
+
+	static void checkInput(const MapleInputState *expected, const MapleInputState *actual)
+	{
+		for (int port = 0; port < 4; port++)
+		{
+			ASSERT_EQ(expected[port].kcode, actual[port].kcode) << port;
+			ASSERT_EQ(0, memcmp(expected[port].halfAxes, actual[port].halfAxes, sizeof(actual[port].halfAxes))) << port;
+			ASSERT_EQ(0, memcmp(expected[port].fullAxes, actual[port].fullAxes, sizeof(actual[port].fullAxes))) << port;
+			ASSERT_EQ(expected[port].absPos.x, actual[port].absPos.x) << port;
+			ASSERT_EQ(expected[port].relPos.wheel, actual[port].relPos.wheel) << port;
+			ASSERT_EQ(0, memcmp(expected[port].keyboard.key, actual[port].keyboard.key, sizeof(actual[port].keyboard.key))) << port;
+		}
+	}
+
+	std::vector<u8> state = std::vector<u8>(1000);
+	const std::string path = "replay_test.bin";
+};
+
+TEST_F(ReplayTest, RecordPlay)
+{
+	// Input of each poll
+	std::vector<std::vector<MapleInputState>> inputs;
+	{
+		Recorder recorder;
+		open(recorder);
+		MapleInputState input[4];
+		for (int frame = 0; frame < 200; frame++)
+		{
+			// Input polled twice per frame, changing every 7 polls
+			for (int poll = 0; poll < 2; poll++)
+			{
+				int n = frame * 2 + poll;
+				if (n % 7 == 0)
+				{
+					input[n % 4].kcode ^= 1 << (n % 16);
+					input[0].fullAxes[PJAI_X1] = -n;
+					input[1].absPos.x = n * 3;
+					input[2].relPos.wheel = n % 5 - 2;
+					input[3].keyboard.key[n % 6] = n;
+				}
+				recorder.input(input);
+				inputs.emplace_back(input, input + 4);
+			}
+			if (frame == 0)
+			{
+				recorder.rtc(1000000);
+				recorder.networkSlots(2, 1);
+			}
+			if (frame == 10)
+			{
+				recorder.modemRead(-1);
+				recorder.modemRead('A');
+				recorder.modemRead(-1);
+				recorder.modemRead(-1);
+				recorder.modemRead('B');
+			}
+			if (frame == 20)
+			{
+				const u8 packet[] = { 1, 2, 3, 4 };
+				recorder.networkReceive(nullptr, 0, 0);
+				recorder.networkReceive(packet, sizeof(packet), 65535);
+				recorder.networkReceive(packet, 2, 0);
+				recorder.mediaChange({ 12345, true, "" });
+				recorder.mediaChange({ 100000, false, "disc2.chd" });
+			}
+			if (frame == 100)
+				recorder.rtc(999999);
+			if (frame % 60 == 59)
+				recorder.checksum(frame * 0x123456789ull);
+			recorder.endFrame();
+		}
+		ASSERT_TRUE(recorder.close());
+	}
+
+	Player player;
+	ASSERT_TRUE(player.open(path));
+	ASSERT_EQ("game.chd", player.getGamePath());
+	ASSERT_EQ(200u, player.frameCount());
+	std::vector<u8> loaded;
+	ASSERT_TRUE(player.loadState(loaded));
+	ASSERT_EQ(state, loaded);
+
+	size_t pollIndex = 0;
+	for (int frame = 0; frame < 200; frame++)
+	{
+		ASSERT_FALSE(player.finished());
+		for (int poll = 0; poll < 2; poll++)
+		{
+			MapleInputState input[4];
+			player.input(input);
+			checkInput(inputs[pollIndex++].data(), input);
+		}
+		if (frame == 0)
+		{
+			ASSERT_EQ(1000000u, player.rtc());
+			int count, id;
+			player.networkSlots(count, id);
+			ASSERT_EQ(2, count);
+			ASSERT_EQ(1, id);
+		}
+		if (frame == 10)
+		{
+			ASSERT_EQ(-1, player.modemRead());
+			ASSERT_EQ('A', player.modemRead());
+			ASSERT_EQ(-1, player.modemRead());
+			ASSERT_EQ(-1, player.modemRead());
+			ASSERT_EQ('B', player.modemRead());
+		}
+		else {
+			ASSERT_EQ(-1, player.modemRead());
+		}
+		u8 packet[16] {};
+		u16 packetNumber = 0;
+		if (frame == 20)
+		{
+			ASSERT_FALSE(player.networkReceive(packet, sizeof(packet), packetNumber));
+			ASSERT_TRUE(player.networkReceive(packet, sizeof(packet), packetNumber));
+			ASSERT_EQ(65535, packetNumber);
+			ASSERT_EQ(4, packet[3]);
+			ASSERT_TRUE(player.networkReceive(packet, sizeof(packet), packetNumber));
+			ASSERT_EQ(0, packetNumber);
+			ASSERT_EQ(2u, player.mediaChanges().size());
+			ASSERT_TRUE(player.mediaChanges()[0].openLid);
+			ASSERT_EQ(12345u, player.mediaChanges()[0].cycle);
+			ASSERT_FALSE(player.mediaChanges()[1].openLid);
+			ASSERT_EQ("disc2.chd", player.mediaChanges()[1].path);
+		}
+		else
+		{
+			ASSERT_FALSE(player.networkReceive(packet, sizeof(packet), packetNumber));
+			ASSERT_TRUE(player.mediaChanges().empty());
+		}
+		if (frame == 100)
+		{
+			ASSERT_EQ(999999u, player.rtc());
+		}
+		ASSERT_TRUE(player.endFrame([frame]() { return frame * 0x123456789ull; })) << player.getError();
+	}
+	ASSERT_TRUE(player.finished());
+	ASSERT_FALSE(player.diverged());
+}
+
+TEST_F(ReplayTest, Divergence)
+{
+	{
+		Recorder recorder;
+		open(recorder);
+		MapleInputState input[4];
+		recorder.input(input);
+		recorder.endFrame();
+		input[0].kcode = 0;
+		recorder.input(input);
+		recorder.checksum(42);
+		recorder.endFrame();
+		recorder.rtc(1);
+		recorder.endFrame();
+		ASSERT_TRUE(recorder.close());
+	}
+	MapleInputState input[4];
+	// Input change not polled
+	Player player;
+	ASSERT_TRUE(player.open(path));
+	player.input(input);
+	ASSERT_TRUE(player.endFrame([]() { return 42; }));
+	ASSERT_FALSE(player.endFrame([]() { return 42; }));
+	ASSERT_TRUE(player.diverged());
+	ASSERT_NE(std::string::npos, player.getError().find("frame 1"));
+
+	// RAM checksum mismatch
+	ASSERT_TRUE(player.open(path));
+	ASSERT_FALSE(player.diverged());
+	player.input(input);
+	ASSERT_TRUE(player.endFrame([]() { return 42; }));
+	player.input(input);
+	ASSERT_EQ(0u, input[0].kcode);
+	ASSERT_FALSE(player.endFrame([]() { return 43; }));
+
+	// RTC read not recorded
+	ASSERT_TRUE(player.open(path));
+	player.input(input);
+	player.rtc();
+	ASSERT_FALSE(player.endFrame([]() { return 42; }));
+}
+
+TEST_F(ReplayTest, Invalid)
+{
+	Player player;
+	ASSERT_FALSE(player.open(path));
+	{
+		Recorder recorder;
+		open(recorder);
+		recorder.rtc(1);
+		recorder.endFrame();
+		ASSERT_TRUE(recorder.close());
+	}
+	ASSERT_TRUE(player.open(path));
+	player.close();
+
+	// Truncated file
+	FILE *f = nowide::fopen(path.c_str(), "rb");
+	ASSERT_NE(nullptr, f);
+	std::fseek(f, 0, SEEK_END);
+	std::vector<u8> content(std::ftell(f));
+	std::fseek(f, 0, SEEK_SET);
+	ASSERT_EQ(1u, std::fread(content.data(), content.size(), 1, f));
+	std::fclose(f);
+	f = nowide::fopen(path.c_str(), "wb");
+	std::fwrite(content.data(), content.size() - 1, 1, f);
+	std::fclose(f);
+	ASSERT_FALSE(player.open(path));
+
+	// Savestate only
+	f = nowide::fopen(path.c_str(), "wb");
+	std::fwrite(content.data(), content.size() / 2, 1, f);
+	std::fclose(f);
+	ASSERT_FALSE(player.open(path));
+}
@@ -0,0 +1,102 @@
+#include "gtest/gtest.h"
+#include "types.h"
+#include "oslib/savefile.h"
+
+#include <cstdio>
+#include <vector>
+
+class SaveFileTest : public ::testing::Test {
+protected:
+	void SetUp() override {
+		removeFiles();
+	}
+
+	void TearDown() override
+	{
+		savefile::term();
+		removeFiles();
+	}
+
+	void removeFiles()
+	{
+		nowide::remove(path.c_str());
+		nowide::remove((path + ".tmp").c_str());
+	}
+
+	std::vector<u8> readFile()
+	{
+		std::vector<u8> data;
+		FILE *f = nowide::fopen(path.c_str(), "rb");
+		if (f == nullptr)
+			return data;
+		u8 buf[256];
+		size_t n;
+		while ((n = std::fread(buf, 1, sizeof(buf), f)) > 0)
+			data.insert(data.end(), buf, buf + n);
+		std::fclose(f);
+		return data;
+	}
+
+	const std::string path = "savefile_test.bin";
+};
+
+TEST_F(SaveFileTest, CoalesceAndFlush)
+{
+	u8 image[1024] {};
+	image[0] = 1;
+	savefile::write(path, image, sizeof(image));
+	image[10] = 2;
+	image[11] = 3;
+	savefile::write(path, image, sizeof(image));
+	image[12] = 4;
+	savefile::write(path, image, sizeof(image));
+	// the file is written once
+	ASSERT_EQ(savefile::pendingBytes(), sizeof(image));
+
+	savefile::flush();
+	ASSERT_EQ(savefile::pendingBytes(), 0u);
+	std::vector<u8> data = readFile();
+	ASSERT_EQ(data.size(), sizeof(image));
+	ASSERT_EQ(data[0], 1);
+	ASSERT_EQ(data[10], 2);
+	ASSERT_EQ(data[11], 3);
+	ASSERT_EQ(data[12], 4);
+
+	// later writes replace the file
+	image[1000] = 5;
+	savefile::write(path, image, sizeof(image));
+	savefile::term();
+	data = readFile();
+	ASSERT_EQ(data.size(), sizeof(image));
+	ASSERT_EQ(data[1000], 5);
+	ASSERT_EQ(data[12], 4);
+}
+
+TEST_F(SaveFileTest, WriteAfterTerm)
+{
+	u8 image[16] {};
+	savefile::term();
+	// the writer thread is started again
+	image[3] = 7;
+	savefile::write(path, image, sizeof(image));
+	savefile::flush();
+	ASSERT_EQ(savefile::pendingBytes(), 0u);
+	std::vector<u8> data = readFile();
+	ASSERT_EQ(data.size(), sizeof(image));
+	ASSERT_EQ(data[3], 7);
+}
+
+TEST_F(SaveFileTest, WriteError)
+{
+	u8 image[16] {};
+	// the directory doesn't exist
+	const std::string badPath = "savefile_test_dir/savefile_test.bin";
+	ASSERT_TRUE(savefile::write(badPath, image, sizeof(image)));
+	savefile::flush();
+	// reported once by the next write
+	ASSERT_FALSE(savefile::write(badPath, image, sizeof(image)));
+	ASSERT_TRUE(savefile::write(path, image, sizeof(image)));
+	savefile::flush();
+	ASSERT_FALSE(savefile::write(badPath, image, sizeof(image)));
+	ASSERT_TRUE(savefile::write(badPath, image, sizeof(image)));
+}
@@ -0,0 +1,103 @@
+#include "gtest/gtest.h"
+#include "types.h"
+#include "emulator.h"
+#include "cfg/option.h"
+#include "hw/mem/addrspace.h"
+#include "hw/sh4/sh4_mem.h"
+#include "hw/sh4/sh4_if.h"
+
+#if FEAT_SHREC != DYNAREC_NONE
+#include "hw/sh4/dyna/blockmanager.h"
+
+#include <algorithm>
+#include <initializer_list>
+
+class Sh4IdleLoopTest : public ::testing::Test {
+protected:
+	void SetUp() override
+	{
+		if (!addrspace::reserve())
+			die("addrspace::reserve failed");
+		emu.init();
+		mem_map_default();
+		dc_reset(true);
+		config::IdleLoopSkip.override(true);
+	}
+
+	void TearDown() override {
+		config::IdleLoopSkip.reset();
+	}
+
+	// Decodes and optimizes the loop. Returns true if it is detected as an idle loop.
+	bool isIdleLoop(std::initializer_list<u16> ops)
+	{
+		u32 pc = START_PC;
+		for (u16 op : ops)
+		{
+			addrspace::write16(pc, op);
+			pc += 2;
+		}
+		// bt START_PC
+		const int disp = ((int)START_PC - (int)(pc + 4)) / 2;
+		addrspace::write16(pc, 0x8900 | (disp & 0xff));
+
+		RuntimeBlockInfo block;
+		if (!block.Setup(START_PC, p_sh4rcb->cntx.fpscr))
+			return false;
+		EXPECT_EQ(START_PC, block.BranchBlock);
+		return std::any_of(block.oplist.begin(), block.oplist.end(), [](const shil_opcode& op) {
+			return op.op == shop_idle;
+		});
+	}
+
+	// Blocks in the first 64 KB of RAM aren't write-protected, so they aren't registered
+	// in the block manager
+	static constexpr u32 START_PC = 0x8C008000;
+};
+
+TEST_F(Sh4IdleLoopTest, RamPolling)
+{
+	// loop:
+	//   mov #0x8C, r1; shll16 r1; shll8 r1	(r1 = 0x8C000000)
+	//   mov.l @r1, r0
+	//   tst r0, r0
+	//   bt loop
+	ASSERT_TRUE(isIdleLoop({ 0xE18C, 0x4128, 0x4118, 0x6012, 0x2008 }));
+
+	// Disabled
+	config::IdleLoopSkip.override(false);
+	ASSERT_FALSE(isIdleLoop({ 0xE18C, 0x4128, 0x4118, 0x6012, 0x2008 }));
+}
+
+TEST_F(Sh4IdleLoopTest, RegisterPolling)
+{
+	// TMU TCNT0 changes by itself
+	// loop:
+	//   mov #0xD8, r1; shll16 r1; add #12, r1	(r1 = 0xFFD8000C)
+	//   mov.l @r1, r0
+	//   tst r0, r0
+	//   bt loop
+	ASSERT_FALSE(isIdleLoop({ 0xE1D8, 0x4128, 0x710C, 0x6012, 0x2008 }));
+}
+
+TEST_F(Sh4IdleLoopTest, UnknownAddress)
+{
+	// The address in r4 isn't known at compile time
+	// loop:
+	//   mov.l @r4, r0
+	//   tst r0, r0
+	//   bt loop
+	ASSERT_FALSE(isIdleLoop({ 0x6042, 0x2008 }));
+}
+
+TEST_F(Sh4IdleLoopTest, SideEffect)
+{
+	// loop:
+	//   mov #0x8C, r1; shll16 r1; shll8 r1
+	//   mov.l @r1, r0
+	//   add #1, r2
+	//   tst r0, r0
+	//   bt loop
+	ASSERT_FALSE(isIdleLoop({ 0xE18C, 0x4128, 0x4118, 0x6012, 0x7201, 0x2008 }));
+}
+#endif
@@ -0,0 +1,143 @@
+#include "gtest/gtest.h"
+#include "types.h"
+
+#ifdef USE_VULKAN
+#include "rend/vulkan/compiler.h"
+#include "oslib/oslib.h"
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+class SpirvCacheTest : public ::testing::Test {
+protected:
+	void SetUp() override {
+		nowide::remove(path.c_str());
+	}
+	void TearDown() override {
+		nowide::remove(path.c_str());
+	}
+
+	static std::string source(int i) {
+		return "void main() { gl_Position = vec4(" + std::to_string(i) + ".0); }";
+	}
+
+	const std::string path = "spirv_cache_test.bin";
+};
+
+TEST_F(SpirvCacheTest, LoadSave)
+{
+	SpirvCache cache;
+	cache.LoadAsync(path);
+	std::vector<unsigned int> spirv;
+	ASSERT_FALSE(cache.Lookup(vk::ShaderStageFlagBits::eVertex, source(1), spirv));
+	cache.Add(vk::ShaderStageFlagBits::eVertex, source(1), { 1, 2, 3 }, 0);
+	cache.Add(vk::ShaderStageFlagBits::eFragment, source(2), { 4, 5 }, 0);
+	cache.Term();
+
+	cache.LoadAsync(path);
+	ASSERT_EQ(2u, cache.size());
+	ASSERT_TRUE(cache.Lookup(vk::ShaderStageFlagBits::eVertex, source(1), spirv));
+	ASSERT_EQ(std::vector<unsigned int>({ 1, 2, 3 }), spirv);
+	ASSERT_TRUE(cache.Lookup(vk::ShaderStageFlagBits::eFragment, source(2), spirv));
+	ASSERT_EQ(std::vector<unsigned int>({ 4, 5 }), spirv);
+	// Same source, different stage
+	ASSERT_FALSE(cache.Lookup(vk::ShaderStageFlagBits::eFragment, source(1), spirv));
+	cache.Term();
+}
+
+TEST_F(SpirvCacheTest, InvalidWordCount)
+{
+	SpirvCache cache;
+	cache.LoadAsync(path);
+	cache.Add(vk::ShaderStageFlagBits::eVertex, source(1), { 1, 2, 3 }, 0);
+	cache.Term();
+
+	// Word count of the first index entry, after the header, hash, stage and source size
+	FILE *f = nowide::fopen(path.c_str(), "r+b");
+	ASSERT_NE(nullptr, f);
+	std::fseek(f, 16 + 8 + 4 + 4, SEEK_SET);
+	const u32 wordCount = 0x40000000;
+	std::fwrite(&wordCount, sizeof(wordCount), 1, f);
+	std::fclose(f);
+
+	cache.LoadAsync(path);
+	ASSERT_EQ(0u, cache.size());
+	cache.Term();
+}
+
+TEST_F(SpirvCacheTest, Eviction)
+{
+	SpirvCache cache;
+	cache.LoadAsync(path);
+	for (int i = 0; i < (int)SpirvCache::MAX_ENTRIES; i++)
+		cache.Add(vk::ShaderStageFlagBits::eVertex, source(i), { (unsigned)i }, 0);
+	std::vector<unsigned int> spirv;
+	ASSERT_TRUE(cache.Lookup(vk::ShaderStageFlagBits::eVertex, source(0), spirv));
+
+	// The least recently used shader is evicted
+	cache.Add(vk::ShaderStageFlagBits::eVertex, source(-1), { 0 }, 0);
+	ASSERT_EQ(SpirvCache::MAX_ENTRIES, cache.size());
+	ASSERT_TRUE(cache.Lookup(vk::ShaderStageFlagBits::eVertex, source(-1), spirv));
+	ASSERT_TRUE(cache.Lookup(vk::ShaderStageFlagBits::eVertex, source(0), spirv));
+	ASSERT_FALSE(cache.Lookup(vk::ShaderStageFlagBits::eVertex, source(1), spirv));
+	cache.Term();
+}
+
+// Cache hit vs. glslang compile time
+// Run with --gtest_also_run_disabled_tests
+TEST_F(SpirvCacheTest, DISABLED_Benchmark)
+{
+	const std::string shader = R"(#version 450
+layout (location = 0) out vec4 FragColor;
+layout (set = 1, binding = 0) uniform sampler2D tex;
+layout (location = 0) in highp vec4 vtx_base;
+layout (location = 1) in highp vec4 vtx_offs;
+layout (location = 2) in highp vec3 vtx_uv;
+layout (push_constant) uniform pushBlock
+{
+	vec4 clipTest;
+	float trilinearAlpha;
+	int palette_index;
+} pushConstants;
+
+void main()
+{
+	vec4 color = vtx_base;
+	vec4 texcol = texture(tex, vtx_uv.st);
+	if (pushConstants.palette_index != 0)
+		texcol.a = 1.0;
+	color *= texcol;
+	color.rgb += vtx_offs.rgb;
+	color.a *= pushConstants.trilinearAlpha;
+	if (color.a < 0.5)
+		discard;
+	FragColor = clamp(color, 0.0, 1.0);
+}
+)";
+	constexpr int Count = 50;
+	ShaderCompiler::Init();
+	SpirvCache cache;
+	cache.LoadAsync(path);
+	std::vector<unsigned int> spirv;
+
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < Count; i++)
+	{
+		spirv.clear();
+		ASSERT_TRUE(ShaderCompiler::CompileSpirv(vk::ShaderStageFlagBits::eFragment, shader, spirv));
+	}
+	const double compileTime = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / Count;
+	cache.Add(vk::ShaderStageFlagBits::eFragment, shader, spirv, 0);
+
+	start = std::chrono::steady_clock::now();
+	for (int i = 0; i < Count; i++)
+		ASSERT_TRUE(cache.Lookup(vk::ShaderStageFlagBits::eFragment, shader, spirv));
+	const double hitTime = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / Count;
+
+	printf("glslang compile %.1f us, cache hit %.1f us\n", compileTime, hitTime);
+	cache.Term();
+	ShaderCompiler::Term();
+}
+#endif
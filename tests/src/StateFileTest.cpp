@@ -0,0 +1,120 @@
+#include "gtest/gtest.h"
+#include "types.h"
+#include "archive/statefile.h"
+#include "archive/rzip.h"
+#include "oslib/oslib.h"
+
+#include <cstdio>
+#include <random>
+#include <vector>
+
+class StateFileTest : public ::testing::Test {
+protected:
+	void SetUp() override
+	{
+		// Device state around a compressible RAM section and an incompressible VRAM section
+		std::mt19937 rng(42);
+		data.resize(5_MB + 300);
+		for (size_t i = 0; i < data.size(); i++)
+			data[i] = (u8)(i / 64);
+		for (size_t i = 3_MB + 100; i < 5_MB + 100; i++)
+			data[i] = (u8)rng();
+		sections.push_back({ Serializer::Section::Ram, 100, 3_MB });
+		sections.push_back({ Serializer::Section::Vram, 3_MB + 100, 2_MB });
+	}
+
+	void TearDown() override {
+		nowide::remove(path.c_str());
+	}
+
+	FILE *open() {
+		return nowide::fopen(path.c_str(), "rb");
+	}
+
+	std::vector<u8> data;
+	std::vector<Serializer::SectionMark> sections;
+	const std::string path = "statefile_test.bin";
+};
+
+TEST_F(StateFileTest, SaveLoad)
+{
+	ASSERT_TRUE(statefile::save(path, data.data(), data.size(), sections));
+	FILE *f = open();
+	ASSERT_NE(nullptr, f);
+	ASSERT_TRUE(statefile::isStateFile(f));
+	std::vector<u8> loaded;
+	ASSERT_TRUE(statefile::load(f, loaded));
+	ASSERT_EQ(data, loaded);
+
+	// Single sections
+	ASSERT_TRUE(statefile::loadSection(f, Serializer::Section::Ram, loaded));
+	ASSERT_EQ(std::vector<u8>(data.begin() + 100, data.begin() + 100 + 3_MB), loaded);
+	ASSERT_TRUE(statefile::loadSection(f, Serializer::Section::Vram, loaded));
+	ASSERT_EQ(std::vector<u8>(data.begin() + 3_MB + 100, data.begin() + 5_MB + 100), loaded);
+	ASSERT_TRUE(statefile::loadSection(f, Serializer::Section::Devices, loaded));
+	ASSERT_EQ(300u, loaded.size());
+	ASSERT_FALSE(statefile::loadSection(f, Serializer::Section::Aram, loaded));
+	std::fclose(f);
+}
+
+TEST_F(StateFileTest, Invalid)
+{
+	// rzip savestates aren't sectioned
+	RZipFile zipFile;
+	ASSERT_TRUE(zipFile.Open(path, true));
+	ASSERT_EQ(data.size(), zipFile.Write(data.data(), data.size()));
+	zipFile.Close();
+	FILE *f = open();
+	ASSERT_FALSE(statefile::isStateFile(f));
+	std::fclose(f);
+
+	// truncated file
+	ASSERT_TRUE(statefile::save(path, data.data(), data.size(), sections));
+	f = open();
+	std::vector<u8> content(1_MB);
+	content.resize(std::fread(content.data(), 1, content.size(), f));
+	std::fclose(f);
+	f = nowide::fopen(path.c_str(), "wb");
+	std::fwrite(content.data(), 1, content.size(), f);
+	std::fclose(f);
+	f = open();
+	ASSERT_TRUE(statefile::isStateFile(f));
+	std::vector<u8> loaded;
+	ASSERT_FALSE(statefile::load(f, loaded));
+	std::fclose(f);
+}
+
+// Run with --gtest_also_run_disabled_tests
+TEST_F(StateFileTest, DISABLED_CompareWithRzip)
+{
+	auto fileSize = [this]() {
+		FILE *f = open();
+		std::fseek(f, 0, SEEK_END);
+		long size = std::ftell(f);
+		std::fclose(f);
+		return size;
+	};
+	double start = os_GetSeconds();
+	RZipFile zipFile;
+	zipFile.Open(path, true);
+	zipFile.Write(data.data(), data.size());
+	zipFile.Close();
+	double saveTime = os_GetSeconds() - start;
+	long size = fileSize();
+	start = os_GetSeconds();
+	zipFile.Open(path, false);
+	std::vector<u8> loaded(data.size());
+	zipFile.Read(loaded.data(), loaded.size());
+	zipFile.Close();
+	printf("rzip: save %.1f ms load %.1f ms size %ld\n", saveTime * 1000.0, (os_GetSeconds() - start) * 1000.0, size);
+
+	start = os_GetSeconds();
+	statefile::save(path, data.data(), data.size(), sections);
+	saveTime = os_GetSeconds() - start;
+	size = fileSize();
+	start = os_GetSeconds();
+	FILE *f = open();
+	statefile::load(f, loaded);
+	std::fclose(f);
+	printf("sectioned: save %.1f ms load %.1f ms size %ld\n", saveTime * 1000.0, (os_GetSeconds() - start) * 1000.0, size);
+}
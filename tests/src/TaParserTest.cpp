@@ -0,0 +1,214 @@
+#include "gtest/gtest.h"
+#include "types.h"
+#include "hw/pvr/ta.h"
+#include "hw/pvr/ta_ctx.h"
+#include "hw/pvr/ta_structs.h"
+#include "cfg/option.h"
+#include "oslib/oslib.h"
+
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+class TaParserTest : public ::testing::Test {
+protected:
+	void SetUp() override
+	{
+		savedRenderer = (RenderType)config::RendererType;
+		// RGBA vertex colors
+		config::RendererType = RenderType::OpenGL;
+		ctx.Alloc();
+		ta_ctx = &ctx;
+		ta_parse_reset();
+	}
+
+	void TearDown() override
+	{
+		ta_ctx = nullptr;
+		config::RendererType = savedRenderer;
+	}
+
+	static u32 f(float v) {
+		u32 u;
+		memcpy(&u, &v, sizeof(u));
+		return u;
+	}
+
+	void polyParam(u32 listType, u8 objCtrl)
+	{
+		PCW pcw{};
+		pcw.ParaType = ParamType_Polygon_or_Modifier_Volume;
+		pcw.ListType = listType;
+		pcw.obj_ctrl = objCtrl;
+		block({ pcw.full });
+		if ((TaTypeLut::instance().table[objCtrl] >> 30) == SZ64)
+			block({});
+	}
+
+	void vertex(bool endOfStrip, std::initializer_list<u32> words)
+	{
+		PCW pcw{};
+		pcw.ParaType = ParamType_Vertex_Parameter;
+		pcw.EndOfStrip = endOfStrip;
+		std::vector<u32> v { pcw.full };
+		v.insert(v.end(), words);
+		v.resize(words.size() <= 7 ? 8 : 16);
+		stream.insert(stream.end(), v.begin(), v.end());
+	}
+
+	void endList()
+	{
+		PCW pcw{};
+		pcw.ParaType = ParamType_End_Of_List;
+		block({ pcw.full });
+	}
+
+	void block(std::initializer_list<u32> words)
+	{
+		std::vector<u32> v(words);
+		v.resize(8);
+		stream.insert(stream.end(), v.begin(), v.end());
+	}
+
+	// Sends the TA stream in chunks of the given size
+	void parse(u32 chunkSize = 0)
+	{
+		ctx.rend.Clear();
+		ta_parse_reset();
+		const u32 size = stream.size() * 4;
+		if (chunkSize == 0)
+			chunkSize = size;
+		for (u32 offset = 0; offset < size; offset += chunkSize)
+		{
+			const u32 len = std::min(chunkSize, size - offset);
+			for (u32 done = 0; done < len; )
+				done += ta_add_ta_data(&stream[(offset + done) / 4], len - done);
+		}
+	}
+
+	const Vertex& vtx(int i) {
+		// the first 4 vertices are for the background polygon
+		return ctx.rend.verts[4 + i];
+	}
+
+	TA_context ctx;
+	RenderType savedRenderer;
+	std::vector<u32> stream;
+};
+
+TEST_F(TaParserTest, PackedColor)
+{
+	// Textured, Packed Color
+	polyParam(ListType_Opaque, 0x08);
+	vertex(false, { f(1.f), f(2.f), f(0.5f), f(0.25f), f(0.75f), 0x80402010, 0x01020304 });
+	vertex(false, { f(3.f), f(4.f), f(2.f), f(0.f), f(1.f), 0xff000000, 0 });
+	vertex(true, { f(5.f), f(6.f), f(0.1f), f(1.f), f(0.f), 0x00ffffff, 0xffffffff });
+	endList();
+	parse();
+
+	ASSERT_EQ(4u + 3u, ctx.rend.verts.size());
+	ASSERT_EQ(2u, ctx.rend.global_param_op.size());
+	const PolyParam& pp = ctx.rend.global_param_op[1];
+	ASSERT_EQ(4u, pp.first);
+	ASSERT_EQ(3u, pp.count);
+
+	const Vertex& v = vtx(0);
+	ASSERT_EQ(1.f, v.x);
+	ASSERT_EQ(2.f, v.y);
+	ASSERT_EQ(0.5f, v.z);
+	ASSERT_EQ(0.25f, v.u);
+	ASSERT_EQ(0.75f, v.v);
+	const u8 col[] = { 0x40, 0x20, 0x10, 0x80 };
+	ASSERT_EQ(0, memcmp(col, v.col, 4));
+	const u8 spc[] = { 0x02, 0x03, 0x04, 0x01 };
+	ASSERT_EQ(0, memcmp(spc, v.spc, 4));
+	ASSERT_EQ(0.f, v.u1);
+	ASSERT_EQ(0xff, vtx(1).col[3]);
+	ASSERT_EQ(0xff, vtx(2).col[0]);
+	ASSERT_EQ(0, vtx(2).col[3]);
+	ASSERT_EQ(2.f, ctx.rend.fZ_max);
+}
+
+TEST_F(TaParserTest, FloatColor)
+{
+	// Non-Textured, Floating Color
+	polyParam(ListType_Translucent, 0x10);
+	vertex(false, { f(1.f), f(2.f), f(1.f), f(1.f), f(0.5f), f(0.f), f(0.25f) });
+	vertex(true, { f(1.f), f(2.f), f(1.f), f(-1.f), f(2.f), f(NAN), f(INFINITY) });
+	endList();
+	parse();
+
+	ASSERT_EQ(4u + 2u, ctx.rend.verts.size());
+	ASSERT_EQ(1u, ctx.rend.global_param_tr.size());
+	const u8 col0[] = { 127, 0, 63, 255 };
+	ASSERT_EQ(0, memcmp(col0, vtx(0).col, 4));
+	const u8 col1[] = { 255, 255, 255, 0 };
+	ASSERT_EQ(0, memcmp(col1, vtx(1).col, 4));
+}
+
+TEST_F(TaParserTest, Split64BVertex)
+{
+	// Textured, Floating Color: 64-byte vertices
+	polyParam(ListType_Opaque, 0x18);
+	for (int i = 0; i < 5; i++)
+		vertex(i == 4, { f(i), f(i * 2.f), f(1.f / (i + 1)), f(0.5f), f(0.25f), 0, 0,
+				f(1.f), f(i / 4.f), f(0.5f), f(0.f), f(0.f), f(1.f), f(1.f), f(1.f) });
+	endList();
+	parse();
+	ASSERT_EQ(4u + 5u, ctx.rend.verts.size());
+	std::vector<Vertex> reference(ctx.rend.verts.begin() + 4, ctx.rend.verts.end());
+	ASSERT_EQ(255, reference[4].col[0]);
+	ASSERT_EQ(127, reference[1].col[1]);
+	ASSERT_EQ(255, reference[1].spc[0]);
+	ASSERT_EQ(0, reference[1].spc[3]);
+	ASSERT_EQ(0.5f, reference[3].u);
+
+	// Vertex halves received separately
+	for (u32 chunk : { 32u, 96u })
+	{
+		parse(chunk);
+		ASSERT_EQ(4u + 5u, ctx.rend.verts.size()) << "chunk " << chunk;
+		ASSERT_EQ(0, memcmp(reference.data(), &vtx(0), reference.size() * sizeof(Vertex))) << "chunk " << chunk;
+		ASSERT_EQ(2u, ctx.rend.global_param_op.size());
+		ASSERT_EQ(5u, ctx.rend.global_param_op[1].count);
+	}
+}
+
+// Run with --gtest_also_run_disabled_tests
+TEST_F(TaParserTest, DISABLED_Throughput)
+{
+	// A frame with the most common vertex types, in strips of 16 vertices
+	const u8 objCtrls[] = {
+		0x00,	// Non-Textured, Packed Color
+		0x08,	// Textured, Packed Color
+		0x09,	// Textured, Packed Color, 16bit UV
+		0x10,	// Non-Textured, Floating Color
+		0x18,	// Textured, Floating Color
+		0x28,	// Textured, Intensity
+	};
+	size_t vertexCount = 0;
+	for (int poly = 0; poly < 1000; poly++)
+	{
+		polyParam(ListType_Opaque, objCtrls[poly % std::size(objCtrls)]);
+		const bool vtx64 = objCtrls[poly % std::size(objCtrls)] == 0x18;
+		for (int i = 0; i < 16; i++)
+		{
+			const float c = (i % 5) / 4.f;
+			if (vtx64)
+				vertex(i == 15, { f(i), f(poly), f(1.f / (i + 1)), f(0.5f), f(0.5f), 0, 0,
+						f(1.f), f(c), f(c), f(c), f(0.f), f(c), f(c), f(c) });
+			else
+				vertex(i == 15, { f(i), f(poly), f(1.f / (i + 1)), f(c), f(c), f(c), f(c) });
+		}
+		vertexCount += 16;
+	}
+	endList();
+
+	const int frames = 200;
+	double start = os_GetSeconds();
+	for (int i = 0; i < frames; i++)
+		parse();
+	double duration = os_GetSeconds() - start;
+	ASSERT_EQ(4 + vertexCount, ctx.rend.verts.size());
+	printf("%.1f Mvertices/s, %.1f us/frame\n", vertexCount * frames / duration / 1e6, duration / frames * 1e6);
+}
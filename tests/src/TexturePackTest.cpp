@@ -0,0 +1,143 @@
+#include "gtest/gtest.h"
+#include "types.h"
+#include "rend/texture_pack.h"
+#include "oslib/oslib.h"
+#include <stb_image_write.h>
+
+#include <cstdio>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+class TexturePackTest : public ::testing::Test {
+protected:
+	void SetUp() override
+	{
+		// A few random images with different sizes
+		std::mt19937 rng(42);
+		const int sizes[][2] = { { 8, 8 }, { 64, 32 }, { 3, 5 }, { 128, 128 } };
+		u32 hash = 0x12345678;
+		for (const auto& size : sizes)
+		{
+			Image image;
+			image.width = size[0];
+			image.height = size[1];
+			image.pixels.resize(image.width * image.height * 4);
+			for (u8& b : image.pixels)
+				b = (u8)rng();
+			std::string path = "texpack_test_" + std::to_string(files.size()) + ".png";
+			stbi_flip_vertically_on_write(0);
+			ASSERT_NE(0, stbi_write_png(path.c_str(), image.width, image.height, 4, image.pixels.data(), 0));
+			files[hash] = path;
+			images[hash] = image;
+			hash = hash * 3 + 0x1001;
+		}
+		// Not an image
+		FILE *f = nowide::fopen("texpack_test_bad.png", "wb");
+		ASSERT_NE(nullptr, f);
+		std::fputs("not a png", f);
+		std::fclose(f);
+		files[0x0bad] = "texpack_test_bad.png";
+	}
+
+	void TearDown() override
+	{
+		for (const auto& it : files)
+			nowide::remove(it.second.c_str());
+		nowide::remove(path.c_str());
+	}
+
+	struct Image {
+		int width = 0;
+		int height = 0;
+		std::vector<u8> pixels;
+	};
+	std::map<u32, std::string> files;
+	std::map<u32, Image> images;
+	const std::string path = "texpack_test.fctex";
+};
+
+TEST_F(TexturePackTest, CreateOpen)
+{
+	std::atomic<bool> cancel { false };
+	ASSERT_TRUE(TexturePack::create(path, files, cancel));
+	TexturePack pack;
+	ASSERT_TRUE(pack.open(path, TexturePack::sourceHash(files)));
+	ASSERT_EQ(images.size(), pack.size());
+	for (const auto& it : images)
+	{
+		const Image& image = it.second;
+		int width, height;
+		const u8 *pixels = pack.find(it.first, width, height);
+		ASSERT_NE(nullptr, pixels);
+		ASSERT_EQ(image.width, width);
+		ASSERT_EQ(image.height, height);
+		ASSERT_EQ(0u, (uintptr_t)pixels % 16);
+		// Stored flipped vertically
+		const int stride = width * 4;
+		for (int y = 0; y < height; y++)
+			ASSERT_EQ(0, memcmp(&image.pixels[y * stride], pixels + (height - 1 - y) * stride, stride)) << "line " << y;
+	}
+	int width, height;
+	ASSERT_EQ(nullptr, pack.find(0x0bad, width, height));
+	ASSERT_EQ(nullptr, pack.find(0, width, height));
+	ASSERT_EQ(nullptr, pack.find(0xffffffff, width, height));
+	pack.close();
+	ASSERT_FALSE(pack.isOpen());
+}
+
+TEST_F(TexturePackTest, Cancel)
+{
+	std::atomic<bool> cancel { true };
+	ASSERT_FALSE(TexturePack::create(path, files, cancel));
+	TexturePack pack;
+	ASSERT_FALSE(pack.open(path, TexturePack::sourceHash(files)));
+}
+
+TEST_F(TexturePackTest, Invalid)
+{
+	TexturePack pack;
+	ASSERT_FALSE(pack.open(path, TexturePack::sourceHash(files)));
+	ASSERT_FALSE(pack.open(files[0x0bad], TexturePack::sourceHash(files)));
+	ASSERT_FALSE(pack.isOpen());
+
+	// Truncated pack
+	std::atomic<bool> cancel { false };
+	ASSERT_TRUE(TexturePack::create(path, files, cancel));
+	FILE *f = nowide::fopen(path.c_str(), "rb");
+	ASSERT_NE(nullptr, f);
+	std::vector<u8> data(1024);
+	data.resize(std::fread(data.data(), 1, data.size(), f));
+	std::fclose(f);
+	f = nowide::fopen(path.c_str(), "wb");
+	ASSERT_NE(nullptr, f);
+	std::fwrite(data.data(), 1, data.size(), f);
+	std::fclose(f);
+	ASSERT_FALSE(pack.open(path, TexturePack::sourceHash(files)));
+}
+
+TEST_F(TexturePackTest, OutOfDate)
+{
+	std::atomic<bool> cancel { false };
+	ASSERT_TRUE(TexturePack::create(path, files, cancel));
+	TexturePack pack;
+	ASSERT_TRUE(pack.open(path, TexturePack::sourceHash(files)));
+
+	// An image has been removed
+	std::map<u32, std::string> newFiles = files;
+	newFiles.erase(0x0bad);
+	ASSERT_FALSE(pack.open(path, TexturePack::sourceHash(newFiles)));
+	ASSERT_FALSE(pack.isOpen());
+
+	// An image has been replaced
+	FILE *f = nowide::fopen(files[0x0bad].c_str(), "wb");
+	ASSERT_NE(nullptr, f);
+	std::fputs("still not a png", f);
+	std::fclose(f);
+	ASSERT_FALSE(pack.open(path, TexturePack::sourceHash(files)));
+
+	// Rebuilt
+	ASSERT_TRUE(TexturePack::create(path, files, cancel));
+	ASSERT_TRUE(pack.open(path, TexturePack::sourceHash(files)));
+}
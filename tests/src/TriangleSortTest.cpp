@@ -0,0 +1,219 @@
+#include "gtest/gtest.h"
+#include "types.h"
+#include "hw/pvr/ta_ctx.h"
+#include "oslib/oslib.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+class TriangleSortTest : public ::testing::Test {
+protected:
+	void SetUp() override
+	{
+		ctx.Clear();
+		ctx.global_param_tr.clear();
+	}
+
+	// Translucent strips. Polygons with the same texture are equivalent and can be merged.
+	void makeFrame(int stripCount, int stripSize, int textures, std::mt19937& rng)
+	{
+		ctx.Clear();
+		std::uniform_real_distribution<float> dist(0.f, 1.f);
+		for (int i = 0; i < stripCount; i++)
+		{
+			PolyParam pp;
+			pp.init();
+			pp.first = ctx.verts.size();
+			pp.count = stripSize;
+			pp.tcw.full = rng() % textures;
+			pp.isp.CullMode = rng() % 4;
+			ctx.global_param_tr.push_back(pp);
+			const float x = dist(rng) * 640.f;
+			const float y = dist(rng) * 480.f;
+			for (int v = 0; v < stripSize; v++)
+			{
+				Vertex vtx{};
+				vtx.x = x + (v & 1) * 8.f;
+				vtx.y = y + (v / 2) * 8.f;
+				// Some ties
+				vtx.z = rng() % 8 == 0 ? 1.f : dist(rng);
+				ctx.verts.push_back(vtx);
+			}
+		}
+		ctx.render_passes.clear();
+		RenderPass pass{};
+		pass.autosort = true;
+		pass.tr_count = ctx.global_param_tr.size();
+		ctx.render_passes.push_back(pass);
+	}
+
+	void moveParticles(float amount, std::mt19937& rng)
+	{
+		std::uniform_real_distribution<float> dist(-amount, amount);
+		for (size_t i = 4; i < ctx.verts.size(); i++)
+			ctx.verts[i].z += dist(rng);
+	}
+
+	void sort()
+	{
+		ctx.idx.clear();
+		ctx.sortedTriangles.clear();
+		RenderPass previousPass{};
+		sortTriangles(ctx, ctx.render_passes[0], previousPass);
+	}
+
+	// stable_sort on the minimum z of each triangle, then merge of equivalent polygons
+	void referenceSort(std::vector<u32>& idx, std::vector<SortedTriangle>& sortedTriangles)
+	{
+		struct Triangle {
+			u32 vid[3];
+			u32 pid;
+			float z;
+		};
+		std::vector<Triangle> triangles;
+		for (u32 pid = 0; pid < ctx.global_param_tr.size(); pid++)
+		{
+			const PolyParam& pp = ctx.global_param_tr[pid];
+			for (u32 i = 2; i < pp.count; i++)
+			{
+				Triangle t;
+				t.pid = pid;
+				// v0 and v1 are swapped for odd triangles
+				t.vid[0] = pp.first + (i & 1 ? i - 1 : i - 2);
+				t.vid[1] = pp.first + (i & 1 ? i - 2 : i - 1);
+				t.vid[2] = pp.first + i;
+				if (std::any_of(std::begin(t.vid), std::end(t.vid), [this](u32 v) {
+					return std::isnan(ctx.verts[v].x) || std::fabs(ctx.verts[v].x) > 1e25f;
+				}))
+					continue;
+				t.z = std::min({ ctx.verts[t.vid[0]].z, ctx.verts[t.vid[1]].z, ctx.verts[t.vid[2]].z });
+				triangles.push_back(t);
+			}
+		}
+		std::stable_sort(triangles.begin(), triangles.end(), [](const Triangle& a, const Triangle& b) {
+			return a.z < b.z;
+		});
+		for (size_t k = 1; k < triangles.size(); k++)
+		{
+			const PolyParam& cur = ctx.global_param_tr[triangles[k].pid];
+			const PolyParam& prev = ctx.global_param_tr[triangles[k - 1].pid];
+			if (cur.equivalentIgnoreCullingDirection(prev) && (cur.isp.CullMode < 2 || cur.isp.CullMode == prev.isp.CullMode))
+				triangles[k].pid = triangles[k - 1].pid;
+		}
+		for (size_t k = 0; k < triangles.size(); k++)
+		{
+			if (k == 0 || triangles[k].pid != triangles[k - 1].pid)
+			{
+				if (!sortedTriangles.empty())
+					sortedTriangles.back().count = k * 3 - sortedTriangles.back().first;
+				sortedTriangles.push_back({ triangles[k].pid, (u32)k * 3, 0 });
+			}
+			idx.insert(idx.end(), std::begin(triangles[k].vid), std::end(triangles[k].vid));
+		}
+		if (!sortedTriangles.empty())
+			sortedTriangles.back().count = idx.size() - sortedTriangles.back().first;
+	}
+
+	void checkSorted()
+	{
+		std::vector<u32> idx;
+		std::vector<SortedTriangle> sortedTriangles;
+		referenceSort(idx, sortedTriangles);
+		ASSERT_EQ(idx, ctx.idx);
+		ASSERT_EQ(sortedTriangles.size(), ctx.sortedTriangles.size());
+		for (size_t i = 0; i < sortedTriangles.size(); i++)
+		{
+			ASSERT_EQ(sortedTriangles[i].polyIndex, ctx.sortedTriangles[i].polyIndex) << i;
+			ASSERT_EQ(sortedTriangles[i].first, ctx.sortedTriangles[i].first) << i;
+			ASSERT_EQ(sortedTriangles[i].count, ctx.sortedTriangles[i].count) << i;
+		}
+		ASSERT_EQ(ctx.sortedTriangles.size(), ctx.render_passes[0].sorted_tr_count);
+	}
+
+	rend_context ctx;
+};
+
+TEST_F(TriangleSortTest, Sort)
+{
+	std::mt19937 rng(42);
+	// Small and large enough for the radix sort
+	for (int strips : { 10, 1000 })
+	{
+		makeFrame(strips, 6, 4, rng);
+		// Invalid vertices and negative z
+		ctx.verts[4 + 7].x = NAN;
+		ctx.verts[4 + 20].x = 1e30f;
+		ctx.verts[4 + 30].z = -1.f;
+		ctx.verts[4 + 31].z = -0.f;
+		ctx.verts[4 + 32].z = 0.f;
+		sort();
+		checkSorted();
+	}
+	// No triangles
+	makeFrame(5, 2, 1, rng);
+	sort();
+	ASSERT_TRUE(ctx.idx.empty());
+	ASSERT_EQ(1u, ctx.sortedTriangles.size());
+	ASSERT_EQ(0u, ctx.sortedTriangles[0].count);
+}
+
+TEST_F(TriangleSortTest, Coherence)
+{
+	std::mt19937 rng(1234);
+	makeFrame(2000, 4, 8, rng);
+	sort();
+	checkSorted();
+	// Same triangles, slightly different order
+	for (int frame = 0; frame < 5; frame++)
+	{
+		moveParticles(0.00002f, rng);
+		sort();
+		checkSorted();
+	}
+	// Same triangles, random order
+	std::uniform_real_distribution<float> dist(0.f, 1.f);
+	for (size_t i = 4; i < ctx.verts.size(); i++)
+		ctx.verts[i].z = dist(rng);
+	sort();
+	checkSorted();
+	// Different triangles
+	ctx.global_param_tr.back().count--;
+	sort();
+	checkSorted();
+}
+
+// Run with --gtest_also_run_disabled_tests
+TEST_F(TriangleSortTest, DISABLED_Benchmark)
+{
+	// 20000 particles (quads)
+	std::mt19937 rng(42);
+	makeFrame(20000, 4, 16, rng);
+	const int frames = 100;
+	for (float speed : { 0.f, 0.00002f })
+	{
+		double duration = 0;
+		for (int i = 0; i < frames; i++)
+		{
+			moveParticles(speed, rng);
+			double start = os_GetSeconds();
+			sort();
+			duration += os_GetSeconds() - start;
+		}
+		printf("%s particles: %.1f us/frame\n", speed == 0.f ? "Static" : "Moving", duration / frames * 1e6);
+	}
+
+	// New particle positions every frame
+	std::uniform_real_distribution<float> dist(0.f, 1.f);
+	double duration = 0;
+	for (int i = 0; i < frames; i++)
+	{
+		for (size_t v = 4; v < ctx.verts.size(); v++)
+			ctx.verts[v].z = dist(rng);
+		double start = os_GetSeconds();
+		sort();
+		duration += os_GetSeconds() - start;
+	}
+	printf("Random particles: %.1f us/frame\n", duration / frames * 1e6);
+}
@@ -37,3 +37,17 @@ TEST_F(SerializeTest, SizeTest)
 
 
 
+
+TEST_F(SerializeTest, OverflowTest)
+{
+	Serializer dryrun;
+	dc_serialize(dryrun);
+
+	std::vector<char> data(1_MB);
+	Serializer ser(data.data(), data.size());
+	dc_serialize(ser);
+	ASSERT_TRUE(ser.overflow());
+	// Overflowing doesn't turn it into a dry run
+	ASSERT_FALSE(ser.dryrun());
+	ASSERT_EQ(dryrun.size(), ser.size());
+}